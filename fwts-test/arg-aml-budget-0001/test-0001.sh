@@ -0,0 +1,24 @@
+#!/bin/bash
+#
+TEST="Test --aml-budget rejects negative and malformed values"
+NAME=test-0001.sh
+TMPLOG=$TMP/aml-budget.log.$$
+
+rm -f $TMPLOG
+for arg in "1000000" "1000000,5000" "-5" " -5" "-5,10" "5,-10" "5, -10" "5,x" "x" ""
+do
+	echo "--aml-budget=\"$arg\"" >> $TMPLOG
+	$FWTS --aml-budget="$arg" --show-tests > /dev/null 2>> $TMPLOG
+	echo "returned $?" >> $TMPLOG
+done
+
+diff $TMPLOG $FWTSTESTDIR/arg-aml-budget-0001/aml-budget-0001.log >> $FAILURE_LOG
+ret=$?
+if [ $ret -eq 0 ]; then
+	echo PASSED: $TEST, $NAME
+else
+	echo FAILED: $TEST, $NAME
+fi
+
+rm $TMPLOG
+exit $ret
@@ -0,0 +1,29 @@
+#!/bin/bash
+#
+TEST="Test --region-replay serves OpRegion reads from a trace"
+NAME=test-0001.sh
+TMPLOG=$TMP/region-replay.log.$$
+HERE=$FWTSTESTDIR/arg-region-replay-0001
+
+$FWTS --show-tests | grep method > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+#
+#  Each _HID returns a field of the same OpRegion: a traced dword, a
+#  dword built from traced bytes, the second value of the traced dword
+#  and a dword that is not traced at all
+#
+$FWTS --log-format="%line %owner " -w 80 -j $FWTSTESTDIR/../data --dumpfile=$HERE/acpidump-0001.log --region-replay=$HERE/trace-0001.log method - | cut -c7- | sed -n -e '/Test _HID/,/^method *$/p' -e '/OpRegion reads/,/fake values/p' > $TMPLOG
+diff $TMPLOG $HERE/region-replay-0001.log >> $FAILURE_LOG
+ret=$?
+if [ $ret -eq 0 ]; then
+	echo PASSED: $TEST, $NAME
+else
+	echo FAILED: $TEST, $NAME
+fi
+
+rm $TMPLOG
+exit $ret
@@ -0,0 +1,57 @@
+#!/bin/bash
+#
+NAME=test-0003.sh
+
+TMPLOG=$TMP/syntaxcheck.log.$$
+HERE=$FWTSTESTDIR/syntaxcheck-0001
+
+$FWTS --show-tests | grep syntaxcheck > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+#
+#  Keep the iasl cache out of the user's home directory
+#
+CACHE=$(mktemp -d $TMP/syntaxcheck-cache.XXXXXX)
+export HOME=$CACHE
+export XDG_CACHE_HOME=$CACHE/cache
+
+failed=0
+for I in 0001 0002
+do
+	ARGS="--dumpfile=$HERE/acpidump-$I.log"
+	if [ $I = 0002 ]; then
+		ARGS="$ARGS --baseline-tables=$HERE/acpidump-$I-baseline.log"
+	fi
+	for JOBS in 1 4
+	do
+		rm -rf $XDG_CACHE_HOME
+		for CACHED in cold warm
+		do
+			TEST="Test syntaxcheck on acpidump-$I with $JOBS job(s) and a $CACHED iasl cache"
+			$FWTS --log-format="%line %owner " -w 80 -j $FWTSTESTDIR/../data $ARGS syntaxcheck --syntaxcheck-jobs=$JOBS - | grep "^[0-9]*[ ]*syntaxcheck" | cut -c7- > $TMPLOG
+			diff $TMPLOG $HERE/syntaxcheck-$I.log >> $FAILURE_LOG
+			if [ $? -eq 0 ]; then
+				echo PASSED: $TEST, $NAME
+			else
+				echo FAILED: $TEST, $NAME
+				failed=1
+			fi
+		done
+		#
+		#  The cold run should have filled the cache
+		#
+		TEST="Test syntaxcheck on acpidump-$I with $JOBS job(s) fills the iasl cache"
+		if [ -n "$(ls $XDG_CACHE_HOME/fwts/iasl 2> /dev/null)" ]; then
+			echo PASSED: $TEST, $NAME
+		else
+			echo FAILED: $TEST, $NAME
+			failed=1
+		fi
+	done
+done
+
+rm -rf $CACHE $TMPLOG
+exit $failed
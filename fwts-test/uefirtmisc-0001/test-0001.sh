@@ -0,0 +1,23 @@
+#!/bin/bash
+#
+TEST="Test uefirtmisc against the UEFI runtime services emulator"
+NAME=test-0001.sh
+TMPLOG=$TMP/uefirtmisc.log.$$
+
+$FWTS --show-tests | grep uefirtmisc > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+$FWTS --log-format="%line %owner " -w 80 -j $FWTSTESTDIR/../data --efi-emulator uefirtmisc - | cut -c7- | grep "^uefirtmisc" > $TMPLOG
+diff $TMPLOG $FWTSTESTDIR/uefirtmisc-0001/uefirtmisc-0001.log >> $FAILURE_LOG
+ret=$?
+if [ $ret -eq 0 ]; then
+	echo PASSED: $TEST, $NAME
+else
+	echo FAILED: $TEST, $NAME
+fi
+
+rm $TMPLOG
+exit $ret
@@ -0,0 +1,23 @@
+#!/bin/bash
+#
+TEST="Test uefirtvariable against the UEFI runtime services emulator"
+NAME=test-0001.sh
+TMPLOG=$TMP/uefirtvariable.log.$$
+
+$FWTS --show-tests | grep uefirtvariable > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+$FWTS --log-format="%line %owner " -w 80 -j $FWTSTESTDIR/../data --efi-emulator uefirtvariable - | cut -c7- | grep "^uefirtvariable" > $TMPLOG
+diff $TMPLOG $FWTSTESTDIR/uefirtvariable-0001/uefirtvariable-0001.log >> $FAILURE_LOG
+ret=$?
+if [ $ret -eq 0 ]; then
+	echo PASSED: $TEST, $NAME
+else
+	echo FAILED: $TEST, $NAME
+fi
+
+rm $TMPLOG
+exit $ret
@@ -0,0 +1,28 @@
+#!/bin/bash
+#
+TEST="Test the uefirtvariable capacity test with a store that reclaims when full"
+NAME=test-0003.sh
+TMPLOG=$TMP/uefirtvariable.log.$$
+
+$FWTS --show-tests | grep uefirtvariable > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+#
+#  Only keep the capacity test, without the timing dependent writes/s figures
+#
+$FWTS --log-format="%line %owner " -w 200 -j $FWTSTESTDIR/../data --efi-emulator=16384 --efi-emulator-reclaim=full --uefi-capacity-writes=5000 uefirtvariable - | \
+	cut -c7- | grep "^uefirtvariable" | sed -n '/Test 11 of 11/,/passed, .* failed/p' | \
+	grep -v "writes/s" | sed -E 's/^(uefirtvariable +[0-9]+ +[0-9]+ +-?[0-9]+) +[0-9]+$/\1/' > $TMPLOG
+diff $TMPLOG $FWTSTESTDIR/uefirtvariable-0001/uefirtvariable-0003.log >> $FAILURE_LOG
+ret=$?
+if [ $ret -eq 0 ]; then
+	echo PASSED: $TEST, $NAME
+else
+	echo FAILED: $TEST, $NAME
+fi
+
+rm $TMPLOG
+exit $ret
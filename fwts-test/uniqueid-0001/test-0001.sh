@@ -0,0 +1,23 @@
+#!/bin/bash
+#
+TEST="Test uniqueid sees _UID values changed by AML"
+NAME=test-0001.sh
+TMPLOG=$TMP/uniqueid.log.$$
+
+$FWTS --show-tests | grep uniqueid > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+$FWTS --log-format="%line %owner " -w 80 --dumpfile=$FWTSTESTDIR/uniqueid-0001/acpidump-0001.log uniqueid - | cut -c7- | grep "^uniqueid" > $TMPLOG
+diff $TMPLOG $FWTSTESTDIR/uniqueid-0001/uniqueid-0001.log >> $FAILURE_LOG
+ret=$?
+if [ $ret -eq 0 ]; then
+	echo PASSED: $TEST, $NAME
+else
+	echo FAILED: $TEST, $NAME
+fi
+
+rm $TMPLOG
+exit $ret
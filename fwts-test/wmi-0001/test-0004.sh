@@ -0,0 +1,51 @@
+#!/bin/bash
+#
+NAME=test-0004.sh
+
+TMPLOG=$TMP/wmi.log.$$
+SNAPSHOT=$TMP/wmi-snapshot.$$
+HERE=$FWTSTESTDIR/wmi-0001
+
+$FWTS --show-tests | grep wmi > /dev/null
+if [ $? -eq 1 ]; then
+	echo SKIP: $TEST, $NAME
+	exit 77
+fi
+
+failed=0
+for I in 0001 0002 0003
+do
+	rm -f $SNAPSHOT
+
+	#
+	#  The first run has no snapshot to load, so it initialises
+	#  ACPICA and writes the snapshot
+	#
+	TEST="Test wmi on acpidump-$I writes a namespace snapshot"
+	$FWTS --log-format="%line %owner " -w 80 --dumpfile=$HERE/acpidump-$I.log --namespace-snapshot=$SNAPSHOT wmi - | grep "^[0-9]*[ ]*wmi" | cut -c7- > $TMPLOG
+	diff $TMPLOG $HERE/wmi-$I.log >> $FAILURE_LOG
+	if [ $? -eq 0 ] && [ "$(head -c 8 $SNAPSHOT 2> /dev/null)" = "FWTSNSS1" ]; then
+		echo PASSED: $TEST, $NAME
+	else
+		echo FAILED: $TEST, $NAME
+		failed=1
+	fi
+
+	#
+	#  The second run loads the snapshot, it must not initialise
+	#  ACPICA, that would write the snapshot again
+	#
+	TEST="Test wmi on acpidump-$I from a namespace snapshot"
+	WRITTEN=$(stat -c %y $SNAPSHOT 2> /dev/null)
+	$FWTS --log-format="%line %owner " -w 80 --dumpfile=$HERE/acpidump-$I.log --namespace-snapshot=$SNAPSHOT wmi - | grep "^[0-9]*[ ]*wmi" | cut -c7- > $TMPLOG
+	diff $TMPLOG $HERE/wmi-$I.log >> $FAILURE_LOG
+	if [ $? -eq 0 ] && [ "$(stat -c %y $SNAPSHOT 2> /dev/null)" = "$WRITTEN" ]; then
+		echo PASSED: $TEST, $NAME
+	else
+		echo FAILED: $TEST, $NAME
+		failed=1
+	fi
+done
+
+rm -f $TMPLOG $SNAPSHOT
+exit $failed
@@ -227,8 +227,140 @@ static int cedt_test1(fwts_framework *fw)
 	return FWTS_OK;
 }
 
+typedef struct {
+	fwts_framework *fw;
+	bool passed;
+} cedt_overlap_info;
+
+/*
+ *  cedt_cfmws_overlap()
+ *	check a pair of overlapping address ranges where at
+ *	least one of them is a CXL fixed memory window
+ */
+static void cedt_cfmws_overlap(
+	const fwts_range *range1,
+	const fwts_range *range2,
+	void *private)
+{
+	cedt_overlap_info *info = (cedt_overlap_info *)private;
+	const fwts_range *cfmws, *other;
+
+	if (range1->source == FWTS_RANGE_CEDT_CFMWS) {
+		cfmws = range1;
+		other = range2;
+	} else if (range2->source == FWTS_RANGE_CEDT_CFMWS) {
+		cfmws = range2;
+		other = range1;
+	} else
+		return;
+
+	switch (other->source) {
+	case FWTS_RANGE_CEDT_CFMWS:
+		info->passed = false;
+		fwts_failed(info->fw, LOG_LEVEL_HIGH,
+			"CEDTCFMWSOverlap",
+			"CEDT CFMWS %" PRIu32 " window 0x%" PRIx64 "-0x%" PRIx64
+			" overlaps CFMWS %" PRIu32 " window 0x%" PRIx64 "-0x%" PRIx64 ".",
+			range1->id, range1->start, range1->last,
+			range2->id, range2->start, range2->last);
+		break;
+	case FWTS_RANGE_MEMORY_MAP:
+		if (other->type != FWTS_MEMORY_MAP_USABLE)
+			break;
+		info->passed = false;
+		fwts_failed(info->fw, LOG_LEVEL_LOW,
+			"CEDTCFMWSSystemRAM",
+			"CEDT CFMWS %" PRIu32 " window 0x%" PRIx64 "-0x%" PRIx64
+			" overlaps System RAM 0x%" PRIx64 "-0x%" PRIx64 " in the "
+			"%s, the window should only be used by CXL memory.",
+			cfmws->id, cfmws->start, cfmws->last,
+			other->start, other->last,
+			fwts_memory_map_name(info->fw->firmware_type));
+		break;
+	case FWTS_RANGE_NFIT_SPA:
+		info->passed = false;
+		fwts_failed(info->fw, LOG_LEVEL_MEDIUM,
+			"CEDTCFMWSOverlapNFIT",
+			"CEDT CFMWS %" PRIu32 " window 0x%" PRIx64 "-0x%" PRIx64
+			" overlaps NFIT SPA range %" PRIu32 " 0x%" PRIx64 "-0x%" PRIx64 ".",
+			cfmws->id, cfmws->start, cfmws->last,
+			other->id, other->start, other->last);
+		break;
+	case FWTS_RANGE_SRAT:
+		/* SRAT may describe CXL memory onlined by firmware, but not straddle windows */
+		if (other->start < cfmws->start || other->last > cfmws->last) {
+			info->passed = false;
+			fwts_failed(info->fw, LOG_LEVEL_LOW,
+				"CEDTCFMWSPartialSRAT",
+				"SRAT memory affinity range 0x%" PRIx64 "-0x%" PRIx64
+				" (proximity domain %" PRIu32 ") is only partly inside "
+				"CEDT CFMWS %" PRIu32 " window 0x%" PRIx64 "-0x%" PRIx64 ".",
+				other->start, other->last, other->domain,
+				cfmws->id, cfmws->start, cfmws->last);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ *  cedt_test2()
+ *	check the CXL fixed memory windows against each other and
+ *	the memory map, SRAT and NFIT address ranges
+ */
+static int cedt_test2(fwts_framework *fw)
+{
+	fwts_range_index *index;
+	fwts_list *memory_map = NULL;
+	cedt_overlap_info info = { .fw = fw, .passed = true };
+	size_t i, windows = 0;
+
+	if ((index = fwts_range_index_new()) == NULL) {
+		fwts_log_error(fw, "Cannot allocate address range index.");
+		return FWTS_ERROR;
+	}
+
+	/* The memory map is from this machine, so only use it for the live tables */
+	if (!fw->acpi_table_path && !fw->acpi_table_acpidump_file)
+		memory_map = fwts_memory_map_table_load(fw);
+	if (!memory_map)
+		fwts_log_info(fw, "No memory map available, not checking "
+			"CFMWS windows against System RAM.");
+
+	if (fwts_range_index_add_memory_map(index, memory_map) != FWTS_OK ||
+	    fwts_range_index_add_acpi(fw, index) != FWTS_OK ||
+	    fwts_range_index_build(index) != FWTS_OK) {
+		fwts_log_error(fw, "Cannot build address range index.");
+		fwts_memory_map_table_free(memory_map);
+		fwts_range_index_free(index);
+		return FWTS_ERROR;
+	}
+	fwts_memory_map_table_free(memory_map);
+
+	for (i = 0; i < index->count; i++)
+		if (index->ranges[i].source == FWTS_RANGE_CEDT_CFMWS)
+			windows++;
+
+	if (!windows) {
+		fwts_skipped(fw, "No CEDT CFMWS windows to check.");
+		fwts_range_index_free(index);
+		return FWTS_SKIP;
+	}
+
+	fwts_range_index_overlaps(index, cedt_cfmws_overlap, &info);
+	fwts_range_index_free(index);
+
+	if (info.passed)
+		fwts_passed(fw, "No overlapping address ranges found for "
+			"%zu CEDT CFMWS windows.", windows);
+
+	return FWTS_OK;
+}
+
 static fwts_framework_minor_test cedt_tests[] = {
 	{ cedt_test1, "Validate CEDT table." },
+	{ cedt_test2, "Check CEDT CFMWS windows against other address ranges." },
 	{ NULL, NULL }
 };
 
@@ -1374,33 +1374,28 @@ static void acpi_table_check_fadt_cst_cnt(fwts_framework *fw)
 static uint64_t fadt_find_p_blk(fwts_framework *fw)
 {
 	uint64_t pblk;
-	fwts_list *objects;
+	const fwts_acpica_nodes *nodes;
 
 	pblk = 0;
-	objects = fwts_acpi_object_get_names();
-	if (objects) {
-		fwts_list_link *obj;
+	nodes = fwts_acpi_object_get_nodes();
+	if (nodes) {
+		size_t i;
 
-		fwts_list_foreach(obj, objects) {
-			char *name = fwts_list_data(char*, obj);
+		for (i = 0; i < nodes->count; i++) {
+			const fwts_acpica_node *node = &nodes->nodes[i];
+			const char *name = nodes->strings + node->path;
 			ACPI_OBJECT pr = { 0 };
 			ACPI_BUFFER buf = { sizeof(ACPI_OBJECT), &pr };
 			ACPI_HANDLE handle;
 			ACPI_OBJECT_TYPE type;
 			ACPI_STATUS status;
 
-			status = AcpiGetHandle(NULL, name, &handle);
+			status = fwts_acpi_object_node_get(nodes, node, &handle, &type);
 			if (ACPI_FAILURE(status)) {
 				fwts_warning(fw, "Failed to get handle for "
 					     "object %s.", name);
 				continue;
 			}
-			status = AcpiGetType(handle, &type);
-			if (ACPI_FAILURE(status)) {
-				fwts_warning(fw, "Failed to get type for "
-					     "object %s.", name);
-				continue;
-			}
 
 			/*
 			 * If a CPU is not defined as a Processor object,
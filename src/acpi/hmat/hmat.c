@@ -26,6 +26,205 @@
 static fwts_acpi_table_info *table;
 acpi_table_init(HMAT, &table)
 
+static fwts_numa_domain *srat_domains;
+static uint32_t srat_domain_count;
+static bool srat_found;
+
+typedef struct {
+	const uint32_t *initiators;
+	const uint32_t *targets;
+	uint32_t *unreachable;		/* per target count of unreachable entries */
+	fwts_numa_bitmap *local;	/* unreachable entries of the same domain */
+} hmat_matrix_info;
+
+static int hmat_pd_cmp(const void *a, const void *b)
+{
+	const uint32_t pd1 = *(const uint32_t *)a;
+	const uint32_t pd2 = *(const uint32_t *)b;
+
+	if (pd1 < pd2)
+		return -1;
+	return pd1 > pd2;
+}
+
+/*
+ *  hmat_pd_list_test()
+ *	check a locality initiator or target proximity domain list
+ *	has no duplicates and that each domain is described by the SRAT
+ */
+static void hmat_pd_list_test(
+	fwts_framework *fw,
+	const uint32_t *pds,
+	const uint32_t count,
+	const bool initiator,
+	bool *passed)
+{
+	const char *name = initiator ? "Initiator" : "Target";
+	uint32_t *sorted, i;
+
+	if (!count)
+		return;
+
+	sorted = malloc(count * sizeof(*sorted));
+	if (sorted) {
+		memcpy(sorted, pds, count * sizeof(*sorted));
+		qsort(sorted, count, sizeof(*sorted), hmat_pd_cmp);
+		for (i = 1; i < count; i++) {
+			if (sorted[i] == sorted[i - 1] &&
+			    (i == 1 || sorted[i] != sorted[i - 2])) {
+				*passed = false;
+				fwts_failed(fw, LOG_LEVEL_MEDIUM,
+					initiator ? "HMATDuplicateInitiatorPD" : "HMATDuplicateTargetPD",
+					"HMAT %s Proximity Domain %" PRIu32 " is listed "
+					"more than once", name, sorted[i]);
+			}
+		}
+		free(sorted);
+	}
+
+	if (!srat_found)
+		return;
+
+	for (i = 0; i < count; i++) {
+		const fwts_numa_domain *domain =
+			fwts_numa_domain_find(srat_domains, srat_domain_count, pds[i]);
+
+		if (!domain) {
+			*passed = false;
+			fwts_failed(fw, LOG_LEVEL_MEDIUM,
+				initiator ? "HMATInitiatorNotInSRAT" : "HMATTargetNotInSRAT",
+				"HMAT %s Proximity Domain %" PRIu32 " is not an "
+				"enabled SRAT proximity domain", name, pds[i]);
+		} else if (initiator && !domain->initiator) {
+			*passed = false;
+			fwts_failed(fw, LOG_LEVEL_LOW,
+				"HMATInitiatorNotInitiatorDomain",
+				"HMAT Initiator Proximity Domain %" PRIu32 " has no "
+				"enabled SRAT processor or generic initiator affinity "
+				"structure", pds[i]);
+		}
+	}
+}
+
+/*
+ *  hmat_unreachable_run()
+ *	account for a run of unreachable entries [row][first..last]
+ */
+static void hmat_unreachable_run(
+	fwts_framework *fw,
+	const uint32_t row,
+	const uint32_t first,
+	const uint32_t last,
+	void *private)
+{
+	hmat_matrix_info *info = (hmat_matrix_info *)private;
+	uint32_t col;
+
+	FWTS_UNUSED(fw);
+
+	for (col = first; col <= last; col++) {
+		info->unreachable[col]++;
+		if (info->initiators[row] == info->targets[col])
+			fwts_numa_bitmap_set(info->local, row, col);
+	}
+}
+
+/*
+ *  hmat_local_run()
+ *	report a run of unreachable entries [row][first..last] where
+ *	the initiator and target are the same proximity domain
+ */
+static void hmat_local_run(
+	fwts_framework *fw,
+	const uint32_t row,
+	const uint32_t first,
+	const uint32_t last,
+	void *private)
+{
+	const hmat_matrix_info *info = (const hmat_matrix_info *)private;
+
+	fwts_failed(fw, LOG_LEVEL_MEDIUM,
+		"HMATLocalUnreachable",
+		"HMAT Entries[%" PRIu32 "][%" PRIu32 "..%" PRIu32 "] are 0xffff "
+		"(unreachable) but Initiator and Target are the same "
+		"Proximity Domain %" PRIu32, row, first, last,
+		info->initiators[row]);
+}
+
+/*
+ *  hmat_locality_matrix_test()
+ *	check the proximity domain lists and the latency or
+ *	bandwidth entries of a locality structure
+ */
+static void hmat_locality_matrix_test(
+	fwts_framework *fw,
+	const fwts_acpi_table_hmat_locality *entry,
+	bool *passed)
+{
+	const uint32_t ni = entry->num_initiator, nt = entry->num_target;
+	const uint32_t *initiators = (const uint32_t *)(entry + 1);
+	const uint32_t *targets = initiators + ni;
+	const uint16_t *matrix = (const uint16_t *)(targets + nt);
+	fwts_numa_bitmap unreachable, local;
+	hmat_matrix_info info;
+	uint32_t j, reported = 0;
+
+	/* pd_size is 32 bit, make sure the lists and matrix really fit */
+	if (((uint64_t)ni + nt) * 4 + ((uint64_t)ni * nt * 2) !=
+	    entry->header.length - sizeof(fwts_acpi_table_hmat_locality))
+		return;
+
+	hmat_pd_list_test(fw, initiators, ni, true, passed);
+	hmat_pd_list_test(fw, targets, nt, false, passed);
+
+	if (!ni || !nt)
+		return;
+
+	if (fwts_numa_hmat_unreachable(matrix, ni, nt, &unreachable) != FWTS_OK)
+		return;
+	if (!unreachable.count) {
+		fwts_numa_bitmap_free(&unreachable);
+		return;
+	}
+	if (fwts_numa_bitmap_init(&local, ni, nt) != FWTS_OK) {
+		fwts_numa_bitmap_free(&unreachable);
+		return;
+	}
+	info.initiators = initiators;
+	info.targets = targets;
+	info.local = &local;
+	info.unreachable = calloc(nt, sizeof(*info.unreachable));
+	if (!info.unreachable)
+		goto done;
+
+	fwts_numa_bitmap_runs(fw, &unreachable, UINT32_MAX, hmat_unreachable_run, &info);
+	fwts_log_info(fw, "HMAT Type 1 has %" PRIu64 " of %" PRIu64 " entries "
+		"set to 0xffff (unreachable).", unreachable.count,
+		(uint64_t)ni * nt);
+
+	if (local.count) {
+		*passed = false;
+		/* Report first 16 runs of errors */
+		fwts_numa_bitmap_runs(fw, &local, 16, hmat_local_run, &info);
+	}
+
+	for (j = 0; j < nt; j++) {
+		if (info.unreachable[j] == ni) {
+			*passed = false;
+			if (reported++ < 16)
+				fwts_failed(fw, LOG_LEVEL_LOW,
+					"HMATTargetUnreachable",
+					"HMAT Target Proximity Domain %" PRIu32 " is "
+					"unreachable (0xffff) from all Initiator "
+					"Proximity Domains", targets[j]);
+		}
+	}
+	free(info.unreachable);
+done:
+	fwts_numa_bitmap_free(&local);
+	fwts_numa_bitmap_free(&unreachable);
+}
+
 static void hmat_proximity_domain_test(
 	fwts_framework *fw,
 	const fwts_acpi_table_hmat_proximity_domain *entry,
@@ -99,7 +298,9 @@ static void hmat_locality_test(
 		fwts_failed(fw, LOG_LEVEL_LOW,
 			"HMATBadNumProximityDomain",
 			"HMAT length does not match to the number of Proximity Domains ");
-	}
+	} else if ((const uint8_t *)entry + entry->header.length <=
+		   (const uint8_t *)table->data + table->length)
+		hmat_locality_matrix_test(fw, entry, passed);
 
 	if (!entry->entry_base_unit) {
 		*passed = false;
@@ -163,6 +364,10 @@ static int hmat_test1(fwts_framework *fw)
 
 	fwts_acpi_reserved_zero("HMAT", "Reserved", hmat->reserved, &passed);
 
+	srat_found = fwts_numa_srat_domains(fw, &srat_domains, &srat_domain_count) == FWTS_OK;
+	if (!srat_found)
+		fwts_log_info(fw, "No SRAT table, skipping HMAT proximity domain checks.");
+
 	entry = (fwts_acpi_table_hmat_header *) (table->data + sizeof(fwts_acpi_table_hmat));
 	offset = sizeof(fwts_acpi_table_hmat);
 	while (offset < table->length) {
@@ -209,6 +414,10 @@ static int hmat_test1(fwts_framework *fw)
 
 	fwts_log_nl(fw);
 
+	free(srat_domains);
+	srat_domains = NULL;
+	srat_domain_count = 0;
+
 	if (passed)
 		fwts_passed(fw, "No issues found in HMAT table.");
 
@@ -306,7 +306,7 @@ static ACPI_STATUS madt_processor_handler(ACPI_HANDLE ObjHandle, uint32_t level,
 		listint->value = obj.Processor.ProcId;
 		break;
 	case ACPI_TYPE_DEVICE:
-		status = AcpiEvaluateObject(ObjHandle, "_UID", NULL, &buf);
+		status = fwts_acpi_object_cache_evaluate(ObjHandle, "_UID", &buf);
 		if (ACPI_FAILURE(status)) {
 			free(listint);
 			return status;
@@ -1813,7 +1813,7 @@ static int madt_deinit(fwts_framework *fw)
 	/* only minor clean up needed */
 	fwts_list_free_items(&msi_frame_ids, NULL);
 	fwts_list_free_items(&its_ids, NULL);
-	fwts_list_free_items(&processor_uids, NULL);
+	fwts_list_free_items(&processor_uids, free);
 
 	return (fw) ? FWTS_ERROR : FWTS_OK;
 }
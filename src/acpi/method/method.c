@@ -26,7 +26,10 @@
 #include <signal.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
+#include <sys/wait.h>
 #include "fwts_acpi_object_eval.h"
 
 /*
@@ -271,8 +274,12 @@
 #define DEVICE_D3HOT	3
 #define DEVICE_D3COLD	4
 
+#define METHOD_JOBS_MAX		(64)	/* Maximum --method-jobs workers */
+#define METHOD_JOBS_MIN_OBJECTS	(8)	/* Objects per worker worth a fork */
+
 static bool fadt_mobile_platform;	/* True if a mobile platform */
 static uint32_t gcp_return_value;
+static int method_jobs;			/* --method-jobs, 0 = evaluate serially */
 
 #define method_test_integer(name, type)				\
 static int method_test ## name(fwts_framework *fw)		\
@@ -383,6 +390,171 @@ void method_evaluate_found_method(
 	}
 }
 
+/*
+ *  method_evaluate_worker()
+ *	evaluate a slice of objects in a forked child, results are
+ *	captured and written to fd for the parent to replay
+ */
+static void method_evaluate_worker(
+	fwts_framework *fw,
+	const int fd,
+	char **names,
+	const size_t start,
+	const size_t end,
+	fwts_method_return check_func,
+	void *private,
+	ACPI_OBJECT *args,
+	int num_args)
+{
+	ACPI_OBJECT_LIST arg_list;
+	size_t i;
+
+	fwts_acpica_fork_child();
+	fwts_log_capture_start(fd);
+
+	arg_list.Count   = num_args;
+	arg_list.Pointer = args;
+	for (i = start; i < end; i++)
+		method_evaluate_found_method(fw, names[i],
+			check_func, private, &arg_list);
+
+	_exit(fwts_log_capture_stop() == FWTS_OK ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*
+ *  method_evaluate_parallel()
+ *	evaluate objects in forked workers that each get a copy on write
+ *	copy of the namespace and a contiguous slice of the objects.
+ *	Results are replayed in worker order so the log is the same as
+ *	for a serial run. Returns FWTS_ERROR if nothing was evaluated
+ *	and the caller should evaluate the objects itself.
+ */
+static int method_evaluate_parallel(
+	fwts_framework *fw,
+	char **names,
+	const size_t count,
+	fwts_method_return check_func,
+	void *private,
+	ACPI_OBJECT *args,
+	int num_args)
+{
+	struct pollfd pfds[METHOD_JOBS_MAX];
+	pid_t pids[METHOD_JOBS_MAX];
+	uint8_t *data[METHOD_JOBS_MAX];
+	size_t data_len[METHOD_JOBS_MAX], data_size[METHOD_JOBS_MAX];
+	size_t workers = count / METHOD_JOBS_MIN_OBJECTS;
+	size_t i, running;
+
+	if (workers > (size_t)method_jobs)
+		workers = (size_t)method_jobs;
+	if (workers < 2)
+		return FWTS_ERROR;
+
+	fwts_acpica_fork_prepare();
+	fflush(NULL);
+
+	for (i = 0; i < workers; i++) {
+		int fds[2];
+
+		if (pipe(fds) < 0)
+			break;
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			close(fds[0]);
+			close(fds[1]);
+			break;
+		}
+		if (pids[i] == 0) {
+			size_t j;
+
+			for (j = 0; j < i; j++)
+				close(pfds[j].fd);
+			close(fds[0]);
+			method_evaluate_worker(fw, fds[1], names,
+				count * i / workers, count * (i + 1) / workers,
+				check_func, private, args, num_args);
+		}
+		close(fds[1]);
+		pfds[i].fd = fds[0];
+		pfds[i].events = POLLIN;
+		data[i] = NULL;
+		data_len[i] = 0;
+		data_size[i] = 0;
+	}
+
+	/* Could not start them all, reap what we have and go serial */
+	if (i < workers) {
+		workers = i;
+		for (i = 0; i < workers; i++) {
+			kill(pids[i], SIGKILL);
+			close(pfds[i].fd);
+			(void)waitpid(pids[i], NULL, 0);
+		}
+		return FWTS_ERROR;
+	}
+
+	/* Drain all the workers so none of them block on a full pipe */
+	for (running = workers; running; ) {
+		if (poll(pfds, workers, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			/* Cannot drain them, stop those that may block writing */
+			for (i = 0; i < workers; i++)
+				if (pfds[i].fd >= 0)
+					kill(pids[i], SIGKILL);
+			break;
+		}
+		for (i = 0; i < workers; i++) {
+			ssize_t n;
+
+			if (pfds[i].fd < 0 || !pfds[i].revents)
+				continue;
+			if (data_size[i] - data_len[i] < 4096) {
+				uint8_t *tmp = realloc(data[i], data_size[i] + 65536);
+
+				if (tmp) {
+					data[i] = tmp;
+					data_size[i] += 65536;
+				}
+			}
+			if (data_size[i] - data_len[i] < 4096)
+				n = 0;	/* Out of memory, drop the rest */
+			else {
+				n = read(pfds[i].fd, data[i] + data_len[i],
+					data_size[i] - data_len[i]);
+				if (n < 0 && errno == EINTR)
+					continue;
+			}
+			if (n <= 0) {
+				close(pfds[i].fd);
+				pfds[i].fd = -1;
+				running--;
+			} else
+				data_len[i] += (size_t)n;
+		}
+	}
+
+	for (i = 0; i < workers; i++) {
+		int status = 0;
+
+		if (pfds[i].fd >= 0)
+			close(pfds[i].fd);
+		(void)waitpid(pids[i], &status, 0);
+
+		if (fwts_log_capture_replay(fw, data[i], data_len[i]) != FWTS_OK ||
+		    !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+			const size_t end = count * (i + 1) / workers;
+
+			fwts_aborted(fw, "Worker evaluating %s to %s did not "
+				"complete, some results may be missing.",
+				names[count * i / workers], names[end - 1]);
+		}
+		free(data[i]);
+	}
+
+	return FWTS_OK;
+}
+
 /*
  *  method_evaluate_method
  *	find all matching object names and evaluate them,
@@ -397,16 +569,21 @@ static int method_evaluate_method(fwts_framework *fw,
 	fwts_method_return check_func,
 	void *private)
 {
-	fwts_list *methods;
+	const fwts_acpica_nodes *nodes;
 	size_t name_len = strlen(name);
 	bool found = false;
+	char **names = NULL;
+	size_t count = 0;
 
+	if ((nodes = fwts_acpi_object_get_nodes()) != NULL) {
+		size_t i;
 
-	if ((methods = fwts_acpi_object_get_names()) != NULL) {
-		fwts_list_link	*item;
+		if (method_jobs > 1)
+			names = calloc(nodes->count, sizeof(char *));
 
-		fwts_list_foreach(item, methods) {
-			char *method_name = fwts_list_data(char*, item);
+		for (i = 0; i < nodes->count; i++) {
+			const fwts_acpica_node *node = &nodes->nodes[i];
+			char *method_name = nodes->strings + node->path;
 			ACPI_HANDLE method_handle;
 			ACPI_OBJECT_TYPE type;
 			ACPI_STATUS status;
@@ -415,21 +592,20 @@ static int method_evaluate_method(fwts_framework *fw,
 			if (strncmp(name, method_name + len - name_len, name_len) == 0) {
 				ACPI_OBJECT_LIST  arg_list;
 
-				status = AcpiGetHandle (NULL, method_name, &method_handle);
+				status = fwts_acpi_object_node_get(nodes, node, &method_handle, &type);
 				if (ACPI_FAILURE(status)) {
 					fwts_warning(fw, "Failed to get handle for object %s.", name);
 					continue;
 				}
-				status = AcpiGetType(method_handle, &type);
-				if (ACPI_FAILURE(status)) {
-					fwts_warning(fw, "Failed to get object type for %s.",name);
-					continue;
-				}
 
 				if (type == ACPI_TYPE_LOCAL_SCOPE)
 					continue;
 
 				found = true;
+				if (names) {
+					names[count++] = method_name;
+					continue;
+				}
 				arg_list.Count   = num_args;
 				arg_list.Pointer = args;
 				method_evaluate_found_method(fw, method_name,
@@ -438,6 +614,22 @@ static int method_evaluate_method(fwts_framework *fw,
 		}
 	}
 
+	/* Deferred for --method-jobs, evaluate in workers or serially */
+	if (names) {
+		if (method_evaluate_parallel(fw, names, count,
+		    check_func, private, args, num_args) != FWTS_OK) {
+			ACPI_OBJECT_LIST arg_list;
+			size_t i;
+
+			arg_list.Count   = num_args;
+			arg_list.Pointer = args;
+			for (i = 0; i < count; i++)
+				method_evaluate_found_method(fw, names[i],
+					check_func, private, &arg_list);
+		}
+		free(names);
+	}
+
 	if (found) {
 		if ((test_type & METHOD_MOBILE) && (!fadt_mobile_platform)) {
 			fwts_warning(fw,
@@ -5244,11 +5436,45 @@ static fwts_framework_minor_test method_tests[] = {
 	{ NULL, NULL }
 };
 
+static int method_options_handler(
+	fwts_framework *fw,
+	int argc,
+	char * const argv[],
+	int option_char,
+	int long_index)
+{
+	FWTS_UNUSED(fw);
+	FWTS_UNUSED(argc);
+	FWTS_UNUSED(argv);
+
+	if (option_char == 0) {
+		switch (long_index) {
+		case 0:	/* --method-jobs */
+			method_jobs = atoi(optarg);
+			if ((method_jobs < 0) || (method_jobs > METHOD_JOBS_MAX)) {
+				fprintf(stderr, "--method-jobs must be between 0 and %d.\n",
+					METHOD_JOBS_MAX);
+				return FWTS_ERROR;
+			}
+			break;
+		}
+	}
+
+	return FWTS_OK;
+}
+
+static fwts_option method_options[] = {
+	{ "method-jobs",	"", 1, "Evaluate objects in N forked workers, e.g. --method-jobs=8" },
+	{ NULL, NULL, 0, NULL }
+};
+
 static fwts_framework_ops method_ops = {
-	.description = "ACPI DSDT Method Semantic tests.",
-	.init        = method_init,
-	.deinit      = method_deinit,
-	.minor_tests = method_tests
+	.description     = "ACPI DSDT Method Semantic tests.",
+	.init            = method_init,
+	.deinit          = method_deinit,
+	.minor_tests     = method_tests,
+	.options         = method_options,
+	.options_handler = method_options_handler,
 };
 
 FWTS_REGISTER("method", &method_ops, FWTS_TEST_ANYTIME,
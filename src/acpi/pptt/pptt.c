@@ -22,9 +22,316 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <dirent.h>
+#include <ctype.h>
+
+#define PPTT_SYSFS_PATH		"/sys"
+#define PPTT_NODE_NONE		UINT32_MAX
+
+/* Processor hierarchy node flags */
+#define PPTT_FLAG_PACKAGE	(1 << 0)
+#define PPTT_FLAG_ID_VALID	(1 << 1)
+#define PPTT_FLAG_THREAD	(1 << 2)
+#define PPTT_FLAG_LEAF		(1 << 3)
+
+/* Cache type structure flags */
+#define PPTT_CACHE_SIZE_VALID	(1 << 0)
+
+/* Node reference errors found when resolving the topology */
+#define PPTT_BAD_PARENT		(1 << 0)
+#define PPTT_BAD_RESOURCE	(1 << 1)
+#define PPTT_BAD_NEXT_CACHE	(1 << 2)
+#define PPTT_CYCLE		(1 << 3)
+
+typedef enum {
+	PPTT_NODE_WHITE = 0,	/* not yet visited */
+	PPTT_NODE_GREY,		/* on the current chain */
+	PPTT_NODE_BLACK		/* visited, chain is acyclic */
+} pptt_node_state;
+
+typedef struct {
+	const fwts_acpi_table_pptt_header *entry;	/* node in the PPTT */
+	uint32_t offset;	/* offset of node from start of PPTT */
+	uint32_t next;		/* parent or next level cache node index */
+	uint32_t children;	/* number of child processor nodes */
+	uint32_t refs;		/* number of references to a cache node */
+	uint32_t package;	/* physical package node index */
+	uint8_t	 packages;	/* physical package nodes on path to root */
+	uint8_t	 errors;	/* PPTT_BAD_* reference errors */
+	uint8_t	 state;		/* pptt_node_state */
+} pptt_node;
+
+typedef struct {
+	pptt_node *nodes;	/* nodes in table order */
+	uint32_t *index;	/* PPTT offset to node index + 1 */
+	uint32_t count;		/* number of nodes */
+	uint32_t leaves;	/* number of leaf processor nodes */
+	uint32_t cycles;	/* number of reference cycles */
+	bool	 truncated;	/* stopped early on malformed structure */
+} pptt_topology;
 
 static fwts_acpi_table_info *table;
-acpi_table_init(PPTT, &table)
+static pptt_topology topology;
+static char *pptt_sysfs_path;
+
+/*
+ *  pptt_node_lookup()
+ *	map a PPTT offset to a node index, PPTT_NODE_NONE if there is
+ *	no structure starting at that offset
+ */
+static uint32_t pptt_node_lookup(const pptt_topology *topo, const uint32_t offset)
+{
+	if (offset >= table->length || topo->index[offset] == 0)
+		return PPTT_NODE_NONE;
+
+	return topo->index[offset] - 1;
+}
+
+/*
+ *  pptt_node_id()
+ *	the topology id Linux reports for a processor node, the ACPI
+ *	processor id if it is valid, otherwise the node offset
+ */
+static uint32_t pptt_node_id(const pptt_node *node)
+{
+	const fwts_acpi_table_pptt_processor *proc =
+		(const fwts_acpi_table_pptt_processor *)node->entry;
+
+	return (proc->flags & PPTT_FLAG_ID_VALID) ?
+		proc->acpi_processor_id : node->offset;
+}
+
+/*
+ *  pptt_topology_cycles()
+ *	find cycles in the parent and next level cache chains, each node
+ *	has at most one outgoing reference so colouring the nodes on each
+ *	chain visits every node a constant number of times
+ */
+static void pptt_topology_cycles(pptt_topology *topo)
+{
+	pptt_node *nodes = topo->nodes;
+	uint32_t i, j;
+
+	for (i = 0; i < topo->count; i++) {
+		if (nodes[i].state != PPTT_NODE_WHITE)
+			continue;
+
+		for (j = i; j != PPTT_NODE_NONE && nodes[j].state == PPTT_NODE_WHITE; j = nodes[j].next)
+			nodes[j].state = PPTT_NODE_GREY;
+
+		/* Reached a node on the current chain, break the cycle there */
+		if (j != PPTT_NODE_NONE && nodes[j].state == PPTT_NODE_GREY) {
+			uint32_t k = nodes[j].next;
+
+			nodes[j].errors |= PPTT_CYCLE;
+			nodes[j].next = PPTT_NODE_NONE;
+			if (k != PPTT_NODE_NONE && nodes[j].entry->type == FWTS_PPTT_PROCESSOR)
+				nodes[k].children--;
+			topo->cycles++;
+		}
+
+		for (j = i; j != PPTT_NODE_NONE && nodes[j].state == PPTT_NODE_GREY; j = nodes[j].next)
+			nodes[j].state = PPTT_NODE_BLACK;
+	}
+}
+
+/*
+ *  pptt_topology_packages()
+ *	count the physical package nodes on the path from each processor
+ *	node to the root, memoizing each path so the total work is linear
+ */
+static int pptt_topology_packages(pptt_topology *topo)
+{
+	pptt_node *nodes = topo->nodes;
+	uint32_t *stack;
+	uint32_t i;
+
+	stack = calloc(topo->count, sizeof(uint32_t));
+	if (!stack)
+		return FWTS_ERROR;
+
+	/* Re-use the state to mark nodes with a resolved package path */
+	for (i = 0; i < topo->count; i++)
+		nodes[i].state = PPTT_NODE_WHITE;
+
+	for (i = 0; i < topo->count; i++) {
+		uint32_t j, depth = 0;
+		uint32_t package = PPTT_NODE_NONE;
+		uint8_t packages = 0;
+
+		if (nodes[i].entry->type != FWTS_PPTT_PROCESSOR)
+			continue;
+
+		for (j = i; j != PPTT_NODE_NONE && nodes[j].state == PPTT_NODE_WHITE; j = nodes[j].next)
+			stack[depth++] = j;
+
+		if (j != PPTT_NODE_NONE) {
+			package = nodes[j].package;
+			packages = nodes[j].packages;
+		}
+
+		while (depth--) {
+			const fwts_acpi_table_pptt_processor *proc;
+			pptt_node *node = &nodes[stack[depth]];
+
+			proc = (const fwts_acpi_table_pptt_processor *)node->entry;
+			if (proc->flags & PPTT_FLAG_PACKAGE) {
+				package = stack[depth];
+				if (packages < UINT8_MAX)
+					packages++;
+			}
+			node->package = package;
+			node->packages = packages;
+			node->state = PPTT_NODE_BLACK;
+		}
+	}
+	free(stack);
+
+	return FWTS_OK;
+}
+
+/*
+ *  pptt_topology_build()
+ *	index every PPTT structure by its offset and resolve the parent,
+ *	private resource and next level cache references into a graph;
+ *	malformed structures are reported by pptt_test1, so the walk just
+ *	stops at the first one
+ */
+static int pptt_topology_build(pptt_topology *topo)
+{
+	uint32_t offset = sizeof(fwts_acpi_table_pptt);
+	uint32_t i, max_nodes;
+
+	memset(topo, 0, sizeof(*topo));
+	if (table->length < offset)
+		return FWTS_OK;
+
+	/* Smallest accepted structure is a processor node, bound the node count */
+	max_nodes = (table->length - offset) / sizeof(fwts_acpi_table_pptt_processor) + 1;
+	topo->nodes = calloc(max_nodes, sizeof(pptt_node));
+	topo->index = calloc(table->length, sizeof(uint32_t));
+	if (!topo->nodes || !topo->index)
+		return FWTS_ERROR;
+
+	while (offset + sizeof(fwts_acpi_table_pptt_header) <= table->length) {
+		const fwts_acpi_table_pptt_header *entry =
+			(const fwts_acpi_table_pptt_header *)(table->data + offset);
+		uint64_t length = 0;
+		pptt_node *node;
+
+		if (entry->type == FWTS_PPTT_PROCESSOR) {
+			const fwts_acpi_table_pptt_processor *proc =
+				(const fwts_acpi_table_pptt_processor *)entry;
+
+			if (entry->length >= sizeof(*proc))
+				length = sizeof(*proc) + (uint64_t)proc->number_priv_resources * 4;
+		} else if (entry->type == FWTS_PPTT_CACHE) {
+			length = sizeof(fwts_acpi_table_pptt_cache) - sizeof(uint32_t);
+		} else if (entry->type == FWTS_PPTT_ID) {
+			length = sizeof(fwts_acpi_table_pptt_id);
+		}
+
+		if (length == 0 || entry->length < length ||
+		    offset + entry->length > table->length) {
+			topo->truncated = true;
+			break;
+		}
+
+		node = &topo->nodes[topo->count];
+		node->entry = entry;
+		node->offset = offset;
+		node->next = PPTT_NODE_NONE;
+		node->package = PPTT_NODE_NONE;
+		topo->index[offset] = ++topo->count;
+
+		offset += entry->length;
+	}
+
+	/* All nodes are indexed, now resolve the references */
+	for (i = 0; i < topo->count; i++) {
+		pptt_node *node = &topo->nodes[i];
+		uint32_t j, ref;
+
+		if (node->entry->type == FWTS_PPTT_PROCESSOR) {
+			const fwts_acpi_table_pptt_processor *proc =
+				(const fwts_acpi_table_pptt_processor *)node->entry;
+
+			if (proc->parent) {
+				ref = pptt_node_lookup(topo, proc->parent);
+				if (ref == PPTT_NODE_NONE ||
+				    topo->nodes[ref].entry->type != FWTS_PPTT_PROCESSOR) {
+					node->errors |= PPTT_BAD_PARENT;
+				} else {
+					node->next = ref;
+					topo->nodes[ref].children++;
+				}
+			}
+			for (j = 0; j < proc->number_priv_resources; j++) {
+				ref = pptt_node_lookup(topo, proc->private_resource[j]);
+				if (ref == PPTT_NODE_NONE ||
+				    topo->nodes[ref].entry->type == FWTS_PPTT_PROCESSOR)
+					node->errors |= PPTT_BAD_RESOURCE;
+				else
+					topo->nodes[ref].refs++;
+			}
+		} else if (node->entry->type == FWTS_PPTT_CACHE) {
+			const fwts_acpi_table_pptt_cache *cache =
+				(const fwts_acpi_table_pptt_cache *)node->entry;
+
+			if (cache->next_level_cache) {
+				ref = pptt_node_lookup(topo, cache->next_level_cache);
+				if (ref == PPTT_NODE_NONE ||
+				    topo->nodes[ref].entry->type != FWTS_PPTT_CACHE) {
+					node->errors |= PPTT_BAD_NEXT_CACHE;
+				} else {
+					node->next = ref;
+					topo->nodes[ref].refs++;
+				}
+			}
+		}
+	}
+
+	pptt_topology_cycles(topo);
+
+	for (i = 0; i < topo->count; i++)
+		if (topo->nodes[i].entry->type == FWTS_PPTT_PROCESSOR &&
+		    topo->nodes[i].children == 0)
+			topo->leaves++;
+
+	return pptt_topology_packages(topo);
+}
+
+static void pptt_topology_free(pptt_topology *topo)
+{
+	free(topo->nodes);
+	free(topo->index);
+	memset(topo, 0, sizeof(*topo));
+}
+
+static int pptt_init(fwts_framework *fw)
+{
+	int ret;
+
+	ret = acpi_table_generic_init(fw, "PPTT", &table);
+	if (ret != FWTS_OK)
+		return ret;
+
+	if (pptt_topology_build(&topology) != FWTS_OK) {
+		pptt_topology_free(&topology);
+		fwts_log_error(fw, "Cannot allocate PPTT topology.");
+		return FWTS_ERROR;
+	}
+
+	return FWTS_OK;
+}
+
+static int pptt_deinit(fwts_framework *fw)
+{
+	FWTS_UNUSED(fw);
+
+	pptt_topology_free(&topology);
+	return FWTS_OK;
+}
 
 static void pptt_processor_test(
 	fwts_framework *fw,
@@ -178,15 +485,450 @@ static int pptt_test1(fwts_framework *fw)
 	return FWTS_OK;
 }
 
+static int pptt_uid_compare(const void *a, const void *b)
+{
+	const uint32_t uid_a = *(const uint32_t *)a;
+	const uint32_t uid_b = *(const uint32_t *)b;
+
+	return (uid_a > uid_b) - (uid_a < uid_b);
+}
+
+/*
+ *  pptt_madt_uids()
+ *	gather the sorted processor UIDs of enabled or online capable
+ *	Local APIC, x2APIC and GICC structures in the MADT
+ */
+static uint32_t *pptt_madt_uids(fwts_framework *fw, uint32_t *count)
+{
+	fwts_acpi_table_info *madt_table;
+	uint32_t *uids, offset, n = 0;
+
+	*count = 0;
+	if (fwts_acpi_find_table(fw, "APIC", 0, &madt_table) != FWTS_OK ||
+	    madt_table == NULL || madt_table->length < sizeof(fwts_acpi_table_madt))
+		return NULL;
+
+	uids = calloc(madt_table->length / sizeof(fwts_acpi_madt_sub_table_header), sizeof(uint32_t));
+	if (!uids)
+		return NULL;
+
+	offset = sizeof(fwts_acpi_table_madt);
+	while (offset + sizeof(fwts_acpi_madt_sub_table_header) <= madt_table->length) {
+		const fwts_acpi_madt_sub_table_header *hdr =
+			(const fwts_acpi_madt_sub_table_header *)(madt_table->data + offset);
+		const void *data = (const uint8_t *)hdr + sizeof(*hdr);
+		size_t len;
+
+		if (hdr->length < sizeof(*hdr) || offset + hdr->length > madt_table->length)
+			break;
+		len = hdr->length - sizeof(*hdr);
+
+		if (hdr->type == FWTS_MADT_LOCAL_APIC &&
+		    len >= sizeof(fwts_acpi_madt_processor_local_apic)) {
+			const fwts_acpi_madt_processor_local_apic *lapic = data;
+
+			if (lapic->flags & 0x3)
+				uids[n++] = lapic->acpi_processor_id;
+		} else if (hdr->type == FWTS_MADT_LOCAL_X2APIC &&
+			   len >= sizeof(fwts_acpi_madt_local_x2apic)) {
+			const fwts_acpi_madt_local_x2apic *x2apic = data;
+
+			if (x2apic->flags & 0x3)
+				uids[n++] = x2apic->processor_uid;
+		} else if (hdr->type == FWTS_MADT_GIC_C_CPU_INTERFACE &&
+			   len >= offsetof(fwts_acpi_madt_gic, flags) + sizeof(uint32_t)) {
+			const fwts_acpi_madt_gic *gicc = data;
+
+			if (gicc->flags & 0x9)
+				uids[n++] = gicc->processor_uid;
+		}
+		offset += hdr->length;
+	}
+
+	qsort(uids, n, sizeof(uint32_t), pptt_uid_compare);
+	*count = n;
+
+	return uids;
+}
+
+/*
+ *  pptt_madt_test()
+ *	every leaf processor should match an enabled MADT processor by
+ *	UID and every enabled MADT processor should have a leaf node
+ */
+static void pptt_madt_test(fwts_framework *fw, bool *passed)
+{
+	uint32_t *uids, count, i;
+	bool *matched;
+
+	uids = pptt_madt_uids(fw, &count);
+	if (!uids || count == 0) {
+		fwts_log_info(fw, "No MADT processor structures found, "
+			"skipping PPTT to MADT processor UID checks.");
+		free(uids);
+		return;
+	}
+
+	matched = calloc(count, sizeof(bool));
+	if (!matched) {
+		fwts_log_error(fw, "Cannot allocate MADT processor UID map.");
+		free(uids);
+		return;
+	}
+
+	for (i = 0; i < topology.count; i++) {
+		const pptt_node *node = &topology.nodes[i];
+		const fwts_acpi_table_pptt_processor *proc;
+		uint32_t *uid;
+
+		if (node->entry->type != FWTS_PPTT_PROCESSOR || node->children)
+			continue;
+
+		proc = (const fwts_acpi_table_pptt_processor *)node->entry;
+		if (!(proc->flags & PPTT_FLAG_ID_VALID))
+			continue;
+
+		uid = bsearch(&proc->acpi_processor_id, uids, count,
+			sizeof(uint32_t), pptt_uid_compare);
+		if (!uid) {
+			*passed = false;
+			fwts_failed(fw, LOG_LEVEL_MEDIUM,
+				"PPTTLeafNoMADTProcessor",
+				"PPTT leaf processor node at offset 0x%8.8" PRIx32
+				" has ACPI Processor ID 0x%8.8" PRIx32 " that does "
+				"not match any enabled MADT processor UID.",
+				node->offset, proc->acpi_processor_id);
+			continue;
+		}
+
+		/* Local APIC and x2APIC may share a UID, use the first match */
+		while (uid > uids && *(uid - 1) == *uid)
+			uid--;
+		if (matched[uid - uids]) {
+			*passed = false;
+			fwts_failed(fw, LOG_LEVEL_MEDIUM,
+				"PPTTDuplicateProcessorID",
+				"PPTT leaf processor node at offset 0x%8.8" PRIx32
+				" has ACPI Processor ID 0x%8.8" PRIx32 " that is "
+				"already used by another leaf processor node.",
+				node->offset, proc->acpi_processor_id);
+		}
+		matched[uid - uids] = true;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (matched[i] || (i > 0 && uids[i] == uids[i - 1]))
+			continue;
+		*passed = false;
+		fwts_failed(fw, LOG_LEVEL_MEDIUM,
+			"PPTTMADTProcessorNoLeaf",
+			"MADT processor UID 0x%8.8" PRIx32 " has no matching "
+			"PPTT leaf processor node.", uids[i]);
+	}
+
+	free(matched);
+	free(uids);
+}
+
+static int pptt_test2(fwts_framework *fw)
+{
+	const uint8_t rev = ((fwts_acpi_table_pptt *)table->data)->header.revision;
+	uint32_t i, processors = 0, caches = 0, packages = 0;
+	bool passed = true;
+
+	if (topology.truncated)
+		fwts_log_info(fw, "PPTT has malformed structures, only the "
+			"first %" PRIu32 " structures are checked.", topology.count);
+
+	for (i = 0; i < topology.count; i++) {
+		const pptt_node *node = &topology.nodes[i];
+
+		if (node->errors & PPTT_BAD_PARENT) {
+			passed = false;
+			fwts_failed(fw, LOG_LEVEL_HIGH,
+				"PPTTBadParent",
+				"PPTT processor node at offset 0x%8.8" PRIx32
+				" has parent 0x%8.8" PRIx32 " which is not a "
+				"processor hierarchy node.", node->offset,
+				((const fwts_acpi_table_pptt_processor *)node->entry)->parent);
+		}
+		if (node->errors & PPTT_BAD_RESOURCE) {
+			passed = false;
+			fwts_failed(fw, LOG_LEVEL_HIGH,
+				"PPTTBadPrivateResource",
+				"PPTT processor node at offset 0x%8.8" PRIx32
+				" has a private resource that is not a cache "
+				"or ID structure.", node->offset);
+		}
+		if (node->errors & PPTT_BAD_NEXT_CACHE) {
+			passed = false;
+			fwts_failed(fw, LOG_LEVEL_HIGH,
+				"PPTTBadNextLevelCache",
+				"PPTT cache node at offset 0x%8.8" PRIx32
+				" has next level of cache 0x%8.8" PRIx32 " which "
+				"is not a cache type structure.", node->offset,
+				((const fwts_acpi_table_pptt_cache *)node->entry)->next_level_cache);
+		}
+		if (node->errors & PPTT_CYCLE) {
+			passed = false;
+			fwts_failed(fw, LOG_LEVEL_CRITICAL,
+				"PPTTReferenceCycle",
+				"PPTT %s node at offset 0x%8.8" PRIx32 " is part "
+				"of a reference cycle.",
+				node->entry->type == FWTS_PPTT_PROCESSOR ?
+				"processor" : "cache", node->offset);
+		}
+
+		if (node->entry->type == FWTS_PPTT_PROCESSOR) {
+			const fwts_acpi_table_pptt_processor *proc =
+				(const fwts_acpi_table_pptt_processor *)node->entry;
+
+			processors++;
+			if (proc->flags & PPTT_FLAG_PACKAGE)
+				packages++;
+
+			/* The leaf flag was introduced in revision 2 */
+			if (rev >= 2 && !!(proc->flags & PPTT_FLAG_LEAF) != (node->children == 0)) {
+				passed = false;
+				fwts_failed(fw, LOG_LEVEL_MEDIUM,
+					"PPTTLeafFlagMismatch",
+					"PPTT processor node at offset 0x%8.8" PRIx32
+					" has %" PRIu32 " child nodes but its Node is "
+					"a Leaf flag is %s.", node->offset,
+					node->children,
+					(proc->flags & PPTT_FLAG_LEAF) ? "set" : "clear");
+			}
+			if (node->children == 0 && node->packages != 1) {
+				passed = false;
+				fwts_failed(fw, LOG_LEVEL_MEDIUM,
+					"PPTTPhysicalPackageCount",
+					"PPTT leaf processor node at offset 0x%8.8" PRIx32
+					" has %" PRIu8 " physical package nodes on its "
+					"path to the root, expected exactly 1.",
+					node->offset, node->packages);
+			}
+		} else if (node->entry->type == FWTS_PPTT_CACHE) {
+			const fwts_acpi_table_pptt_cache *cache =
+				(const fwts_acpi_table_pptt_cache *)node->entry;
+
+			caches++;
+			if (node->refs == 0) {
+				passed = false;
+				fwts_failed(fw, LOG_LEVEL_LOW,
+					"PPTTCacheUnreferenced",
+					"PPTT cache node at offset 0x%8.8" PRIx32
+					" is not referenced by any processor or "
+					"cache node.", node->offset);
+			}
+			if (node->next != PPTT_NODE_NONE) {
+				const fwts_acpi_table_pptt_cache *next =
+					(const fwts_acpi_table_pptt_cache *)topology.nodes[node->next].entry;
+
+				if ((cache->flags & PPTT_CACHE_SIZE_VALID) &&
+				    (next->flags & PPTT_CACHE_SIZE_VALID) &&
+				    next->size < cache->size) {
+					passed = false;
+					fwts_failed(fw, LOG_LEVEL_LOW,
+						"PPTTCacheLevelSize",
+						"PPTT cache node at offset 0x%8.8" PRIx32
+						" has size 0x%8.8" PRIx32 " which is larger "
+						"than its next level of cache size 0x%8.8" PRIx32 ".",
+						node->offset, cache->size, next->size);
+				}
+			}
+		}
+	}
+
+	fwts_log_info(fw, "PPTT topology: %" PRIu32 " processor nodes, "
+		"%" PRIu32 " leaf nodes, %" PRIu32 " physical package nodes, "
+		"%" PRIu32 " cache nodes.",
+		processors, topology.leaves, packages, caches);
+
+	pptt_madt_test(fw, &passed);
+
+	if (passed)
+		fwts_passed(fw, "No issues found in PPTT topology.");
+
+	return FWTS_OK;
+}
+
+/*
+ *  pptt_ids()
+ *	sorted topology ids Linux derives for the physical package or
+ *	core of each leaf processor node
+ */
+static uint32_t *pptt_ids(const bool package, uint32_t *count)
+{
+	uint32_t *ids, i, n = 0;
+
+	ids = calloc(topology.leaves + 1, sizeof(uint32_t));
+	if (!ids)
+		return NULL;
+
+	for (i = 0; i < topology.count; i++) {
+		const pptt_node *node = &topology.nodes[i];
+		const fwts_acpi_table_pptt_processor *proc =
+			(const fwts_acpi_table_pptt_processor *)node->entry;
+
+		if (node->entry->type != FWTS_PPTT_PROCESSOR || node->children)
+			continue;
+
+		if (package) {
+			if (node->package != PPTT_NODE_NONE)
+				ids[n++] = pptt_node_id(&topology.nodes[node->package]);
+		} else if ((proc->flags & PPTT_FLAG_THREAD) && node->next != PPTT_NODE_NONE) {
+			ids[n++] = pptt_node_id(&topology.nodes[node->next]);
+		} else {
+			ids[n++] = pptt_node_id(node);
+		}
+	}
+	qsort(ids, n, sizeof(uint32_t), pptt_uid_compare);
+	*count = n;
+
+	return ids;
+}
+
+static int pptt_sysfs_id(const char *path, const char *cpu, const char *name, uint32_t *id)
+{
+	char file[PATH_MAX];
+	int value;
+
+	snprintf(file, sizeof(file), "%s/devices/system/cpu/%s/topology/%s", path, cpu, name);
+	if (fwts_get_int(file, &value) != FWTS_OK || value < 0)
+		return FWTS_ERROR;
+	*id = (uint32_t)value;
+
+	return FWTS_OK;
+}
+
+static int pptt_test3(fwts_framework *fw)
+{
+	const char *path = pptt_sysfs_path ? pptt_sysfs_path : PPTT_SYSFS_PATH;
+	uint32_t *package_ids, *core_ids, packages, cores, cpus = 0;
+	char cpu_path[PATH_MAX];
+	struct dirent *entry;
+	bool passed = true;
+	DIR *dir;
+
+	/*
+	 *  The running kernel only reflects the PPTT when the tables come
+	 *  from this machine, captured trees must be given explicitly
+	 */
+	if (!pptt_sysfs_path) {
+		if (fw->acpi_table_path || fw->acpi_table_acpidump_file) {
+			fwts_skipped(fw, "ACPI tables are not from the running system, "
+				"use --pptt-sysfs-path to check against a captured sysfs.");
+			return FWTS_SKIP;
+		}
+		if (fw->target_arch != FWTS_ARCH_ARM64) {
+			fwts_skipped(fw, "Kernel CPU topology is only derived "
+				"from the PPTT on ARM64 systems.");
+			return FWTS_SKIP;
+		}
+	}
+
+	snprintf(cpu_path, sizeof(cpu_path), "%s/devices/system/cpu", path);
+	dir = opendir(cpu_path);
+	if (!dir) {
+		fwts_skipped(fw, "Cannot open %s.", cpu_path);
+		return FWTS_SKIP;
+	}
+
+	package_ids = pptt_ids(true, &packages);
+	core_ids = pptt_ids(false, &cores);
+	if (!package_ids || !core_ids) {
+		free(package_ids);
+		free(core_ids);
+		closedir(dir);
+		fwts_log_error(fw, "Cannot allocate PPTT topology ids.");
+		return FWTS_ERROR;
+	}
+
+	while ((entry = readdir(dir)) != NULL) {
+		uint32_t id;
+
+		if (strncmp(entry->d_name, "cpu", 3) || !isdigit(entry->d_name[3]))
+			continue;
+
+		if (pptt_sysfs_id(path, entry->d_name, "physical_package_id", &id) == FWTS_OK) {
+			cpus++;
+			if (!bsearch(&id, package_ids, packages, sizeof(uint32_t), pptt_uid_compare)) {
+				passed = false;
+				fwts_failed(fw, LOG_LEVEL_MEDIUM,
+					"PPTTSysfsPackageID",
+					"%s physical_package_id 0x%8.8" PRIx32 " does "
+					"not match any PPTT physical package node.",
+					entry->d_name, id);
+			}
+		}
+		if (pptt_sysfs_id(path, entry->d_name, "core_id", &id) == FWTS_OK &&
+		    !bsearch(&id, core_ids, cores, sizeof(uint32_t), pptt_uid_compare)) {
+			passed = false;
+			fwts_failed(fw, LOG_LEVEL_MEDIUM,
+				"PPTTSysfsCoreID",
+				"%s core_id 0x%8.8" PRIx32 " does not match any "
+				"PPTT processor core node.", entry->d_name, id);
+		}
+	}
+	closedir(dir);
+	free(package_ids);
+	free(core_ids);
+
+	if (cpus > topology.leaves) {
+		passed = false;
+		fwts_failed(fw, LOG_LEVEL_MEDIUM,
+			"PPTTSysfsCPUCount",
+			"Kernel reports %" PRIu32 " CPUs but the PPTT only has "
+			"%" PRIu32 " leaf processor nodes.", cpus, topology.leaves);
+	}
+
+	if (passed)
+		fwts_passed(fw, "PPTT topology matches %" PRIu32 " CPUs in %s.",
+			cpus, cpu_path);
+
+	return FWTS_OK;
+}
+
+static int options_handler(
+	fwts_framework *fw,
+	int argc,
+	char * const argv[],
+	int option_char,
+	int long_index)
+{
+	FWTS_UNUSED(fw);
+	FWTS_UNUSED(argc);
+	FWTS_UNUSED(argv);
+
+	if (option_char == 0) {
+		switch (long_index) {
+		case 0:	/* --pptt-sysfs-path */
+			pptt_sysfs_path = optarg;
+			break;
+		}
+	}
+	return FWTS_OK;
+}
+
+static fwts_option options[] = {
+	{ "pptt-sysfs-path",	"", 1, "Specify sysfs path to check PPTT topology against, e.g. a captured /sys tree." },
+	{ NULL, NULL, 0, NULL }
+};
+
 static fwts_framework_minor_test pptt_tests[] = {
 	{ pptt_test1, "Validate PPTT table." },
+	{ pptt_test2, "Validate PPTT topology." },
+	{ pptt_test3, "Check PPTT topology against kernel CPU topology." },
 	{ NULL, NULL }
 };
 
 static fwts_framework_ops pptt_ops = {
-	.description = "PPTT Processor Properties Topology Table test.",
-	.init        = PPTT_init,
-	.minor_tests = pptt_tests
+	.description     = "PPTT Processor Properties Topology Table test.",
+	.init            = pptt_init,
+	.deinit          = pptt_deinit,
+	.minor_tests     = pptt_tests,
+	.options         = options,
+	.options_handler = options_handler,
 };
 
 FWTS_REGISTER("pptt", &pptt_ops, FWTS_TEST_ANYTIME, FWTS_FLAG_BATCH | FWTS_FLAG_ACPI | FWTS_FLAG_SBBR)
@@ -26,11 +26,112 @@
 #include <inttypes.h>
 #include <string.h>
 
-#define	INDEX(i, j)	(((i) * slit->num_of_system_localities) + (j))
+#define	INDEX(i, j)	(((uint64_t)(i) * n) + (j))
 
 static fwts_acpi_table_info *table;
 acpi_table_init(SLIT, &table)
 
+typedef struct {
+	const char *label;
+	const char *explanation;	/* appended to the failure message */
+	const char *summary;		/* appended to the totals message */
+	bool transposed;		/* report the transposed entry too */
+} slit_violation;
+
+/* Indexed by fwts_numa_slit_check */
+static const slit_violation slit_violations[FWTS_NUMA_SLIT_MAX] = {
+	{ "SLITEntryReserved",
+	  "a reserved value and has no defined meaning",
+	  "were using reserved values", false },
+	{ "SLITEntryLocalDistance",
+	  "the local distance, only diagonal entries may use this value",
+	  "were using the local distance", false },
+	{ "SLITBadDiagonalEntry",
+	  "not the local distance 0x0a",
+	  "on the diagonal were not the local distance", false },
+	{ "SLITEntryNotSymmetric",
+	  "the distances must be the same",
+	  "were not matching their diagonal partner element", true },
+	{ "SLITEntryUnreachableMismatch",
+	  "only one of the distances is 0xff (unreachable)",
+	  "had a one way unreachable distance", true },
+};
+
+typedef struct {
+	const uint8_t *matrix;
+	uint64_t n;
+	const slit_violation *violation;
+} slit_run_info;
+
+/*
+ *  slit_report_run()
+ *	report a run of entries [row][first..last] with the same violation
+ */
+static void slit_report_run(
+	fwts_framework *fw,
+	const uint32_t row,
+	const uint32_t first,
+	const uint32_t last,
+	void *private)
+{
+	const slit_run_info *info = (const slit_run_info *)private;
+	const slit_violation *v = info->violation;
+	const uint64_t n = info->n;
+
+	if (first != last)
+		fwts_failed(fw, LOG_LEVEL_HIGH, v->label,
+			"SLIT Entry[%" PRIu32 "][%" PRIu32 "..%" PRIu32 "] "
+			"(first is 0x%" PRIx8 "), %s",
+			row, first, last, info->matrix[INDEX(row, first)],
+			v->explanation);
+	else if (v->transposed)
+		fwts_failed(fw, LOG_LEVEL_HIGH, v->label,
+			"SLIT Entry[%" PRIu32 "][%" PRIu32 "] is 0x%" PRIx8
+			" and SLIT Entry[%" PRIu32 "][%" PRIu32 "] is 0x%" PRIx8
+			", %s",
+			row, first, info->matrix[INDEX(row, first)],
+			first, row, info->matrix[INDEX(first, row)],
+			v->explanation);
+	else
+		fwts_failed(fw, LOG_LEVEL_HIGH, v->label,
+			"SLIT Entry[%" PRIu32 "][%" PRIu32 "] is 0x%" PRIx8
+			" which is %s",
+			row, first, info->matrix[INDEX(row, first)],
+			v->explanation);
+}
+
+/*
+ *  slit_srat_check()
+ *	check the number of localities against the SRAT proximity domains
+ */
+static bool slit_srat_check(fwts_framework *fw, const uint64_t n)
+{
+	fwts_numa_domain *domains;
+	uint32_t count, i, missing = 0;
+
+	if (fwts_numa_srat_domains(fw, &domains, &count) != FWTS_OK) {
+		fwts_log_info(fw, "No SRAT table, skipping SLIT proximity domain checks.");
+		return true;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (domains[i].domain >= n) {
+			missing++;
+			fwts_failed(fw, LOG_LEVEL_MEDIUM,
+				"SLITMissingSRATDomain",
+				"SRAT proximity domain %" PRIu32 " has no SLIT "
+				"locality, the SLIT only has %" PRIu64 " localities.",
+				domains[i].domain, n);
+		}
+	}
+	if (count - missing < n)
+		fwts_log_info(fw, "SLIT has %" PRIu64 " localities but only %" PRIu32
+			" are SRAT proximity domains.", n, count - missing);
+	free(domains);
+
+	return missing == 0;
+}
+
 /*
  *  For SLIT System Locality Distance Information refer to
  *    section 5.2.17 of the ACPI specification version 6.0
@@ -38,8 +139,9 @@ acpi_table_init(SLIT, &table)
 static int slit_test1(fwts_framework *fw)
 {
 	bool passed = true;
-	uint64_t i, j, size, n, reserved = 0, bad_entry = 0;
+	uint64_t i, size, n;
 	uint8_t *entry;
+	fwts_numa_bitmap bitmaps[FWTS_NUMA_SLIT_MAX];
 	fwts_acpi_table_slit *slit = (fwts_acpi_table_slit *)table->data;
 
 	/* Size sanity check #1, got enough table to at least get matrix size */
@@ -93,63 +195,28 @@ static int slit_test1(fwts_framework *fw)
 	/*
 	 *  Now sanity check the entries..
 	 */
-	if (entry[INDEX(0,0)] != 10) {
-		passed = false;
-		fwts_failed(fw, LOG_LEVEL_HIGH,
-			"SLITBadCornerEntry",
-			"SLIT Entry[0][0] is 0x%" PRIx8 ", expecting value 0x0a.",
-			entry[INDEX(0,0)]);
-	}
-	if (entry[INDEX(n - 1, n - 1)] != 10) {
-		passed = false;
-		fwts_failed(fw, LOG_LEVEL_HIGH,
-			"SLITBadCornerEntry",
-			"SLIT Entry[%" PRIu64 "][%" PRIu64 "] is 0x%" PRIx8 ", expecting value 0x0a.",
-			n - 1, n - 1,
-			entry[INDEX(n - 1, n - 1)]);
+	if (fwts_numa_slit_check_matrix(entry, n, bitmaps) != FWTS_OK) {
+		fwts_log_error(fw, "Cannot allocate SLIT entry bitmaps.");
+		return FWTS_ERROR;
 	}
 
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < n; j++) {
-			uint8_t val1 = entry[INDEX(i, j)],
-				val2 = entry[INDEX(j, i)];
-
-			/* Check for distances less than 10 (reserved, no meaning) */
-			if (val1 < 10) {
-				reserved++;
-				/* Report first 16 errors */
-				if (reserved < 16) {
-					fwts_failed(fw, LOG_LEVEL_HIGH,
-						"SLITEntryReserved",
-						"SLIT Entry[%" PRIu64 "][%" PRIu64 "]"
-						" is 0x%" PRIx8 " which is a reserved value"
-						" and has no defined meaning",
-						i, j, val1);
-				}
-			}
-
-			if (val1 != val2) {
-				bad_entry++;
-				/* Report first 16 bad entries */
-				if (bad_entry < 16) {
-					fwts_failed(fw, LOG_LEVEL_HIGH,
-						"SLITEntryReserved",
-						"SLIT Entry[%" PRIu64 "][%" PRIu64 "]"
-						" is 0x%" PRIx8 " and not the same as "
-						"SLIT Entry[%" PRIu64 "][%" PRIu64 "]"
-						" which is 0x%" PRIx8,
-						i, j, val1, j, i, val2);
-				}
-			}
+	for (i = 0; i < FWTS_NUMA_SLIT_MAX; i++) {
+		const slit_violation *v = &slit_violations[i];
+		slit_run_info info = { .matrix = entry, .n = n, .violation = v };
+		uint32_t runs;
+
+		if (bitmaps[i].count) {
+			passed = false;
+			/* Report first 16 runs of errors */
+			runs = fwts_numa_bitmap_runs(fw, &bitmaps[i], 16, slit_report_run, &info);
+			fwts_log_info(fw, "Total of %" PRIu64 " entries %s (%" PRIu32 " runs)",
+				bitmaps[i].count, v->summary, runs);
 		}
+		fwts_numa_bitmap_free(&bitmaps[i]);
 	}
 
-	if (reserved)
-		fwts_log_info(fw, "Total of %" PRIu64 " entries were using reserved values",
-			reserved);
-	if (bad_entry)
-		fwts_log_info(fw, "Total of %" PRIu64 " entries were not matching "
-			"their diagonal parner element", bad_entry);
+	if (!slit_srat_check(fw, n))
+		passed = false;
 done:
 	if (passed)
 		fwts_passed(fw, "No issues found in SLIT table.");
@@ -26,8 +26,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 
 #define MAX_TABLES	(128)
+#define SYNTAXCHECK_JOBS_MAX	(64)	/* Maximum --syntaxcheck-jobs workers */
 
 #define ASL_EXCEPTIONS
 #include "aslmessages.h"
@@ -38,6 +40,39 @@ typedef struct {
 	char		*advice;
 } syntaxcheck_error_map_item;
 
+/*
+ *  A table to check and the output of its reassembly
+ */
+typedef struct syntaxcheck_reassembly {
+	const fwts_acpi_table_info *info;
+	int ret;			/* fwts_iasl_assemble() return */
+	fwts_iasl_text *iasl_disassembly;
+	fwts_list *iasl_stdout;
+	fwts_list *iasl_stderr;
+	bool unchanged;			/* Identical to its baseline table */
+	struct syntaxcheck_reassembly *baseline;	/* Changed baseline table */
+} syntaxcheck_reassembly;
+
+/*
+ *  Diagnostics of a baseline table, for --baseline-tables
+ */
+typedef struct {
+	char **diagnostics;		/* "level code: message" */
+	bool *matched;			/* Also reported for the new table */
+	size_t count;
+} syntaxcheck_diagnostics;
+
+typedef struct {
+	fwts_framework *fw;
+	syntaxcheck_reassembly *tables;
+	size_t count;
+	size_t next;			/* Next table to reassemble */
+} syntaxcheck_work;
+
+static int syntaxcheck_jobs;		/* --syntaxcheck-jobs, 0 = one per online CPU */
+static char *syntaxcheck_baseline_path;	/* --baseline-tables */
+static fwts_acpi_table_info *syntaxcheck_baseline_tables;
+
 static int syntaxcheck_load_advice(fwts_framework *fw);
 static void syntaxcheck_free_advice(void);
 
@@ -249,6 +284,15 @@ static int syntaxcheck_init(fwts_framework *fw)
 {
 	(void)syntaxcheck_load_advice(fw);
 
+	if (syntaxcheck_baseline_path) {
+		syntaxcheck_baseline_tables = fwts_acpi_load_table_set(fw, syntaxcheck_baseline_path);
+		if (syntaxcheck_baseline_tables == NULL) {
+			fwts_aborted(fw, "Cannot load baseline ACPI tables from %s, aborting.",
+				syntaxcheck_baseline_path);
+			return FWTS_ERROR;
+		}
+	}
+
 	if (fwts_iasl_init(fw) != FWTS_OK) {
 		fwts_aborted(fw, "Failure to initialise iasl, aborting.");
 		return FWTS_ERROR;
@@ -262,6 +306,8 @@ static int syntaxcheck_deinit(fwts_framework *fw)
 
 	fwts_iasl_deinit();
 	syntaxcheck_free_advice();
+	fwts_acpi_free_table_set(syntaxcheck_baseline_tables);
+	syntaxcheck_baseline_tables = NULL;
 
 	return FWTS_OK;
 }
@@ -322,28 +368,31 @@ static void syntaxcheck_dump_code(fwts_framework *fw,
 	int error_code,
 	int carat_offset,
 	char *error_message,
-	fwts_list* iasl_disassembly,
+	const fwts_iasl_text *iasl_disassembly,
 	int error_line,
 	int howmany)
 {
-	int i = 0;
-	fwts_list_link *item;
+	/* Lines are numbered from 1 */
+	int i = error_line - (howmany / 2) + 1;
+	int last = error_line + (howmany / 2) - 1;
 
 	fwts_log_info_verbatim(fw, "Line | AML source\n");
 	fwts_log_underline(fw->results, '-');
 
-	fwts_list_foreach(item, iasl_disassembly) {
-		i++;
-		if (i >= error_line + (howmany / 2))
-			break;
-		if (i > error_line - (howmany / 2)) {
-			fwts_log_info_verbatim(fw, "%5.5d| %s\n", i,
-				fwts_text_list_text(item));
-			if (i == error_line) {
-				fwts_log_info_verbatim(fw, "     | %*.*s", carat_offset, carat_offset, "^");
-				fwts_log_info_verbatim(fw, "     | %s %d: %s\n",
-					syntaxcheck_error_level(error_code), error_code, error_message);
-			}
+	if (i < 1)
+		i = 1;
+	if (iasl_disassembly == NULL)
+		last = 0;
+	else if ((size_t)last > iasl_disassembly->count)
+		last = (int)iasl_disassembly->count;
+
+	for (; i <= last; i++) {
+		fwts_log_info_verbatim(fw, "%5.5d| %s\n", i,
+			iasl_disassembly->lines[i - 1]);
+		if (i == error_line) {
+			fwts_log_info_verbatim(fw, "     | %*.*s", carat_offset, carat_offset, "^");
+			fwts_log_info_verbatim(fw, "     | %s %d: %s\n",
+				syntaxcheck_error_level(error_code), error_code, error_message);
 		}
 	}
 	fwts_log_underline(fw->results, '=');
@@ -481,27 +530,157 @@ static void syntaxcheck_give_advice(fwts_framework *fw, uint32_t error_code)
 	}
 }
 
+/*
+ *  syntaxcheck_error_message()
+ *	trim an iasl error line and return the message after
+ *	its "Error  4042 - " prefix
+ */
+static char *syntaxcheck_error_message(char *error_text)
+{
+	char *ptr;
+
+	/* trim */
+	fwts_chop_newline(error_text);
+
+	/* Strip out the ^ from the error message */
+	for (ptr = error_text; *ptr; ptr++)
+		if (*ptr == '^')
+			*ptr = ' ';
+
+	/* Look for error message after: "Error:  4042 - " prefix */
+	ptr = strstr(error_text, "-");
+	if (ptr)
+		ptr += 2;
+	else
+		ptr = error_text;	/* Urgh, none found, default */
+
+	/* Skip over leading white space */
+	while (*ptr == ' ')
+		ptr++;
+
+	return ptr;
+}
+
+/*
+ *  syntaxcheck_diagnostic()
+ *	describe a diagnostic independently of its line number,
+ *	the same diagnostic can move around between two versions
+ *	of a table
+ */
+static void syntaxcheck_diagnostic(
+	char *buf,
+	const size_t len,
+	const int error_code,
+	const char *message)
+{
+	snprintf(buf, len, "%s %d: %s",
+		syntaxcheck_error_level(error_code), error_code, message);
+}
+
+/*
+ *  syntaxcheck_baseline_diagnostics()
+ *	gather the diagnostics reported for a baseline table
+ */
+static void syntaxcheck_baseline_diagnostics(
+	fwts_list *iasl_stderr,
+	syntaxcheck_diagnostics *diagnostics)
+{
+	fwts_list_link *item;
+	size_t n = 0;
+
+	memset(diagnostics, 0, sizeof(*diagnostics));
+	if (iasl_stderr == NULL || fwts_list_len(iasl_stderr) == 0)
+		return;
+
+	diagnostics->diagnostics = calloc(fwts_list_len(iasl_stderr), sizeof(char *));
+	diagnostics->matched = calloc(fwts_list_len(iasl_stderr), sizeof(bool));
+	if (!diagnostics->diagnostics || !diagnostics->matched) {
+		free(diagnostics->diagnostics);
+		free(diagnostics->matched);
+		memset(diagnostics, 0, sizeof(*diagnostics));
+		return;
+	}
+
+	fwts_list_foreach(item, iasl_stderr) {
+		int num, error_code;
+		char ch, buf[4096];
+		char *error_text, *line = fwts_text_list_text(item);
+
+		if ((sscanf(line, "%*s %d%c", &num, &ch) != 2) || (ch != ':') || (item->next == NULL))
+			continue;
+
+		item = item->next;
+		error_text = fwts_text_list_text(item);
+		if (!strstr(error_text, "Error") &&
+		    !strstr(error_text, "Warning") &&
+		    !strstr(error_text, "Remark"))
+			continue;
+		if (sscanf(error_text, "%*s %d", &error_code) != 1)
+			continue;
+
+		syntaxcheck_diagnostic(buf, sizeof(buf), error_code,
+			syntaxcheck_error_message(error_text));
+		if ((diagnostics->diagnostics[n] = strdup(buf)) != NULL)
+			n++;
+	}
+	diagnostics->count = n;
+}
+
+/*
+ *  syntaxcheck_baseline_match()
+ *	match a diagnostic against an unmatched one of the baseline
+ */
+static bool syntaxcheck_baseline_match(
+	syntaxcheck_diagnostics *diagnostics,
+	const char *diagnostic)
+{
+	size_t i;
+
+	for (i = 0; i < diagnostics->count; i++) {
+		if (!diagnostics->matched[i] &&
+		    !strcmp(diagnostics->diagnostics[i], diagnostic)) {
+			diagnostics->matched[i] = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void syntaxcheck_baseline_free(syntaxcheck_diagnostics *diagnostics)
+{
+	size_t i;
+
+	for (i = 0; i < diagnostics->count; i++)
+		free(diagnostics->diagnostics[i]);
+	free(diagnostics->diagnostics);
+	free(diagnostics->matched);
+}
+
 /*
  *  syntaxcheck_single_table()
- *	disassemble and reassemble a table, check for errors. which indicates the Nth
- *	table
+ *	check a reassembled table for errors, n indicates the Nth table,
+ *	frees the reassembly output.  Diagnostics also in the baseline
+ *	diagnostics, if any, are logged as unchanged and not reported.
  */
 static int syntaxcheck_single_table(
 	fwts_framework *fw,
-	const fwts_acpi_table_info *info,
-	const int n)
+	const syntaxcheck_reassembly *table,
+	const int n,
+	syntaxcheck_diagnostics *baseline)
 {
+	const fwts_acpi_table_info *info = table->info;
 	fwts_list_link *item;
 	int errors = 0;
 	int warnings = 0;
 	int remarks = 0;
-	fwts_list *iasl_stdout = NULL,
-		  *iasl_stderr = NULL,
-		  *iasl_disassembly = NULL;
-
-	if (fwts_iasl_reassemble(fw, info,
-		&iasl_disassembly, &iasl_stdout, &iasl_stderr) != FWTS_OK) {
-		fwts_text_list_free(iasl_disassembly);
+	int added = 0;
+	int unchanged = 0;
+	fwts_list *iasl_stdout = table->iasl_stdout,
+		  *iasl_stderr = table->iasl_stderr;
+	fwts_iasl_text *iasl_disassembly = table->iasl_disassembly;
+
+	if (table->ret != FWTS_OK) {
+		fwts_iasl_text_free(iasl_disassembly);
 		fwts_text_list_free(iasl_stderr);
 		fwts_text_list_free(iasl_stdout);
 		fwts_aborted(fw, "Cannot re-assasemble with iasl.");
@@ -541,24 +720,22 @@ static int syntaxcheck_single_table(
 							syntaxcheck_error_code_to_error_level((uint32_t)error_code);
 						bool skip = false;
 
-						/* trim */
-						fwts_chop_newline(error_text);
-
-						/* Strip out the ^ from the error message */
-						for (ptr = error_text; *ptr; ptr++)
-							if (*ptr == '^')
-								*ptr = ' ';
-
-						/* Look for error message after: "Error:  4042 - " prefix */
-						ptr = strstr(error_text, "-");
-						if (ptr)
-							ptr += 2;
-						else
-							ptr = error_text;	/* Urgh, none found, default */
-
-						/* Skip over leading white space */
-						while (*ptr == ' ')
-							ptr++;
+						ptr = syntaxcheck_error_message(error_text);
+
+						if (baseline) {
+							char diagnostic[4096];
+
+							syntaxcheck_diagnostic(diagnostic, sizeof(diagnostic),
+								error_code, ptr);
+							if (syntaxcheck_baseline_match(baseline, diagnostic)) {
+								fwts_log_info(fw, "Unchanged from baseline in line %d: %s",
+									num, diagnostic);
+								unchanged++;
+								item = item->next;
+								continue;
+							}
+							added++;
+						}
 
 						snprintf(label, sizeof(label), "AMLAsm%s",
 							syntaxcheck_error_code_to_id(error_code));
@@ -626,10 +803,31 @@ static int syntaxcheck_single_table(
 		}
 	}
 
-	fwts_text_list_free(iasl_disassembly);
+	fwts_iasl_text_free(iasl_disassembly);
 	fwts_text_list_free(iasl_stdout);
 	fwts_text_list_free(iasl_stderr);
 
+	if (baseline) {
+		size_t i;
+		int removed = 0;
+
+		for (i = 0; i < baseline->count; i++) {
+			if (!baseline->matched[i]) {
+				fwts_log_info(fw, "Removed since baseline: %s",
+					baseline->diagnostics[i]);
+				removed++;
+			}
+		}
+		fwts_log_info(fw, "Table %s (%d) relative to baseline: %d added, %d removed, %d unchanged.",
+			info->name, n, added, removed, unchanged);
+		if (added == 0)
+			fwts_passed(fw, "%s (%d) reassembly, no new errors, warnings or remarks "
+				"since the baseline.", info->name, n);
+		fwts_log_nl(fw);
+
+		return FWTS_OK;
+	}
+
 	if (errors + warnings + remarks > 0)
 		fwts_log_info(fw, "Table %s (%d) reassembly: Found %d errors, %d warnings, %d remarks.",
 			info->name, n, errors, warnings, remarks);
@@ -641,18 +839,270 @@ static int syntaxcheck_single_table(
 	return FWTS_OK;
 }
 
+/*
+ *  syntaxcheck_reassemble_worker()
+ *	reassemble tables until there are none left
+ */
+static void *syntaxcheck_reassemble_worker(void *arg)
+{
+	syntaxcheck_work *work = (syntaxcheck_work *)arg;
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED)) < work->count) {
+		syntaxcheck_reassembly *table = &work->tables[i];
+
+		if (table->unchanged)
+			continue;
+		table->ret = fwts_iasl_assemble(work->fw, table->info,
+			table->iasl_disassembly, &table->iasl_stdout, &table->iasl_stderr);
+	}
+
+	return NULL;
+}
+
+/*
+ *  syntaxcheck_reassemble()
+ *	disassemble the tables in one iasl session, then reassemble
+ *	them concurrently in up to --syntaxcheck-jobs threads, each
+ *	reassembly forks iasl so the threads just wait.  Tables that
+ *	are unchanged from the baseline are skipped.
+ */
+static void syntaxcheck_reassemble(
+	fwts_framework *fw,
+	syntaxcheck_reassembly *tables,
+	const size_t count)
+{
+	pthread_t threads[SYNTAXCHECK_JOBS_MAX];
+	const fwts_acpi_table_info *info[ACPI_MAX_TABLES];
+	fwts_iasl_text *disassembly[ACPI_MAX_TABLES];
+	syntaxcheck_work work;
+	size_t i, n, jobs, started;
+
+	if (syntaxcheck_jobs > 0)
+		jobs = (size_t)syntaxcheck_jobs;
+	else {
+		const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		jobs = (cpus > 0) ? (size_t)cpus : 1;
+	}
+	if (jobs > SYNTAXCHECK_JOBS_MAX)
+		jobs = SYNTAXCHECK_JOBS_MAX;
+
+	for (i = 0, n = 0; i < count; i++)
+		if (!tables[i].unchanged)
+			info[n++] = tables[i].info;
+	if (n == 0)
+		return;
+	if (jobs > n)
+		jobs = n;
+
+	(void)fwts_iasl_disassemble_session(fw, info, (int)n, true, (int)jobs, disassembly);
+	for (i = 0, n = 0; i < count; i++)
+		if (!tables[i].unchanged)
+			tables[i].iasl_disassembly = disassembly[n++];
+
+	work.fw = fw;
+	work.tables = tables;
+	work.count = count;
+	work.next = 0;
+
+	/* This thread is a worker too */
+	for (started = 0; started + 1 < jobs; started++)
+		if (pthread_create(&threads[started], NULL,
+		    syntaxcheck_reassemble_worker, &work) != 0)
+			break;
+	(void)syntaxcheck_reassemble_worker(&work);
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i], NULL);
+}
+
+/*
+ *  syntaxcheck_table_same()
+ *	tables pair up with the baseline when they have the same
+ *	signature and OEM table id
+ */
+static bool syntaxcheck_table_same(
+	const fwts_acpi_table_info *a,
+	const fwts_acpi_table_info *b)
+{
+	const fwts_acpi_table_header *ha = (const fwts_acpi_table_header *)a->data;
+	const fwts_acpi_table_header *hb = (const fwts_acpi_table_header *)b->data;
+
+	if (strcmp(a->name, b->name))
+		return false;
+	if ((a->length < sizeof(*ha)) || (b->length < sizeof(*hb)))
+		return (a->length < sizeof(*ha)) && (b->length < sizeof(*hb));
+
+	return !memcmp(ha->oem_tbl_id, hb->oem_tbl_id, sizeof(ha->oem_tbl_id));
+}
+
+/*
+ *  syntaxcheck_table_instance()
+ *	how many earlier tables of a set have the same signature
+ *	and OEM table id
+ */
+static int syntaxcheck_table_instance(
+	const fwts_acpi_table_info **set,
+	const size_t index)
+{
+	size_t i;
+	int instance = 0;
+
+	for (i = 0; i < index; i++)
+		if (syntaxcheck_table_same(set[i], set[index]))
+			instance++;
+
+	return instance;
+}
+
+/*
+ *  syntaxcheck_baseline_pair()
+ *	pair each table with the same instance of its signature and
+ *	OEM table id in the baseline, mark the byte identical ones as
+ *	unchanged and set up the baselines of the changed ones for
+ *	reassembly, returns the number of baseline tables to reassemble
+ */
+static size_t syntaxcheck_baseline_pair(
+	fwts_framework *fw,
+	syntaxcheck_reassembly *tables,
+	const size_t count,
+	syntaxcheck_reassembly *baselines)
+{
+	const fwts_acpi_table_info *current[ACPI_MAX_TABLES];
+	const fwts_acpi_table_info *baseline[ACPI_MAX_TABLES];
+	bool paired[ACPI_MAX_TABLES];
+	size_t i, j, baseline_count = 0, n = 0;
+
+	for (i = 0; i < count; i++)
+		current[i] = tables[i].info;
+	for (i = 0; i < ACPI_MAX_TABLES; i++) {
+		fwts_acpi_table_info *info = &syntaxcheck_baseline_tables[i];
+
+		if (info->data == NULL)
+			break;
+		if (info->has_aml) {
+			paired[baseline_count] = false;
+			baseline[baseline_count++] = info;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		const int instance = syntaxcheck_table_instance(current, i);
+
+		for (j = 0; j < baseline_count; j++) {
+			if (paired[j] ||
+			    !syntaxcheck_table_same(baseline[j], current[i]) ||
+			    (syntaxcheck_table_instance(baseline, j) != instance))
+				continue;
+
+			paired[j] = true;
+			if ((baseline[j]->length == current[i]->length) &&
+			    !memcmp(baseline[j]->data, current[i]->data, current[i]->length)) {
+				tables[i].unchanged = true;
+			} else {
+				baselines[n].info = baseline[j];
+				tables[i].baseline = &baselines[n++];
+			}
+			break;
+		}
+	}
+
+	for (j = 0; j < baseline_count; j++)
+		if (!paired[j])
+			fwts_log_info(fw, "Baseline table %s is no longer present.",
+				baseline[j]->name);
+
+	return n;
+}
+
+/*
+ *  syntaxcheck_baseline_reassemble()
+ *	reassemble the changed baseline tables, iasl is switched over
+ *	to the baseline table set so their externals come from it
+ */
+static void syntaxcheck_baseline_reassemble(
+	fwts_framework *fw,
+	syntaxcheck_reassembly *baselines,
+	const size_t count)
+{
+	if (count == 0)
+		return;
+
+	fwts_iasl_deinit();
+	if (fwts_iasl_init_tables(fw, syntaxcheck_baseline_tables) == FWTS_OK)
+		syntaxcheck_reassemble(fw, baselines, count);
+	else
+		fwts_log_error(fw, "Cannot initialise iasl for the baseline tables, "
+			"all diagnostics of changed tables are reported as added.");
+	fwts_iasl_deinit();
+
+	if (fwts_iasl_init(fw) != FWTS_OK)
+		fwts_log_error(fw, "Failure to initialise iasl.");
+}
+
 static int syntaxcheck_tables(fwts_framework *fw)
 {
-	int i, n;
+	syntaxcheck_reassembly *tables, *baselines = NULL;
+	size_t count = 0, baseline_count = 0;
+	int i;
 
-	for (i = 0, n = 0; i < ACPI_MAX_TABLES; i++) {
+	if ((tables = calloc(ACPI_MAX_TABLES, sizeof(*tables))) == NULL) {
+		fwts_log_error(fw, "Cannot allocate table list.");
+		return FWTS_ERROR;
+	}
+
+	for (i = 0; i < ACPI_MAX_TABLES; i++) {
 		fwts_acpi_table_info *info;
 
 		if (fwts_acpi_get_table(fw, i, &info) != FWTS_OK)
 			break;
 		if (info && info->has_aml)
-			syntaxcheck_single_table(fw, info, n++);
+			tables[count++].info = info;
+	}
+
+	if (syntaxcheck_baseline_tables) {
+		if ((baselines = calloc(ACPI_MAX_TABLES, sizeof(*baselines))) == NULL) {
+			fwts_log_error(fw, "Cannot allocate baseline table list.");
+			free(tables);
+			return FWTS_ERROR;
+		}
+		baseline_count = syntaxcheck_baseline_pair(fw, tables, count, baselines);
+		syntaxcheck_baseline_reassemble(fw, baselines, baseline_count);
+	}
+
+	syntaxcheck_reassemble(fw, tables, count);
+
+	/* Report in table order so the log does not depend on the jobs */
+	for (i = 0; i < (int)count; i++) {
+		syntaxcheck_reassembly *baseline = tables[i].baseline;
+		syntaxcheck_diagnostics diagnostics;
+
+		if (tables[i].unchanged) {
+			fwts_log_nl(fw);
+			fwts_skipped(fw, "ACPI table %s (#%d) is identical to the baseline, "
+				"not reassembling it.", tables[i].info->name, i);
+			continue;
+		}
+		if (syntaxcheck_baseline_tables == NULL) {
+			syntaxcheck_single_table(fw, &tables[i], i, NULL);
+			continue;
+		}
+
+		/* A new table, or one whose baseline failed, has all its diagnostics added */
+		memset(&diagnostics, 0, sizeof(diagnostics));
+		if (baseline && (baseline->ret == FWTS_OK))
+			syntaxcheck_baseline_diagnostics(baseline->iasl_stderr, &diagnostics);
+		syntaxcheck_single_table(fw, &tables[i], i, &diagnostics);
+		syntaxcheck_baseline_free(&diagnostics);
+	}
+
+	for (i = 0; i < (int)baseline_count; i++) {
+		fwts_iasl_text_free(baselines[i].iasl_disassembly);
+		fwts_text_list_free(baselines[i].iasl_stdout);
+		fwts_text_list_free(baselines[i].iasl_stderr);
 	}
+	free(baselines);
+	free(tables);
 
 	return FWTS_OK;
 }
@@ -662,11 +1112,49 @@ static fwts_framework_minor_test syntaxcheck_tests[] = {
 	{ NULL, NULL }
 };
 
+static int syntaxcheck_options_handler(
+	fwts_framework *fw,
+	int argc,
+	char * const argv[],
+	int option_char,
+	int long_index)
+{
+	FWTS_UNUSED(fw);
+	FWTS_UNUSED(argc);
+	FWTS_UNUSED(argv);
+
+	if (option_char == 0) {
+		switch (long_index) {
+		case 0:	/* --syntaxcheck-jobs */
+			syntaxcheck_jobs = atoi(optarg);
+			if ((syntaxcheck_jobs < 0) || (syntaxcheck_jobs > SYNTAXCHECK_JOBS_MAX)) {
+				fprintf(stderr, "--syntaxcheck-jobs must be between 0 and %d.\n",
+					SYNTAXCHECK_JOBS_MAX);
+				return FWTS_ERROR;
+			}
+			break;
+		case 1:	/* --baseline-tables */
+			syntaxcheck_baseline_path = optarg;
+			break;
+		}
+	}
+
+	return FWTS_OK;
+}
+
+static fwts_option syntaxcheck_options[] = {
+	{ "syntaxcheck-jobs",	"", 1, "Reassemble up to N tables at once, 0 for one per CPU, e.g. --syntaxcheck-jobs=4" },
+	{ "baseline-tables",	"", 1, "Only report diagnostics new since the ACPI tables in the given directory or acpidump file, e.g. --baseline-tables=old" },
+	{ NULL, NULL, 0, NULL }
+};
+
 static fwts_framework_ops syntaxcheck_ops = {
-	.description = "Re-assemble DSDT and SSDTs to find syntax errors and warnings.",
-	.init        = syntaxcheck_init,
-	.deinit      = syntaxcheck_deinit,
-	.minor_tests = syntaxcheck_tests
+	.description     = "Re-assemble DSDT and SSDTs to find syntax errors and warnings.",
+	.init            = syntaxcheck_init,
+	.deinit          = syntaxcheck_deinit,
+	.minor_tests     = syntaxcheck_tests,
+	.options         = syntaxcheck_options,
+	.options_handler = syntaxcheck_options_handler,
 };
 
 FWTS_REGISTER("syntaxcheck", &syntaxcheck_ops, FWTS_TEST_ANYTIME, FWTS_FLAG_BATCH_EXPERIMENTAL)
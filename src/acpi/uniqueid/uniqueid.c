@@ -63,14 +63,15 @@ static int uniqueid_evaluate_method(fwts_framework *fw,
 	fwts_method_return check_func,
 	void *private)
 {
-	fwts_list *methods;
+	const fwts_acpica_nodes *nodes;
 	const size_t name_len = strlen(name);
 
-	if ((methods = fwts_acpi_object_get_names()) != NULL) {
-		fwts_list_link	*item;
+	if ((nodes = fwts_acpi_object_get_nodes()) != NULL) {
+		size_t i;
 
-		fwts_list_foreach(item, methods) {
-			char *method_name = fwts_list_data(char*, item);
+		for (i = 0; i < nodes->count; i++) {
+			const fwts_acpica_node *node = &nodes->nodes[i];
+			char *method_name = nodes->strings + node->path;
 			ACPI_HANDLE method_handle;
 			ACPI_OBJECT_TYPE type;
 			ACPI_STATUS status;
@@ -79,16 +80,11 @@ static int uniqueid_evaluate_method(fwts_framework *fw,
 			if (strncmp(name, method_name + len - name_len, name_len) == 0) {
 				ACPI_OBJECT_LIST  arg_list;
 
-				status = AcpiGetHandle (NULL, method_name, &method_handle);
+				status = fwts_acpi_object_node_get(nodes, node, &method_handle, &type);
 				if (ACPI_FAILURE(status)) {
 					fwts_warning(fw, "Failed to get handle for object %s.", name);
 					continue;
 				}
-				status = AcpiGetType(method_handle, &type);
-				if (ACPI_FAILURE(status)) {
-					fwts_warning(fw, "Failed to get object type for %s.",name);
-					continue;
-				}
 
 				if (type == ACPI_TYPE_LOCAL_SCOPE)
 					continue;
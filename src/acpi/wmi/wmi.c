@@ -144,11 +144,12 @@ static bool wmi_advice_given;
 
 /*
  *  wmi_init()
- *	initialize ACPI
+ *	initialize ACPI, only the namespace is needed unless
+ *	_WDG is a control method
  */
 static int wmi_init(fwts_framework *fw)
 {
-	if (fwts_acpi_init(fw) != FWTS_OK) {
+	if (fwts_acpi_namespace_init(fw) != FWTS_OK) {
 		fwts_log_error(fw, "Cannot initialise ACPI.");
 		return FWTS_ERROR;
 	}
@@ -162,7 +163,7 @@ static int wmi_init(fwts_framework *fw)
  */
 static int wmi_deinit(fwts_framework *fw)
 {
-	return fwts_acpi_deinit(fw);
+	return fwts_acpi_namespace_deinit(fw);
 }
 
 /*
@@ -494,11 +495,29 @@ static int wmi_test1(fwts_framework *fw)
 		const size_t len = strlen(name);
 
 		if (strncmp("_WDG", name + len - name_len, name_len) == 0) {
+			const fwts_acpi_namespace_node *node = fwts_acpi_namespace_find(name);
 			ACPI_OBJECT_LIST arg_list;
 			ACPI_BUFFER buf;
 			ACPI_OBJECT *obj;
 			int ret;
 
+			/* Use the value of a Name() without evaluating it */
+			if (node && (node->value_type == FWTS_ACPI_NAMESPACE_VALUE_BUFFER)) {
+				if (node->value_length > 0) {
+					wmi_parse_wdg_data(fw, name,
+						node->value_length, node->value);
+					wdg_found = true;
+				}
+				continue;
+			}
+			if (node && ((node->type == ACPI_TYPE_INTEGER) ||
+				     (node->type == ACPI_TYPE_STRING) ||
+				     (node->type == ACPI_TYPE_BUFFER) ||
+				     (node->type == ACPI_TYPE_PACKAGE)))
+				continue;
+			if (fwts_acpi_namespace_interpreter(fw) != FWTS_OK)
+				continue;
+
 			arg_list.Count   = 0;
 			arg_list.Pointer = NULL;
 
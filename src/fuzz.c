@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  fwts-fuzz: run one ACPI table test in-process against fuzzed tables.
+ *
+ *  The input is injected as the table the test checks and the test's
+ *  minor tests are run with all logging discarded; all state is reset
+ *  between runs.  Tests that also need other tables (e.g. madt needs the
+ *  FADT) get them from an acpidump file, all tables in it other than the
+ *  one being fuzzed are injected alongside the input on each run.
+ *
+ *  Built with -DFWTS_FUZZ_LIBFUZZER and -fsanitize=fuzzer this provides
+ *  a libFuzzer target, the test and acpidump file are then selected with
+ *  the FWTS_FUZZ_TEST and FWTS_FUZZ_DUMP environment variables.
+ *  Otherwise a standalone driver is built:
+ *
+ *	fwts-fuzz [-d acpidump] [-n iterations] [-v] test [file ...]
+ *
+ *  that runs the test on each file (or stdin), -v shows the results of
+ *  the last run on each input.  It loops in AFL persistent mode when
+ *  built with afl-clang-fast.  FWTS_FUZZ_TABLE overrides the name of the
+ *  table the input is injected as.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <inttypes.h>
+
+#include "fwts.h"
+
+#define FUZZ_MAX_SIZE	(1024 * 1024)
+
+typedef struct {
+	const char *test;	/* fwts test name */
+	const char *table;	/* table the test checks */
+} fwts_fuzz_target;
+
+static const fwts_fuzz_target fuzz_targets[] = {
+	{ "madt",	"APIC" },
+	{ "hest",	"HEST" },
+	{ "iort",	"IORT" },
+	{ "nfit",	"NFIT" },
+	{ "pptt",	"PPTT" },
+	{ "cedt",	"CEDT" },
+	{ "hmat",	"HMAT" },
+	{ "slit",	"SLIT" },
+	{ "srat",	"SRAT" },
+	{ NULL,		NULL }
+};
+
+typedef struct {
+	char name[5];
+	void *data;
+	size_t length;
+	uint64_t addr;
+} fwts_fuzz_table;
+
+static fwts_framework *fuzz_fw;
+static const char *fuzz_table;
+static fwts_fuzz_table fuzz_tables[ACPI_MAX_TABLES];
+static int fuzz_tables_count;
+static bool fuzz_verbose;
+
+/*
+ *  fuzz_load_tables()
+ *	load the tables the test needs besides the one being fuzzed
+ */
+static int fuzz_load_tables(const char *acpidump)
+{
+	int i;
+
+	free(fuzz_fw->acpi_table_acpidump_file);
+	if ((fuzz_fw->acpi_table_acpidump_file = strdup(acpidump)) == NULL)
+		return FWTS_ERROR;
+
+	if (fwts_acpi_load_tables(fuzz_fw) != FWTS_OK) {
+		fprintf(stderr, "Cannot load ACPI tables from %s.\n", acpidump);
+		return FWTS_ERROR;
+	}
+
+	for (i = 0; i < ACPI_MAX_TABLES; i++) {
+		fwts_acpi_table_info *info;
+		fwts_fuzz_table *table = &fuzz_tables[fuzz_tables_count];
+
+		if ((fwts_acpi_get_table(fuzz_fw, i, &info) != FWTS_OK) || !info)
+			break;
+		if (!strcmp(info->name, fuzz_table))
+			continue;
+
+		if ((table->data = malloc(info->length)) == NULL) {
+			fprintf(stderr, "Cannot allocate table %s.\n", info->name);
+			return FWTS_ERROR;
+		}
+		memcpy(table->name, info->name, sizeof(table->name));
+		memcpy(table->data, info->data, info->length);
+		table->length = info->length;
+		table->addr = info->addr;
+		fuzz_tables_count++;
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fuzz_free_tables()
+ *	free the tables loaded by fuzz_load_tables()
+ */
+static void fuzz_free_tables(void)
+{
+	int i;
+
+	for (i = 0; i < fuzz_tables_count; i++)
+		free(fuzz_tables[i].data);
+	fuzz_tables_count = 0;
+}
+
+/*
+ *  fuzz_run()
+ *	run the test once with data injected as the fuzzed table
+ */
+static int fuzz_run(const uint8_t *data, const size_t size)
+{
+	int i;
+
+	if (fwts_framework_fuzz_reset(fuzz_fw) != FWTS_OK)
+		return FWTS_ERROR;
+
+	for (i = 0; i < fuzz_tables_count; i++)
+		if (fwts_acpi_inject_table(fuzz_tables[i].name,
+		    fuzz_tables[i].data, fuzz_tables[i].length,
+		    fuzz_tables[i].addr) != FWTS_OK)
+			return FWTS_ERROR;
+
+	if (fwts_acpi_inject_table(fuzz_table, data, size, 0) != FWTS_OK)
+		return FWTS_ERROR;
+
+	return fwts_framework_fuzz_run(fuzz_fw);
+}
+
+/*
+ *  fuzz_init()
+ *	set up the framework to run the named test
+ */
+static int fuzz_init(const char *test, const char *acpidump)
+{
+	const fwts_fuzz_target *target;
+
+	fuzz_table = getenv("FWTS_FUZZ_TABLE");
+	for (target = fuzz_targets; !fuzz_table && target->test; target++)
+		if (!strcmp(target->test, test))
+			fuzz_table = target->table;
+
+	if (!fuzz_table || strlen(fuzz_table) != 4) {
+		fprintf(stderr, "No table known for test '%s', "
+			"set FWTS_FUZZ_TABLE to a 4 character table name.\n", test);
+		return FWTS_ERROR;
+	}
+
+	if ((fuzz_fw = fwts_framework_fuzz_new(test)) == NULL) {
+		fprintf(stderr, "Cannot run test '%s'.\n", test);
+		return FWTS_ERROR;
+	}
+
+	if (acpidump && (fuzz_load_tables(acpidump) != FWTS_OK)) {
+		fuzz_free_tables();
+		fwts_framework_fuzz_free(fuzz_fw);
+		return FWTS_ERROR;
+	}
+
+	return FWTS_OK;
+}
+
+#if defined(FWTS_FUZZ_LIBFUZZER)
+
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+	const char *test = getenv("FWTS_FUZZ_TEST");
+
+	FWTS_UNUSED(argc);
+	FWTS_UNUSED(argv);
+
+	if (fuzz_init(test ? test : "madt", getenv("FWTS_FUZZ_DUMP")) != FWTS_OK)
+		exit(EXIT_FAILURE);
+
+	return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	(void)fuzz_run(data, size);
+
+	return 0;
+}
+
+#else
+
+/*
+ *  fuzz_read()
+ *	read up to FUZZ_MAX_SIZE bytes of input from fd
+ */
+static ssize_t fuzz_read(const int fd, uint8_t *buf)
+{
+	size_t size = 0;
+
+	while (size < FUZZ_MAX_SIZE) {
+		ssize_t n = read(fd, buf + size, FUZZ_MAX_SIZE - size);
+
+		if (n < 0)
+			return -1;
+		if (n == 0)
+			break;
+		size += n;
+	}
+	return size;
+}
+
+/*
+ *  fuzz_run_fd()
+ *	run the test iterations times on input read from fd
+ */
+static int fuzz_run_fd(
+	const int fd,
+	const char *name,
+	uint8_t *buf,
+	const unsigned long iterations)
+{
+	ssize_t size;
+	unsigned long i;
+
+	if ((size = fuzz_read(fd, buf)) < 0)
+		return FWTS_ERROR;
+
+	for (i = 0; i < iterations; i++)
+		(void)fuzz_run(buf, size);
+
+	if (fuzz_verbose)
+		printf("%s: %zd bytes, %" PRIu32 " passed, %" PRIu32 " failed, "
+			"%" PRIu32 " warning, %" PRIu32 " aborted, %" PRIu32 " skipped\n",
+			name, size, fuzz_fw->total.passed, fuzz_fw->total.failed,
+			fuzz_fw->total.warning, fuzz_fw->total.aborted,
+			fuzz_fw->total.skipped);
+
+	return FWTS_OK;
+}
+
+static void fuzz_syntax(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-d acpidump] [-n iterations] [-v] test [file ...]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t *buf;
+	const char *acpidump = NULL;
+	unsigned long iterations = 1, runs = 0;
+	struct timespec start, end;
+	double secs;
+	int opt, ret = EXIT_SUCCESS;
+
+	while ((opt = getopt(argc, argv, "d:n:vh")) != -1) {
+		switch (opt) {
+		case 'd':
+			acpidump = optarg;
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 10);
+			break;
+		case 'v':
+			fuzz_verbose = true;
+			break;
+		default:
+			fuzz_syntax(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind >= argc) {
+		fuzz_syntax(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (fuzz_init(argv[optind++], acpidump) != FWTS_OK)
+		exit(EXIT_FAILURE);
+
+	if ((buf = malloc(FUZZ_MAX_SIZE)) == NULL) {
+		fprintf(stderr, "Cannot allocate input buffer.\n");
+		fuzz_free_tables();
+		fwts_framework_fuzz_free(fuzz_fw);
+		exit(EXIT_FAILURE);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+#if defined(__AFL_LOOP)
+	if (optind >= argc) {
+		while (__AFL_LOOP(10000)) {
+			(void)fuzz_run_fd(STDIN_FILENO, "stdin", buf, iterations);
+			runs += iterations;
+		}
+	}
+#else
+	if (optind >= argc) {
+		if (fuzz_run_fd(STDIN_FILENO, "stdin", buf, iterations) != FWTS_OK) {
+			fprintf(stderr, "Cannot read input from stdin.\n");
+			ret = EXIT_FAILURE;
+		}
+		runs += iterations;
+	}
+#endif
+	for (; optind < argc; optind++) {
+		int fd;
+
+		if ((fd = open(argv[optind], O_RDONLY)) < 0) {
+			fprintf(stderr, "Cannot open %s.\n", argv[optind]);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+		if (fuzz_run_fd(fd, argv[optind], buf, iterations) != FWTS_OK) {
+			fprintf(stderr, "Cannot read %s.\n", argv[optind]);
+			ret = EXIT_FAILURE;
+		}
+		(void)close(fd);
+		runs += iterations;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	secs = (double)(end.tv_sec - start.tv_sec) +
+	       (double)(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+	if (iterations > 1 && secs > 0.0)
+		fprintf(stderr, "%lu runs in %.3f seconds, %.0f runs/second\n",
+			runs, secs, (double)runs / secs);
+
+	free(buf);
+	fuzz_free_tables();
+	fwts_framework_fuzz_free(fuzz_fw);
+
+	exit(ret);
+}
+
+#endif
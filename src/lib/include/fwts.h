@@ -163,6 +163,7 @@
 #include "fwts_binpaths.h"
 #include "fwts_framework.h"
 #include "fwts_log.h"
+#include "fwts_log_capture.h"
 #include "fwts_log_scan.h"
 #include "fwts_list.h"
 #include "fwts_text_list.h"
@@ -170,6 +171,9 @@
 #include "fwts_get.h"
 #include "fwts_acpi.h"
 #include "fwts_acpi_tables.h"
+#include "fwts_acpi_coverage.h"
+#include "fwts_acpi_namespace.h"
+#include "fwts_acpi_region_trace.h"
 #include "fwts_acpid.h"
 #include "fwts_arch.h"
 #include "fwts_checkeuid.h"
@@ -219,5 +223,7 @@
 #include "fwts_devicetree.h"
 #include "fwts_pm_debug.h"
 #include "fwts_modprobe.h"
+#include "fwts_numa.h"
+#include "fwts_range_index.h"
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __FWTS_ACPI_NAMESPACE_H__
+#define __FWTS_ACPI_NAMESPACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fwts_framework.h"
+#include "fwts_list.h"
+
+#define FWTS_ACPI_NAMESPACE_MAGIC	"FWTSNSS1"
+#define FWTS_ACPI_NAMESPACE_VERSION	(1)
+#define FWTS_ACPI_NAMESPACE_NONE	(0xffffffff)	/* No parent or AML table */
+
+typedef enum {
+	FWTS_ACPI_NAMESPACE_VALUE_NONE = 0,	/* No static value */
+	FWTS_ACPI_NAMESPACE_VALUE_INTEGER,
+	FWTS_ACPI_NAMESPACE_VALUE_STRING,
+	FWTS_ACPI_NAMESPACE_VALUE_BUFFER,
+} fwts_acpi_namespace_value_type;
+
+/*
+ *  Namespace snapshot file layout, a header followed by the
+ *  tables, nodes, a string pool of node paths and a data pool
+ *  of static values.  Nodes are in namespace walk order, each
+ *  parent before its children.
+ */
+typedef struct {
+	char		magic[8];		/* FWTS_ACPI_NAMESPACE_MAGIC */
+	uint32_t	version;		/* FWTS_ACPI_NAMESPACE_VERSION */
+	uint32_t	tables;			/* Number of AML tables */
+	uint32_t	nodes;			/* Number of nodes */
+	uint32_t	strings_size;		/* Size of string pool */
+	uint32_t	data_size;		/* Size of data pool */
+	uint32_t	reserved;
+	uint64_t	fingerprint;		/* Of the AML tables loaded */
+} __attribute__ ((packed)) fwts_acpi_namespace_file_header;
+
+typedef struct {
+	char		signature[4];
+	char		oem_tbl_id[8];
+	uint32_t	length;
+} __attribute__ ((packed)) fwts_acpi_namespace_file_table;
+
+typedef struct {
+	uint32_t	parent;			/* Parent node index */
+	char		name[4];		/* Node name */
+	uint32_t	path;			/* Offset of path in string pool */
+	uint8_t		type;			/* ACPI_TYPE_* */
+	uint8_t		value_type;		/* fwts_acpi_namespace_value_type */
+	uint8_t		args;			/* Control method argument count */
+	uint8_t		reserved;
+	uint32_t	table;			/* Table of control method AML */
+	uint32_t	aml_offset;		/* Offset of control method AML in table */
+	uint32_t	aml_length;		/* Length of control method AML */
+	uint32_t	value_offset;		/* Offset of string or buffer in data pool */
+	uint32_t	value_length;		/* Length of string or buffer */
+	uint64_t	integer;		/* Integer value */
+} __attribute__ ((packed)) fwts_acpi_namespace_file_node;
+
+/*
+ *  A namespace node of a loaded snapshot
+ */
+typedef struct {
+	const char	*path;			/* As from fwts_acpi_object_get_names() */
+	uint32_t	parent;			/* Parent node index, or FWTS_ACPI_NAMESPACE_NONE */
+	char		name[5];		/* Node name */
+	uint8_t		type;			/* ACPI_TYPE_* */
+	uint8_t		value_type;		/* fwts_acpi_namespace_value_type of static value */
+	uint8_t		args;			/* Control method argument count */
+	uint32_t	table;			/* Control method table index, or FWTS_ACPI_NAMESPACE_NONE */
+	uint32_t	aml_offset;		/* Offset of control method AML in table */
+	uint32_t	aml_length;		/* Length of control method AML */
+	uint64_t	integer;		/* Static integer value */
+	const uint8_t	*value;			/* Static string or buffer value */
+	uint32_t	value_length;		/* Length of string or buffer value */
+} fwts_acpi_namespace_node;
+
+uint64_t fwts_acpi_namespace_fingerprint(fwts_framework *fw);
+int  fwts_acpi_namespace_export(fwts_framework *fw);
+int  fwts_acpi_namespace_init(fwts_framework *fw);
+int  fwts_acpi_namespace_deinit(fwts_framework *fw);
+int  fwts_acpi_namespace_interpreter(fwts_framework *fw);
+bool fwts_acpi_namespace_loaded(void);
+fwts_list *fwts_acpi_namespace_names(void);
+const fwts_acpi_namespace_node *fwts_acpi_namespace_find(const char *path);
+const fwts_acpi_namespace_node *fwts_acpi_namespace_nodes(size_t *count);
+const fwts_acpi_namespace_file_table *fwts_acpi_namespace_tables(size_t *count);
+
+#endif
@@ -31,12 +31,25 @@ int fwts_acpi_init(fwts_framework *fw);
 int fwts_acpi_deinit(fwts_framework *fw);
 char *fwts_acpi_object_exists(const char *name);
 fwts_list *fwts_acpi_object_get_names(void);
+const fwts_acpica_nodes *fwts_acpi_object_get_nodes(void);
+ACPI_STATUS fwts_acpi_object_node_get(const fwts_acpica_nodes *nodes,
+	const fwts_acpica_node *node, ACPI_HANDLE *handle, ACPI_OBJECT_TYPE *type);
 void fwts_acpi_object_dump(fwts_framework *fw, const ACPI_OBJECT *obj);
 void fwts_acpi_object_evaluate_report_error(fwts_framework *fw,
 	const char *name, const ACPI_STATUS status);
 ACPI_STATUS fwts_acpi_object_evaluate(fwts_framework *fw, char *name,
 	ACPI_OBJECT_LIST *arg_list, ACPI_BUFFER *buf);
 
+typedef struct {
+	uint64_t hits;		/* Results returned from the cache */
+	uint64_t misses;	/* Results that had to be evaluated */
+} fwts_acpi_object_cache_stats;
+
+ACPI_STATUS fwts_acpi_object_cache_evaluate(ACPI_HANDLE scope,
+	const char *pathname, ACPI_BUFFER *buf);
+void fwts_acpi_object_cache_flush(void);
+void fwts_acpi_object_cache_stats_get(fwts_acpi_object_cache_stats *stats);
+
 /* Test types */
 #define METHOD_MANDATORY	1
 #define METHOD_OPTIONAL		2
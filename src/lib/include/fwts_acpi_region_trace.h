@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __FWTS_ACPI_REGION_TRACE_H__
+#define __FWTS_ACPI_REGION_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fwts_framework.h"
+
+/*
+ *  Address used for PCI configuration space reads made through
+ *  AcpiOsReadPciConfiguration(), ECAM style
+ */
+#define FWTS_REGION_TRACE_PCI_ADDR(seg, bus, dev, func, reg)	\
+	(((uint64_t)(seg) << 32) | ((uint64_t)(bus) << 20) |	\
+	 ((uint64_t)(dev) << 15) | ((uint64_t)(func) << 12) |	\
+	 (uint64_t)(reg))
+
+typedef struct {
+	uint64_t hits;		/* Reads served from the trace */
+	uint64_t misses;	/* Reads not in the trace, faked */
+} fwts_acpi_region_trace_stats;
+
+int  fwts_acpi_region_trace_load(const char *filename);
+void fwts_acpi_region_trace_free(void);
+void fwts_acpi_region_trace_rewind(void);
+bool fwts_acpi_region_trace_read(const uint8_t space_id, const uint64_t address,
+	const uint32_t width, uint64_t *value);
+void fwts_acpi_region_trace_stats_get(fwts_acpi_region_trace_stats *stats);
+int  fwts_acpi_region_trace_capture(fwts_framework *fw, const char *filename);
+
+#endif
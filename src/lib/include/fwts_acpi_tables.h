@@ -60,6 +60,10 @@ static int name ## _init (fwts_framework *fw)			\
 
 int fwts_acpi_load_tables(fwts_framework *fw);
 int fwts_acpi_free_tables(void);
+fwts_acpi_table_info *fwts_acpi_load_table_set(fwts_framework *fw, const char *path);
+void fwts_acpi_free_table_set(fwts_acpi_table_info *set);
+int fwts_acpi_inject_table(const char *name, const void *data, const size_t length,
+	const uint64_t addr);
 
 int fwts_acpi_find_table(fwts_framework *fw, const char *name, const uint32_t which,
 	fwts_acpi_table_info **info);
@@ -24,13 +24,92 @@
 
 typedef void (*fwts_acpica_log_callback)(fwts_framework *fw, const char *buffer);
 
+typedef struct {
+	uint64_t queued;	/* Deferred calls queued by AcpiOsExecute */
+	uint64_t executed;	/* Deferred calls completed */
+	uint64_t dropped;	/* Deferred calls dropped, queue full */
+} fwts_acpica_execute_stats;
+
+typedef struct {
+	char path[256];		/* OperationRegion name */
+	const char *space_name;	/* Address space name */
+	uint8_t space_id;	/* Address space id */
+	uint64_t address;	/* Region start */
+	uint64_t length;	/* Region length in bytes */
+} fwts_acpica_region;
+
+typedef enum {
+	FWTS_ACPICA_BUDGET_OK = 0,	/* Evaluation ran within its budget */
+	FWTS_ACPICA_BUDGET_OPCODES,	/* Aborted, ran out of opcodes */
+	FWTS_ACPICA_BUDGET_TIME,	/* Aborted, ran out of wall time */
+} fwts_acpica_budget_reason;
+
+typedef struct {
+	char *path;		/* Fully qualified method name */
+	uint32_t offset;	/* Offset of the method AML in its table */
+	uint32_t length;	/* Length of the method AML */
+} fwts_acpica_coverage_method;
+
+typedef struct {
+	fwts_acpi_table_header header;	/* Header of the table covered */
+	uint8_t *executed;		/* Bit per table byte, set for opcodes executed */
+	fwts_acpica_coverage_method *methods;	/* Control methods in the table */
+	size_t methods_count;
+	size_t methods_size;
+	bool methods_done;		/* Control methods have been recorded */
+} fwts_acpica_coverage_table;
+
+#define FWTS_ACPICA_NODE_NONE	(0xffffffff)	/* No parent node */
+
+typedef struct {
+	void *handle;		/* ACPI_HANDLE of the node */
+	uint32_t parent;	/* Index of parent node, or FWTS_ACPICA_NODE_NONE */
+	uint32_t path;		/* Offset of full path in the string pool */
+	char name[4];		/* Node name, not '\0' terminated */
+	uint8_t type;		/* ACPI_TYPE_* of the node */
+} fwts_acpica_node;
+
+typedef struct {
+	fwts_acpica_node *nodes;	/* Nodes in namespace walk order */
+	size_t count;
+	char *strings;		/* Interned node paths */
+	size_t strings_size;
+	uint32_t unloads;	/* Table unloads when walked, see fwts_acpica_nodes_valid() */
+} fwts_acpica_nodes;
+
 void fwts_acpica_set_fwts_framework(fwts_framework *fw);
 int  fwts_acpica_init(fwts_framework *fw);
 int  fwts_acpica_deinit(void);
 fwts_list *fwts_acpica_get_object_names(const int type);
+fwts_acpica_nodes *fwts_acpica_get_nodes(void);
+void fwts_acpica_nodes_free(fwts_acpica_nodes *nodes);
+bool fwts_acpica_nodes_valid(const fwts_acpica_nodes *nodes);
+fwts_list *fwts_acpica_get_regions(void);
 void fwts_acpica_sem_count_clear(void);
 void fwts_acpica_sem_count_get(int *acquired, int *released);
+void fwts_acpica_execute_stats_get(fwts_acpica_execute_stats *stats);
+void fwts_acpica_fork_prepare(void);
+void fwts_acpica_fork_child(void);
 void fwts_acpi_region_handler_called_set(const bool val);
 bool fwts_acpi_region_handler_called_get(void);
+void fwts_acpica_profile_start(void);
+void fwts_acpica_profile_stop(void);
+bool fwts_acpica_profile_enabled(void);
+void fwts_acpica_profile_region(const uint8_t space_id);
+void fwts_acpica_profile_report(fwts_framework *fw);
+void fwts_acpica_budget_set(const uint64_t opcodes, const uint32_t ms);
+void fwts_acpica_budget_get(uint64_t *opcodes, uint32_t *ms);
+void fwts_acpica_budget_begin(void);
+fwts_acpica_budget_reason fwts_acpica_budget_exceeded(void);
+void fwts_acpica_coverage_start(void);
+void fwts_acpica_coverage_stop(void);
+bool fwts_acpica_coverage_enabled(void);
+void fwts_acpica_coverage_opcode(const uint8_t *aml);
+fwts_acpica_coverage_table * const *fwts_acpica_coverage_get(size_t *count);
+void fwts_acpica_coverage_free(void);
+int fwts_acpica_namespace_snapshot(const uint64_t fingerprint, void **data, size_t *length);
+void fwts_acpica_side_effects_clear(void);
+bool fwts_acpica_side_effects_get(void);
+uint32_t fwts_acpica_namespace_generation(void);
 
 #endif
@@ -26,5 +26,32 @@ int fwts_lib_efi_runtime_open(void);
 int fwts_lib_efi_runtime_close(const int fd);
 int fwts_lib_efi_runtime_kernel_lockdown(fwts_framework *fw);
 int fwts_lib_efi_runtime_module_init(fwts_framework *fw, int *fd);
+int fwts_lib_efi_runtime_ioctl(const int fd, const unsigned long request, void *arg);
+
+int fwts_efi_emulator_init(fwts_framework *fw);
+void fwts_efi_emulator_deinit(void);
+int fwts_efi_emulator_efivarfs(fwts_framework *fw);
+int fwts_efi_emulator_ioctl(const unsigned long request, void *arg);
+
+#define FWTS_EFI_HISTOGRAM_LINEAR	(16)	/* Latencies below are bucketed exactly */
+#define FWTS_EFI_HISTOGRAM_SUB_BITS	(3)	/* 8 buckets per power of two above */
+#define FWTS_EFI_HISTOGRAM_BUCKETS	\
+	(FWTS_EFI_HISTOGRAM_LINEAR + (64 - 4) * (1 << FWTS_EFI_HISTOGRAM_SUB_BITS))
+
+/* Log-linear latency histogram, in nanoseconds */
+typedef struct {
+	uint64_t	buckets[FWTS_EFI_HISTOGRAM_BUCKETS];
+	uint64_t	calls;
+	uint64_t	max_ns;
+} fwts_efi_histogram;
+
+void fwts_efi_histogram_add(fwts_efi_histogram *histogram, const uint64_t ns);
+uint64_t fwts_efi_histogram_percentile(const fwts_efi_histogram *histogram, const double fraction);
+
+uint64_t fwts_efi_profile_time(void);
+void fwts_efi_profile_start(void);
+void fwts_efi_profile_sample(const unsigned long request, void *arg,
+	const uint64_t start_ns, const uint64_t end_ns);
+void fwts_efi_profile_report(fwts_framework *fw);
 
 #endif
@@ -37,6 +37,16 @@ typedef struct fwts_framework fwts_framework;
 
 #define FWTS_FRAMEWORK_MAGIC	0x2af61aec98b7315fULL
 
+#define FWTS_EFI_EMULATOR_STORE_SIZE	(65536)	/* Default --efi-emulator variable store size */
+#define FWTS_UEFI_RT_THRESHOLD_US	(1000)	/* Default --uefi-rt-threshold */
+
+/* --efi-emulator-reclaim, when the store gets back deleted variable space */
+typedef enum {
+	FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE = 0,	/* At once */
+	FWTS_EFI_EMULATOR_RECLAIM_FULL,			/* When a write does not fit */
+	FWTS_EFI_EMULATOR_RECLAIM_BOOT,			/* Not until the next boot */
+} fwts_efi_emulator_reclaim;
+
 typedef enum {
 	FWTS_FLAG_DEFAULT			= 0x00000000,
 	FWTS_FLAG_STDOUT_SUMMARY		= 0x00000001,
@@ -63,6 +73,11 @@ typedef enum {
 	FWTS_FLAG_COMPLIANCE_ACPI		= 0x00800000,
 	FWTS_FLAG_SBBR				= 0x01000000,
 	FWTS_FLAG_EBBR				= 0x02000000,
+	FWTS_FLAG_AML_PROFILE			= 0x04000000,
+	FWTS_FLAG_AML_COVERAGE			= 0x08000000,
+	FWTS_FLAG_NO_IASL_CACHE			= 0x10000000,
+	FWTS_FLAG_EFI_EMULATOR			= 0x20000000,
+	FWTS_FLAG_UEFI_RT_PROFILE		= 0x40000000,
 	FWTS_FLAG_XBBR				= FWTS_FLAG_SBBR | FWTS_FLAG_EBBR
 } fwts_framework_flags;
 
@@ -120,6 +135,11 @@ struct fwts_framework {
 	char *olog;				/* path to OLOG */
 	char *json_data_path;			/* path to application json data files, e.g. json klog data */
 	char *json_data_file;			/* json file to use for olog analysis */
+	char *aml_profile_file;			/* JSON file for --aml-profile output */
+	char *aml_coverage_file;		/* Report file for --aml-coverage output */
+	char *namespace_snapshot_file;		/* File for --namespace-snapshot */
+	char *uefi_rt_profile_file;		/* CSV or JSON file for --uefi-rt-profile samples */
+	char *region_capture_file;		/* Trace file for --region-capture */
 	struct fwts_framework_test *current_major_test; /* current test */
 	void *rsdp;				/* ACPI RSDP address */
 	void *fdt;				/* Flattened device tree data */
@@ -130,6 +150,12 @@ struct fwts_framework {
 	uint32_t major_tests_total;		/* Total number of major tests */
 	uint32_t total_run;			/* total number of major tests run */
 	uint32_t minor_test_progress;		/* Percentage completion of current test */
+	uint32_t aml_budget_ms;			/* --aml-budget wall time per evaluation, 0 = unlimited */
+	uint64_t aml_budget_opcodes;		/* --aml-budget opcodes per evaluation, 0 = unlimited */
+	uint64_t efi_emulator_store_size;	/* --efi-emulator variable store size in bytes */
+	uint32_t efi_emulator_latency_us;	/* --efi-emulator latency added to each call */
+	uint32_t efi_emulator_fault_every;	/* --efi-emulator fail every Nth call, 0 = never */
+	uint32_t uefi_rt_threshold_us;		/* --uefi-rt-threshold, 0 = no threshold */
 
 	fwts_results minor_tests;		/* results for each minor test */
 	fwts_results total;			/* totals over all tests */
@@ -142,6 +168,7 @@ struct fwts_framework {
 	fwts_list errors_filter_discard;	/* Results to discard, empty = discard none */
 	fwts_acpica_mode acpica_mode;		/* ACPICA mode flags */
 	fwts_pm_method pm_method;
+	fwts_efi_emulator_reclaim efi_emulator_reclaim;	/* --efi-emulator-reclaim */
 	fwts_architecture host_arch;		/* arch FWTS was built for */
 	fwts_architecture target_arch;		/* arch being tested */
 
@@ -193,6 +220,10 @@ void fwts_framework_test_add(const char *name, fwts_framework_ops *ops,
 	const fwts_firmware_feature fw_features);
 int  fwts_framework_compare_test_name(void *, void *);
 void fwts_framework_show_version(FILE *fp, const char *name);
+fwts_framework *fwts_framework_fuzz_new(const char *name);
+int  fwts_framework_fuzz_reset(fwts_framework *fw);
+int  fwts_framework_fuzz_run(fwts_framework *fw);
+void fwts_framework_fuzz_free(fwts_framework *fw);
 
 void fwts_framework_passed(fwts_framework *, const char *fmt, ...)
 	__attribute__((format(printf, 2, 3)));
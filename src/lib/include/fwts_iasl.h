@@ -22,8 +22,20 @@
 
 #include "fwts.h"
 #include <stdint.h>
+#include <stddef.h>
+
+/*
+ *  Disassembly text, a single buffer with an index of its lines
+ */
+typedef struct {
+	char	*text;		/* Text, each line '\0' terminated */
+	size_t	length;		/* Length of text */
+	char	**lines;	/* Start of each line */
+	size_t	count;		/* Number of lines */
+} fwts_iasl_text;
 
 int fwts_iasl_init(fwts_framework *fw);
+int fwts_iasl_init_tables(fwts_framework *fw, fwts_acpi_table_info *set);
 void fwts_iasl_deinit(void);
 
 int fwts_iasl_disassemble_all_to_file(fwts_framework *fw,
@@ -34,9 +46,34 @@ int fwts_iasl_disassemble(fwts_framework *fw,
 	const bool use_externals,
 	fwts_list **ias_output);
 
+int fwts_iasl_disassemble_listing(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const bool use_externals,
+	fwts_list **iasl_output);
+
+int fwts_iasl_disassemble_text(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const bool use_externals,
+	fwts_iasl_text **iasl_output);
+
+int fwts_iasl_disassemble_session(fwts_framework *fw,
+	const fwts_acpi_table_info *info[],
+	const int count,
+	const bool use_externals,
+	const int jobs,
+	fwts_iasl_text *iasl_output[]);
+
+void fwts_iasl_text_free(fwts_iasl_text *text);
+
+int fwts_iasl_assemble(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const fwts_iasl_text *iasl_disassembly,
+	fwts_list **iasl_stdout,
+	fwts_list **iasl_stderr);
+
 int fwts_iasl_reassemble(fwts_framework *fw,
 	const fwts_acpi_table_info *info,
-	fwts_list **iasl_disassembly,
+	fwts_iasl_text **iasl_disassembly,
 	fwts_list **iasl_stdout,
 	fwts_list **iasl_stderr);
 
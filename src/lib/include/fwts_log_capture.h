@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __FWTS_LOG_CAPTURE_H__
+#define __FWTS_LOG_CAPTURE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fwts_framework.h"
+#include "fwts_log.h"
+
+/*
+ *  Test results and log output from a forked child process are
+ *  captured as records written to a file descriptor, the parent
+ *  then replays them into its own results log and counters.
+ */
+bool fwts_log_capture_active(void);
+void fwts_log_capture_start(const int fd);
+int  fwts_log_capture_stop(void);
+void fwts_log_capture_framework(fwts_framework *fw, const fwts_log_field field,
+	const char *label, const fwts_log_level level, const uint32_t *count,
+	const char *buffer);
+void fwts_log_capture_printf(const fwts_framework *fw, const fwts_log_field field,
+	const fwts_log_level level, const char *status, const char *label,
+	const char *prefix, const char *buffer);
+int  fwts_log_capture_replay(fwts_framework *fw, const void *data, const size_t len);
+
+#endif
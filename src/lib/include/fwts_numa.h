@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __FWTS_NUMA_H__
+#define __FWTS_NUMA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fwts.h"
+
+/*
+ *  Proximity domain as described by the enabled SRAT entries
+ */
+typedef struct {
+	uint32_t	domain;
+	bool		memory;		/* has enabled memory affinity */
+	bool		initiator;	/* has enabled processor or generic initiator affinity */
+} fwts_numa_domain;
+
+/*
+ *  One bit per matrix entry, rows padded to a multiple of 64 bits
+ */
+typedef struct {
+	uint64_t	*bits;
+	uint32_t	rows;
+	uint32_t	cols;
+	uint32_t	words_per_row;
+	uint64_t	count;		/* number of bits set */
+} fwts_numa_bitmap;
+
+/*
+ *  SLIT distance matrix violation classes
+ */
+typedef enum {
+	FWTS_NUMA_SLIT_RESERVED,	/* off diagonal distance < 10 */
+	FWTS_NUMA_SLIT_LOCAL,		/* off diagonal distance of 10 */
+	FWTS_NUMA_SLIT_DIAGONAL,	/* diagonal distance not 10 */
+	FWTS_NUMA_SLIT_ASYMMETRIC,	/* [i][j] != [j][i], neither 0xff, upper triangle only */
+	FWTS_NUMA_SLIT_UNREACHABLE,	/* only one of [i][j], [j][i] is 0xff, upper triangle only */
+	FWTS_NUMA_SLIT_MAX
+} fwts_numa_slit_check;
+
+/* Called for each run [first..last] of set bits in a bitmap row */
+typedef void (*fwts_numa_run_func)(fwts_framework *fw, const uint32_t row,
+	const uint32_t first, const uint32_t last, void *private);
+
+int fwts_numa_srat_domains(fwts_framework *fw, fwts_numa_domain **domains, uint32_t *count);
+fwts_numa_domain *fwts_numa_domain_find(fwts_numa_domain *domains, const uint32_t count, const uint32_t domain);
+
+int fwts_numa_bitmap_init(fwts_numa_bitmap *bitmap, const uint32_t rows, const uint32_t cols);
+void fwts_numa_bitmap_free(fwts_numa_bitmap *bitmap);
+uint32_t fwts_numa_bitmap_runs(fwts_framework *fw, const fwts_numa_bitmap *bitmap,
+	const uint32_t max_runs, fwts_numa_run_func func, void *private);
+
+static inline void fwts_numa_bitmap_set(fwts_numa_bitmap *bitmap, const uint32_t row, const uint32_t col)
+{
+	uint64_t *word = &bitmap->bits[((uint64_t)row * bitmap->words_per_row) + (col / 64)];
+	const uint64_t bit = 1ULL << (col % 64);
+
+	if (!(*word & bit)) {
+		*word |= bit;
+		bitmap->count++;
+	}
+}
+
+static inline bool fwts_numa_bitmap_test(const fwts_numa_bitmap *bitmap, const uint32_t row, const uint32_t col)
+{
+	return (bitmap->bits[((uint64_t)row * bitmap->words_per_row) + (col / 64)] >> (col % 64)) & 1;
+}
+
+int fwts_numa_slit_check_matrix(const uint8_t *matrix, const uint32_t n,
+	fwts_numa_bitmap bitmaps[FWTS_NUMA_SLIT_MAX]);
+int fwts_numa_hmat_unreachable(const uint16_t *matrix, const uint32_t rows,
+	const uint32_t cols, fwts_numa_bitmap *bitmap);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef __FWTS_RANGE_INDEX_H__
+#define __FWTS_RANGE_INDEX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fwts_list.h"
+#include "fwts_framework.h"
+
+typedef enum {
+	FWTS_RANGE_MEMORY_MAP,		/* e820 / UEFI memory map entry */
+	FWTS_RANGE_SRAT,		/* SRAT memory affinity structure */
+	FWTS_RANGE_CEDT_CFMWS,		/* CEDT CXL fixed memory window */
+	FWTS_RANGE_NFIT_SPA,		/* NFIT system physical address range */
+	FWTS_RANGE_OTHER,
+} fwts_range_source;
+
+/*
+ *  An address range [start..last], last is inclusive so
+ *  that a range can end at the top of the address space.
+ */
+typedef struct {
+	uint64_t		start;
+	uint64_t		last;
+	fwts_range_source	source;
+	int			type;		/* FWTS_MEMORY_MAP_* for memory map ranges */
+	uint32_t		domain;		/* proximity domain for SRAT and NFIT ranges */
+	uint32_t		id;		/* index of the range in its source table */
+} fwts_range;
+
+/*
+ *  Ranges sorted on start address, laid out as an implicit
+ *  balanced tree where each subtree root holds the highest last
+ *  address in that subtree.
+ */
+typedef struct {
+	fwts_range	*ranges;
+	uint64_t	*max_last;
+	size_t		count;
+	size_t		size;
+	bool		built;
+} fwts_range_index;
+
+typedef void (*fwts_range_func)(const fwts_range *range, void *private);
+typedef void (*fwts_range_pair_func)(const fwts_range *range1, const fwts_range *range2, void *private);
+
+fwts_range_index *fwts_range_index_new(void);
+void fwts_range_index_free(fwts_range_index *index);
+int fwts_range_index_add(fwts_range_index *index, const uint64_t start,
+	const uint64_t length, const fwts_range_source source,
+	const int type, const uint32_t domain, const uint32_t id);
+int fwts_range_index_add_memory_map(fwts_range_index *index, fwts_list *memory_map_list);
+int fwts_range_index_add_acpi(fwts_framework *fw, fwts_range_index *index);
+int fwts_range_index_build(fwts_range_index *index);
+
+const fwts_range *fwts_range_index_find(const fwts_range_index *index, const uint64_t address);
+size_t fwts_range_index_query(const fwts_range_index *index, const uint64_t start,
+	const uint64_t last, fwts_range_func func, void *private);
+size_t fwts_range_index_overlaps(const fwts_range_index *index,
+	fwts_range_pair_func func, void *private);
+const char *fwts_range_source_name(const fwts_range_source source);
+
+#endif
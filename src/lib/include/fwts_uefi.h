@@ -41,6 +41,13 @@ typedef struct {
 	uint32_t	attributes;
 } fwts_uefi_var;
 
+/* All the variables, names and data are held in one arena */
+typedef struct {
+	fwts_uefi_var	*vars;			/* Sorted by name, then GUID */
+	size_t		count;
+	uint8_t		*arena;
+} fwts_uefi_var_set;
+
 typedef uint8_t  fwts_uefi_mac_addr[32];
 typedef uint8_t  fwts_uefi_ipv4_addr[4];
 typedef uint16_t fwts_uefi_ipv6_addr[8];
@@ -680,11 +687,14 @@ int fwts_uefi_get_variable(const char *varname, fwts_uefi_var *var);
 void fwts_uefi_free_variable(fwts_uefi_var *var);
 void fwts_uefi_free_variable_names(fwts_list *list);
 int fwts_uefi_get_variable_names(fwts_list *list);
+int fwts_uefi_get_variables(fwts_uefi_var_set *set);
+void fwts_uefi_free_variables(fwts_uefi_var_set *set);
 
 void fwts_uefi_print_status_info(fwts_framework *fw, const uint64_t status);
 char *fwts_uefi_attribute_info(uint32_t attr);
 
 bool fwts_uefi_efivars_iface_exist(void);
+void fwts_uefi_set_efivars_path(const char *path);
 
 void fwts_uefi_rt_support_status_get(int fd, uint32_t *rtservicessupported);
 PRAGMA_POP
@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  AML coverage report.
+ *
+ *  The executed opcode bitmaps collected by fwts_acpica_coverage.c are
+ *  mapped onto the iasl disassembly of each table.  An iasl listing dumps
+ *  the AML byte code of each statement after it, which gives the table
+ *  offsets of the lines of the disassembly; a line is executed if any
+ *  opcode in its byte code was.  The listing is aligned with the plain
+ *  fwts_iasl_disassemble() output so the annotated disassembly is the
+ *  same text other tests and acpidump show.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+#include "fwts.h"
+
+#define COVERAGE_ALIGN_WINDOW	(16)	/* Listing lines searched to align a line */
+#define COVERAGE_LOG_UNCOVERED	(20)	/* Uncovered methods listed in the results log */
+
+/*
+ *  Table byte range disassembled by a group of listing lines
+ */
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+} fwts_acpi_coverage_block;
+
+/*
+ *  ASL line of a listing
+ */
+typedef struct {
+	const char *text;
+	int block;			/* Index of its byte range, -1 if unknown */
+} fwts_acpi_coverage_line;
+
+/*
+ *  Coverage of a control method
+ */
+typedef struct {
+	const fwts_acpica_coverage_method *method;
+	uint32_t lines;			/* Executable disassembly lines */
+	uint32_t executed;		/* Executable lines that were executed */
+	bool called;			/* Any of its opcodes were executed */
+} fwts_acpi_coverage_stats;
+
+/*
+ *  Coverage of all the tables
+ */
+typedef struct {
+	uint32_t methods;
+	uint32_t called;
+	uint64_t lines;
+	uint64_t executed;
+} fwts_acpi_coverage_totals;
+
+static double coverage_percent(const uint64_t n, const uint64_t total)
+{
+	return total ? 100.0 * (double)n / (double)total : 0.0;
+}
+
+/*
+ *  coverage_executed()
+ *	true if any opcode in table bytes start..end-1 was executed
+ */
+static bool coverage_executed(
+	const fwts_acpica_coverage_table *table,
+	uint32_t start,
+	uint32_t end)
+{
+	if (end > table->header.length)
+		end = table->header.length;
+
+	for (; start < end; start++) {
+		/* Skip whole bytes of the bitmap that are clear */
+		if (((start & 7) == 0) && (start + 8 <= end) && !table->executed[start >> 3]) {
+			start += 7;
+			continue;
+		}
+		if (table->executed[start >> 3] & (1 << (start & 7)))
+			return true;
+	}
+	return false;
+}
+
+/*
+ *  coverage_hex_line()
+ *	parse a byte code dump line of a listing, "    0024: 14 12 5F ..."
+ */
+static bool coverage_hex_line(const char *line, uint32_t *offset, uint32_t *count)
+{
+	char *end;
+	unsigned long val;
+	uint32_t n = 0;
+
+	while (*line == ' ')
+		line++;
+	if (!isxdigit((unsigned char)*line))
+		return false;
+	val = strtoul(line, &end, 16);
+	if ((end - line < 4) || (end[0] != ':') || (end[1] != ' '))
+		return false;
+
+	for (line = end + 2; n < 16; line += 3, n++)
+		if (!isxdigit((unsigned char)line[0]) ||
+		    !isxdigit((unsigned char)line[1]) ||
+		    (line[2] != ' '))
+			break;
+	if (!n)
+		return false;
+
+	*offset = (uint32_t)val;
+	*count = n;
+	return true;
+}
+
+/*
+ *  coverage_listing_parse()
+ *	split a listing into its ASL lines and the byte ranges they
+ *	disassemble, the byte code of a group of lines is dumped after it
+ */
+static int coverage_listing_parse(
+	fwts_list *listing,
+	const uint32_t table_length,
+	fwts_acpi_coverage_line **lines_out,
+	int *lines_count,
+	fwts_acpi_coverage_block **blocks_out,
+	int *blocks_count)
+{
+	fwts_acpi_coverage_line *lines;
+	fwts_acpi_coverage_block *blocks;
+	fwts_list_link *item;
+	int n = 0, nblocks = 0, pending = 0, i;
+	bool in_block = false;
+
+	lines = calloc(fwts_list_len(listing) + 1, sizeof(*lines));
+	blocks = calloc(fwts_list_len(listing) + 1, sizeof(*blocks));
+	if (!lines || !blocks) {
+		free(lines);
+		free(blocks);
+		return FWTS_ERROR;
+	}
+
+	fwts_list_foreach(item, listing) {
+		const char *text = fwts_list_data(char *, item);
+		uint32_t offset, count;
+
+		if (coverage_hex_line(text, &offset, &count)) {
+			if (!in_block) {
+				blocks[nblocks].start = offset;
+				in_block = true;
+			}
+			blocks[nblocks].end = offset + count;
+			continue;
+		}
+		if (in_block) {
+			for (i = pending; i < n; i++)
+				lines[i].block = nblocks;
+			pending = n;
+			nblocks++;
+			in_block = false;
+		}
+		/* The table dump at the end of a listing */
+		if (!strncmp(text, "Table Header:", 13))
+			break;
+		if (*text == '\0')
+			continue;
+		lines[n].text = text;
+		lines[n].block = -1;
+		n++;
+	}
+
+	/* The last lines run to the end of the table */
+	if ((pending < n) && nblocks && (blocks[nblocks - 1].end < table_length)) {
+		blocks[nblocks].start = blocks[nblocks - 1].end;
+		blocks[nblocks].end = table_length;
+		for (i = pending; i < n; i++)
+			lines[i].block = nblocks;
+		nblocks++;
+	}
+
+	*lines_out = lines;
+	*lines_count = n;
+	*blocks_out = blocks;
+	*blocks_count = nblocks;
+
+	return FWTS_OK;
+}
+
+/*
+ *  coverage_line_executable()
+ *	true if a disassembly line is a statement rather than a brace or comment
+ */
+static bool coverage_line_executable(const char *text)
+{
+	while (isspace((unsigned char)*text))
+		text++;
+
+	return *text && (*text != '{') && (*text != '}') && (*text != '*') &&
+		strncmp(text, "//", 2) && strncmp(text, "/*", 2);
+}
+
+static int coverage_cmp_offset(const void *a, const void *b)
+{
+	const fwts_acpi_coverage_stats *sa = (const fwts_acpi_coverage_stats *)a;
+	const fwts_acpi_coverage_stats *sb = (const fwts_acpi_coverage_stats *)b;
+
+	if (sa->method->offset != sb->method->offset)
+		return sa->method->offset < sb->method->offset ? -1 : 1;
+	return 0;
+}
+
+/*
+ *  coverage_method_find()
+ *	find the method, sorted by offset, whose AML overlaps start..end-1
+ */
+static fwts_acpi_coverage_stats *coverage_method_find(
+	fwts_acpi_coverage_stats *stats,
+	const size_t count,
+	const uint32_t start,
+	const uint32_t end)
+{
+	size_t lo = 0, hi = count;
+
+	/* Find the last method starting before end */
+	while (lo < hi) {
+		const size_t mid = (lo + hi) / 2;
+
+		if (stats[mid].method->offset < end)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return NULL;
+
+	return (start < stats[lo - 1].method->offset + stats[lo - 1].method->length) ?
+		&stats[lo - 1] : NULL;
+}
+
+/*
+ *  coverage_table_info()
+ *	find the fwts ACPI table that was covered
+ */
+static fwts_acpi_table_info *coverage_table_info(
+	fwts_framework *fw,
+	const fwts_acpica_coverage_table *table)
+{
+	int i;
+
+	for (i = 0; i < ACPI_MAX_TABLES; i++) {
+		fwts_acpi_table_info *info;
+
+		if (fwts_acpi_get_table(fw, i, &info) != FWTS_OK)
+			break;
+		if (info && info->has_aml && (info->length == table->header.length) &&
+		    !memcmp(info->data, &table->header, sizeof(table->header)))
+			return info;
+	}
+	return NULL;
+}
+
+/*
+ *  coverage_annotate()
+ *	mark each line of the disassembly '+' if executed, '-' if it is
+ *	in a control method and was not executed, and count lines per method
+ */
+static void coverage_annotate(
+	fwts_list *disassembly,
+	fwts_list *listing,
+	const fwts_acpica_coverage_table *table,
+	fwts_acpi_coverage_stats *stats,
+	char *marks)
+{
+	fwts_acpi_coverage_line *lines;
+	fwts_acpi_coverage_block *blocks;
+	fwts_list_link *item;
+	int nlines, nblocks, cursor = 0, i = 0;
+
+	if (coverage_listing_parse(listing, table->header.length,
+		&lines, &nlines, &blocks, &nblocks) != FWTS_OK)
+		return;
+
+	fwts_list_foreach(item, disassembly) {
+		const char *text = fwts_list_data(char *, item);
+		const fwts_acpi_coverage_block *block = NULL;
+		fwts_acpi_coverage_stats *method;
+		bool executed;
+		int j;
+
+		marks[i++] = ' ';
+		if (*text == '\0')
+			continue;
+
+		/* Lines missing from the listing, such as the header, are skipped */
+		for (j = cursor; (j < nlines) && (j < cursor + COVERAGE_ALIGN_WINDOW); j++) {
+			if (!strcmp(text, lines[j].text)) {
+				if (lines[j].block >= 0)
+					block = &blocks[lines[j].block];
+				cursor = j + 1;
+				break;
+			}
+		}
+		if (!block || !coverage_line_executable(text))
+			continue;
+
+		method = coverage_method_find(stats, table->methods_count,
+			block->start, block->end);
+		executed = coverage_executed(table, block->start, block->end);
+		if (method) {
+			method->lines++;
+			if (executed)
+				method->executed++;
+		}
+		if (executed)
+			marks[i - 1] = '+';
+		else if (method)
+			marks[i - 1] = '-';
+	}
+
+	free(lines);
+	free(blocks);
+}
+
+/*
+ *  coverage_table_report()
+ *	report the coverage of a table, to the results log and the report file
+ */
+static void coverage_table_report(
+	fwts_framework *fw,
+	FILE *fp,
+	const fwts_acpica_coverage_table *table,
+	fwts_acpi_coverage_totals *totals)
+{
+	fwts_acpi_coverage_stats *stats;
+	fwts_acpi_table_info *info;
+	fwts_list *disassembly = NULL, *listing = NULL;
+	char *marks = NULL;
+	char name[5];
+	uint32_t called = 0, uncovered = 0;
+	uint64_t lines = 0, executed = 0;
+	size_t i;
+
+	memcpy(name, table->header.signature, 4);
+	name[4] = '\0';
+
+	if ((stats = calloc(table->methods_count + 1, sizeof(*stats))) == NULL) {
+		fwts_log_error(fw, "Cannot allocate AML coverage of %s.", name);
+		return;
+	}
+	for (i = 0; i < table->methods_count; i++) {
+		stats[i].method = &table->methods[i];
+		stats[i].called = coverage_executed(table, table->methods[i].offset,
+			table->methods[i].offset + table->methods[i].length);
+		if (stats[i].called)
+			called++;
+	}
+	qsort(stats, table->methods_count, sizeof(*stats), coverage_cmp_offset);
+
+	info = coverage_table_info(fw, table);
+	if (info &&
+	    (fwts_iasl_disassemble(fw, info, true, &disassembly) == FWTS_OK) &&
+	    (fwts_iasl_disassemble_listing(fw, info, true, &listing) == FWTS_OK) &&
+	    ((marks = calloc(fwts_list_len(disassembly) + 1, 1)) != NULL))
+		coverage_annotate(disassembly, listing, table, stats, marks);
+
+	for (i = 0; i < table->methods_count; i++) {
+		lines += stats[i].lines;
+		executed += stats[i].executed;
+	}
+	totals->methods += table->methods_count;
+	totals->called += called;
+	totals->lines += lines;
+	totals->executed += executed;
+
+	if (lines)
+		fwts_log_info(fw, "%s (%.8s): %" PRIu32 " of %zu control methods executed (%.1f%%), "
+			"%" PRIu64 " of %" PRIu64 " lines executed (%.1f%%).",
+			name, table->header.oem_tbl_id, called, table->methods_count,
+			coverage_percent(called, table->methods_count),
+			executed, lines, coverage_percent(executed, lines));
+	else
+		fwts_log_info(fw, "%s (%.8s): %" PRIu32 " of %zu control methods executed (%.1f%%).",
+			name, table->header.oem_tbl_id, called, table->methods_count,
+			coverage_percent(called, table->methods_count));
+	if (called < table->methods_count) {
+		fwts_log_info(fw, "Control methods in %s that were never executed:", name);
+		for (i = 0; i < table->methods_count; i++) {
+			if (stats[i].called)
+				continue;
+			if (uncovered++ < COVERAGE_LOG_UNCOVERED)
+				fwts_log_info_verbatim(fw, "  %s", stats[i].method->path);
+		}
+		if (uncovered > COVERAGE_LOG_UNCOVERED)
+			fwts_log_info_verbatim(fw, "  (%" PRIu32 " more control methods not shown)",
+				uncovered - COVERAGE_LOG_UNCOVERED);
+	}
+
+	if (fp) {
+		fprintf(fp, "%s (OEM table ID %.8s, 0x%" PRIx32 " bytes)\n"
+			"  %" PRIu32 " of %zu control methods executed (%.1f%%)\n",
+			name, table->header.oem_tbl_id, table->header.length,
+			called, table->methods_count,
+			coverage_percent(called, table->methods_count));
+		if (lines)
+			fprintf(fp, "  %" PRIu64 " of %" PRIu64 " lines executed (%.1f%%)\n",
+				executed, lines, coverage_percent(executed, lines));
+		fprintf(fp, "\n");
+
+		fprintf(fp, "  Lines  Executed  Coverage  Method\n");
+		for (i = 0; i < table->methods_count; i++) {
+			if (stats[i].lines)
+				fprintf(fp, "%7" PRIu32 " %9" PRIu32 " %8.1f%%  %s\n",
+					stats[i].lines, stats[i].executed,
+					coverage_percent(stats[i].executed, stats[i].lines),
+					stats[i].method->path);
+			else
+				fprintf(fp, "%7s %9s %9s  %s\n", "-", "-",
+					stats[i].called ? "called" : "never",
+					stats[i].method->path);
+		}
+
+		if (called < table->methods_count) {
+			fprintf(fp, "\nControl methods never executed:\n");
+			for (i = 0; i < table->methods_count; i++)
+				if (!stats[i].called)
+					fprintf(fp, "  %s\n", stats[i].method->path);
+		}
+
+		if (marks) {
+			fwts_list_link *item;
+			int j = 0;
+
+			fprintf(fp, "\nAnnotated disassembly of %s, "
+				"'+' executed, '-' not executed:\n\n", name);
+			fwts_list_foreach(item, disassembly)
+				fprintf(fp, "%c %s\n", marks[j++], fwts_list_data(char *, item));
+		} else {
+			fprintf(fp, "\nCannot disassemble %s to annotate it.\n", name);
+		}
+		fprintf(fp, "\n");
+	}
+
+	free(marks);
+	fwts_text_list_free(disassembly);
+	fwts_text_list_free(listing);
+	free(stats);
+}
+
+/*
+ *  fwts_acpi_coverage_report()
+ *	report the AML coverage collected over all the tests run,
+ *	to the results log and the --aml-coverage report file
+ */
+void fwts_acpi_coverage_report(fwts_framework *fw)
+{
+	fwts_acpica_coverage_table * const *tables;
+	fwts_acpi_coverage_totals totals;
+	FILE *fp = NULL;
+	size_t i, count;
+	bool iasl;
+
+	tables = fwts_acpica_coverage_get(&count);
+	if (!count)
+		return;
+
+	if (fw->aml_coverage_file &&
+	    ((fp = fopen(fw->aml_coverage_file, "w")) == NULL))
+		fwts_log_error(fw, "Cannot write AML coverage report to %s.",
+			fw->aml_coverage_file);
+	if (fp)
+		fprintf(fp, "AML coverage report\n\n");
+
+	iasl = (fwts_iasl_init(fw) == FWTS_OK);
+	memset(&totals, 0, sizeof(totals));
+	fwts_log_nl(fw);
+	for (i = 0; i < count; i++)
+		coverage_table_report(fw, fp, tables[i], &totals);
+	if (iasl)
+		fwts_iasl_deinit();
+
+	if (totals.lines)
+		fwts_log_info(fw, "AML coverage of %zu tables: %" PRIu32 " of %" PRIu32
+			" control methods executed (%.1f%%), %" PRIu64 " of %" PRIu64
+			" lines executed (%.1f%%).", count,
+			totals.called, totals.methods,
+			coverage_percent(totals.called, totals.methods),
+			totals.executed, totals.lines,
+			coverage_percent(totals.executed, totals.lines));
+	else
+		fwts_log_info(fw, "AML coverage of %zu tables: %" PRIu32 " of %" PRIu32
+			" control methods executed (%.1f%%).", count,
+			totals.called, totals.methods,
+			coverage_percent(totals.called, totals.methods));
+	fwts_log_nl(fw);
+
+	if (fp)
+		(void)fclose(fp);
+
+	fwts_acpica_coverage_free();
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "fwts.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* acpica headers */
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "acpi.h"
+#pragma GCC diagnostic error "-Wunused-parameter"
+#include "fwts_acpi_object_eval.h"
+#include "fwts_acpica.h"
+
+/*
+ *  Namespace snapshots.
+ *
+ *  Initialising ACPICA loads and parses every AML table which is the
+ *  bulk of the start up time of tests that only look at the names in
+ *  the namespace and the values of static data objects.  With
+ *  --namespace-snapshot=FILE the namespace is written to FILE the
+ *  first time ACPICA is initialised, and tests that use
+ *  fwts_acpi_namespace_init() load it from FILE on later runs against
+ *  the same AML tables without initialising ACPICA at all.  Such tests
+ *  call fwts_acpi_namespace_interpreter() to initialise ACPICA should
+ *  they need to evaluate a control method after all.
+ */
+
+static void *namespace_data;				/* Snapshot loaded */
+static fwts_acpi_namespace_node *namespace_nodes;	/* Nodes of the snapshot */
+static size_t namespace_nodes_count;
+static const fwts_acpi_namespace_file_table *namespace_tables;
+static size_t namespace_tables_count;
+static fwts_list *namespace_names;			/* Paths of the nodes, from the snapshot */
+static bool namespace_from_file;			/* Snapshot loaded from file */
+static bool namespace_interpreter;			/* ACPICA initialised by us */
+static bool namespace_exported;				/* Snapshot file written or checked */
+
+/*
+ *  fwts_acpi_namespace_fingerprint()
+ *	FNV-1a hash of the AML tables, a snapshot is only used
+ *	for the tables it was taken from
+ */
+uint64_t fwts_acpi_namespace_fingerprint(fwts_framework *fw)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint32_t i;
+
+	for (i = 0; ; i++) {
+		fwts_acpi_table_info *info;
+		const uint8_t *data;
+		size_t j;
+
+		if (fwts_acpi_get_table(fw, i, &info) != FWTS_OK)
+			break;
+		if (info == NULL)
+			break;
+		if (!info->has_aml || !info->data)
+			continue;
+
+		data = (const uint8_t *)info->data;
+		for (j = 0; j < info->length; j++) {
+			hash ^= data[j];
+			hash *= 0x100000001b3ULL;
+		}
+	}
+
+	return hash;
+}
+
+/*
+ *  fwts_acpi_namespace_parse()
+ *	sanity check a snapshot and build its nodes, the snapshot
+ *	data is owned by the loaded snapshot on success
+ */
+static int fwts_acpi_namespace_parse(
+	void *data,
+	const size_t length,
+	const uint64_t fingerprint)
+{
+	const fwts_acpi_namespace_file_header *header = data;
+	const fwts_acpi_namespace_file_table *tables;
+	const fwts_acpi_namespace_file_node *file_nodes;
+	fwts_acpi_namespace_node *nodes;
+	const char *strings;
+	const uint8_t *values;
+	uint64_t size;
+	uint32_t i;
+
+	if (length < sizeof(*header))
+		return FWTS_ERROR;
+	if (memcmp(header->magic, FWTS_ACPI_NAMESPACE_MAGIC, sizeof(header->magic)) ||
+	    (header->version != FWTS_ACPI_NAMESPACE_VERSION) ||
+	    (header->fingerprint != fingerprint))
+		return FWTS_ERROR;
+
+	size = sizeof(*header) +
+		((uint64_t)header->tables * sizeof(*tables)) +
+		((uint64_t)header->nodes * sizeof(*file_nodes)) +
+		header->strings_size + header->data_size;
+	if (size != length)
+		return FWTS_ERROR;
+
+	tables = (const fwts_acpi_namespace_file_table *)(header + 1);
+	file_nodes = (const fwts_acpi_namespace_file_node *)(tables + header->tables);
+	strings = (const char *)(file_nodes + header->nodes);
+	values = (const uint8_t *)strings + header->strings_size;
+
+	if (header->nodes && (!header->strings_size || strings[header->strings_size - 1]))
+		return FWTS_ERROR;
+
+	if ((nodes = calloc(header->nodes ? header->nodes : 1, sizeof(*nodes))) == NULL)
+		return FWTS_OUT_OF_MEMORY;
+
+	for (i = 0; i < header->nodes; i++) {
+		const fwts_acpi_namespace_file_node *file_node = &file_nodes[i];
+		fwts_acpi_namespace_node *node = &nodes[i];
+
+		/* Parents come before their children */
+		if ((file_node->path >= header->strings_size) ||
+		    ((file_node->parent != FWTS_ACPI_NAMESPACE_NONE) && (file_node->parent >= i)) ||
+		    ((file_node->table != FWTS_ACPI_NAMESPACE_NONE) &&
+		     ((file_node->table >= header->tables) ||
+		      ((uint64_t)file_node->aml_offset + file_node->aml_length >
+		       tables[file_node->table].length))) ||
+		    ((uint64_t)file_node->value_offset + file_node->value_length > header->data_size)) {
+			free(nodes);
+			return FWTS_ERROR;
+		}
+
+		node->path = strings + file_node->path;
+		node->parent = file_node->parent;
+		memcpy(node->name, file_node->name, sizeof(file_node->name));
+		node->name[4] = '\0';
+		node->type = file_node->type;
+		node->value_type = file_node->value_type;
+		node->args = file_node->args;
+		node->table = file_node->table;
+		node->aml_offset = file_node->aml_offset;
+		node->aml_length = file_node->aml_length;
+		node->integer = file_node->integer;
+		node->value = file_node->value_length ? values + file_node->value_offset : NULL;
+		node->value_length = file_node->value_length;
+	}
+
+	namespace_data = data;
+	namespace_nodes = nodes;
+	namespace_nodes_count = header->nodes;
+	namespace_tables = tables;
+	namespace_tables_count = header->tables;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_acpi_namespace_read()
+ *	read a snapshot file, returns NULL if it cannot be read
+ */
+static void *fwts_acpi_namespace_read(const char *filename, size_t *length)
+{
+	struct stat buf;
+	void *data;
+	FILE *fp;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+		return NULL;
+	if ((fstat(fileno(fp), &buf) < 0) || (buf.st_size <= 0)) {
+		(void)fclose(fp);
+		return NULL;
+	}
+	if ((data = malloc(buf.st_size)) == NULL) {
+		(void)fclose(fp);
+		return NULL;
+	}
+	if (fread(data, 1, buf.st_size, fp) != (size_t)buf.st_size) {
+		free(data);
+		(void)fclose(fp);
+		return NULL;
+	}
+	(void)fclose(fp);
+	*length = buf.st_size;
+
+	return data;
+}
+
+/*
+ *  fwts_acpi_namespace_export()
+ *	write the namespace to the --namespace-snapshot file unless it
+ *	already holds a snapshot of these tables, ACPICA must be initialised
+ */
+int fwts_acpi_namespace_export(fwts_framework *fw)
+{
+	fwts_acpi_namespace_file_header header;
+	uint64_t fingerprint;
+	void *data;
+	size_t length;
+	FILE *fp;
+	int ret;
+
+	if (!fw->namespace_snapshot_file || namespace_exported)
+		return FWTS_OK;
+	namespace_exported = true;
+
+	fingerprint = fwts_acpi_namespace_fingerprint(fw);
+	if ((fp = fopen(fw->namespace_snapshot_file, "r")) != NULL) {
+		const bool current =
+			(fread(&header, sizeof(header), 1, fp) == 1) &&
+			!memcmp(header.magic, FWTS_ACPI_NAMESPACE_MAGIC, sizeof(header.magic)) &&
+			(header.version == FWTS_ACPI_NAMESPACE_VERSION) &&
+			(header.fingerprint == fingerprint);
+
+		(void)fclose(fp);
+		if (current)
+			return FWTS_OK;
+	}
+
+	if ((ret = fwts_acpica_namespace_snapshot(fingerprint, &data, &length)) != FWTS_OK) {
+		fwts_log_error(fw, "Cannot take a snapshot of the ACPI namespace.");
+		return ret;
+	}
+
+	if ((fp = fopen(fw->namespace_snapshot_file, "w")) == NULL) {
+		fwts_log_error(fw, "Cannot create namespace snapshot file %s.",
+			fw->namespace_snapshot_file);
+		free(data);
+		return FWTS_ERROR;
+	}
+	ret = (fwrite(data, 1, length, fp) == length) ? FWTS_OK : FWTS_ERROR;
+	if (fclose(fp) != 0)
+		ret = FWTS_ERROR;
+	if (ret != FWTS_OK)
+		fwts_log_error(fw, "Cannot write namespace snapshot file %s.",
+			fw->namespace_snapshot_file);
+	free(data);
+
+	return ret;
+}
+
+/*
+ *  fwts_acpi_namespace_init()
+ *	load the namespace from the --namespace-snapshot file if it
+ *	matches the AML tables, otherwise initialise ACPICA and take
+ *	a snapshot of the namespace it loaded
+ */
+int fwts_acpi_namespace_init(fwts_framework *fw)
+{
+	const uint64_t fingerprint = fwts_acpi_namespace_fingerprint(fw);
+	void *data;
+	size_t length;
+	int ret;
+
+	if (fw->namespace_snapshot_file &&
+	    ((data = fwts_acpi_namespace_read(fw->namespace_snapshot_file, &length)) != NULL)) {
+		if (fwts_acpi_namespace_parse(data, length, fingerprint) == FWTS_OK) {
+			namespace_from_file = true;
+			return FWTS_OK;
+		}
+		free(data);
+	}
+
+	if (fwts_acpi_namespace_interpreter(fw) != FWTS_OK)
+		return FWTS_ERROR;
+
+	if ((ret = fwts_acpica_namespace_snapshot(fingerprint, &data, &length)) != FWTS_OK)
+		return ret;
+	if ((ret = fwts_acpi_namespace_parse(data, length, fingerprint)) != FWTS_OK)
+		free(data);
+
+	return ret;
+}
+
+/*
+ *  fwts_acpi_namespace_interpreter()
+ *	initialise ACPICA if it has not been already, for tests
+ *	that need to evaluate objects
+ */
+int fwts_acpi_namespace_interpreter(fwts_framework *fw)
+{
+	if (namespace_interpreter)
+		return FWTS_OK;
+	if (fwts_acpi_init(fw) != FWTS_OK)
+		return FWTS_ERROR;
+	namespace_interpreter = true;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_acpi_namespace_deinit()
+ *	free the snapshot and close ACPICA if it was initialised
+ */
+int fwts_acpi_namespace_deinit(fwts_framework *fw)
+{
+	int ret = FWTS_OK;
+
+	if (namespace_interpreter) {
+		ret = fwts_acpi_deinit(fw);
+		namespace_interpreter = false;
+	}
+
+	fwts_list_free(namespace_names, NULL);
+	namespace_names = NULL;
+	free(namespace_nodes);
+	namespace_nodes = NULL;
+	namespace_nodes_count = 0;
+	namespace_tables = NULL;
+	namespace_tables_count = 0;
+	free(namespace_data);
+	namespace_data = NULL;
+	namespace_from_file = false;
+
+	return ret;
+}
+
+/*
+ *  fwts_acpi_namespace_loaded()
+ *	true if the namespace was loaded from a snapshot file
+ */
+bool fwts_acpi_namespace_loaded(void)
+{
+	return namespace_from_file;
+}
+
+/*
+ *  fwts_acpi_namespace_names()
+ *	list of the paths of the snapshot nodes, in the same
+ *	order as fwts_acpi_object_get_names() gives them
+ */
+fwts_list *fwts_acpi_namespace_names(void)
+{
+	size_t i;
+
+	if (namespace_names || !namespace_data)
+		return namespace_names;
+
+	if ((namespace_names = fwts_list_new()) == NULL)
+		return NULL;
+	for (i = 0; i < namespace_nodes_count; i++) {
+		if (fwts_list_append(namespace_names, (void *)namespace_nodes[i].path) == NULL) {
+			fwts_list_free(namespace_names, NULL);
+			namespace_names = NULL;
+			break;
+		}
+	}
+
+	return namespace_names;
+}
+
+/*
+ *  fwts_acpi_namespace_find()
+ *	find a node by its full path
+ */
+const fwts_acpi_namespace_node *fwts_acpi_namespace_find(const char *path)
+{
+	size_t i;
+
+	for (i = 0; i < namespace_nodes_count; i++)
+		if (!strcmp(namespace_nodes[i].path, path))
+			return &namespace_nodes[i];
+
+	return NULL;
+}
+
+/*
+ *  fwts_acpi_namespace_nodes()
+ *	get the nodes of the snapshot
+ */
+const fwts_acpi_namespace_node *fwts_acpi_namespace_nodes(size_t *count)
+{
+	*count = namespace_nodes_count;
+
+	return namespace_nodes;
+}
+
+/*
+ *  fwts_acpi_namespace_tables()
+ *	get the AML tables the snapshot control methods are in
+ */
+const fwts_acpi_namespace_file_table *fwts_acpi_namespace_tables(size_t *count)
+{
+	*count = namespace_tables_count;
+
+	return namespace_tables;
+}
@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "fwts.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/* acpica headers */
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "acpi.h"
+#pragma GCC diagnostic error "-Wunused-parameter"
+#include "fwts_acpi_object_eval.h"
+
+/*
+ *  Cache of identification object results.
+ *
+ *  _HID, _CID, _UID, _STA and _ADR are evaluated by many tests and are
+ *  expected to return the same value every time.  Results are cached,
+ *  keyed by scope handle and object name, if the object is a Name() or
+ *  a method that was seen not to touch an OpRegion, store to a named
+ *  object, Notify or load a table while being evaluated.  Cached objects
+ *  are copied into an arena that is released in one go whenever the
+ *  namespace changes or any evaluation stores to a named object,
+ *  writes an OpRegion or queues a Notify.
+ */
+
+#define CACHE_TABLE_SIZE	(512)		/* Initial hash table size, power of 2 */
+#define CACHE_ARENA_CHUNK	(64 * 1024)	/* Arena allocation granularity */
+
+typedef struct fwts_acpi_object_cache_chunk {
+	struct fwts_acpi_object_cache_chunk *next;
+	size_t		size;			/* Usable bytes in data */
+	size_t		used;			/* Bytes allocated so far */
+	uint8_t		data[];
+} fwts_acpi_object_cache_chunk;
+
+typedef struct {
+	ACPI_HANDLE	scope;			/* Scope evaluated in, NULL for root */
+	ACPI_NAME	name;			/* Object name */
+	ACPI_OBJECT	*obj;			/* Flattened copy of result, in arena */
+	ACPI_SIZE	length;			/* Size of flattened result */
+} fwts_acpi_object_cache_entry;
+
+static const char *cache_names[] = {
+	"_HID", "_CID", "_UID", "_STA", "_ADR", NULL
+};
+
+static pthread_mutex_t			cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static fwts_acpi_object_cache_entry	*cache_table;
+static size_t				cache_table_size;
+static size_t				cache_count;
+static fwts_acpi_object_cache_chunk	*cache_arena;
+static uint32_t				cache_generation;
+static fwts_acpi_object_cache_stats	cache_stats;
+
+/*
+ *  cache_arena_alloc()
+ *	allocate from the arena, 8 byte aligned
+ */
+static void *cache_arena_alloc(const size_t size)
+{
+	const size_t n = (size + 7) & ~(size_t)7;
+	fwts_acpi_object_cache_chunk *chunk = cache_arena;
+
+	if (!chunk || (chunk->size - chunk->used < n)) {
+		const size_t chunk_size = n > CACHE_ARENA_CHUNK ? n : CACHE_ARENA_CHUNK;
+
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk)
+			return NULL;
+		chunk->next = cache_arena;
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		cache_arena = chunk;
+	}
+	chunk->used += n;
+
+	return chunk->data + chunk->used - n;
+}
+
+/*
+ *  cache_flush()
+ *	drop all cached objects, cache_mutex must be held
+ */
+static void cache_flush(void)
+{
+	while (cache_arena) {
+		fwts_acpi_object_cache_chunk *next = cache_arena->next;
+
+		free(cache_arena);
+		cache_arena = next;
+	}
+	free(cache_table);
+	cache_table = NULL;
+	cache_table_size = 0;
+	cache_count = 0;
+}
+
+/*
+ *  cache_hash()
+ *	hash a scope handle and name into the cache table
+ */
+static inline size_t cache_hash(const ACPI_HANDLE scope, const ACPI_NAME name, const size_t size)
+{
+	uint64_t h = (uint64_t)(uintptr_t)scope ^ ((uint64_t)name << 32);
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+
+	return (size_t)h & (size - 1);
+}
+
+/*
+ *  cache_find()
+ *	find the slot for scope and name, empty if not cached
+ */
+static fwts_acpi_object_cache_entry *cache_find(const ACPI_HANDLE scope, const ACPI_NAME name)
+{
+	size_t i = cache_hash(scope, name, cache_table_size);
+
+	for (;;) {
+		fwts_acpi_object_cache_entry *entry = &cache_table[i];
+
+		if (!entry->obj || ((entry->scope == scope) && (entry->name == name)))
+			return entry;
+		i = (i + 1) & (cache_table_size - 1);
+	}
+}
+
+/*
+ *  cache_table_grow()
+ *	double the size of the cache table (or create it)
+ */
+static int cache_table_grow(void)
+{
+	fwts_acpi_object_cache_entry *old = cache_table;
+	const size_t old_size = cache_table_size;
+	const size_t new_size = old_size ? old_size * 2 : CACHE_TABLE_SIZE;
+	size_t i;
+
+	cache_table = calloc(new_size, sizeof(*cache_table));
+	if (!cache_table) {
+		cache_table = old;
+		return FWTS_ERROR;
+	}
+	cache_table_size = new_size;
+
+	for (i = 0; i < old_size; i++)
+		if (old[i].obj)
+			*cache_find(old[i].scope, old[i].name) = old[i];
+	free(old);
+
+	return FWTS_OK;
+}
+
+/*
+ *  cache_relocate()
+ *	adjust the pointers inside a flattened ACPI_OBJECT tree that
+ *	has been copied from one buffer to another
+ */
+static void cache_relocate(ACPI_OBJECT *obj, const uint8_t *from, const ACPI_SIZE length, uint8_t *to)
+{
+#define CACHE_RELOCATE(p)						\
+	if (((uint8_t *)(p) >= from) && ((uint8_t *)(p) < from + length))	\
+		(p) = (void *)(to + ((uint8_t *)(p) - from))
+
+	uint32_t i;
+
+	switch (obj->Type) {
+	case ACPI_TYPE_STRING:
+		CACHE_RELOCATE(obj->String.Pointer);
+		break;
+	case ACPI_TYPE_BUFFER:
+		CACHE_RELOCATE(obj->Buffer.Pointer);
+		break;
+	case ACPI_TYPE_PACKAGE:
+		CACHE_RELOCATE(obj->Package.Elements);
+		for (i = 0; i < obj->Package.Count; i++)
+			cache_relocate(&obj->Package.Elements[i], from, length, to);
+		break;
+	default:
+		break;
+	}
+#undef CACHE_RELOCATE
+}
+
+/*
+ *  cache_copy_out()
+ *	copy a cached result into the caller's buffer
+ */
+static ACPI_STATUS cache_copy_out(const fwts_acpi_object_cache_entry *entry, ACPI_BUFFER *buf)
+{
+	uint8_t *ptr;
+
+	if (buf->Length == ACPI_ALLOCATE_BUFFER) {
+		if ((ptr = malloc(entry->length)) == NULL)
+			return AE_NO_MEMORY;
+	} else {
+		if (buf->Length < entry->length) {
+			buf->Length = entry->length;
+			return AE_BUFFER_OVERFLOW;
+		}
+		ptr = buf->Pointer;
+	}
+	memcpy(ptr, entry->obj, entry->length);
+	cache_relocate((ACPI_OBJECT *)ptr, (uint8_t *)entry->obj, entry->length, ptr);
+	buf->Pointer = ptr;
+	buf->Length = entry->length;
+
+	return AE_OK;
+}
+
+/*
+ *  cache_add()
+ *	copy an evaluation result into the cache, cache_mutex must be held
+ */
+static void cache_add(const ACPI_HANDLE scope, const ACPI_NAME name, const ACPI_BUFFER *buf)
+{
+	fwts_acpi_object_cache_entry *entry;
+	ACPI_OBJECT *obj;
+
+	if ((cache_count + 1) * 2 > cache_table_size)
+		if (cache_table_grow() != FWTS_OK)
+			return;
+
+	if ((obj = cache_arena_alloc(buf->Length)) == NULL)
+		return;
+	memcpy(obj, buf->Pointer, buf->Length);
+	cache_relocate(obj, buf->Pointer, buf->Length, (uint8_t *)obj);
+
+	entry = cache_find(scope, name);
+	if (!entry->obj)
+		cache_count++;
+	entry->scope = scope;
+	entry->name = name;
+	entry->obj = obj;
+	entry->length = buf->Length;
+}
+
+/*
+ *  cache_name()
+ *	return the last name segment of a path if it is an object
+ *	that can be cached, NULL otherwise
+ */
+static const char *cache_name(const char *pathname)
+{
+	const size_t len = strlen(pathname);
+	const char *seg;
+	int i;
+
+	if (len < 4)
+		return NULL;
+	seg = pathname + len - 4;
+	if ((seg > pathname) && (seg[-1] != '.') && (seg[-1] != '\\') && (seg[-1] != '^'))
+		return NULL;
+
+	for (i = 0; cache_names[i]; i++)
+		if (!strcmp(seg, cache_names[i]))
+			return seg;
+
+	return NULL;
+}
+
+/*
+ *  fwts_acpi_object_cache_evaluate()
+ *	evaluate an object with no arguments, in the same way as
+ *	AcpiEvaluateObject(), returning a cached result for _HID, _CID,
+ *	_UID, _STA and _ADR if it has been evaluated before.
+ */
+ACPI_STATUS fwts_acpi_object_cache_evaluate(
+	ACPI_HANDLE scope,
+	const char *pathname,
+	ACPI_BUFFER *buf)
+{
+	fwts_acpi_object_cache_entry *entry;
+	ACPI_HANDLE key_scope = scope;
+	ACPI_NAME key_name;
+	ACPI_STATUS status;
+	const char *seg;
+	uint32_t generation;
+
+	/* Not cacheable, or profiling where every evaluation should be run */
+	if (!pathname || ((seg = cache_name(pathname)) == NULL) ||
+	    fwts_acpica_profile_enabled())
+		return AcpiEvaluateObject(scope, (ACPI_STRING)pathname, NULL, buf);
+
+	/* Key on the scope the name segment is found in */
+	if (seg != pathname) {
+		char prefix[256];
+		size_t n = seg - pathname;
+
+		if ((n > 1) && (pathname[n - 1] == '.'))
+			n--;
+		if (n >= sizeof(prefix))
+			return AcpiEvaluateObject(scope, (ACPI_STRING)pathname, NULL, buf);
+		memcpy(prefix, pathname, n);
+		prefix[n] = '\0';
+		if (ACPI_FAILURE(AcpiGetHandle(scope, prefix, &key_scope)))
+			return AcpiEvaluateObject(scope, (ACPI_STRING)pathname, NULL, buf);
+	}
+	memcpy(&key_name, seg, sizeof(key_name));
+
+	pthread_mutex_lock(&cache_mutex);
+	generation = fwts_acpica_namespace_generation();
+	if (generation != cache_generation) {
+		cache_flush();
+		cache_generation = generation;
+	}
+	if (cache_table_size) {
+		entry = cache_find(key_scope, key_name);
+		if (entry->obj) {
+			status = cache_copy_out(entry, buf);
+			cache_stats.hits++;
+			pthread_mutex_unlock(&cache_mutex);
+			return status;
+		}
+	}
+	cache_stats.misses++;
+	pthread_mutex_unlock(&cache_mutex);
+
+	fwts_acpica_side_effects_clear();
+	status = AcpiEvaluateObject(scope, (ACPI_STRING)pathname, NULL, buf);
+	if (ACPI_FAILURE(status) || !buf->Pointer || fwts_acpica_side_effects_get())
+		return status;
+
+	pthread_mutex_lock(&cache_mutex);
+	if (generation == fwts_acpica_namespace_generation())
+		cache_add(key_scope, key_name, buf);
+	pthread_mutex_unlock(&cache_mutex);
+
+	return status;
+}
+
+/*
+ *  fwts_acpi_object_cache_flush()
+ *	drop all cached results
+ */
+void fwts_acpi_object_cache_flush(void)
+{
+	pthread_mutex_lock(&cache_mutex);
+	cache_flush();
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+/*
+ *  fwts_acpi_object_cache_stats_get()
+ *	get number of cache hits and misses
+ */
+void fwts_acpi_object_cache_stats_get(fwts_acpi_object_cache_stats *stats)
+{
+	pthread_mutex_lock(&cache_mutex);
+	*stats = cache_stats;
+	pthread_mutex_unlock(&cache_mutex);
+}
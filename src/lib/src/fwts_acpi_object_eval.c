@@ -286,9 +286,31 @@ static const acpi_eval_error errors[] = {
 	{ 0,				0,			NULL,			NULL , 		NULL}
 };
 
+static fwts_acpica_nodes *fwts_object_nodes;
 static fwts_list *fwts_object_names;
 static bool fwts_acpi_initialized = false;
 
+/*
+ *  fwts_acpi_object_names_from_nodes()
+ *	list of the node paths, for callers that want object names,
+ *	the names are in the nodes string pool and not allocated
+ */
+static fwts_list *fwts_acpi_object_names_from_nodes(const fwts_acpica_nodes *nodes)
+{
+	fwts_list *list;
+	size_t i;
+
+	if ((list = fwts_list_new()) == NULL)
+		return NULL;
+	if (!nodes)
+		return list;
+
+	for (i = 0; i < nodes->count; i++)
+		fwts_list_append(list, nodes->strings + nodes->nodes[i].path);
+
+	return list;
+}
+
 /*
  *  fwts_acpi_init()
  *	Initialise ACPIA engine and collect method namespace
@@ -298,10 +320,14 @@ int fwts_acpi_init(fwts_framework *fw)
 	if (fwts_acpica_init(fw) != FWTS_OK)
 		return FWTS_ERROR;
 
-	/* Gather all object names */
-	fwts_object_names = fwts_acpica_get_object_names(0);
+	/* Gather all objects and their names */
+	fwts_object_nodes = fwts_acpica_get_nodes();
+	fwts_object_names = fwts_acpi_object_names_from_nodes(fwts_object_nodes);
 	fwts_acpi_initialized = true;
 
+	/* Save the namespace for later runs if asked to */
+	(void)fwts_acpi_namespace_export(fw);
+
 	return FWTS_OK;
 }
 
@@ -313,12 +339,22 @@ int fwts_acpi_deinit(fwts_framework *fw)
 {
 	int ret = FWTS_ERROR;
 
-	FWTS_UNUSED(fw);
-
 	if (fwts_acpi_initialized) {
-		fwts_list_free(fwts_object_names, free);
+		fwts_acpica_execute_stats stats;
+
+		fwts_list_free(fwts_object_names, NULL);
 		fwts_object_names = NULL;
+		fwts_acpica_nodes_free(fwts_object_nodes);
+		fwts_object_nodes = NULL;
 		ret = fwts_acpica_deinit();
+		fwts_acpi_object_cache_flush();
+
+		fwts_acpica_execute_stats_get(&stats);
+		if (stats.dropped)
+			fwts_log_info(fw, "%" PRIu64 " of %" PRIu64 " deferred "
+				"AML calls (such as Notify) were dropped, the "
+				"ACPICA execution queue was full.",
+				stats.dropped, stats.dropped + stats.queued);
 
 		fwts_acpi_initialized = false;
 	}
@@ -328,13 +364,54 @@ int fwts_acpi_deinit(fwts_framework *fw)
 
 /*
  *  fwts_acpi_object_get_names()
- *	return list of object names
+ *	return list of object names, from the namespace snapshot
+ *	if ACPICA has not been initialised
  */
 fwts_list *fwts_acpi_object_get_names(void)
 {
+	if (!fwts_acpi_initialized)
+		return fwts_acpi_namespace_names();
+
 	return fwts_object_names;
 }
 
+/*
+ *  fwts_acpi_object_get_nodes()
+ *	return the records of all the objects, NULL if ACPICA
+ *	has not been initialised
+ */
+const fwts_acpica_nodes *fwts_acpi_object_get_nodes(void)
+{
+	return fwts_acpi_initialized ? fwts_object_nodes : NULL;
+}
+
+/*
+ *  fwts_acpi_object_node_get()
+ *	get the handle and type of an object record, these are looked
+ *	up again by path if a table has been unloaded since the records
+ *	were fetched as the node may have gone
+ */
+ACPI_STATUS fwts_acpi_object_node_get(
+	const fwts_acpica_nodes *nodes,
+	const fwts_acpica_node *node,
+	ACPI_HANDLE *handle,
+	ACPI_OBJECT_TYPE *type)
+{
+	ACPI_STATUS status;
+
+	if (fwts_acpica_nodes_valid(nodes)) {
+		*handle = node->handle;
+		*type = node->type;
+		return AE_OK;
+	}
+
+	status = AcpiGetHandle(NULL, nodes->strings + node->path, handle);
+	if (ACPI_FAILURE(status))
+		return status;
+
+	return AcpiGetType(*handle, type);
+}
+
 /*
  *  fwts_acpi_object_exists()
  *	return first matching name
@@ -343,8 +420,12 @@ char *fwts_acpi_object_exists(const char *name)
 {
 	size_t name_len = strlen(name);
 	fwts_list_link	*item;
+	fwts_list *names = fwts_acpi_object_get_names();
+
+	if (!names)
+		return NULL;
 
-	fwts_list_foreach(item, fwts_object_names) {
+	fwts_list_foreach(item, names) {
 		char *method_name = fwts_list_data(char*, item);
 		size_t len = strlen(method_name);
 
@@ -433,6 +514,27 @@ void fwts_acpi_object_evaluate_report_error(
 {
 	int i;
 
+	/* Aborted by --aml-budget */
+	if (status == AE_AML_LOOP_TIMEOUT) {
+		const fwts_acpica_budget_reason reason = fwts_acpica_budget_exceeded();
+		uint64_t opcodes;
+		uint32_t ms;
+
+		fwts_acpica_budget_get(&opcodes, &ms);
+		if (reason == FWTS_ACPICA_BUDGET_OPCODES) {
+			fwts_failed(fw, LOG_LEVEL_MEDIUM, "AMLBudgetExceeded",
+				"Evaluation of '%s' was aborted after executing "
+				"%" PRIu64 " AML opcodes.", name, opcodes);
+			return;
+		}
+		if (reason == FWTS_ACPICA_BUDGET_TIME) {
+			fwts_failed(fw, LOG_LEVEL_MEDIUM, "AMLBudgetExceeded",
+				"Evaluation of '%s' was aborted after running "
+				"for %" PRIu32 " milliseconds.", name, ms);
+			return;
+		}
+	}
+
 	/* Generic cases */
 	for (i = 0; errors[i].error_type; i++) {
 		if (status == errors[i].status) {
@@ -482,6 +584,9 @@ ACPI_STATUS fwts_acpi_object_evaluate(fwts_framework *fw,
 	buf->Length  = ACPI_ALLOCATE_BUFFER;
 	buf->Pointer = NULL;
 
+	if (!arg_list || !arg_list->Count)
+		return fwts_acpi_object_cache_evaluate(NULL, name, buf);
+
 	return AcpiEvaluateObject(NULL, name, arg_list, buf);
 }
 
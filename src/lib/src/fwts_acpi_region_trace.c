@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  OpRegion traces: register values that the ACPICA region handler and
+ *  port / PCI configuration reads serve instead of the usual fake values.
+ *
+ *  A trace is a text file, one register per line:
+ *
+ *	space-id address width value [value ...]
+ *
+ *  all numbers in C notation, '#' starts a comment.  Successive reads of
+ *  a register return successive values, the last value is repeated once
+ *  the sequence is exhausted, so polled status registers can be made to
+ *  change after N reads.  Wider reads that are not in the trace are
+ *  built from 8 bit entries when all the bytes are present, which is how
+ *  captured traces are written.
+ */
+
+#include "fwts.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+/* acpica headers */
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "acpi.h"
+#pragma GCC diagnostic error "-Wunused-parameter"
+
+#define TRACE_MAX_VALUES	(4096)		/* Values per trace line */
+#define TRACE_MAX_CAPTURE	(64 * 1024)	/* Largest region captured */
+#define TRACE_EC_IO		"/sys/kernel/debug/ec/ec0/io"
+#define TRACE_EC_SIZE		(256)
+
+typedef struct {
+	uint64_t	address;
+	uint32_t	width;		/* Access width in bits */
+	uint8_t		space_id;
+	uint32_t	line;		/* Line in trace file, keeps sequences in order */
+	uint32_t	count;		/* Number of values */
+	uint32_t	cursor;		/* Next value to return */
+	uint64_t	*values;
+} fwts_region_trace_entry;
+
+static fwts_region_trace_entry	*trace_entries;
+static size_t			trace_count;
+static fwts_acpi_region_trace_stats trace_stats;
+static pthread_mutex_t		trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int fwts_region_trace_key_cmp(const void *a, const void *b)
+{
+	const fwts_region_trace_entry *ea = (const fwts_region_trace_entry *)a;
+	const fwts_region_trace_entry *eb = (const fwts_region_trace_entry *)b;
+
+	if (ea->space_id != eb->space_id)
+		return ea->space_id < eb->space_id ? -1 : 1;
+	if (ea->address != eb->address)
+		return ea->address < eb->address ? -1 : 1;
+	if (ea->width != eb->width)
+		return ea->width < eb->width ? -1 : 1;
+	return 0;
+}
+
+static int fwts_region_trace_cmp(const void *a, const void *b)
+{
+	const fwts_region_trace_entry *ea = (const fwts_region_trace_entry *)a;
+	const fwts_region_trace_entry *eb = (const fwts_region_trace_entry *)b;
+	int ret = fwts_region_trace_key_cmp(a, b);
+
+	if (ret || (ea->line == eb->line))
+		return ret;
+	return ea->line < eb->line ? -1 : 1;
+}
+
+/*
+ *  fwts_region_trace_find()
+ *	find the trace entry for a register, NULL if it is not traced
+ */
+static fwts_region_trace_entry *fwts_region_trace_find(
+	const uint8_t space_id,
+	const uint64_t address,
+	const uint32_t width)
+{
+	fwts_region_trace_entry key;
+
+	if (!trace_entries)
+		return NULL;
+
+	key.space_id = space_id;
+	key.address = address;
+	key.width = width;
+
+	return bsearch(&key, trace_entries, trace_count,
+		sizeof(*trace_entries), fwts_region_trace_key_cmp);
+}
+
+/*
+ *  fwts_region_trace_next()
+ *	return the next value in a register's sequence
+ */
+static uint64_t fwts_region_trace_next(fwts_region_trace_entry *entry)
+{
+	uint64_t value = entry->values[entry->cursor];
+
+	if (entry->cursor + 1 < entry->count)
+		entry->cursor++;
+
+	return value;
+}
+
+/*
+ *  fwts_region_trace_parse_line()
+ *	parse a trace line into entry, returns FWTS_SKIP for blank lines
+ */
+static int fwts_region_trace_parse_line(
+	char *line,
+	const uint32_t lineno,
+	fwts_region_trace_entry *entry)
+{
+	char *ptr, *end;
+	uint64_t values[TRACE_MAX_VALUES];
+	unsigned long space_id, width;
+
+	if ((ptr = strchr(line, '#')) != NULL)
+		*ptr = '\0';
+	for (ptr = line; isspace((unsigned char)*ptr); ptr++)
+		;
+	if (*ptr == '\0')
+		return FWTS_SKIP;
+
+	memset(entry, 0, sizeof(*entry));
+	entry->line = lineno;
+
+	space_id = strtoul(ptr, &end, 0);
+	if ((end == ptr) || (space_id > 0xff))
+		return FWTS_ERROR;
+	entry->space_id = (uint8_t)space_id;
+
+	ptr = end;
+	entry->address = strtoull(ptr, &end, 0);
+	if (end == ptr)
+		return FWTS_ERROR;
+
+	ptr = end;
+	width = strtoul(ptr, &end, 0);
+	if ((end == ptr) || (width == 0) || (width > 64))
+		return FWTS_ERROR;
+	entry->width = (uint32_t)width;
+
+	for (ptr = end; ; ptr = end) {
+		uint64_t value = strtoull(ptr, &end, 0);
+
+		if (end == ptr)
+			break;
+		if (entry->count >= TRACE_MAX_VALUES)
+			return FWTS_ERROR;
+		if (width < 64)
+			value &= (1ULL << width) - 1;
+		values[entry->count++] = value;
+	}
+	for (; isspace((unsigned char)*ptr); ptr++)
+		;
+	if ((*ptr != '\0') || (entry->count == 0))
+		return FWTS_ERROR;
+
+	if ((entry->values = malloc(entry->count * sizeof(*entry->values))) == NULL)
+		return FWTS_OUT_OF_MEMORY;
+	memcpy(entry->values, values, entry->count * sizeof(*entry->values));
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_region_trace_merge()
+ *	sort the entries and merge lines for the same register into one
+ *	sequence, in the order they appear in the trace
+ */
+static int fwts_region_trace_merge(void)
+{
+	size_t i, n = 0;
+
+	qsort(trace_entries, trace_count, sizeof(*trace_entries), fwts_region_trace_cmp);
+
+	for (i = 0; i < trace_count; i++) {
+		fwts_region_trace_entry *prev = n ? &trace_entries[n - 1] : NULL;
+		fwts_region_trace_entry *entry = &trace_entries[i];
+
+		if (prev && !fwts_region_trace_key_cmp(prev, entry)) {
+			uint64_t *values;
+
+			values = realloc(prev->values,
+				(prev->count + entry->count) * sizeof(*values));
+			if (!values) {
+				/* Drop the entries not merged yet */
+				for (; i < trace_count; i++)
+					free(trace_entries[i].values);
+				trace_count = n;
+				return FWTS_OUT_OF_MEMORY;
+			}
+			memcpy(values + prev->count, entry->values,
+				entry->count * sizeof(*values));
+			prev->values = values;
+			prev->count += entry->count;
+			free(entry->values);
+			continue;
+		}
+		trace_entries[n++] = *entry;
+	}
+	trace_count = n;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_acpi_region_trace_load()
+ *	load an OpRegion trace for the region handler to replay
+ */
+int fwts_acpi_region_trace_load(const char *filename)
+{
+	FILE *fp;
+	char line[65536];
+	uint32_t lineno = 0;
+	size_t size = 0;
+	int ret;
+
+	fwts_acpi_region_trace_free();
+
+	if ((fp = fopen(filename, "r")) == NULL) {
+		fprintf(stderr, "Cannot open OpRegion trace %s.\n", filename);
+		return FWTS_ERROR;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		fwts_region_trace_entry entry;
+
+		lineno++;
+		ret = fwts_region_trace_parse_line(line, lineno, &entry);
+		if (ret == FWTS_SKIP)
+			continue;
+		if (ret != FWTS_OK) {
+			fprintf(stderr, "OpRegion trace %s line %" PRIu32 " should be: "
+				"space-id address width value [value ...]\n",
+				filename, lineno);
+			goto err;
+		}
+		if (trace_count == size) {
+			fwts_region_trace_entry *entries;
+
+			size = size ? size * 2 : 256;
+			entries = realloc(trace_entries, size * sizeof(*entries));
+			if (!entries) {
+				free(entry.values);
+				fprintf(stderr, "Cannot allocate OpRegion trace.\n");
+				goto err;
+			}
+			trace_entries = entries;
+		}
+		trace_entries[trace_count++] = entry;
+	}
+	(void)fclose(fp);
+
+	if (fwts_region_trace_merge() != FWTS_OK) {
+		fprintf(stderr, "Cannot allocate OpRegion trace.\n");
+		fwts_acpi_region_trace_free();
+		return FWTS_ERROR;
+	}
+
+	return FWTS_OK;
+err:
+	(void)fclose(fp);
+	fwts_acpi_region_trace_free();
+
+	return FWTS_ERROR;
+}
+
+/*
+ *  fwts_acpi_region_trace_free()
+ *	free the OpRegion trace, the region handler goes back to fake values
+ */
+void fwts_acpi_region_trace_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < trace_count; i++)
+		free(trace_entries[i].values);
+	free(trace_entries);
+	trace_entries = NULL;
+	trace_count = 0;
+}
+
+/*
+ *  fwts_acpi_region_trace_rewind()
+ *	restart all register sequences and clear the hit/miss counts,
+ *	so each ACPICA session sees the same values
+ */
+void fwts_acpi_region_trace_rewind(void)
+{
+	size_t i;
+
+	pthread_mutex_lock(&trace_mutex);
+	for (i = 0; i < trace_count; i++)
+		trace_entries[i].cursor = 0;
+	memset(&trace_stats, 0, sizeof(trace_stats));
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+/*
+ *  fwts_acpi_region_trace_read()
+ *	read a register from the trace, returns false if no trace is
+ *	loaded or the register is not in it
+ */
+bool fwts_acpi_region_trace_read(
+	const uint8_t space_id,
+	const uint64_t address,
+	const uint32_t width,
+	uint64_t *value)
+{
+	fwts_region_trace_entry *entry;
+	bool found = false;
+
+	if (!trace_entries)
+		return false;
+
+	pthread_mutex_lock(&trace_mutex);
+	if ((entry = fwts_region_trace_find(space_id, address, width)) != NULL) {
+		*value = fwts_region_trace_next(entry);
+		found = true;
+	} else if (width > 8 && width <= 64 && !(width & 7)) {
+		fwts_region_trace_entry *bytes[8];
+		uint32_t i;
+
+		/* Try to build it from byte entries */
+		for (i = 0; i < width / 8; i++)
+			if ((bytes[i] = fwts_region_trace_find(space_id, address + i, 8)) == NULL)
+				break;
+		if (i == width / 8) {
+			*value = 0;
+			for (i = 0; i < width / 8; i++)
+				*value |= fwts_region_trace_next(bytes[i]) << (i * 8);
+			found = true;
+		}
+	}
+	if (found)
+		trace_stats.hits++;
+	else
+		trace_stats.misses++;
+	pthread_mutex_unlock(&trace_mutex);
+
+	return found;
+}
+
+/*
+ *  fwts_acpi_region_trace_stats_get()
+ *	get the hit/miss counts since the trace was rewound
+ */
+void fwts_acpi_region_trace_stats_get(fwts_acpi_region_trace_stats *stats)
+{
+	pthread_mutex_lock(&trace_mutex);
+	*stats = trace_stats;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+/*
+ *  fwts_region_trace_write_bytes()
+ *	write captured bytes of a region as 8 bit trace entries
+ */
+static void fwts_region_trace_write_bytes(
+	FILE *fp,
+	const fwts_acpica_region *region,
+	const uint8_t *data)
+{
+	uint64_t i;
+
+	fprintf(fp, "# %s %s 0x%" PRIx64 " length 0x%" PRIx64 "\n",
+		region->path, region->space_name,
+		region->address, region->length);
+	for (i = 0; i < region->length; i++)
+		fprintf(fp, "0x%2.2" PRIx8 " 0x%16.16" PRIx64 " 8 0x%2.2" PRIx8 "\n",
+			region->space_id, region->address + i, data[i]);
+}
+
+/*
+ *  fwts_region_trace_capture_memory()
+ *	read a SystemMemory region, only regions wholly inside RAM or ACPI
+ *	NVS are read as reading elsewhere could touch device registers
+ */
+static int fwts_region_trace_capture_memory(
+	fwts_list *memory_map,
+	const fwts_acpica_region *region,
+	uint8_t *data)
+{
+	fwts_memory_map_entry *entry;
+	void *mem;
+	int ret;
+
+	if (!memory_map)
+		return FWTS_SKIP;
+	entry = fwts_memory_map_info(memory_map, region->address);
+	if (!entry ||
+	    (entry != fwts_memory_map_info(memory_map, region->address + region->length - 1)) ||
+	    ((entry->type != FWTS_MEMORY_MAP_USABLE) && (entry->type != FWTS_MEMORY_MAP_ACPI)))
+		return FWTS_SKIP;
+
+	if ((mem = fwts_mmap((off_t)region->address, (size_t)region->length)) == FWTS_MAP_FAILED)
+		return FWTS_ERROR;
+	ret = fwts_safe_memcpy(data, mem, (size_t)region->length);
+	(void)fwts_munmap(mem, (size_t)region->length);
+
+	return ret == FWTS_OK ? FWTS_OK : FWTS_ERROR;
+}
+
+/*
+ *  fwts_region_trace_capture_ec()
+ *	copy an EmbeddedControl region from the EC RAM dump
+ */
+static int fwts_region_trace_capture_ec(
+	const uint8_t *ec,
+	const ssize_t ec_size,
+	const fwts_acpica_region *region,
+	uint8_t *data)
+{
+	if ((ec_size <= 0) || (region->address + region->length > (uint64_t)ec_size))
+		return FWTS_SKIP;
+
+	memcpy(data, ec + region->address, (size_t)region->length);
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_acpi_region_trace_capture()
+ *	write a trace of the current contents of the OpRegions defined by
+ *	the ACPI tables.  Registers are read directly, not through AML, and
+ *	only where reading has no side effects: SystemMemory regions in RAM
+ *	or ACPI NVS and EmbeddedControl regions from the kernel's EC debugfs
+ *	dump.  Other regions are listed in the trace but not captured.
+ */
+int fwts_acpi_region_trace_capture(fwts_framework *fw, const char *filename)
+{
+	fwts_list *regions, *memory_map;
+	fwts_list_link *item;
+	uint8_t ec[TRACE_EC_SIZE], *data;
+	ssize_t ec_size = -1;
+	int fd, captured = 0, skipped = 0;
+	FILE *fp;
+
+	if (fwts_acpica_init(fw) != FWTS_OK) {
+		fprintf(stderr, "Cannot initialise ACPICA to find OpRegions.\n");
+		return FWTS_ERROR;
+	}
+	regions = fwts_acpica_get_regions();
+	fwts_acpica_deinit();
+	if (!regions) {
+		fprintf(stderr, "Cannot allocate OpRegion list.\n");
+		return FWTS_ERROR;
+	}
+
+	if ((fp = fopen(filename, "w")) == NULL) {
+		fprintf(stderr, "Cannot create OpRegion trace %s.\n", filename);
+		fwts_list_free(regions, free);
+		return FWTS_ERROR;
+	}
+	if ((data = malloc(TRACE_MAX_CAPTURE)) == NULL) {
+		fprintf(stderr, "Cannot allocate OpRegion capture buffer.\n");
+		(void)fclose(fp);
+		fwts_list_free(regions, free);
+		return FWTS_ERROR;
+	}
+
+	memory_map = fwts_memory_map_table_load(fw);
+	if ((fd = open(TRACE_EC_IO, O_RDONLY)) >= 0) {
+		ec_size = read(fd, ec, sizeof(ec));
+		(void)close(fd);
+	}
+
+	fprintf(fp, "# fwts OpRegion trace\n");
+	fprintf(fp, "# space-id address width value [value ...]\n");
+
+	fwts_list_foreach(item, regions) {
+		fwts_acpica_region *region = fwts_list_data(fwts_acpica_region *, item);
+		int ret = FWTS_SKIP;
+
+		if ((region->length > 0) && (region->length <= TRACE_MAX_CAPTURE)) {
+			switch (region->space_id) {
+			case ACPI_ADR_SPACE_SYSTEM_MEMORY:
+				ret = fwts_region_trace_capture_memory(memory_map, region, data);
+				break;
+			case ACPI_ADR_SPACE_EC:
+				ret = fwts_region_trace_capture_ec(ec, ec_size, region, data);
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (ret == FWTS_OK) {
+			fwts_region_trace_write_bytes(fp, region, data);
+			captured++;
+		} else {
+			fprintf(fp, "# %s %s 0x%" PRIx64 " length 0x%" PRIx64 " not captured\n",
+				region->path, region->space_name,
+				region->address, region->length);
+			skipped++;
+		}
+	}
+	(void)fclose(fp);
+
+	printf("Captured %d OpRegions to %s, %d could not be read safely.\n",
+		captured, filename, skipped);
+
+	free(data);
+	if (memory_map)
+		fwts_memory_map_table_free(memory_map);
+	fwts_list_free(regions, free);
+
+	return FWTS_OK;
+}
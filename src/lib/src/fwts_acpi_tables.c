@@ -237,11 +237,12 @@ static void *fwts_acpi_load_table(const off_t addr)
 }
 
 /*
- *  fwts_acpi_add_table()
- *	Add a table to internal ACPI table cache. Ignore duplicates based on
+ *  fwts_acpi_add_table_to_set()
+ *	Add a table to a set of ACPI tables. Ignore duplicates based on
  *	their address.
  */
-static void fwts_acpi_add_table(
+static void fwts_acpi_add_table_to_set(
+	fwts_acpi_table_info *set,		/* Table set */
 	const char *name,			/* Table Name */
 	void *table,				/* Table binary blob */
 	const uint64_t addr,			/* Address of table */
@@ -253,30 +254,46 @@ static void fwts_acpi_add_table(
 	uint32_t which = 0;
 
 	for (i = 0; i < ACPI_MAX_TABLES; i++) {
-		if (addr && tables[i].addr == addr) {
+		if (addr && set[i].addr == addr) {
 			/* We don't need it, it's a duplicate, so free and return */
 			fwts_low_free(table);
 			return;
 		}
-		if (strncmp(tables[i].name, name, 4) == 0)
+		if (strncmp(set[i].name, name, 4) == 0)
 			which++;
-		if (tables[i].data == NULL) {
-			memcpy(tables[i].name, name, 4);
-			tables[i].name[4] = 0;
-			tables[i].data = table;
-			tables[i].addr = addr;
-			tables[i].length = length;
-			tables[i].which = which;
-			tables[i].index = i;
-			tables[i].provenance = provenance;
-			tables[i].has_aml =
-				((!strcmp(tables[i].name, "DSDT")) ||
-				 (!strcmp(tables[i].name, "SSDT")));
+		if (set[i].data == NULL) {
+			memcpy(set[i].name, name, 4);
+			set[i].name[4] = 0;
+			set[i].data = table;
+			set[i].addr = addr;
+			set[i].length = length;
+			set[i].which = which;
+			set[i].index = i;
+			set[i].provenance = provenance;
+			set[i].has_aml =
+				((!strcmp(set[i].name, "DSDT")) ||
+				 (!strcmp(set[i].name, "SSDT")));
 			return;
 		}
 	}
 }
 
+/*
+ *  fwts_acpi_add_table()
+ *	Add a table to internal ACPI table cache. Ignore duplicates based on
+ *	their address.
+ */
+static void fwts_acpi_add_table(
+	const char *name,			/* Table Name */
+	void *table,				/* Table binary blob */
+	const uint64_t addr,			/* Address of table */
+	const size_t length,			/* Length of table */
+	const fwts_acpi_table_provenance provenance)
+						/* Where we got the table from */
+{
+	fwts_acpi_add_table_to_set(tables, name, table, addr, length, provenance);
+}
+
 /*
  *  fwts_acpi_free_tables()
  *	free up the cached copies of the ACPI tables
@@ -291,6 +308,8 @@ int fwts_acpi_free_tables(void)
 			memset(&tables[i], 0, sizeof(fwts_acpi_table_info));
 		}
 	}
+	acpi_tables_loaded = ACPI_TABLES_NOT_LOADED;
+
 	return FWTS_OK;
 }
 
@@ -722,16 +741,18 @@ static uint8_t *fwts_acpi_load_table_from_acpidump(
  *  fwts_acpi_load_tables_from_acpidump()
  *	Load in all ACPI tables from output of acpidump or fwts --dump
  */
-static int fwts_acpi_load_tables_from_acpidump(fwts_framework *fw)
+static int fwts_acpi_load_tables_from_acpidump(
+	fwts_framework *fw,
+	fwts_acpi_table_info *set,
+	const char *filename)
 {
 	FILE *fp;
 
-	if (!fw->acpi_table_acpidump_file)
+	if (!filename)
 		return FWTS_ERROR;
 
-	if ((fp = fopen(fw->acpi_table_acpidump_file, "r")) == NULL) {
-		fwts_log_error(fw, "Cannot open '%s' to read ACPI tables.",
-			fw->acpi_table_acpidump_file);
+	if ((fp = fopen(filename, "r")) == NULL) {
+		fwts_log_error(fw, "Cannot open '%s' to read ACPI tables.", filename);
 		return FWTS_ERROR;
 	}
 
@@ -742,7 +763,8 @@ static int fwts_acpi_load_tables_from_acpidump(fwts_framework *fw)
 		char name[16];
 
 		if ((table = fwts_acpi_load_table_from_acpidump(fw, fp, name, &addr, &length)) != NULL)
-			fwts_acpi_add_table(name, table, addr, length, FWTS_ACPI_TABLE_FROM_FILE);
+			fwts_acpi_add_table_to_set(set, name, table, addr, length,
+				FWTS_ACPI_TABLE_FROM_FILE);
 	}
 
 	(void)fclose(fp);
@@ -820,7 +842,8 @@ err_no_data:
  */
 static int fwts_acpi_load_tables_from_file_generic(
 	fwts_framework *fw,
-	char *acpi_table_path,
+	fwts_acpi_table_info *set,
+	const char *acpi_table_path,
 	const char *extension,
 	int *count)
 {
@@ -900,7 +923,7 @@ static int fwts_acpi_load_tables_from_file_generic(
 						 */
 						fwts_low_free(table);
 					} else {
-						fwts_acpi_add_table(name, table,
+						fwts_acpi_add_table_to_set(set, name, table,
 							(uint64_t)fwts_fake_physical_addr(length), length,
 							FWTS_ACPI_TABLE_FROM_FILE);
 					}
@@ -926,7 +949,7 @@ static int fwts_acpi_load_tables_from_file(fwts_framework *fw)
 	if (!fw->acpi_table_path)
 		return FWTS_ERROR;
 
-	fwts_acpi_load_tables_from_file_generic(fw, fw->acpi_table_path, ".dat", &count);
+	fwts_acpi_load_tables_from_file_generic(fw, tables, fw->acpi_table_path, ".dat", &count);
 	if (count == 0) {
 		fwts_log_error(fw, "Could not find any ACPI tables in directory '%s'.\n", fw->acpi_table_path);
 		return FWTS_ERROR;
@@ -1219,8 +1242,8 @@ static int fwts_acpi_load_tables_fixup(fwts_framework *fw)
 static int fwts_acpi_load_tables_from_sysfs(fwts_framework *fw)
 {
 	int count, total;
-	fwts_acpi_load_tables_from_file_generic(fw, "/sys/firmware/acpi/tables", "", &total);
-	fwts_acpi_load_tables_from_file_generic(fw, "/sys/firmware/acpi/tables/dynamic", "", &count);
+	fwts_acpi_load_tables_from_file_generic(fw, tables, "/sys/firmware/acpi/tables", "", &total);
+	fwts_acpi_load_tables_from_file_generic(fw, tables, "/sys/firmware/acpi/tables/dynamic", "", &count);
 	total += count;
 	if (total == 0) {
 		fwts_log_error(fw, "Could not find any ACPI tables in directory '/sys/firmware/acpi/tables'.\n");
@@ -1242,7 +1265,7 @@ int fwts_acpi_load_tables(fwts_framework *fw)
 		ret = fwts_acpi_load_tables_from_file(fw);
 		require_fixup = true;
 	} else if (fw->acpi_table_acpidump_file != NULL) {
-		ret = fwts_acpi_load_tables_from_acpidump(fw);
+		ret = fwts_acpi_load_tables_from_acpidump(fw, tables, fw->acpi_table_acpidump_file);
 		require_fixup = true;
 	} else if (fwts_check_root_euid(fw, true) == FWTS_OK) {
 		ret = fwts_acpi_load_tables_from_sysfs(fw);
@@ -1269,6 +1292,102 @@ int fwts_acpi_load_tables(fwts_framework *fw)
 	return ret;
 }
 
+/*
+ *  fwts_acpi_load_table_set()
+ *	Load a separate set of ACPI tables, e.g. from an earlier
+ *	firmware image to compare against, from a directory of
+ *	raw .dat tables or from the output of acpidump or fwts
+ *	--dump.  The tables loaded for the tests are untouched.
+ *	Tables in the set are indexed as by fwts_acpi_get_table(),
+ *	free the set with fwts_acpi_free_table_set().
+ */
+fwts_acpi_table_info *fwts_acpi_load_table_set(fwts_framework *fw, const char *path)
+{
+	fwts_acpi_table_info *set;
+	struct stat buf;
+	int ret, count = 0;
+
+	if (path == NULL)
+		return NULL;
+	if (stat(path, &buf) < 0) {
+		fwts_log_error(fw, "Cannot stat '%s' to read ACPI tables.", path);
+		return NULL;
+	}
+	if ((set = calloc(ACPI_MAX_TABLES, sizeof(*set))) == NULL)
+		return NULL;
+
+	if (S_ISDIR(buf.st_mode)) {
+		ret = fwts_acpi_load_tables_from_file_generic(fw, set, path, ".dat", &count);
+		if ((ret == FWTS_OK) && (count == 0)) {
+			fwts_log_error(fw, "Could not find any ACPI tables in directory '%s'.", path);
+			ret = FWTS_ERROR;
+		}
+	} else
+		ret = fwts_acpi_load_tables_from_acpidump(fw, set, path);
+
+	if (ret != FWTS_OK) {
+		fwts_acpi_free_table_set(set);
+		return NULL;
+	}
+
+	return set;
+}
+
+/*
+ *  fwts_acpi_free_table_set()
+ *	free a set of tables loaded by fwts_acpi_load_table_set()
+ */
+void fwts_acpi_free_table_set(fwts_acpi_table_info *set)
+{
+	int i;
+
+	if (set == NULL)
+		return;
+
+	for (i = 0; i < ACPI_MAX_TABLES; i++)
+		if (set[i].data)
+			fwts_low_free(set[i].data);
+	free(set);
+}
+
+/*
+ *  fwts_acpi_inject_table()
+ *	Add a copy of a raw table buffer to the table cache as if it had
+ *	been loaded from file, without loading any other tables.  This
+ *	allows a test to be run against an arbitrary (and possibly
+ *	malformed) table, e.g. by a fuzzer.  A zero addr fakes a unique
+ *	address. The table cache should be emptied with
+ *	fwts_acpi_free_tables() before injecting a new set.
+ */
+int fwts_acpi_inject_table(
+	const char *name,
+	const void *data,
+	const size_t length,
+	const uint64_t addr)
+{
+	uint8_t *table;
+
+	if ((name == NULL) || (strlen(name) != 4))
+		return FWTS_ERROR;
+	if ((data == NULL) && length)
+		return FWTS_NULL_POINTER;
+	if (tables[ACPI_MAX_TABLES - 1].data)
+		return FWTS_ERROR;
+
+	/* Zero length tables still need a valid data pointer */
+	if ((table = fwts_low_calloc(1, length ? length : 1)) == NULL)
+		return FWTS_OUT_OF_MEMORY;
+	if (length)
+		memcpy(table, data, length);
+
+	fwts_acpi_add_table(name, table,
+		addr ? addr : (uint64_t)fwts_fake_physical_addr(length),
+		length, FWTS_ACPI_TABLE_FROM_FILE);
+	acpi_tables_loaded = ACPI_TABLES_LOADED_OK;
+
+	return FWTS_OK;
+}
+
 /*
  *  fwts_acpi_find_table()
  *  	Search for an ACPI table. There may be more than one, so
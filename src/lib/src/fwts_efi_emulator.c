@@ -0,0 +1,805 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  In-process stand-in for the efi_runtime driver and the firmware
+ *  behind it, --efi-emulator.  The ioctls of the driver are served
+ *  from an emulated variable store, clock and monotonic counter so
+ *  the UEFI runtime service tests can run without UEFI firmware.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+#include "fwts.h"
+#include "fwts_uefi.h"
+#include "fwts_efi_runtime.h"
+#include "fwts_efi_module.h"
+
+#define EFI_EMULATOR_VARIABLE_OVERHEAD	(32)	/* Store bytes per variable, as a header */
+#define EFI_EMULATOR_VARIABLE_SIZE_MAX	(32768)	/* Largest variable, name and data */
+#define EFI_EMULATOR_TIMEZONE_UNSPECIFIED	(2047)
+
+#define EFI_EMULATOR_SUPPORTED		\
+	(EFI_RT_SUPPORTED_ALL &		\
+	 ~(EFI_RT_SUPPORTED_SET_VIRTUAL_ADDRESS_MAP |	\
+	   EFI_RT_SUPPORTED_CONVERT_POINTER |		\
+	   EFI_RT_SUPPORTED_RESET_SYSTEM |		\
+	   EFI_RT_SUPPORTED_UPDATE_CAPSULE |		\
+	   EFI_RT_SUPPORTED_QUERY_CAPSULE_CAPABILITIES))
+
+#define EFI_EMULATOR_RUNTIME_ATTRIBUTES	\
+	(FWTS_UEFI_VAR_NON_VOLATILE |		\
+	 FWTS_UEFI_VAR_BOOTSERVICE_ACCESS |	\
+	 FWTS_UEFI_VAR_RUNTIME_ACCESS)
+
+#define EFI_EMULATOR_ATTRIBUTES		\
+	(FWTS_UEFI_VAR_NON_VOLATILE |		\
+	 FWTS_UEFI_VAR_BOOTSERVICE_ACCESS |	\
+	 FWTS_UEFI_VAR_RUNTIME_ACCESS |		\
+	 FWTS_UEFI_VARIABLE_HARDWARE_ERROR_RECORD)
+
+typedef struct {
+	uint16_t	*name;
+	size_t		name_size;		/* In bytes, with the terminating null */
+	EFI_GUID	guid;
+	uint32_t	attributes;
+	uint8_t		*data;
+	size_t		data_size;
+} efi_emulator_variable;
+
+typedef struct {
+	efi_emulator_variable *variables;
+	size_t		count;
+	size_t		size;			/* Allocated variables */
+	uint64_t	store_used;		/* Store bytes used, with garbage */
+	uint64_t	store_size;		/* --efi-emulator store size */
+	uint64_t	garbage;		/* Deleted variable bytes not reclaimed yet */
+	fwts_efi_emulator_reclaim reclaim;	/* --efi-emulator-reclaim */
+	uint32_t	latency_us;		/* --efi-emulator latency per call */
+	uint32_t	fault_every;		/* --efi-emulator fault every Nth call, 0 = never */
+	uint64_t	calls;
+	time_t		time_offset;		/* Emulated clock minus the host clock */
+	int16_t		timezone;
+	uint8_t		daylight;
+	uint8_t		wakeup_enabled;
+	EFI_TIME	wakeup_time;
+	uint32_t	high_count;		/* GetNextHighMonotonicCount */
+} efi_emulator_state;
+
+static efi_emulator_state efi_emulator;
+static char efi_emulator_efivarfs_dir[256];	/* fwts_efi_emulator_efivarfs() copy */
+static pthread_mutex_t efi_emulator_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ *  efi_emulator_variable_cost()
+ *	store bytes taken by a variable
+ */
+static uint64_t efi_emulator_variable_cost(const size_t name_size, const size_t data_size)
+{
+	return EFI_EMULATOR_VARIABLE_OVERHEAD + name_size + data_size;
+}
+
+/*
+ *  efi_emulator_store_fits()
+ *	check there is room for bytes more in the store, reclaiming the
+ *	space of deleted variables first if the store is full and the
+ *	reclaim mode allows it
+ */
+static bool efi_emulator_store_fits(const uint64_t bytes)
+{
+	if (efi_emulator.store_used + bytes <= efi_emulator.store_size)
+		return true;
+	if ((efi_emulator.reclaim != FWTS_EFI_EMULATOR_RECLAIM_FULL) || !efi_emulator.garbage)
+		return false;
+
+	efi_emulator.store_used -= efi_emulator.garbage;
+	efi_emulator.garbage = 0;
+
+	return efi_emulator.store_used + bytes <= efi_emulator.store_size;
+}
+
+/*
+ *  efi_emulator_variable_find()
+ *	find a variable by name and vendor guid
+ */
+static efi_emulator_variable *efi_emulator_variable_find(
+	const uint16_t *name,
+	const EFI_GUID *guid)
+{
+	const size_t name_size = (fwts_uefi_str16len(name) + 1) * sizeof(uint16_t);
+	size_t i;
+
+	for (i = 0; i < efi_emulator.count; i++) {
+		efi_emulator_variable *var = &efi_emulator.variables[i];
+
+		if ((var->name_size == name_size) &&
+		    !memcmp(var->name, name, name_size) &&
+		    !memcmp(&var->guid, guid, sizeof(EFI_GUID)))
+			return var;
+	}
+	return NULL;
+}
+
+/*
+ *  efi_emulator_variable_delete()
+ *	remove a variable, keeping the others in order, its space
+ *	is garbage until reclaimed unless reclaim is immediate
+ */
+static void efi_emulator_variable_delete(efi_emulator_variable *var)
+{
+	const size_t i = var - efi_emulator.variables;
+	const uint64_t cost = efi_emulator_variable_cost(var->name_size, var->data_size);
+
+	if (efi_emulator.reclaim == FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE)
+		efi_emulator.store_used -= cost;
+	else
+		efi_emulator.garbage += cost;
+	free(var->name);
+	free(var->data);
+	memmove(var, var + 1, (efi_emulator.count - i - 1) * sizeof(*var));
+	efi_emulator.count--;
+}
+
+/*
+ *  efi_emulator_variable_add()
+ *	add a new variable to the end of the store
+ */
+static uint64_t efi_emulator_variable_add(
+	const uint16_t *name,
+	const EFI_GUID *guid,
+	const uint32_t attributes,
+	const void *data,
+	const size_t data_size)
+{
+	const size_t name_size = (fwts_uefi_str16len(name) + 1) * sizeof(uint16_t);
+	efi_emulator_variable *var;
+
+	if (name_size + data_size > EFI_EMULATOR_VARIABLE_SIZE_MAX)
+		return EFI_INVALID_PARAMETER;
+	if (!efi_emulator_store_fits(efi_emulator_variable_cost(name_size, data_size)))
+		return EFI_OUT_OF_RESOURCES;
+
+	if (efi_emulator.count == efi_emulator.size) {
+		const size_t size = efi_emulator.size ? efi_emulator.size * 2 : 64;
+		efi_emulator_variable *variables;
+
+		variables = realloc(efi_emulator.variables, size * sizeof(*variables));
+		if (!variables)
+			return EFI_OUT_OF_RESOURCES;
+		efi_emulator.variables = variables;
+		efi_emulator.size = size;
+	}
+
+	var = &efi_emulator.variables[efi_emulator.count];
+	var->name = malloc(name_size);
+	var->data = malloc(data_size);
+	if (!var->name || !var->data) {
+		free(var->name);
+		free(var->data);
+		return EFI_OUT_OF_RESOURCES;
+	}
+	memcpy(var->name, name, name_size);
+	memcpy(&var->guid, guid, sizeof(EFI_GUID));
+	memcpy(var->data, data, data_size);
+	var->name_size = name_size;
+	var->data_size = data_size;
+	var->attributes = attributes;
+	efi_emulator.count++;
+	efi_emulator.store_used += efi_emulator_variable_cost(name_size, data_size);
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_get_variable(void *arg)
+{
+	struct efi_getvariable *getvariable = arg;
+	efi_emulator_variable *var;
+
+	if (!getvariable->VariableName || !getvariable->VendorGuid ||
+	    !getvariable->DataSize)
+		return EFI_INVALID_PARAMETER;
+
+	if ((var = efi_emulator_variable_find(getvariable->VariableName,
+	     getvariable->VendorGuid)) == NULL)
+		return EFI_NOT_FOUND;
+
+	if (*getvariable->DataSize < var->data_size) {
+		*getvariable->DataSize = var->data_size;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+	if (!getvariable->Data)
+		return EFI_INVALID_PARAMETER;
+
+	memcpy(getvariable->Data, var->data, var->data_size);
+	*getvariable->DataSize = var->data_size;
+	if (getvariable->Attributes)
+		*getvariable->Attributes = var->attributes;
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_set_variable(void *arg)
+{
+	struct efi_setvariable *setvariable = arg;
+	const uint32_t attributes = setvariable->Attributes;
+	const bool append = attributes & FWTS_UEFI_VARIABLE_APPEND_WRITE;
+	efi_emulator_variable *var;
+	size_t name_size;
+	uint64_t used;
+
+	if (!setvariable->VariableName || !setvariable->VendorGuid ||
+	    !setvariable->VariableName[0])
+		return EFI_INVALID_PARAMETER;
+	if (setvariable->DataSize && !setvariable->Data)
+		return EFI_INVALID_PARAMETER;
+
+	var = efi_emulator_variable_find(setvariable->VariableName, setvariable->VendorGuid);
+
+	/* No access attributes, or no data without appending, deletes the variable */
+	if (!(attributes & (FWTS_UEFI_VAR_BOOTSERVICE_ACCESS | FWTS_UEFI_VAR_RUNTIME_ACCESS)) ||
+	    (!setvariable->DataSize && !append)) {
+		if (!var)
+			return EFI_NOT_FOUND;
+		efi_emulator_variable_delete(var);
+		return EFI_SUCCESS;
+	}
+
+	/* Authenticated variables need signature checks the emulator does not do */
+	if (attributes & (FWTS_UEFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS |
+			  FWTS_UEFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS |
+			  FWTS_UEFI_VARIABLE_ENHANCED_AUTHENTICATED_ACCESS))
+		return EFI_UNSUPPORTED;
+	/* At runtime only non-volatile variables accessible to both can be set */
+	if ((attributes & EFI_EMULATOR_RUNTIME_ATTRIBUTES) != EFI_EMULATOR_RUNTIME_ATTRIBUTES)
+		return EFI_INVALID_PARAMETER;
+	if (attributes & ~(EFI_EMULATOR_ATTRIBUTES | FWTS_UEFI_VARIABLE_APPEND_WRITE))
+		return EFI_INVALID_PARAMETER;
+
+	name_size = (fwts_uefi_str16len(setvariable->VariableName) + 1) * sizeof(uint16_t);
+
+	if (var) {
+		size_t data_size;
+		uint8_t *data;
+
+		if (var->attributes != (attributes & ~FWTS_UEFI_VARIABLE_APPEND_WRITE))
+			return EFI_INVALID_PARAMETER;
+
+		data_size = append ? var->data_size + setvariable->DataSize : setvariable->DataSize;
+		if (name_size + data_size > EFI_EMULATOR_VARIABLE_SIZE_MAX)
+			return EFI_INVALID_PARAMETER;
+		if (efi_emulator.reclaim == FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE) {
+			used = efi_emulator.store_used - var->data_size + data_size;
+			if (used > efi_emulator.store_size)
+				return EFI_OUT_OF_RESOURCES;
+		} else {
+			/* The new copy is written out, the old one is garbage */
+			if (!efi_emulator_store_fits(efi_emulator_variable_cost(name_size, data_size)))
+				return EFI_OUT_OF_RESOURCES;
+			used = efi_emulator.store_used + efi_emulator_variable_cost(name_size, data_size);
+		}
+
+		if ((data = malloc(data_size ? data_size : 1)) == NULL)
+			return EFI_OUT_OF_RESOURCES;
+		if (append) {
+			memcpy(data, var->data, var->data_size);
+			if (setvariable->DataSize)
+				memcpy(data + var->data_size, setvariable->Data, setvariable->DataSize);
+		} else
+			memcpy(data, setvariable->Data, data_size);
+
+		if (efi_emulator.reclaim != FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE)
+			efi_emulator.garbage += efi_emulator_variable_cost(name_size, var->data_size);
+		free(var->data);
+		var->data = data;
+		var->data_size = data_size;
+		efi_emulator.store_used = used;
+
+		return EFI_SUCCESS;
+	}
+
+	/* Appending no data to a variable that does not exist does nothing */
+	if (!setvariable->DataSize)
+		return EFI_SUCCESS;
+
+	return efi_emulator_variable_add(setvariable->VariableName, setvariable->VendorGuid,
+		attributes & ~FWTS_UEFI_VARIABLE_APPEND_WRITE, setvariable->Data, setvariable->DataSize);
+}
+
+static uint64_t efi_emulator_get_next_variable_name(void *arg)
+{
+	struct efi_getnextvariablename *getnextvariablename = arg;
+	const uint64_t name_size = getnextvariablename->VariableNameSize ?
+		*getnextvariablename->VariableNameSize : 0;
+	uint16_t *name = getnextvariablename->VariableName;
+	efi_emulator_variable *next;
+	size_t i;
+
+	if (!getnextvariablename->VariableNameSize || !name ||
+	    !getnextvariablename->VendorGuid)
+		return EFI_INVALID_PARAMETER;
+
+	/* The name passed in has to be null terminated within its buffer */
+	for (i = 0; i < name_size / sizeof(uint16_t); i++)
+		if (!name[i])
+			break;
+	if (i == name_size / sizeof(uint16_t))
+		return EFI_INVALID_PARAMETER;
+
+	if (!name[0]) {
+		next = efi_emulator.count ? &efi_emulator.variables[0] : NULL;
+	} else {
+		efi_emulator_variable *var;
+
+		var = efi_emulator_variable_find(name, getnextvariablename->VendorGuid);
+		if (!var)
+			return EFI_INVALID_PARAMETER;
+		next = (var + 1 < efi_emulator.variables + efi_emulator.count) ? var + 1 : NULL;
+	}
+	if (!next)
+		return EFI_NOT_FOUND;
+
+	if (name_size < next->name_size) {
+		*getnextvariablename->VariableNameSize = next->name_size;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+	memcpy(name, next->name, next->name_size);
+	memcpy(getnextvariablename->VendorGuid, &next->guid, sizeof(EFI_GUID));
+	*getnextvariablename->VariableNameSize = next->name_size;
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_query_variable_info(void *arg)
+{
+	struct efi_queryvariableinfo *queryvariableinfo = arg;
+	uint64_t max_size;
+
+	if (!queryvariableinfo->MaximumVariableStorageSize ||
+	    !queryvariableinfo->RemainingVariableStorageSize ||
+	    !queryvariableinfo->MaximumVariableSize ||
+	    !(queryvariableinfo->Attributes & (FWTS_UEFI_VAR_BOOTSERVICE_ACCESS | FWTS_UEFI_VAR_RUNTIME_ACCESS)))
+		return EFI_INVALID_PARAMETER;
+	if (queryvariableinfo->Attributes & ~EFI_EMULATOR_ATTRIBUTES)
+		return EFI_UNSUPPORTED;
+
+	/* A write that does not fit can still go in after a reclaim */
+	max_size = efi_emulator.store_size - efi_emulator.store_used;
+	if (efi_emulator.reclaim == FWTS_EFI_EMULATOR_RECLAIM_FULL)
+		max_size += efi_emulator.garbage;
+	if (max_size > EFI_EMULATOR_VARIABLE_SIZE_MAX)
+		max_size = EFI_EMULATOR_VARIABLE_SIZE_MAX;
+
+	*queryvariableinfo->MaximumVariableStorageSize = efi_emulator.store_size;
+	*queryvariableinfo->RemainingVariableStorageSize =
+		efi_emulator.store_size - efi_emulator.store_used;
+	*queryvariableinfo->MaximumVariableSize = max_size;
+
+	return EFI_SUCCESS;
+}
+
+/*
+ *  efi_emulator_time_valid()
+ *	check an EFI_TIME is in the ranges the specification allows
+ */
+static bool efi_emulator_time_valid(const EFI_TIME *time)
+{
+	static const uint8_t days[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if ((time->Year < 1900) || (time->Year > 9999) ||
+	    (time->Month < 1) || (time->Month > 12) ||
+	    (time->Day < 1) || (time->Day > days[time->Month - 1]) ||
+	    (time->Hour > 23) || (time->Minute > 59) || (time->Second > 59) ||
+	    (time->Nanosecond > 999999999))
+		return false;
+	/* February 29th only in leap years */
+	if ((time->Month == 2) && (time->Day == 29) &&
+	    !(((time->Year % 4) == 0) && (((time->Year % 100) != 0) || ((time->Year % 400) == 0))))
+		return false;
+	if ((time->TimeZone != EFI_EMULATOR_TIMEZONE_UNSPECIFIED) &&
+	    ((time->TimeZone < -1440) || (time->TimeZone > 1440)))
+		return false;
+	if (time->Daylight & ~(FWTS_UEFI_TIME_ADJUST_DAYLIGHT | FWTS_UEFI_TIME_IN_DAYLIGHT))
+		return false;
+
+	return true;
+}
+
+static uint64_t efi_emulator_get_time(void *arg)
+{
+	struct efi_gettime *gettime = arg;
+	struct timespec now;
+	struct tm tm;
+	time_t t;
+
+	if (!gettime->Time)
+		return EFI_INVALID_PARAMETER;
+
+	(void)clock_gettime(CLOCK_REALTIME, &now);
+	t = now.tv_sec + efi_emulator.time_offset;
+	if (!gmtime_r(&t, &tm))
+		return EFI_DEVICE_ERROR;
+
+	memset(gettime->Time, 0, sizeof(*gettime->Time));
+	gettime->Time->Year = tm.tm_year + 1900;
+	gettime->Time->Month = tm.tm_mon + 1;
+	gettime->Time->Day = tm.tm_mday;
+	gettime->Time->Hour = tm.tm_hour;
+	gettime->Time->Minute = tm.tm_min;
+	gettime->Time->Second = tm.tm_sec;
+	gettime->Time->Nanosecond = now.tv_nsec;
+	gettime->Time->TimeZone = efi_emulator.timezone;
+	gettime->Time->Daylight = efi_emulator.daylight;
+
+	if (gettime->Capabilities) {
+		gettime->Capabilities->Resolution = 1;
+		gettime->Capabilities->Accuracy = 50000000;	/* 50 ppm, in units of 1e-6 ppm */
+		gettime->Capabilities->SetsToZero = 0;
+	}
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_set_time(void *arg)
+{
+	struct efi_settime *settime = arg;
+	struct timespec now;
+	struct tm tm;
+
+	if (!settime->Time || !efi_emulator_time_valid(settime->Time))
+		return EFI_INVALID_PARAMETER;
+
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = settime->Time->Year - 1900;
+	tm.tm_mon = settime->Time->Month - 1;
+	tm.tm_mday = settime->Time->Day;
+	tm.tm_hour = settime->Time->Hour;
+	tm.tm_min = settime->Time->Minute;
+	tm.tm_sec = settime->Time->Second;
+
+	(void)clock_gettime(CLOCK_REALTIME, &now);
+	efi_emulator.time_offset = timegm(&tm) - now.tv_sec;
+	efi_emulator.timezone = settime->Time->TimeZone;
+	efi_emulator.daylight = settime->Time->Daylight;
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_get_wakeup_time(void *arg)
+{
+	struct efi_getwakeuptime *getwakeuptime = arg;
+	if (!getwakeuptime->Enabled || !getwakeuptime->Pending || !getwakeuptime->Time)
+		return EFI_INVALID_PARAMETER;
+
+	*getwakeuptime->Enabled = efi_emulator.wakeup_enabled;
+	*getwakeuptime->Pending = 0;
+	memcpy(getwakeuptime->Time, &efi_emulator.wakeup_time, sizeof(EFI_TIME));
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_set_wakeup_time(void *arg)
+{
+	struct efi_setwakeuptime *setwakeuptime = arg;
+	if (setwakeuptime->Enabled) {
+		if (!setwakeuptime->Time || !efi_emulator_time_valid(setwakeuptime->Time))
+			return EFI_INVALID_PARAMETER;
+		memcpy(&efi_emulator.wakeup_time, setwakeuptime->Time, sizeof(EFI_TIME));
+	}
+	efi_emulator.wakeup_enabled = setwakeuptime->Enabled ? 1 : 0;
+
+	return EFI_SUCCESS;
+}
+
+static uint64_t efi_emulator_get_next_high_monotonic_count(void *arg)
+{
+	struct efi_getnexthighmonotoniccount *getnexthighmonotoniccount = arg;
+	if (!getnexthighmonotoniccount->HighCount)
+		return EFI_INVALID_PARAMETER;
+
+	*getnexthighmonotoniccount->HighCount = ++efi_emulator.high_count;
+
+	return EFI_SUCCESS;
+}
+
+/*
+ *  efi_emulator_call()
+ *	run a runtime service, after the injected latency and
+ *	unless it is a call that is made to fail
+ */
+static int efi_emulator_call(
+	uint64_t (*service)(void *arg),
+	void *arg,
+	uint64_t *status)
+{
+	uint64_t ret;
+	bool fault;
+
+	if (!status) {
+		errno = EFAULT;
+		return -1;
+	}
+
+	if (efi_emulator.latency_us)
+		(void)usleep(efi_emulator.latency_us);
+
+	pthread_mutex_lock(&efi_emulator_mutex);
+	efi_emulator.calls++;
+	fault = efi_emulator.fault_every &&
+		((efi_emulator.calls % efi_emulator.fault_every) == 0);
+	ret = fault ? EFI_DEVICE_ERROR : service(arg);
+	pthread_mutex_unlock(&efi_emulator_mutex);
+
+	*status = ret;
+	if (ret != EFI_SUCCESS) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+#define EFI_EMULATOR_CALL(service, type, arg)	\
+	efi_emulator_call((uint64_t (*)(void *))service, arg, ((type *)arg)->status)
+
+/*
+ *  fwts_efi_emulator_ioctl()
+ *	emulate an efi_runtime driver ioctl, returns 0 or -1
+ *	and sets errno as the ioctl would
+ */
+int fwts_efi_emulator_ioctl(const unsigned long request, void *arg)
+{
+	if (!arg) {
+		errno = EFAULT;
+		return -1;
+	}
+
+	switch (request) {
+	case EFI_RUNTIME_GET_VARIABLE:
+		return EFI_EMULATOR_CALL(efi_emulator_get_variable, struct efi_getvariable, arg);
+	case EFI_RUNTIME_SET_VARIABLE:
+		return EFI_EMULATOR_CALL(efi_emulator_set_variable, struct efi_setvariable, arg);
+	case EFI_RUNTIME_GET_NEXTVARIABLENAME:
+		return EFI_EMULATOR_CALL(efi_emulator_get_next_variable_name, struct efi_getnextvariablename, arg);
+	case EFI_RUNTIME_QUERY_VARIABLEINFO:
+		return EFI_EMULATOR_CALL(efi_emulator_query_variable_info, struct efi_queryvariableinfo, arg);
+	case EFI_RUNTIME_GET_TIME:
+		return EFI_EMULATOR_CALL(efi_emulator_get_time, struct efi_gettime, arg);
+	case EFI_RUNTIME_SET_TIME:
+		return EFI_EMULATOR_CALL(efi_emulator_set_time, struct efi_settime, arg);
+	case EFI_RUNTIME_GET_WAKETIME:
+		return EFI_EMULATOR_CALL(efi_emulator_get_wakeup_time, struct efi_getwakeuptime, arg);
+	case EFI_RUNTIME_SET_WAKETIME:
+		return EFI_EMULATOR_CALL(efi_emulator_set_wakeup_time, struct efi_setwakeuptime, arg);
+	case EFI_RUNTIME_GET_NEXTHIGHMONOTONICCOUNT:
+		return EFI_EMULATOR_CALL(efi_emulator_get_next_high_monotonic_count,
+			struct efi_getnexthighmonotoniccount, arg);
+	case EFI_RUNTIME_QUERY_CAPSULECAPABILITIES:
+		*((struct efi_querycapsulecapabilities *)arg)->status = EFI_UNSUPPORTED;
+		errno = EINVAL;
+		return -1;
+	case EFI_RUNTIME_GET_SUPPORTED_MASK:
+		*(uint32_t *)arg = EFI_EMULATOR_SUPPORTED;
+		return 0;
+	default:
+		/* Like ResetSystem, not something the emulator can do */
+		errno = ENOTTY;
+		return -1;
+	}
+}
+
+/*
+ *  efi_emulator_variables_default()
+ *	a few global variables any firmware has, the variable
+ *	tests expect the store not to be empty
+ */
+static void efi_emulator_variables_default(void)
+{
+	static const EFI_GUID global = EFI_GLOBAL_VARIABLE;
+	static const uint16_t platformlang[] = { 'P', 'l', 'a', 't', 'f', 'o', 'r', 'm', 'L', 'a', 'n', 'g', 0 };
+	static const uint16_t timeout[] = { 'T', 'i', 'm', 'e', 'o', 'u', 't', 0 };
+	static const uint16_t bootorder[] = { 'B', 'o', 'o', 't', 'O', 'r', 'd', 'e', 'r', 0 };
+	static const uint16_t secureboot[] = { 'S', 'e', 'c', 'u', 'r', 'e', 'B', 'o', 'o', 't', 0 };
+	static const char lang[] = "en-US";
+	static const uint16_t seconds = 5;
+	static const uint16_t order = 0;
+	static const uint8_t disabled = 0;
+
+	(void)efi_emulator_variable_add(platformlang, &global,
+		EFI_EMULATOR_RUNTIME_ATTRIBUTES, lang, sizeof(lang));
+	(void)efi_emulator_variable_add(timeout, &global,
+		EFI_EMULATOR_RUNTIME_ATTRIBUTES, &seconds, sizeof(seconds));
+	(void)efi_emulator_variable_add(bootorder, &global,
+		EFI_EMULATOR_RUNTIME_ATTRIBUTES, &order, sizeof(order));
+	(void)efi_emulator_variable_add(secureboot, &global,
+		FWTS_UEFI_VAR_BOOTSERVICE_ACCESS | FWTS_UEFI_VAR_RUNTIME_ACCESS,
+		&disabled, sizeof(disabled));
+
+	/* Boot wrote Timeout and BootOrder again, the old copies await a reclaim */
+	if (efi_emulator.reclaim != FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE) {
+		const uint64_t old =
+			efi_emulator_variable_cost(sizeof(timeout), sizeof(seconds)) +
+			efi_emulator_variable_cost(sizeof(bootorder), sizeof(order));
+
+		efi_emulator.store_used += old;
+		efi_emulator.garbage += old;
+	}
+}
+
+/*
+ *  fwts_efi_emulator_init()
+ *	start with the default variables and the host clock
+ */
+int fwts_efi_emulator_init(fwts_framework *fw)
+{
+	struct efi_gettime gettime;
+	uint64_t status;
+
+	fwts_efi_emulator_deinit();
+
+	efi_emulator.store_size = fw->efi_emulator_store_size;
+	efi_emulator.latency_us = fw->efi_emulator_latency_us;
+	efi_emulator.fault_every = fw->efi_emulator_fault_every;
+	efi_emulator.reclaim = fw->efi_emulator_reclaim;
+	efi_emulator.timezone = EFI_EMULATOR_TIMEZONE_UNSPECIFIED;
+
+	gettime.Time = &efi_emulator.wakeup_time;
+	gettime.Capabilities = NULL;
+	gettime.status = &status;
+	(void)efi_emulator_get_time(&gettime);
+
+	efi_emulator_variables_default();
+
+	fwts_log_info(fw, "Using the UEFI runtime services emulator, "
+		"%" PRIu64 " byte variable store.", efi_emulator.store_size);
+	if (efi_emulator.reclaim == FWTS_EFI_EMULATOR_RECLAIM_FULL)
+		fwts_log_info(fw, "Deleted variable space is reclaimed when the store is full.");
+	else if (efi_emulator.reclaim == FWTS_EFI_EMULATOR_RECLAIM_BOOT)
+		fwts_log_info(fw, "Deleted variable space is not reclaimed until the next boot.");
+
+	return FWTS_OK;
+}
+
+/*
+ *  efi_emulator_efivarfs_write()
+ *	write a variable as an efivarfs file, the attributes then the data
+ */
+static int efi_emulator_efivarfs_write(const efi_emulator_variable *var)
+{
+	char name[512], guid[37], path[PATH_MAX];
+	uint8_t guid_buf[16];
+	FILE *fp;
+	bool ok;
+	int i;
+
+	fwts_uefi_str16_to_str(name, sizeof(name), var->name);
+	memcpy(guid_buf, &var->guid, sizeof(guid_buf));
+	fwts_guid_buf_to_str(guid_buf, guid, sizeof(guid));
+	for (i = 0; guid[i]; i++)
+		guid[i] = tolower((unsigned char)guid[i]);
+
+	snprintf(path, sizeof(path), "%s/%s-%s", efi_emulator_efivarfs_dir, name, guid);
+	if ((fp = fopen(path, "w")) == NULL)
+		return FWTS_ERROR;
+	ok = (fwrite(&var->attributes, sizeof(var->attributes), 1, fp) == 1) &&
+	     (fwrite(var->data, 1, var->data_size, fp) == var->data_size);
+	if (fclose(fp) != 0)
+		ok = false;
+
+	return ok ? FWTS_OK : FWTS_ERROR;
+}
+
+/*
+ *  efi_emulator_efivarfs_remove()
+ *	remove the efivarfs copy of the store
+ */
+static void efi_emulator_efivarfs_remove(void)
+{
+	DIR *dir;
+
+	if (!*efi_emulator_efivarfs_dir)
+		return;
+
+	if ((dir = opendir(efi_emulator_efivarfs_dir)) != NULL) {
+		struct dirent *entry;
+
+		while ((entry = readdir(dir)) != NULL) {
+			char path[PATH_MAX];
+
+			if (entry->d_name[0] == '.')
+				continue;
+			snprintf(path, sizeof(path), "%s/%s",
+				efi_emulator_efivarfs_dir, entry->d_name);
+			(void)unlink(path);
+		}
+		(void)closedir(dir);
+	}
+	(void)rmdir(efi_emulator_efivarfs_dir);
+	*efi_emulator_efivarfs_dir = '\0';
+	fwts_uefi_set_efivars_path(NULL);
+}
+
+/*
+ *  fwts_efi_emulator_efivarfs()
+ *	copy the emulated variables into a temporary directory laid out
+ *	like efivarfs and read the variables from there, so the tests
+ *	that read efivarfs see the emulated store. The copy is taken
+ *	now, later runtime service calls do not update it.
+ */
+int fwts_efi_emulator_efivarfs(fwts_framework *fw)
+{
+	const char *tmp = getenv("TMPDIR");
+	size_t i;
+	int ret = FWTS_OK;
+
+	efi_emulator_efivarfs_remove();
+
+	snprintf(efi_emulator_efivarfs_dir, sizeof(efi_emulator_efivarfs_dir),
+		"%s/fwts-efivars-XXXXXX", tmp ? tmp : "/tmp");
+	if (mkdtemp(efi_emulator_efivarfs_dir) == NULL) {
+		fwts_log_error(fw, "Cannot create a directory for the emulated "
+			"UEFI variables: %s.", strerror(errno));
+		*efi_emulator_efivarfs_dir = '\0';
+		return FWTS_ERROR;
+	}
+
+	pthread_mutex_lock(&efi_emulator_mutex);
+	for (i = 0; (i < efi_emulator.count) && (ret == FWTS_OK); i++)
+		ret = efi_emulator_efivarfs_write(&efi_emulator.variables[i]);
+	pthread_mutex_unlock(&efi_emulator_mutex);
+
+	if (ret != FWTS_OK) {
+		fwts_log_error(fw, "Cannot write the emulated UEFI variables to %s.",
+			efi_emulator_efivarfs_dir);
+		efi_emulator_efivarfs_remove();
+		return FWTS_ERROR;
+	}
+	fwts_uefi_set_efivars_path(efi_emulator_efivarfs_dir);
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_efi_emulator_deinit()
+ *	free the variable store and any efivarfs copy of it
+ */
+void fwts_efi_emulator_deinit(void)
+{
+	size_t i;
+
+	efi_emulator_efivarfs_remove();
+
+	for (i = 0; i < efi_emulator.count; i++) {
+		free(efi_emulator.variables[i].name);
+		free(efi_emulator.variables[i].data);
+	}
+	free(efi_emulator.variables);
+	memset(&efi_emulator, 0, sizeof(efi_emulator));
+}
@@ -23,11 +23,15 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 
 #include "fwts_pipeio.h"
+#include "fwts_efi_module.h"
 
 static char *efi_dev_name = NULL;
 static char *module_name = NULL;
+static bool efi_emulated = false;	/* --efi-emulator */
+static bool efi_profiled = false;	/* --uefi-rt-profile */
 
 /*
  *  check_module_loaded_no_dev()
@@ -138,6 +142,11 @@ int fwts_lib_efi_runtime_unload_module(fwts_framework *fw)
 	bool loaded;
 	char *tmp_name = module_name;
 
+	if (efi_profiled) {
+		fwts_efi_profile_report(fw);
+		efi_profiled = false;
+	}
+
 	efi_dev_name = NULL;
 
 	/* No module, not much to do */
@@ -181,9 +190,35 @@ int fwts_lib_efi_runtime_open(void)
  */
 int fwts_lib_efi_runtime_close(const int fd)
 {
+	if (efi_emulated) {
+		fwts_efi_emulator_deinit();
+		efi_emulated = false;
+	}
 	return close(fd);
 }
 
+/*
+ *  fwts_lib_efi_runtime_ioctl()
+ *	issue an efi_runtime ioctl, to the driver or to the
+ *	emulator with --efi-emulator, timing it with --uefi-rt-profile
+ */
+int fwts_lib_efi_runtime_ioctl(const int fd, const unsigned long request, void *arg)
+{
+	uint64_t start_ns;
+	int ret;
+
+	if (!efi_profiled)
+		return efi_emulated ? fwts_efi_emulator_ioctl(request, arg) :
+			ioctl(fd, request, arg);
+
+	start_ns = fwts_efi_profile_time();
+	ret = efi_emulated ? fwts_efi_emulator_ioctl(request, arg) :
+		ioctl(fd, request, arg);
+	fwts_efi_profile_sample(request, arg, start_ns, fwts_efi_profile_time());
+
+	return ret;
+}
+
 /*
  *  fwts_lib_efi_runtime_kernel_lockdown()
  *  check if the kernel has been lockdown
@@ -213,6 +248,21 @@ int fwts_lib_efi_runtime_kernel_lockdown(fwts_framework *fw)
  */
 int fwts_lib_efi_runtime_module_init(fwts_framework *fw, int *fd)
 {
+	if (fw->flags & FWTS_FLAG_UEFI_RT_PROFILE) {
+		fwts_efi_profile_start();
+		efi_profiled = true;
+	}
+
+	/* The emulator needs no firmware or driver, fd is just something to close */
+	if (fw->flags & FWTS_FLAG_EFI_EMULATOR) {
+		*fd = open("/dev/null", O_RDWR);
+		if (*fd == -1) {
+			fwts_log_info(fw, "Cannot open /dev/null for the UEFI emulator. Aborted.");
+			return FWTS_ABORTED;
+		}
+		efi_emulated = true;
+		return fwts_efi_emulator_init(fw);
+	}
 
 	if (fw->firmware_type != FWTS_FIRMWARE_UEFI) {
 		fwts_log_info(fw, "Cannot detect any UEFI firmware. Aborted.");
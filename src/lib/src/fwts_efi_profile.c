@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  UEFI runtime service latency profile, --uefi-rt-profile.  Every
+ *  efi_runtime ioctl is timed and the latencies are kept in a
+ *  log-linear histogram per service, SetVariable per data size, so
+ *  firmware that stalls in SMM shows up in the tail percentiles.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+#include "fwts.h"
+#include "fwts_uefi.h"
+#include "fwts_efi_runtime.h"
+#include "fwts_efi_module.h"
+
+#define PROFILE_LINEAR		FWTS_EFI_HISTOGRAM_LINEAR
+#define PROFILE_SUB_BITS	FWTS_EFI_HISTOGRAM_SUB_BITS
+#define PROFILE_BUCKETS		FWTS_EFI_HISTOGRAM_BUCKETS
+#define PROFILE_LOG_SLOW	(10)	/* Slow calls logged individually */
+
+typedef enum {
+	PROFILE_GET_VARIABLE,
+	PROFILE_SET_VARIABLE_DELETE,
+	PROFILE_SET_VARIABLE_64,
+	PROFILE_SET_VARIABLE_1K,
+	PROFILE_SET_VARIABLE_4K,
+	PROFILE_SET_VARIABLE_LARGE,
+	PROFILE_GET_NEXT_VARIABLE_NAME,
+	PROFILE_QUERY_VARIABLE_INFO,
+	PROFILE_GET_TIME,
+	PROFILE_SET_TIME,
+	PROFILE_GET_WAKEUP_TIME,
+	PROFILE_SET_WAKEUP_TIME,
+	PROFILE_GET_NEXT_HIGH_MONOTONIC_COUNT,
+	PROFILE_QUERY_CAPSULE_CAPABILITIES,
+	PROFILE_GET_SUPPORTED_MASK,
+	PROFILE_OTHER,
+	PROFILE_SERVICES
+} profile_service;
+
+static const char *profile_service_names[PROFILE_SERVICES] = {
+	"GetVariable",
+	"SetVariable (delete)",
+	"SetVariable (<= 64 bytes)",
+	"SetVariable (<= 1 KiB)",
+	"SetVariable (<= 4 KiB)",
+	"SetVariable (> 4 KiB)",
+	"GetNextVariableName",
+	"QueryVariableInfo",
+	"GetTime",
+	"SetTime",
+	"GetWakeupTime",
+	"SetWakeupTime",
+	"GetNextHighMonotonicCount",
+	"QueryCapsuleCapabilities",
+	"RuntimeServicesSupported",
+	"Other",
+};
+
+typedef struct {
+	uint64_t	start_ns;		/* Since profiling started */
+	uint64_t	latency_ns;
+	uint64_t	status;			/* EFI status, ~0 if not returned */
+	uint64_t	data_size;		/* Get/SetVariable data size */
+	uint8_t		service;		/* profile_service */
+} profile_sample;
+
+typedef struct {
+	fwts_efi_histogram latency;
+	uint64_t	slow;			/* Calls over the threshold */
+} profile_histogram;
+
+static profile_sample *profile_samples;
+static size_t profile_count;
+static size_t profile_size;
+static uint64_t profile_start_ns;
+static bool profile_csv_started;		/* CSV file has been written to */
+static bool profile_json_started;		/* JSON file has been written to */
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ *  fwts_efi_profile_time()
+ *	CLOCK_MONOTONIC_RAW in nanoseconds, not slewed by NTP
+ */
+uint64_t fwts_efi_profile_time(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  profile_bucket()
+ *	log-linear histogram bucket of a latency
+ */
+static int profile_bucket(const uint64_t ns)
+{
+	int exponent;
+
+	if (ns < PROFILE_LINEAR)
+		return (int)ns;
+
+	exponent = 63 - __builtin_clzll(ns);
+	return PROFILE_LINEAR + (exponent - 4) * (1 << PROFILE_SUB_BITS) +
+		(int)((ns >> (exponent - PROFILE_SUB_BITS)) & ((1 << PROFILE_SUB_BITS) - 1));
+}
+
+/*
+ *  profile_bucket_max()
+ *	largest latency that falls into a bucket
+ */
+static uint64_t profile_bucket_max(const int bucket)
+{
+	int exponent, sub;
+
+	if (bucket < PROFILE_LINEAR)
+		return (uint64_t)bucket;
+
+	exponent = ((bucket - PROFILE_LINEAR) >> PROFILE_SUB_BITS) + 4;
+	sub = (bucket - PROFILE_LINEAR) & ((1 << PROFILE_SUB_BITS) - 1);
+
+	return ((((uint64_t)(1 << PROFILE_SUB_BITS) + sub + 1) << (exponent - PROFILE_SUB_BITS))) - 1;
+}
+
+/*
+ *  fwts_efi_histogram_add()
+ *	add a latency to a histogram
+ */
+void fwts_efi_histogram_add(fwts_efi_histogram *histogram, const uint64_t ns)
+{
+	histogram->buckets[profile_bucket(ns)]++;
+	histogram->calls++;
+	if (ns > histogram->max_ns)
+		histogram->max_ns = ns;
+}
+
+/*
+ *  fwts_efi_histogram_percentile()
+ *	latency below which a fraction of the calls fall, to the
+ *	resolution of the histogram, never more than the maximum
+ */
+uint64_t fwts_efi_histogram_percentile(const fwts_efi_histogram *histogram, const double fraction)
+{
+	uint64_t target = (uint64_t)(fraction * (double)histogram->calls + 0.999999);
+	uint64_t total = 0;
+	int i;
+
+	if (target == 0)
+		target = 1;
+
+	for (i = 0; i < PROFILE_BUCKETS; i++) {
+		total += histogram->buckets[i];
+		if (total >= target) {
+			const uint64_t ns = profile_bucket_max(i);
+
+			return ns < histogram->max_ns ? ns : histogram->max_ns;
+		}
+	}
+	return histogram->max_ns;
+}
+
+/*
+ *  profile_classify()
+ *	service, EFI status and data size of an ioctl
+ */
+static void profile_classify(
+	const unsigned long request,
+	void *arg,
+	profile_sample *sample)
+{
+	uint64_t *status = NULL;
+
+	sample->data_size = 0;
+	sample->service = PROFILE_OTHER;
+
+	switch (request) {
+	case EFI_RUNTIME_GET_VARIABLE: {
+		struct efi_getvariable *getvariable = arg;
+
+		sample->service = PROFILE_GET_VARIABLE;
+		if (getvariable->DataSize)
+			sample->data_size = *getvariable->DataSize;
+		status = getvariable->status;
+		break;
+	}
+	case EFI_RUNTIME_SET_VARIABLE: {
+		struct efi_setvariable *setvariable = arg;
+
+		sample->data_size = setvariable->DataSize;
+		if (!setvariable->DataSize)
+			sample->service = PROFILE_SET_VARIABLE_DELETE;
+		else if (setvariable->DataSize <= 64)
+			sample->service = PROFILE_SET_VARIABLE_64;
+		else if (setvariable->DataSize <= 1024)
+			sample->service = PROFILE_SET_VARIABLE_1K;
+		else if (setvariable->DataSize <= 4096)
+			sample->service = PROFILE_SET_VARIABLE_4K;
+		else
+			sample->service = PROFILE_SET_VARIABLE_LARGE;
+		status = setvariable->status;
+		break;
+	}
+	case EFI_RUNTIME_GET_NEXTVARIABLENAME:
+		sample->service = PROFILE_GET_NEXT_VARIABLE_NAME;
+		status = ((struct efi_getnextvariablename *)arg)->status;
+		break;
+	case EFI_RUNTIME_QUERY_VARIABLEINFO:
+		sample->service = PROFILE_QUERY_VARIABLE_INFO;
+		status = ((struct efi_queryvariableinfo *)arg)->status;
+		break;
+	case EFI_RUNTIME_GET_TIME:
+		sample->service = PROFILE_GET_TIME;
+		status = ((struct efi_gettime *)arg)->status;
+		break;
+	case EFI_RUNTIME_SET_TIME:
+		sample->service = PROFILE_SET_TIME;
+		status = ((struct efi_settime *)arg)->status;
+		break;
+	case EFI_RUNTIME_GET_WAKETIME:
+		sample->service = PROFILE_GET_WAKEUP_TIME;
+		status = ((struct efi_getwakeuptime *)arg)->status;
+		break;
+	case EFI_RUNTIME_SET_WAKETIME:
+		sample->service = PROFILE_SET_WAKEUP_TIME;
+		status = ((struct efi_setwakeuptime *)arg)->status;
+		break;
+	case EFI_RUNTIME_GET_NEXTHIGHMONOTONICCOUNT:
+		sample->service = PROFILE_GET_NEXT_HIGH_MONOTONIC_COUNT;
+		status = ((struct efi_getnexthighmonotoniccount *)arg)->status;
+		break;
+	case EFI_RUNTIME_QUERY_CAPSULECAPABILITIES:
+		sample->service = PROFILE_QUERY_CAPSULE_CAPABILITIES;
+		status = ((struct efi_querycapsulecapabilities *)arg)->status;
+		break;
+	case EFI_RUNTIME_GET_SUPPORTED_MASK:
+		sample->service = PROFILE_GET_SUPPORTED_MASK;
+		break;
+	default:
+		break;
+	}
+
+	sample->status = status ? *status : ~0ULL;
+}
+
+/*
+ *  fwts_efi_profile_start()
+ *	start profiling with no samples
+ */
+void fwts_efi_profile_start(void)
+{
+	pthread_mutex_lock(&profile_mutex);
+	profile_count = 0;
+	profile_start_ns = fwts_efi_profile_time();
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+/*
+ *  fwts_efi_profile_sample()
+ *	add a completed ioctl that ran from start_ns to end_ns
+ */
+void fwts_efi_profile_sample(
+	const unsigned long request,
+	void *arg,
+	const uint64_t start_ns,
+	const uint64_t end_ns)
+{
+	profile_sample sample;
+
+	if (!arg)
+		return;
+
+	profile_classify(request, arg, &sample);
+	sample.latency_ns = end_ns - start_ns;
+
+	pthread_mutex_lock(&profile_mutex);
+	sample.start_ns = start_ns - profile_start_ns;
+	if (profile_count == profile_size) {
+		const size_t size = profile_size ? profile_size * 2 : 4096;
+		profile_sample *samples;
+
+		if ((samples = realloc(profile_samples, size * sizeof(*samples))) == NULL) {
+			pthread_mutex_unlock(&profile_mutex);
+			return;
+		}
+		profile_samples = samples;
+		profile_size = size;
+	}
+	profile_samples[profile_count++] = sample;
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+/*
+ *  profile_csv_write()
+ *	append the raw samples of this test to the CSV file
+ */
+static int profile_csv_write(fwts_framework *fw)
+{
+	const char *test = fw->current_major_test ? fw->current_major_test->name : "";
+	FILE *fp;
+	size_t i;
+
+	if ((fp = fopen(fw->uefi_rt_profile_file, profile_csv_started ? "a" : "w")) == NULL)
+		return FWTS_ERROR;
+	if (!profile_csv_started)
+		fprintf(fp, "test,service,data_size,start_ns,latency_ns,status\n");
+
+	for (i = 0; i < profile_count; i++)
+		fprintf(fp, "%s,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",0x%" PRIx64 "\n",
+			test, profile_service_names[profile_samples[i].service],
+			profile_samples[i].data_size, profile_samples[i].start_ns,
+			profile_samples[i].latency_ns, profile_samples[i].status);
+	(void)fclose(fp);
+
+	profile_csv_started = true;
+
+	return FWTS_OK;
+}
+
+/*
+ *  profile_json_write()
+ *	add the histograms and raw samples of this test to the JSON file,
+ *	the file holds an array with an object for each test and is kept
+ *	valid JSON after each test is appended
+ */
+static int profile_json_write(
+	fwts_framework *fw,
+	const profile_histogram *histograms)
+{
+	FILE *fp;
+	size_t i;
+	int j, k;
+	bool first = true;
+
+	if (profile_json_started) {
+		if ((fp = fopen(fw->uefi_rt_profile_file, "r+")) == NULL)
+			return FWTS_ERROR;
+		/* Overwrite the closing "\n]\n" */
+		if (fseek(fp, -3, SEEK_END) < 0) {
+			(void)fclose(fp);
+			return FWTS_ERROR;
+		}
+		fprintf(fp, ",\n");
+	} else {
+		if ((fp = fopen(fw->uefi_rt_profile_file, "w")) == NULL)
+			return FWTS_ERROR;
+		fprintf(fp, "[\n");
+	}
+
+	fprintf(fp, "  {\n    \"test\": \"%s\",\n    \"threshold_ns\": %" PRIu64 ",\n    \"services\": [",
+		fw->current_major_test ? fw->current_major_test->name : "",
+		(uint64_t)fw->uefi_rt_threshold_us * 1000);
+	for (j = 0; j < PROFILE_SERVICES; j++) {
+		const fwts_efi_histogram *histogram = &histograms[j].latency;
+		bool first_bucket = true;
+
+		if (!histogram->calls)
+			continue;
+		fprintf(fp, "%s\n      {\n"
+			"        \"service\": \"%s\",\n"
+			"        \"calls\": %" PRIu64 ",\n"
+			"        \"p50_ns\": %" PRIu64 ",\n"
+			"        \"p99_ns\": %" PRIu64 ",\n"
+			"        \"p99_9_ns\": %" PRIu64 ",\n"
+			"        \"max_ns\": %" PRIu64 ",\n"
+			"        \"over_threshold\": %" PRIu64 ",\n"
+			"        \"histogram\": [",
+			first ? "" : ",", profile_service_names[j], histogram->calls,
+			fwts_efi_histogram_percentile(histogram, 0.50),
+			fwts_efi_histogram_percentile(histogram, 0.99),
+			fwts_efi_histogram_percentile(histogram, 0.999),
+			histogram->max_ns, histograms[j].slow);
+		for (k = 0; k < PROFILE_BUCKETS; k++) {
+			if (!histogram->buckets[k])
+				continue;
+			fprintf(fp, "%s { \"le_ns\": %" PRIu64 ", \"count\": %" PRIu64 " }",
+				first_bucket ? "" : ",", profile_bucket_max(k), histogram->buckets[k]);
+			first_bucket = false;
+		}
+		fprintf(fp, " ]\n      }");
+		first = false;
+	}
+
+	fprintf(fp, "\n    ],\n    \"samples\": [");
+	for (i = 0; i < profile_count; i++)
+		fprintf(fp, "%s\n      { \"service\": \"%s\", \"data_size\": %" PRIu64
+			", \"start_ns\": %" PRIu64 ", \"latency_ns\": %" PRIu64
+			", \"status\": %" PRIu64 " }",
+			i ? "," : "", profile_service_names[profile_samples[i].service],
+			profile_samples[i].data_size, profile_samples[i].start_ns,
+			profile_samples[i].latency_ns, profile_samples[i].status);
+	fprintf(fp, "\n    ]\n  }\n]\n");
+	(void)fclose(fp);
+
+	profile_json_started = true;
+
+	return FWTS_OK;
+}
+
+/*
+ *  profile_histogram_log()
+ *	log the non-empty powers of two of a histogram
+ */
+static void profile_histogram_log(fwts_framework *fw, const fwts_efi_histogram *histogram)
+{
+	uint64_t count = 0;
+	int i;
+
+	for (i = 0; i < PROFILE_BUCKETS; i++) {
+		count += histogram->buckets[i];
+
+		/* The last bucket of a power of two, or the linear part */
+		if ((i + 1 < PROFILE_LINEAR) ||
+		    ((i >= PROFILE_LINEAR) && (((i - PROFILE_LINEAR + 1) & ((1 << PROFILE_SUB_BITS) - 1)) != 0)))
+			continue;
+		if (count) {
+			const int width = (int)((count * 40 + histogram->calls - 1) / histogram->calls);
+
+			fwts_log_info_verbatim(fw, "  <= %12.3f us %9" PRIu64 " %.*s",
+				(double)profile_bucket_max(i) / 1000.0, count, width,
+				"########################################");
+		}
+		count = 0;
+	}
+}
+
+/*
+ *  fwts_efi_profile_report()
+ *	log the latency percentiles of each runtime service called since
+ *	profiling was started, write the samples to the profile file if
+ *	one was given and free them
+ */
+void fwts_efi_profile_report(fwts_framework *fw)
+{
+	const uint64_t threshold_ns = (uint64_t)fw->uefi_rt_threshold_us * 1000;
+	profile_histogram *histograms;
+	size_t i, slow = 0;
+	int j;
+
+	pthread_mutex_lock(&profile_mutex);
+	if (!profile_count)
+		goto done;
+
+	if ((histograms = calloc(PROFILE_SERVICES, sizeof(*histograms))) == NULL) {
+		fwts_log_error(fw, "Cannot allocate UEFI runtime service profile.");
+		goto done;
+	}
+
+	fwts_log_nl(fw);
+	for (i = 0; i < profile_count; i++) {
+		const profile_sample *sample = &profile_samples[i];
+		profile_histogram *histogram = &histograms[sample->service];
+
+		fwts_efi_histogram_add(&histogram->latency, sample->latency_ns);
+		if (threshold_ns && (sample->latency_ns > threshold_ns)) {
+			histogram->slow++;
+			if (slow++ < PROFILE_LOG_SLOW)
+				fwts_log_warning(fw, "%s took %.3f us, at %.3f ms into the test.",
+					profile_service_names[sample->service],
+					(double)sample->latency_ns / 1000.0,
+					(double)sample->start_ns / 1000000.0);
+		}
+	}
+	if (slow > PROFILE_LOG_SLOW)
+		fwts_log_warning(fw, "(%zu more calls over %" PRIu32 " us not shown)",
+			slow - PROFILE_LOG_SLOW, fw->uefi_rt_threshold_us);
+
+	fwts_log_info(fw, "UEFI runtime service latency profile of %zu calls:", profile_count);
+	fwts_log_info_verbatim(fw, "    Calls    p50 (us)    p99 (us)  p99.9 (us)    max (us)  Slow  Service");
+	for (j = 0; j < PROFILE_SERVICES; j++) {
+		const fwts_efi_histogram *histogram = &histograms[j].latency;
+
+		if (!histogram->calls)
+			continue;
+		fwts_log_info_verbatim(fw, "%9" PRIu64 " %11.3f %11.3f %11.3f %11.3f %5" PRIu64 "  %s",
+			histogram->calls,
+			(double)fwts_efi_histogram_percentile(histogram, 0.50) / 1000.0,
+			(double)fwts_efi_histogram_percentile(histogram, 0.99) / 1000.0,
+			(double)fwts_efi_histogram_percentile(histogram, 0.999) / 1000.0,
+			(double)histogram->max_ns / 1000.0,
+			histograms[j].slow, profile_service_names[j]);
+	}
+	for (j = 0; j < PROFILE_SERVICES; j++) {
+		if (!histograms[j].latency.calls)
+			continue;
+		fwts_log_info(fw, "%s latency distribution:", profile_service_names[j]);
+		profile_histogram_log(fw, &histograms[j].latency);
+	}
+	if (slow)
+		fwts_log_warning(fw, "%zu UEFI runtime service calls took longer than %" PRIu32 " us.",
+			slow, fw->uefi_rt_threshold_us);
+	fwts_log_nl(fw);
+
+	if (fw->uefi_rt_profile_file) {
+		const size_t len = strlen(fw->uefi_rt_profile_file);
+		int ret;
+
+		if ((len > 5) && !strcmp(fw->uefi_rt_profile_file + len - 5, ".json"))
+			ret = profile_json_write(fw, histograms);
+		else
+			ret = profile_csv_write(fw);
+		if (ret != FWTS_OK)
+			fwts_log_error(fw, "Cannot write UEFI runtime service profile to %s.",
+				fw->uefi_rt_profile_file);
+	}
+	free(histograms);
+
+done:
+	free(profile_samples);
+	profile_samples = NULL;
+	profile_count = 0;
+	profile_size = 0;
+	pthread_mutex_unlock(&profile_mutex);
+}
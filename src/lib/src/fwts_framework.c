@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <errno.h>
 #include <time.h>
 #include <getopt.h>
 #include <bsd/string.h>
@@ -140,6 +141,17 @@ static fwts_option fwts_framework_options[] = {
 	{ "ifv",		"",   0, "Run tests in firmware-vendor modes." },
 	{ "clog",		"",   1, "Specify a coreboot logfile dump" },
 	{ "ebbr",		"",   0, "Run EBBR tests." },
+	{ "aml-profile",	"",   2, "Report AML execution time, opcodes, loop iterations and OpRegion accesses per control method, e.g. --aml-profile=profile.json to also write a JSON profile." },
+	{ "region-replay",	"",   1, "Replay OpRegion, port and PCI config reads from a trace file instead of faking them, e.g. --region-replay=regions.trace" },
+	{ "region-capture",	"",   1, "Capture the OpRegions that can be read safely into a trace file for --region-replay, e.g. --region-capture=regions.trace" },
+	{ "aml-budget",		"",   1, "Abort AML evaluations that execute more than N opcodes, or with N,MS that also run longer than MS milliseconds, e.g. --aml-budget=1000000" },
+	{ "aml-coverage",	"",   2, "Report which control methods and lines of the AML disassembly the tests executed, e.g. --aml-coverage=coverage.txt to also write per method coverage and an annotated disassembly." },
+	{ "namespace-snapshot",	"",   1, "Save the ACPI namespace to a file the first time the AML is loaded and reload it from the file on later runs against the same tables, e.g. --namespace-snapshot=namespace.snap" },
+	{ "no-iasl-cache",	"",   0, "Do not use or update the cache of ACPI table disassemblies in ~/.cache/fwts/iasl." },
+	{ "efi-emulator",	"",   2, "Run the UEFI runtime service tests against an emulated firmware instead of the efi_runtime driver, optionally with a store size in bytes, microseconds of latency per call and failing every Nth call, e.g. --efi-emulator=65536,100,50" },
+	{ "uefi-rt-profile",	"",   2, "Report the latency percentiles and histogram of each UEFI runtime service call, e.g. --uefi-rt-profile=samples.csv to also write every call to a CSV, or a JSON file if the name ends in .json." },
+	{ "uefi-rt-threshold",	"",   1, "Warn about UEFI runtime service calls in --uefi-rt-profile taking longer than N microseconds, 0 for none, default 1000, e.g. --uefi-rt-threshold=500" },
+	{ "efi-emulator-reclaim", "", 1, "Select when the --efi-emulator store gets back the space of deleted and updated variables. Accepted values are \"immediate\" (the default), \"full\" when a write does not fit and \"boot\" for never during the run." },
 	{ NULL, NULL, 0, NULL }
 };
 
@@ -829,6 +841,12 @@ void fwts_framework_log(
 	} else
 		*buffer = '\0';
 
+	/* Forked child, the parent does the accounting and logging */
+	if (fwts_log_capture_active()) {
+		fwts_log_capture_framework(fw, field, label, level, count, fmt ? buffer : NULL);
+		return;
+	}
+
 	switch (field) {
 	case LOG_ADVICE:
 		/* If the previous LOG_FAILED message was filtered out, ignore following advice */
@@ -1101,6 +1119,105 @@ static int fwts_framework_acpica_parse(fwts_framework *fw, char *arg)
 	return FWTS_OK;
 }
 
+/*
+ *  fwts_framework_negative()
+ *	true if a number starts with '-', after any white space, as
+ *	strtoull() accepts and negates these rather than failing
+ */
+static bool fwts_framework_negative(const char *str)
+{
+	while (isspace((unsigned char)*str))
+		str++;
+
+	return *str == '-';
+}
+
+/*
+ *  fwts_framework_aml_budget_parse()
+ *	parse optarg of aml-budget, opcodes[,milliseconds]
+ */
+static int fwts_framework_aml_budget_parse(fwts_framework *fw, const char *arg)
+{
+	char *end;
+	unsigned long long opcodes;
+	unsigned long ms = 0;
+
+	if (fwts_framework_negative(arg))
+		goto err;
+	errno = 0;
+	opcodes = strtoull(arg, &end, 10);
+	if (!errno && (end != arg) && (*end == ',')) {
+		arg = end + 1;
+		if (fwts_framework_negative(arg))
+			goto err;
+		ms = strtoul(arg, &end, 10);
+		if (end == arg || ms > UINT32_MAX)
+			errno = ERANGE;
+	}
+	if (errno || (end == arg) || (*end != '\0'))
+		goto err;
+	fw->aml_budget_opcodes = (uint64_t)opcodes;
+	fw->aml_budget_ms = (uint32_t)ms;
+
+	return FWTS_OK;
+err:
+	fprintf(stderr, "--aml-budget expects opcodes[,milliseconds], e.g. --aml-budget=1000000,5000\n");
+	return FWTS_ERROR;
+}
+
+/*
+ *  fwts_framework_efi_emulator_parse()
+ *	parse optarg of efi-emulator, store[,latency_us[,fault_every]]
+ */
+static int fwts_framework_efi_emulator_parse(fwts_framework *fw, const char *arg)
+{
+	unsigned long long values[3] = { FWTS_EFI_EMULATOR_STORE_SIZE, 0, 0 };
+	const char *ptr = arg;
+	char *end;
+	int i;
+
+	for (i = 0; ptr && (i < 3); i++) {
+		errno = 0;
+		values[i] = strtoull(ptr, &end, 10);
+		if (errno || (end == ptr) || fwts_framework_negative(ptr) ||
+		    ((*end != ',') && (*end != '\0')) ||
+		    ((i > 0) && (values[i] > UINT32_MAX)))
+			goto err;
+		ptr = (*end == ',') ? end + 1 : NULL;
+	}
+	if (ptr || (values[0] == 0))
+		goto err;
+
+	fw->efi_emulator_store_size = (uint64_t)values[0];
+	fw->efi_emulator_latency_us = (uint32_t)values[1];
+	fw->efi_emulator_fault_every = (uint32_t)values[2];
+
+	return FWTS_OK;
+err:
+	fprintf(stderr, "--efi-emulator expects store[,latency_us[,fault_every]], e.g. --efi-emulator=65536,100,50\n");
+	return FWTS_ERROR;
+}
+
+/*
+ *  fwts_framework_efi_emulator_reclaim_parse()
+ *	parse optarg of efi-emulator-reclaim
+ */
+static int fwts_framework_efi_emulator_reclaim_parse(fwts_framework *fw, const char *arg)
+{
+	if (strcmp(arg, "immediate") == 0)
+		fw->efi_emulator_reclaim = FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE;
+	else if (strcmp(arg, "full") == 0)
+		fw->efi_emulator_reclaim = FWTS_EFI_EMULATOR_RECLAIM_FULL;
+	else if (strcmp(arg, "boot") == 0)
+		fw->efi_emulator_reclaim = FWTS_EFI_EMULATOR_RECLAIM_BOOT;
+	else {
+		fprintf(stderr, "--efi-emulator-reclaim only supports immediate, full and boot\n");
+		return FWTS_ERROR;
+	}
+
+	return FWTS_OK;
+}
+
 /*
  *  fwts_framework_pm_method_parse()
  *	parse optarg of pm-method mode flag
@@ -1358,6 +1475,60 @@ int fwts_framework_options_handler(fwts_framework *fw, int argc, char * const ar
 			fprintf(stderr, "option not available on this architecture\n");
 			return FWTS_ERROR;
 #endif
+		case 50: /* --aml-profile */
+			fw->flags |= FWTS_FLAG_AML_PROFILE;
+			if (optarg)
+				fwts_framework_strdup(&fw->aml_profile_file, optarg);
+			break;
+		case 51: /* --region-replay */
+#if defined(FWTS_HAS_ACPI)
+			if (fwts_acpi_region_trace_load(optarg) != FWTS_OK)
+				return FWTS_ERROR;
+			break;
+#else
+			fprintf(stderr, "option not available on this architecture\n");
+			return FWTS_ERROR;
+#endif
+		case 52: /* --region-capture */
+#if defined(FWTS_HAS_ACPI)
+			fwts_framework_strdup(&fw->region_capture_file, optarg);
+			break;
+#else
+			fprintf(stderr, "option not available on this architecture\n");
+			return FWTS_ERROR;
+#endif
+		case 53: /* --aml-budget */
+			if (fwts_framework_aml_budget_parse(fw, optarg) != FWTS_OK)
+				return FWTS_ERROR;
+			break;
+		case 54: /* --aml-coverage */
+			fw->flags |= FWTS_FLAG_AML_COVERAGE;
+			if (optarg)
+				fwts_framework_strdup(&fw->aml_coverage_file, optarg);
+			break;
+		case 55: /* --namespace-snapshot */
+			fwts_framework_strdup(&fw->namespace_snapshot_file, optarg);
+			break;
+		case 56: /* --no-iasl-cache */
+			fw->flags |= FWTS_FLAG_NO_IASL_CACHE;
+			break;
+		case 57: /* --efi-emulator */
+			fw->flags |= FWTS_FLAG_EFI_EMULATOR;
+			if (optarg && (fwts_framework_efi_emulator_parse(fw, optarg) != FWTS_OK))
+				return FWTS_ERROR;
+			break;
+		case 58: /* --uefi-rt-profile */
+			fw->flags |= FWTS_FLAG_UEFI_RT_PROFILE;
+			if (optarg)
+				fwts_framework_strdup(&fw->uefi_rt_profile_file, optarg);
+			break;
+		case 59: /* --uefi-rt-threshold */
+			fw->uefi_rt_threshold_us = strtoul(optarg, NULL, 10);
+			break;
+		case 60: /* --efi-emulator-reclaim */
+			if (fwts_framework_efi_emulator_reclaim_parse(fw, optarg) != FWTS_OK)
+				return FWTS_ERROR;
+			break;
 		}
 		break;
 	case 'a': /* --all */
@@ -1448,6 +1619,107 @@ int fwts_framework_options_handler(fwts_framework *fw, int argc, char * const ar
 	return FWTS_OK;
 }
 
+#if defined(FWTS_HAS_ACPI)
+/*
+ *  fwts_framework_fuzz_new()
+ *	create a framework context that runs the named test in-process
+ *	against tables added with fwts_acpi_inject_table(). Nothing is
+ *	loaded from firmware and the results log has no back-ends, so
+ *	the test can be run repeatedly, e.g. from a fuzzer.
+ */
+fwts_framework *fwts_framework_fuzz_new(const char *name)
+{
+	fwts_framework *fw;
+	fwts_framework_test *test;
+
+	if ((test = fwts_framework_test_find(name)) == NULL)
+		return NULL;
+
+	if ((fw = (fwts_framework *)calloc(1, sizeof(fwts_framework))) == NULL)
+		return NULL;
+
+	fw->magic = FWTS_FRAMEWORK_MAGIC;
+	fw->flags = FWTS_FLAG_QUIET;
+	fw->log_type = LOG_TYPE_NONE;
+	fw->filter_level = LOG_LEVEL_ALL;
+	fw->pm_method = FWTS_PM_UNDEFINED;
+	fw->host_arch = fwts_arch_get_host();
+	fw->target_arch = fw->host_arch;
+	fw->firmware_type = fwts_firmware_detect();
+	fw->current_major_test = test;
+
+	fwts_list_init(&fw->errors_filter_keep);
+	fwts_list_init(&fw->errors_filter_discard);
+
+	/* Tables never come from live firmware, tests should treat them as a dump */
+	fwts_framework_strdup(&fw->acpi_table_acpidump_file, "/dev/null");
+
+	if ((fw->acpi_table_acpidump_file == NULL) ||
+	    (fwts_summary_init() != FWTS_OK)) {
+		free(fw->acpi_table_acpidump_file);
+		free(fw);
+		return NULL;
+	}
+
+	/* A log with no log types has no back-ends, so nothing is written */
+	if ((fw->results = fwts_log_open("fwts", "/dev/null", "w", LOG_TYPE_NONE)) == NULL) {
+		fwts_summary_deinit();
+		free(fw->acpi_table_acpidump_file);
+		free(fw);
+		return NULL;
+	}
+	fwts_log_filter_unset_field(LOG_FIELD_MASK);
+
+	return fw;
+}
+
+/*
+ *  fwts_framework_fuzz_reset()
+ *	discard the ACPI tables and results of the previous run,
+ *	tables for the next run are then added with fwts_acpi_inject_table()
+ */
+int fwts_framework_fuzz_reset(fwts_framework *fw)
+{
+	fwts_acpi_free_tables();
+	fwts_summary_deinit();
+	if (fwts_summary_init() != FWTS_OK)
+		return FWTS_ERROR;
+
+	fwts_results_zero(&fw->total);
+	fw->total_run = 0;
+	fw->failed_level = 0;
+	fw->error_filtered_out = false;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_framework_fuzz_run()
+ *	run the test once on the injected tables
+ */
+int fwts_framework_fuzz_run(fwts_framework *fw)
+{
+	/* fwts_framework_fuzz_new() stashed the test to run */
+	return fwts_framework_run_test(fw, fw->current_major_test);
+}
+
+/*
+ *  fwts_framework_fuzz_free()
+ *	free a context created by fwts_framework_fuzz_new()
+ */
+void fwts_framework_fuzz_free(fwts_framework *fw)
+{
+	if (!fw)
+		return;
+
+	fwts_acpi_free_tables();
+	fwts_summary_deinit();
+	fwts_log_close(fw->results);
+	free(fw->acpi_table_acpidump_file);
+	free(fw);
+}
+#endif
+
 /*
  *  fwts_framework_args()
  *	parse args and run tests
@@ -1471,6 +1743,10 @@ int fwts_framework_args(const int argc, char **argv)
 	fw->host_arch = fwts_arch_get_host();
 	fw->target_arch = fw->host_arch;
 
+	fw->efi_emulator_store_size = FWTS_EFI_EMULATOR_STORE_SIZE;
+	fw->efi_emulator_reclaim = FWTS_EFI_EMULATOR_RECLAIM_IMMEDIATE;
+	fw->uefi_rt_threshold_us = FWTS_UEFI_RT_THRESHOLD_US;
+
 	ret = fwts_args_add_options(fwts_framework_options,
 		fwts_framework_options_handler, NULL);
 	if (ret == FWTS_ERROR)
@@ -1532,6 +1808,14 @@ int fwts_framework_args(const int argc, char **argv)
 		fwts_dump_info(fw);
 		goto tidy_close;
 	}
+#if defined(FWTS_HAS_ACPI)
+	/* After all the options, --dumpfile and --table-path affect the tables */
+	if (fw->region_capture_file) {
+		if (fwts_acpi_region_trace_capture(fw, fw->region_capture_file) != FWTS_OK)
+			ret = FWTS_ERROR;
+		goto tidy_close;
+	}
+#endif
 	if ((fw->lspci == NULL) || (fw->results_logname == NULL)) {
 		ret = FWTS_ERROR;
 		fprintf(stderr, "%s: Memory allocation failure.", argv[0]);
@@ -1629,6 +1913,15 @@ int fwts_framework_args(const int argc, char **argv)
 	fwts_framework_tests_run(fw, &tests_to_run);
 	fwts_log_section_end(fw->results);
 
+#if defined(FWTS_HAS_ACPI)
+	if (fw->flags & FWTS_FLAG_AML_COVERAGE) {
+		fwts_log_section_begin(fw->results, "coverage");
+		fwts_log_set_owner(fw->results, "coverage");
+		fwts_acpi_coverage_report(fw);
+		fwts_log_section_end(fw->results);
+	}
+#endif
+
 	if (fw->print_summary) {
 		fwts_log_section_begin(fw->results, "summary");
 		fwts_log_set_owner(fw->results, "summary");
@@ -1647,6 +1940,7 @@ tidy:
 tidy_close:
 #if defined(FWTS_HAS_ACPI)
 	fwts_acpi_free_tables();
+	fwts_acpi_region_trace_free();
 #endif
 	fwts_summary_deinit();
 
@@ -1657,6 +1951,11 @@ tidy_close:
 	free(fw->olog);
 	free(fw->json_data_path);
 	free(fw->json_data_file);
+	free(fw->aml_profile_file);
+	free(fw->aml_coverage_file);
+	free(fw->namespace_snapshot_file);
+	free(fw->uefi_rt_profile_file);
+	free(fw->region_capture_file);
 	free(fw->fdt);
 
 	fwts_list_free_items(&fw->errors_filter_discard, NULL);
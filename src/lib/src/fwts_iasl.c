@@ -16,6 +16,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  *
  */
+
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -26,6 +29,10 @@
 #include <string.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/time.h>
 
 #include "fwts.h"
 
@@ -35,9 +42,94 @@
 /* For ACPICA interface */
 static char *iasl_cached_table_filename[ACPI_MAX_TABLES];
 static char *iasl_cached_table_name[ACPI_MAX_TABLES];
+static int iasl_cached_table_fd[ACPI_MAX_TABLES];	/* memfd of table, -1 if a file */
+static uint64_t iasl_cached_table_hash[ACPI_MAX_TABLES];	/* FNV-1a hash of table */
 
 static bool iasl_init = false;
 static int cached_max = 0;
+static const char *iasl_tmpdir = "/tmp";	/* Where iasl writes its output */
+static char *iasl_cache_dir;			/* Disassembly cache, NULL if not used */
+static bool iasl_cache_evicted;			/* Eviction done for this run */
+
+#define IASL_CACHE_MAX_SIZE	(64 * 1024 * 1024)	/* Least recently used evicted beyond this */
+#define IASL_CACHE_KEY_LEN	(17)
+
+/*
+ *  fwts_iasl_hash()
+ *	FNV-1a hash of some data
+ */
+static uint64_t fwts_iasl_hash(uint64_t hash, const void *data, const size_t len)
+{
+	const uint8_t *ptr = (const uint8_t *)data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= ptr[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/*
+ *  fwts_iasl_file_read()
+ *	read a whole file into a '\0' terminated buffer
+ */
+static char *fwts_iasl_file_read(const char *filename, size_t *length)
+{
+	struct stat buf;
+	char *data;
+	size_t len = 0;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) < 0)
+		return NULL;
+	if ((fstat(fd, &buf) < 0) || ((data = malloc(buf.st_size + 1)) == NULL)) {
+		(void)close(fd);
+		return NULL;
+	}
+
+	while (len < (size_t)buf.st_size) {
+		ssize_t n = read(fd, data + len, buf.st_size - len);
+
+		if (n < 0) {
+			(void)close(fd);
+			free(data);
+			return NULL;
+		}
+		if (n == 0)
+			break;
+		len += n;
+	}
+	(void)close(fd);
+
+	data[len] = '\0';
+	*length = len;
+
+	return data;
+}
+
+/*
+ *  fwts_iasl_write_all()
+ *	write all of a buffer to a file
+ */
+static int fwts_iasl_write_all(const int fd, const char *data, const size_t length)
+{
+	size_t len = 0;
+
+	while (len < length) {
+		ssize_t n = write(fd, data + len, length - len);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return FWTS_ERROR;
+		}
+		len += n;
+	}
+
+	return FWTS_OK;
+}
 
 /*
  *  fwts_iasl_dump_aml_to_file()
@@ -68,36 +160,88 @@ static int fwts_iasl_dump_aml_to_file(
 	return FWTS_OK;
 }
 
+/*
+ *  fwts_iasl_dump_aml_to_memfd()
+ *	write AML data of given length to an in-memory file, iasl
+ *	children inherit it and open it as /proc/self/fd/N,
+ *	returns the fd or -1 if in-memory files are not available
+ */
+static int fwts_iasl_dump_aml_to_memfd(
+	const char *name,
+	const uint8_t *data,
+	const int length)
+{
+#if defined(MFD_CLOEXEC)
+	int fd;
+
+	if (access("/proc/self/fd", R_OK) < 0)
+		return -1;
+	if ((fd = memfd_create(name, MFD_CLOEXEC)) < 0)
+		return -1;
+	if (write(fd, data, length) != length) {
+		(void)close(fd);
+		return -1;
+	}
+
+	return fd;
+#else
+	FWTS_UNUSED(name);
+	FWTS_UNUSED(data);
+	FWTS_UNUSED(length);
+
+	return -1;
+#endif
+}
+
 /*
  *  fwts_iasl_cache_tables_to_file()
- *	to disassemble an APCPI table we need to dump it
- *	to file. To save effort in saving these to file
+ *	to disassemble an APCPI table iasl needs to read it
+ *	from file. To save effort in saving these to file
  *	multiple times, we dump out all the tables and
- *	cache the references to these.
+ *	cache the references to these.  The tables are kept
+ *	in memory if possible, in /tmp if not.
  */
-static int fwts_iasl_cache_tables_to_file(fwts_framework *fw)
+static int fwts_iasl_cache_tables_to_file(fwts_framework *fw, fwts_acpi_table_info *set)
 {
 	pid_t pid = getpid();
 	char tmpname[PATH_MAX];
 	fwts_acpi_table_info *table;
 
 	for (cached_max = 0; cached_max < ACPI_MAX_TABLES; cached_max++) {
-		int ret = fwts_acpi_get_table(fw, cached_max, &table);
+		int fd, ret = FWTS_OK;
+
+		if (set)
+			table = set[cached_max].data ? &set[cached_max] : NULL;
+		else
+			ret = fwts_acpi_get_table(fw, cached_max, &table);
 		if (ret != FWTS_OK)
 			return ret;
 		if (table == NULL)
 			continue;
 
-		snprintf(tmpname, sizeof(tmpname),
-			"/tmp/fwts_tmp_table_%d_%s_%d.dsl",
-			pid, table->name, cached_max);
+		snprintf(tmpname, sizeof(tmpname), "fwts_tmp_table_%s_%d",
+			table->name, cached_max);
+		if ((fd = fwts_iasl_dump_aml_to_memfd(tmpname, table->data, table->length)) >= 0)
+			snprintf(tmpname, sizeof(tmpname), "/proc/self/fd/%d", fd);
+		else
+			snprintf(tmpname, sizeof(tmpname),
+				"/tmp/fwts_tmp_table_%d_%s_%d.dsl",
+				pid, table->name, cached_max);
+
+		iasl_cached_table_fd[cached_max] = fd;
+		iasl_cached_table_hash[cached_max] =
+			fwts_iasl_hash(0xcbf29ce484222325ULL, table->data, table->length);
 		iasl_cached_table_filename[cached_max] = strdup(tmpname);
 		iasl_cached_table_name[cached_max] = table->name;
 		if (iasl_cached_table_filename[cached_max] == NULL) {
 			fwts_log_error(fw, "Cannot allocate cached table file name.");
+			if (fd >= 0)
+				(void)close(fd);
+			iasl_cached_table_fd[cached_max] = -1;
 			return FWTS_ERROR;
 		}
-		if (fwts_iasl_dump_aml_to_file(fw, table->data, table->length, tmpname) != FWTS_OK) {
+		if ((fd < 0) &&
+		    (fwts_iasl_dump_aml_to_file(fw, table->data, table->length, tmpname) != FWTS_OK)) {
 			free(iasl_cached_table_filename[cached_max]);
 			iasl_cached_table_filename[cached_max] = NULL;
 			iasl_cached_table_name[cached_max] = NULL;
@@ -115,22 +259,229 @@ void fwts_iasl_deinit(void)
 	int i;
 
 	for (i = 0; i < cached_max; i++) {
-		if (iasl_cached_table_filename[i]) {
+		if (iasl_cached_table_fd[i] >= 0)
+			(void)close(iasl_cached_table_fd[i]);
+		else if (iasl_cached_table_filename[i])
 			(void)unlink(iasl_cached_table_filename[i]);
-			free(iasl_cached_table_filename[i]);
-		}
+		free(iasl_cached_table_filename[i]);
 		iasl_cached_table_filename[i] = NULL;
 		iasl_cached_table_name[i] = NULL;
+		iasl_cached_table_fd[i] = -1;
 	}
 	memset(iasl_cached_table_filename, 0, sizeof(iasl_cached_table_filename));
 	cached_max = 0;
+	free(iasl_cache_dir);
+	iasl_cache_dir = NULL;
 }
 
 /*
- *  fwts_iasl_init()
- *	initialise iasl - cache DSDT and SSDT to file
+ *  fwts_iasl_cache_dir()
+ *	find and create the disassembly cache directory,
+ *	$XDG_CACHE_HOME/fwts/iasl or ~/.cache/fwts/iasl
  */
-int fwts_iasl_init(fwts_framework *fw)
+static char *fwts_iasl_cache_dir(void)
+{
+	const char *base = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	char path[PATH_MAX];
+	char *sub;
+	int n;
+
+	if (base && *base)
+		n = snprintf(path, sizeof(path), "%s/fwts/iasl", base);
+	else if (home && *home)
+		n = snprintf(path, sizeof(path), "%s/.cache/fwts/iasl", home);
+	else
+		return NULL;
+	if ((n < 0) || ((size_t)n >= sizeof(path)))
+		return NULL;
+
+	/* Create each missing directory along the path */
+	for (sub = strchr(path + 1, '/'); ; sub = strchr(sub + 1, '/')) {
+		if (sub)
+			*sub = '\0';
+		if ((mkdir(path, 0700) < 0) && (errno != EEXIST))
+			return NULL;
+		if (sub == NULL)
+			break;
+		*sub = '/';
+	}
+	if (access(path, R_OK | W_OK | X_OK) < 0)
+		return NULL;
+
+	return strdup(path);
+}
+
+typedef struct {
+	char	*name;
+	off_t	size;
+	time_t	mtime;
+} fwts_iasl_cache_entry;
+
+static int fwts_iasl_cache_entry_cmp(const void *a, const void *b)
+{
+	const fwts_iasl_cache_entry *ea = (const fwts_iasl_cache_entry *)a;
+	const fwts_iasl_cache_entry *eb = (const fwts_iasl_cache_entry *)b;
+
+	return (ea->mtime > eb->mtime) - (ea->mtime < eb->mtime);
+}
+
+/*
+ *  fwts_iasl_cache_evict()
+ *	remove the least recently used cache entries until
+ *	the cache is no larger than max_size, hits touch
+ *	the modification time of an entry
+ */
+static void fwts_iasl_cache_evict(const char *dir, const off_t max_size)
+{
+	fwts_iasl_cache_entry *entries = NULL;
+	size_t i, n = 0, size = 0;
+	off_t total = 0;
+	struct dirent *entry;
+	DIR *dp;
+
+	if ((dp = opendir(dir)) == NULL)
+		return;
+
+	while ((entry = readdir(dp)) != NULL) {
+		char path[PATH_MAX];
+		struct stat buf;
+
+		if (entry->d_name[0] == '.' && (entry->d_name[1] == '\0' ||
+		    (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+		if ((lstat(path, &buf) < 0) || !S_ISREG(buf.st_mode))
+			continue;
+		if (n == size) {
+			fwts_iasl_cache_entry *tmp;
+
+			size = size ? size * 2 : 64;
+			if ((tmp = realloc(entries, size * sizeof(*entries))) == NULL)
+				goto out;
+			entries = tmp;
+		}
+		if ((entries[n].name = strdup(entry->d_name)) == NULL)
+			goto out;
+		entries[n].size = buf.st_size;
+		entries[n].mtime = buf.st_mtime;
+		total += buf.st_size;
+		n++;
+	}
+
+	if (total > max_size) {
+		qsort(entries, n, sizeof(*entries), fwts_iasl_cache_entry_cmp);
+		for (i = 0; (i < n) && (total > max_size); i++) {
+			char path[PATH_MAX];
+
+			snprintf(path, sizeof(path), "%s/%s", dir, entries[i].name);
+			if (unlink(path) == 0)
+				total -= entries[i].size;
+		}
+	}
+out:
+	for (i = 0; i < n; i++)
+		free(entries[i].name);
+	free(entries);
+	(void)closedir(dp);
+}
+
+/*
+ *  fwts_iasl_cache_key()
+ *	key of a disassembly in the cache, a hash of the table,
+ *	the external tables included and the iasl version, and of
+ *	the source text if this is the key of an assembly
+ */
+static void fwts_iasl_cache_key(
+	const int which,
+	const bool use_externals,
+	const bool listing,
+	const fwts_iasl_text *source,
+	char *key)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	const uint32_t version = fwts_iasl_version__();
+	const uint8_t mode = (use_externals ? 1 : 0) | (listing ? 2 : 0);
+	size_t line;
+	int i;
+
+	hash = fwts_iasl_hash(hash, &version, sizeof(version));
+	hash = fwts_iasl_hash(hash, &mode, sizeof(mode));
+	hash = fwts_iasl_hash(hash, &iasl_cached_table_hash[which], sizeof(uint64_t));
+
+	/* Same external tables as fwts_iasl_disassemble_aml() includes */
+	for (i = 0; use_externals && (i < cached_max); i++) {
+		if ((i != which) &&
+		    (iasl_cached_table_name[i] != NULL) &&
+		    (iasl_cached_table_filename[i] != NULL) &&
+		    (!strcmp(iasl_cached_table_name[i], "SSDT") ||
+		     !strcmp(iasl_cached_table_name[i], "DSDT")))
+			hash = fwts_iasl_hash(hash, &iasl_cached_table_hash[i], sizeof(uint64_t));
+	}
+
+	/* Callers may assemble source that is not the cached disassembly */
+	for (line = 0; source && (line < source->count); line++)
+		hash = fwts_iasl_hash(hash, source->lines[line], strlen(source->lines[line]) + 1);
+
+	snprintf(key, IASL_CACHE_KEY_LEN, "%016" PRIx64, hash);
+}
+
+/*
+ *  fwts_iasl_cache_get()
+ *	get a cache entry, NULL if it is not in the cache
+ */
+static char *fwts_iasl_cache_get(const char *key, const char *suffix, size_t *length)
+{
+	char path[PATH_MAX];
+	char *data;
+
+	if (iasl_cache_dir == NULL)
+		return NULL;
+
+	snprintf(path, sizeof(path), "%s/%s.%s", iasl_cache_dir, key, suffix);
+	if ((data = fwts_iasl_file_read(path, length)) != NULL)
+		(void)utimes(path, NULL);	/* Recently used */
+
+	return data;
+}
+
+/*
+ *  fwts_iasl_cache_put()
+ *	add an entry to the cache, it is written to a temporary
+ *	file first so readers never see a partial entry
+ */
+static void fwts_iasl_cache_put(
+	const char *key,
+	const char *suffix,
+	const char *data,
+	const size_t length)
+{
+	char tmpname[PATH_MAX];
+	char path[PATH_MAX];
+	int fd, ret;
+
+	if (iasl_cache_dir == NULL)
+		return;
+
+	snprintf(tmpname, sizeof(tmpname), "%s/.%s.%s.XXXXXX", iasl_cache_dir, key, suffix);
+	snprintf(path, sizeof(path), "%s/%s.%s", iasl_cache_dir, key, suffix);
+
+	if ((fd = mkstemp(tmpname)) < 0)
+		return;
+	ret = fwts_iasl_write_all(fd, data, length);
+	if (close(fd) < 0)
+		ret = FWTS_ERROR;
+	if ((ret != FWTS_OK) || (rename(tmpname, path) < 0))
+		(void)unlink(tmpname);
+}
+
+/*
+ *  fwts_iasl_init_tables()
+ *	initialise iasl for a set of tables loaded with
+ *	fwts_acpi_load_table_set(), or the tables under test
+ *	if set is NULL - cache DSDT and SSDT to file
+ */
+int fwts_iasl_init_tables(fwts_framework *fw, fwts_acpi_table_info *set)
 {
 	int ret;
 
@@ -138,16 +489,36 @@ int fwts_iasl_init(fwts_framework *fw)
 	fwts_iasl_deinit();	/* Ensure it is clean */
 
 	memset(iasl_cached_table_filename, 0, sizeof(iasl_cached_table_filename));
+	memset(iasl_cached_table_fd, -1, sizeof(iasl_cached_table_fd));
+
+	/* iasl can only write to named files, prefer a RAM backed directory */
+	iasl_tmpdir = (access("/dev/shm", W_OK | X_OK) == 0) ? "/dev/shm" : "/tmp";
 
-	ret = fwts_iasl_cache_tables_to_file(fw);
+	ret = fwts_iasl_cache_tables_to_file(fw, set);
 	if (ret != FWTS_OK)
 		return ret;
 
+	if (!(fw->flags & FWTS_FLAG_NO_IASL_CACHE) &&
+	    ((iasl_cache_dir = fwts_iasl_cache_dir()) != NULL) &&
+	    !iasl_cache_evicted) {
+		fwts_iasl_cache_evict(iasl_cache_dir, IASL_CACHE_MAX_SIZE);
+		iasl_cache_evicted = true;
+	}
+
 	iasl_init = true;
 
 	return FWTS_OK;
 }
 
+/*
+ *  fwts_iasl_init()
+ *	initialise iasl - cache DSDT and SSDT to file
+ */
+int fwts_iasl_init(fwts_framework *fw)
+{
+	return fwts_iasl_init_tables(fw, NULL);
+}
+
 /*
  *  fwts_iasl_disassemble_to_file()
  *	Disassemble a given table and dump disassembly to a file.
@@ -155,6 +526,7 @@ int fwts_iasl_init(fwts_framework *fw)
 static int fwts_iasl_disassemble_to_file(fwts_framework *fw,
 	const fwts_acpi_table_info *info,
 	const bool use_externals,
+	const bool listing,
 	const char *filename)
 {
 	if (!iasl_init)
@@ -165,23 +537,84 @@ static int fwts_iasl_disassemble_to_file(fwts_framework *fw,
 	if (fwts_iasl_disassemble_aml(
 		iasl_cached_table_filename,
 		iasl_cached_table_name,
-		cached_max, info->index, use_externals, filename) < 0)
+		cached_max, info->index, use_externals, listing, filename) < 0)
 		return FWTS_ERROR;
 
 	return FWTS_OK;
 }
 
 /*
- *  fwts_iasl_disassemble()
- *	Disassemble a given table and dump disassembly list of strings.
- *
+ *  fwts_iasl_text_free()
+ *	free disassembly text
  */
-int fwts_iasl_disassemble(fwts_framework *fw,
+void fwts_iasl_text_free(fwts_iasl_text *text)
+{
+	if (text) {
+		free(text->lines);
+		free(text->text);
+		free(text);
+	}
+}
+
+/*
+ *  fwts_iasl_text_index()
+ *	index the lines of a buffer of text, newlines are replaced
+ *	by string terminators, the text is owned by the returned
+ *	fwts_iasl_text
+ */
+static fwts_iasl_text *fwts_iasl_text_index(char *data, const size_t length)
+{
+	fwts_iasl_text *text;
+	size_t i, n;
+	char *ptr;
+
+	if (data == NULL)
+		return NULL;
+	if ((text = calloc(1, sizeof(*text))) == NULL) {
+		free(data);
+		return NULL;
+	}
+	text->text = data;
+	text->length = length;
+
+	for (i = 0, n = 0; i < length; i++)
+		if (data[i] == '\n')
+			n++;
+	if (length && data[length - 1] != '\n')
+		n++;
+
+	if ((text->lines = calloc(n + 1, sizeof(char *))) == NULL) {
+		fwts_iasl_text_free(text);
+		return NULL;
+	}
+	for (ptr = data; ptr < data + length; ) {
+		char *eol = memchr(ptr, '\n', data + length - ptr);
+
+		text->lines[text->count++] = ptr;
+		if (eol == NULL)
+			break;
+		*eol = '\0';
+		ptr = eol + 1;
+	}
+
+	return text;
+}
+
+/*
+ *  fwts_iasl_disassemble_text_output()
+ *	Disassemble a given table and return the disassembly text,
+ *	from the cache if the table has been disassembled before.
+ */
+static int fwts_iasl_disassemble_text_output(fwts_framework *fw,
 	const fwts_acpi_table_info *info,
 	const bool use_externals,
-	fwts_list **iasl_output)
+	const bool listing,
+	fwts_iasl_text **iasl_output)
 {
 	char tmpfile[PATH_MAX];
+	char key[IASL_CACHE_KEY_LEN];
+	char *data;
+	size_t length = 0;
 	int pid = getpid();
 	int ret;
 
@@ -192,19 +625,245 @@ int fwts_iasl_disassemble(fwts_framework *fw,
 
 	*iasl_output = NULL;
 
+	fwts_iasl_cache_key(info->index, use_externals, listing, NULL, key);
+	if ((data = fwts_iasl_cache_get(key, "dsl", &length)) != NULL) {
+		*iasl_output = fwts_iasl_text_index(data, length);
+		return *iasl_output ? FWTS_OK : FWTS_ERROR;
+	}
+
 	snprintf(tmpfile, sizeof(tmpfile),
-		"/tmp/fwts_iasl_disassemble_%d_%s_%d.dsl",
-		pid, info->name, info->index);
+		"%s/fwts_iasl_disassemble_%d_%s_%d.dsl",
+		iasl_tmpdir, pid, info->name, info->index);
 
-	if ((ret = fwts_iasl_disassemble_to_file(fw, info, use_externals, tmpfile)) != FWTS_OK)
+	if ((ret = fwts_iasl_disassemble_to_file(fw, info, use_externals, listing, tmpfile)) != FWTS_OK) {
+		(void)unlink(tmpfile);
 		return ret;
+	}
 
-	*iasl_output = fwts_file_open_and_read(tmpfile);
+	if ((data = fwts_iasl_file_read(tmpfile, &length)) != NULL)
+		fwts_iasl_cache_put(key, "dsl", data, length);
 	(void)unlink(tmpfile);
 
+	*iasl_output = fwts_iasl_text_index(data, length);
+
 	return *iasl_output ? FWTS_OK : FWTS_ERROR;
 }
 
+/*
+ *  fwts_iasl_disassemble_list()
+ *	Disassemble a given table and dump disassembly list of strings.
+ */
+static int fwts_iasl_disassemble_list(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const bool use_externals,
+	const bool listing,
+	fwts_list **iasl_output)
+{
+	fwts_iasl_text *text;
+	size_t i;
+	int ret;
+
+	if (iasl_output == NULL)
+		return FWTS_ERROR;
+
+	*iasl_output = NULL;
+
+	if ((ret = fwts_iasl_disassemble_text_output(fw, info, use_externals, listing, &text)) != FWTS_OK)
+		return ret;
+
+	if ((*iasl_output = fwts_list_new()) == NULL) {
+		fwts_iasl_text_free(text);
+		return FWTS_ERROR;
+	}
+	for (i = 0; i < text->count; i++) {
+		char *str = strdup(text->lines[i]);
+
+		if ((str == NULL) || (fwts_list_append(*iasl_output, str) == NULL)) {
+			free(str);
+			fwts_text_list_free(*iasl_output);
+			*iasl_output = NULL;
+			break;
+		}
+	}
+	fwts_iasl_text_free(text);
+
+	return *iasl_output ? FWTS_OK : FWTS_ERROR;
+}
+
+/*
+ *  fwts_iasl_disassemble_text()
+ *	Disassemble a given table into a single buffer of text
+ *	with an index of its lines.
+ */
+int fwts_iasl_disassemble_text(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const bool use_externals,
+	fwts_iasl_text **iasl_output)
+{
+	return fwts_iasl_disassemble_text_output(fw, info, use_externals, false, iasl_output);
+}
+
+/*
+ *  fwts_iasl_disassemble()
+ *	Disassemble a given table and dump disassembly list of strings.
+ *
+ */
+int fwts_iasl_disassemble(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const bool use_externals,
+	fwts_list **iasl_output)
+{
+	return fwts_iasl_disassemble_list(fw, info, use_externals, false, iasl_output);
+}
+
+/*
+ *  fwts_iasl_disassemble_listing()
+ *	Disassemble a given table into a listing, a list of strings
+ *	with the AML byte code of each statement dumped after it.
+ */
+int fwts_iasl_disassemble_listing(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	const bool use_externals,
+	fwts_list **iasl_output)
+{
+	return fwts_iasl_disassemble_list(fw, info, use_externals, true, iasl_output);
+}
+
+/*
+ *  fwts_iasl_disassemble_session_raw()
+ *	Disassemble a set of tables in one iasl session, the
+ *	disassembly text of each table is returned in data,
+ *	NULL for any table that could not be disassembled.
+ */
+static int fwts_iasl_disassemble_session_raw(fwts_framework *fw,
+	const fwts_acpi_table_info *info[],
+	const int count,
+	const bool use_externals,
+	const bool listing,
+	int jobs,
+	char *data[],
+	size_t length[])
+{
+	char key[IASL_CACHE_KEY_LEN];
+	char tmpfile[PATH_MAX];
+	char **outputfiles;
+	int *which, *target;
+	int i, n, ret = FWTS_OK;
+	int pid = getpid();
+
+	if (!iasl_init)
+		return FWTS_ERROR;
+	if (count < 1)
+		return FWTS_OK;
+
+	for (i = 0; i < count; i++) {
+		data[i] = NULL;
+		length[i] = 0;
+	}
+
+	outputfiles = calloc(count, sizeof(char *));
+	which = calloc(count, sizeof(int));
+	target = calloc(count, sizeof(int));
+	if (!outputfiles || !which || !target) {
+		ret = FWTS_OUT_OF_MEMORY;
+		goto free_all;
+	}
+
+	/* Only tables not in the cache need iasl */
+	for (i = 0, n = 0; i < count; i++) {
+		fwts_iasl_cache_key(info[i]->index, use_externals, listing, NULL, key);
+		if ((data[i] = fwts_iasl_cache_get(key, "dsl", &length[i])) != NULL)
+			continue;
+
+		snprintf(tmpfile, sizeof(tmpfile),
+			"%s/fwts_iasl_session_%d_%s_%d.dsl",
+			iasl_tmpdir, pid, info[i]->name, info[i]->index);
+		if ((outputfiles[n] = strdup(tmpfile)) == NULL) {
+			ret = FWTS_OUT_OF_MEMORY;
+			goto free_all;
+		}
+		which[n] = info[i]->index;
+		target[n] = i;
+		n++;
+	}
+	if (n == 0)
+		goto free_all;
+
+	if (jobs < 1)
+		jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	fwts_acpica_set_fwts_framework(fw);
+	if (fwts_iasl_disassemble_session_aml(
+		iasl_cached_table_filename,
+		iasl_cached_table_name,
+		cached_max, which, outputfiles, n,
+		use_externals, listing, jobs) < 0)
+		ret = FWTS_ERROR;
+
+	for (i = 0; i < n; i++) {
+		const int k = target[i];
+
+		if ((ret == FWTS_OK) &&
+		    ((data[k] = fwts_iasl_file_read(outputfiles[i], &length[k])) != NULL)) {
+			fwts_iasl_cache_key(which[i], use_externals, listing, NULL, key);
+			fwts_iasl_cache_put(key, "dsl", data[k], length[k]);
+		}
+		(void)unlink(outputfiles[i]);
+	}
+
+free_all:
+	if (outputfiles)
+		for (i = 0; i < count; i++)
+			free(outputfiles[i]);
+	free(outputfiles);
+	free(which);
+	free(target);
+
+	return ret;
+}
+
+/*
+ *  fwts_iasl_disassemble_session()
+ *	Disassemble a set of tables, loading the external tables
+ *	once for all of them rather than once for each table, with
+ *	up to jobs disassemblies at a time, 0 for one per CPU.
+ *	The disassembly of each table is returned in iasl_output,
+ *	NULL for any table that could not be disassembled.
+ */
+int fwts_iasl_disassemble_session(fwts_framework *fw,
+	const fwts_acpi_table_info *info[],
+	const int count,
+	const bool use_externals,
+	const int jobs,
+	fwts_iasl_text *iasl_output[])
+{
+	char **data;
+	size_t *length;
+	int i, ret;
+
+	if (count < 1)
+		return FWTS_OK;
+	for (i = 0; i < count; i++)
+		iasl_output[i] = NULL;
+
+	data = calloc(count, sizeof(char *));
+	length = calloc(count, sizeof(size_t));
+	if (!data || !length) {
+		free(data);
+		free(length);
+		return FWTS_OUT_OF_MEMORY;
+	}
+
+	ret = fwts_iasl_disassemble_session_raw(fw, info, count,
+		use_externals, false, jobs, data, length);
+	for (i = 0; i < count; i++)
+		iasl_output[i] = fwts_iasl_text_index(data[i], length[i]);
+
+	free(data);
+	free(length);
+
+	return ret;
+}
 
 /*
  *  fwts_iasl_disassemble_all_to_file()
@@ -214,7 +873,10 @@ int fwts_iasl_disassemble_all_to_file(
 	fwts_framework *fw,
 	const char *path)
 {
-	int i, j, ret;
+	const fwts_acpi_table_info *info[ACPI_MAX_TABLES];
+	char *data[ACPI_MAX_TABLES];
+	size_t length[ACPI_MAX_TABLES];
+	int i, n, ret;
 	char filename[PATH_MAX + 18];
 	char pathname[PATH_MAX];
 
@@ -233,21 +895,40 @@ int fwts_iasl_disassemble_all_to_file(
 	else
 		snprintf(pathname, sizeof(pathname), "%s/", path);
 
-	for (i = 0, j = 0; i < cached_max; i++) {
-		fwts_acpi_table_info *info;
+	for (i = 0, n = 0; i < cached_max; i++) {
+		fwts_acpi_table_info *table;
 
-		ret = fwts_acpi_get_table(fw, i, &info);
+		ret = fwts_acpi_get_table(fw, i, &table);
 		if (ret != FWTS_OK)
 			break;
-		if (info && info->has_aml) {
-			snprintf(filename, sizeof(filename), "%s%s%d.dsl",
-				pathname, info->name, j);
-			if (fwts_iasl_disassemble_to_file(fw, info, true, filename) != FWTS_OK)
-				fprintf(stderr, "Could not disassemble %s\n", info->name);
-			else
-				printf("Disassembled %s to %s\n", info->name, filename);
-			j++;
+		if (table && table->has_aml)
+			info[n++] = table;
+	}
+
+	if (fwts_iasl_disassemble_session_raw(fw, info, n, true, false, 0, data, length) != FWTS_OK) {
+		fprintf(stderr, "Could not disassemble tables.\n");
+		fwts_iasl_deinit();
+		return FWTS_ERROR;
+	}
+
+	for (i = 0; i < n; i++) {
+		int fd;
+
+		snprintf(filename, sizeof(filename), "%s%s%d.dsl",
+			pathname, info[i]->name, i);
+
+		ret = FWTS_ERROR;
+		if (data[i] &&
+		    ((fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0)) {
+			ret = fwts_iasl_write_all(fd, data[i], length[i]);
+			if (close(fd) < 0)
+				ret = FWTS_ERROR;
 		}
+		if (ret != FWTS_OK)
+			fprintf(stderr, "Could not disassemble %s\n", info[i]->name);
+		else
+			printf("Disassembled %s to %s\n", info[i]->name, filename);
+		free(data[i]);
 	}
 	fwts_iasl_deinit();
 
@@ -255,20 +936,24 @@ int fwts_iasl_disassemble_all_to_file(
 }
 
 /*
- *  fwts_iasl_reassemble()
- *	given a ACPI table go and disassemble it
- *	and re-assemble it.  Dump the disassembly into list iasl_disassembly and
- * 	any re-assembly errors into list iasl_errors.
+ *  fwts_iasl_assemble()
+ *	given the disassembly of an ACPI table re-assemble it,
+ *	returning any re-assembly errors in lists iasl_stdout and
+ *	iasl_stderr.  Different tables may be assembled
+ *	concurrently from separate threads.
  */
-int fwts_iasl_reassemble(fwts_framework *fw,
+int fwts_iasl_assemble(fwts_framework *fw,
 	const fwts_acpi_table_info *info,
-	fwts_list **iasl_disassembly,
+	const fwts_iasl_text *iasl_disassembly,
 	fwts_list **iasl_stdout,
 	fwts_list **iasl_stderr)
 {
 	char tmpfile[PATH_MAX];
+	char key[IASL_CACHE_KEY_LEN];
 	char *stdout_output = NULL, *stderr_output = NULL;
 	int pid = getpid();
+	size_t i, length;
+	FILE *fp;
 
 	if ((!iasl_init) ||
 	    (iasl_disassembly == NULL) ||
@@ -278,20 +963,31 @@ int fwts_iasl_reassemble(fwts_framework *fw,
 		return FWTS_ERROR;
 
 	fwts_acpica_set_fwts_framework(fw);
-	*iasl_disassembly = NULL;
-	snprintf(tmpfile, sizeof(tmpfile), "/tmp/fwts_iasl_reassemble_%d.dsl", pid);
 
-	if (fwts_iasl_disassemble_aml(
-		iasl_cached_table_filename,
-		iasl_cached_table_name,
-		cached_max, info->index, true, tmpfile) < 0) {
+	/* Unchanged source is served from the cache without running iasl */
+	fwts_iasl_cache_key(info->index, true, false, iasl_disassembly, key);
+	stdout_output = fwts_iasl_cache_get(key, "out", &length);
+	stderr_output = fwts_iasl_cache_get(key, "err", &length);
+	if (stdout_output && stderr_output)
+		goto done;
+	free(stdout_output);
+	free(stderr_output);
+	stdout_output = NULL;
+	stderr_output = NULL;
+
+	/* Unique per table, tables may be reassembled concurrently */
+	snprintf(tmpfile, sizeof(tmpfile), "%s/fwts_iasl_reassemble_%d_%s_%d.dsl",
+		iasl_tmpdir, pid, info->name, info->index);
+
+	if ((fp = fopen(tmpfile, "w")) == NULL)
+		return FWTS_ERROR;
+	for (i = 0; i < iasl_disassembly->count; i++)
+		fprintf(fp, "%s\n", iasl_disassembly->lines[i]);
+	if (fclose(fp) != 0) {
 		(void)unlink(tmpfile);
 		return FWTS_ERROR;
 	}
 
-	/* Read in the disassembled text to return later */
-	*iasl_disassembly = fwts_file_open_and_read(tmpfile);
-
 	/* Now we have a disassembled source in tmpfile, so let's assemble it */
 	if (fwts_iasl_assemble_aml(tmpfile, &stdout_output, &stderr_output) < 0) {
 		(void)unlink(tmpfile);
@@ -303,16 +999,52 @@ int fwts_iasl_reassemble(fwts_framework *fw,
 	(void)unlink(tmpfile);
 
 	/* And remove aml file generated from ACPICA compiler */
-	snprintf(tmpfile, sizeof(tmpfile), "/tmp/fwts_iasl_reassemble_%d.aml", pid);
+	snprintf(tmpfile, sizeof(tmpfile), "%s/fwts_iasl_reassemble_%d_%s_%d.aml",
+		iasl_tmpdir, pid, info->name, info->index);
 	(void)unlink(tmpfile);
 
+	fwts_iasl_cache_put(key, "out", stdout_output ? stdout_output : "",
+		stdout_output ? strlen(stdout_output) : 0);
+	fwts_iasl_cache_put(key, "err", stderr_output ? stderr_output : "",
+		stderr_output ? strlen(stderr_output) : 0);
+
+done:
 	*iasl_stdout = fwts_list_from_text(stdout_output);
 	*iasl_stderr = fwts_list_from_text(stderr_output);
 	free(stdout_output);
+	free(stderr_output);
 
 	return FWTS_OK;
 }
 
+/*
+ *  fwts_iasl_reassemble()
+ *	given a ACPI table go and disassemble it
+ *	and re-assemble it.  Return the disassembly text in iasl_disassembly and
+ * 	any re-assembly errors into list iasl_errors.  Different tables
+ *	may be reassembled concurrently from separate threads.
+ */
+int fwts_iasl_reassemble(fwts_framework *fw,
+	const fwts_acpi_table_info *info,
+	fwts_iasl_text **iasl_disassembly,
+	fwts_list **iasl_stdout,
+	fwts_list **iasl_stderr)
+{
+	int ret;
+
+	if ((iasl_disassembly == NULL) ||
+	    (iasl_stdout == NULL) ||
+	    (iasl_stderr == NULL) ||
+	    (info == NULL))
+		return FWTS_ERROR;
+
+	ret = fwts_iasl_disassemble_text_output(fw, info, true, false, iasl_disassembly);
+	if (ret != FWTS_OK)
+		return ret;
+
+	return fwts_iasl_assemble(fw, info, *iasl_disassembly, iasl_stdout, iasl_stderr);
+}
+
 const char *fwts_iasl_exception_level(uint8_t level)
 {
 	return fwts_iasl_exception_level__(level);
@@ -414,6 +414,18 @@ int fwts_log_printf(
 	if (FWTS_LEVEL_IGNORE(fw, level))
 		return ret;
 
+	/* Forked child, hand the output back to the parent */
+	if (fwts_log_capture_active()) {
+		char buffer[LOG_MAX_BUF_SIZE];
+		va_list	args;
+
+		va_start(args, fmt);
+		ret = vsnprintf(buffer, sizeof(buffer), fmt, args);
+		va_end(args);
+		fwts_log_capture_printf(fw, field, level, status, label, prefix, buffer);
+		return ret;
+	}
+
 	if (log && log->magic == LOG_MAGIC) {
 		char buffer[LOG_MAX_BUF_SIZE];
 		va_list	args;
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "fwts.h"
+
+#define CAPTURE_BUF_SIZE	(64 * 1024)	/* Records buffered before a write */
+#define CAPTURE_NULL		(0xffff)	/* String length for a NULL string */
+
+typedef enum {
+	CAPTURE_FRAMEWORK = 1,			/* fwts_framework_log() call */
+	CAPTURE_PRINTF = 2,			/* fwts_log_printf() call */
+} fwts_log_capture_kind;
+
+typedef enum {
+	CAPTURE_COUNT_NONE = 0,
+	CAPTURE_COUNT_PASSED,
+	CAPTURE_COUNT_FAILED,
+	CAPTURE_COUNT_WARNING,
+	CAPTURE_COUNT_SKIPPED,
+	CAPTURE_COUNT_ABORTED,
+	CAPTURE_COUNT_INFOONLY,
+} fwts_log_capture_count;
+
+enum {
+	CAPTURE_STR_STATUS = 0,
+	CAPTURE_STR_LABEL,
+	CAPTURE_STR_PREFIX,
+	CAPTURE_STR_MESSAGE,
+	CAPTURE_STRS
+};
+
+/*
+ *  Record header, followed by the strings it refers to
+ */
+typedef struct {
+	uint8_t		kind;			/* fwts_log_capture_kind */
+	uint8_t		count;			/* fwts_log_capture_count */
+	uint16_t	len[CAPTURE_STRS];	/* String lengths, or CAPTURE_NULL */
+	uint32_t	field;			/* fwts_log_field */
+	uint32_t	level;			/* fwts_log_level */
+} __attribute__ ((packed)) fwts_log_capture_record;
+
+static int	capture_fd = -1;
+static bool	capture_error;
+static size_t	capture_used;
+static uint8_t	capture_buf[CAPTURE_BUF_SIZE];
+
+/*
+ *  fwts_log_capture_active()
+ *	true if results are being captured rather than logged
+ */
+bool fwts_log_capture_active(void)
+{
+	return capture_fd != -1;
+}
+
+/*
+ *  fwts_log_capture_start()
+ *	capture all results and log output to fd
+ */
+void fwts_log_capture_start(const int fd)
+{
+	capture_fd = fd;
+	capture_error = false;
+	capture_used = 0;
+}
+
+/*
+ *  capture_flush()
+ *	write out buffered records
+ */
+static void capture_flush(void)
+{
+	size_t done = 0;
+
+	while (done < capture_used) {
+		const ssize_t n = write(capture_fd, capture_buf + done, capture_used - done);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			capture_error = true;
+			break;
+		}
+		done += (size_t)n;
+	}
+	capture_used = 0;
+}
+
+/*
+ *  fwts_log_capture_stop()
+ *	flush any buffered records and stop capturing
+ */
+int fwts_log_capture_stop(void)
+{
+	if (capture_fd == -1)
+		return FWTS_ERROR;
+
+	capture_flush();
+	capture_fd = -1;
+
+	return capture_error ? FWTS_ERROR : FWTS_OK;
+}
+
+/*
+ *  capture_record()
+ *	buffer a record, flushing when the buffer is full
+ */
+static void capture_record(
+	const fwts_log_capture_kind kind,
+	const fwts_log_capture_count count,
+	const fwts_log_field field,
+	const fwts_log_level level,
+	const char *strs[CAPTURE_STRS])
+{
+	fwts_log_capture_record rec;
+	size_t size = sizeof(rec);
+	int i;
+
+	rec.kind = kind;
+	rec.count = count;
+	rec.field = field;
+	rec.level = level;
+	for (i = 0; i < CAPTURE_STRS; i++) {
+		if (strs[i]) {
+			const size_t len = strlen(strs[i]);
+
+			rec.len[i] = len < CAPTURE_NULL ? len : CAPTURE_NULL - 1;
+			size += rec.len[i];
+		} else
+			rec.len[i] = CAPTURE_NULL;
+	}
+
+	if (capture_used + size > sizeof(capture_buf))
+		capture_flush();
+
+	memcpy(capture_buf + capture_used, &rec, sizeof(rec));
+	capture_used += sizeof(rec);
+	for (i = 0; i < CAPTURE_STRS; i++) {
+		if (rec.len[i] == CAPTURE_NULL)
+			continue;
+		memcpy(capture_buf + capture_used, strs[i], rec.len[i]);
+		capture_used += rec.len[i];
+	}
+}
+
+/*
+ *  fwts_log_capture_framework()
+ *	capture a fwts_framework_log() call
+ */
+void fwts_log_capture_framework(
+	fwts_framework *fw,
+	const fwts_log_field field,
+	const char *label,
+	const fwts_log_level level,
+	const uint32_t *count,
+	const char *buffer)
+{
+	fwts_log_capture_count counter = CAPTURE_COUNT_NONE;
+	const char *strs[CAPTURE_STRS] = { NULL, label, NULL, buffer };
+
+	if (count == &fw->minor_tests.passed)
+		counter = CAPTURE_COUNT_PASSED;
+	else if (count == &fw->minor_tests.failed)
+		counter = CAPTURE_COUNT_FAILED;
+	else if (count == &fw->minor_tests.warning)
+		counter = CAPTURE_COUNT_WARNING;
+	else if (count == &fw->minor_tests.skipped)
+		counter = CAPTURE_COUNT_SKIPPED;
+	else if (count == &fw->minor_tests.aborted)
+		counter = CAPTURE_COUNT_ABORTED;
+	else if (count == &fw->minor_tests.infoonly)
+		counter = CAPTURE_COUNT_INFOONLY;
+
+	capture_record(CAPTURE_FRAMEWORK, counter, field, level, strs);
+}
+
+/*
+ *  fwts_log_capture_printf()
+ *	capture a fwts_log_printf() call
+ */
+void fwts_log_capture_printf(
+	const fwts_framework *fw,
+	const fwts_log_field field,
+	const fwts_log_level level,
+	const char *status,
+	const char *label,
+	const char *prefix,
+	const char *buffer)
+{
+	const char *strs[CAPTURE_STRS] = { status, label, prefix, buffer };
+
+	FWTS_UNUSED(fw);
+
+	capture_record(CAPTURE_PRINTF, CAPTURE_COUNT_NONE, field, level, strs);
+}
+
+/*
+ *  fwts_log_capture_replay()
+ *	replay captured records into the results log and counters
+ */
+int fwts_log_capture_replay(fwts_framework *fw, const void *data, const size_t len)
+{
+	const uint8_t *ptr = data;
+	const uint8_t *end = ptr + len;
+
+	while (ptr + sizeof(fwts_log_capture_record) <= end) {
+		fwts_log_capture_record rec;
+		char *strs[CAPTURE_STRS];
+		uint32_t *count = NULL;
+		int i;
+
+		memcpy(&rec, ptr, sizeof(rec));
+		ptr += sizeof(rec);
+
+		for (i = 0; i < CAPTURE_STRS; i++) {
+			if (rec.len[i] == CAPTURE_NULL) {
+				strs[i] = NULL;
+				continue;
+			}
+			if (ptr + rec.len[i] > end ||
+			    (strs[i] = strndup((const char *)ptr, rec.len[i])) == NULL) {
+				while (--i >= 0)
+					free(strs[i]);
+				return FWTS_ERROR;
+			}
+			ptr += rec.len[i];
+		}
+
+		switch (rec.count) {
+		case CAPTURE_COUNT_PASSED:
+			count = &fw->minor_tests.passed;
+			break;
+		case CAPTURE_COUNT_FAILED:
+			count = &fw->minor_tests.failed;
+			break;
+		case CAPTURE_COUNT_WARNING:
+			count = &fw->minor_tests.warning;
+			break;
+		case CAPTURE_COUNT_SKIPPED:
+			count = &fw->minor_tests.skipped;
+			break;
+		case CAPTURE_COUNT_ABORTED:
+			count = &fw->minor_tests.aborted;
+			break;
+		case CAPTURE_COUNT_INFOONLY:
+			count = &fw->minor_tests.infoonly;
+			break;
+		default:
+			break;
+		}
+
+		if (rec.kind == CAPTURE_FRAMEWORK)
+			fwts_framework_log(fw, rec.field, strs[CAPTURE_STR_LABEL], rec.level,
+				count, strs[CAPTURE_STR_MESSAGE] ? "%s" : NULL,
+				strs[CAPTURE_STR_MESSAGE]);
+		else if (rec.kind == CAPTURE_PRINTF)
+			fwts_log_printf(fw, rec.field, rec.level,
+				strs[CAPTURE_STR_STATUS] ? strs[CAPTURE_STR_STATUS] : "",
+				strs[CAPTURE_STR_LABEL] ? strs[CAPTURE_STR_LABEL] : "",
+				strs[CAPTURE_STR_PREFIX] ? strs[CAPTURE_STR_PREFIX] : "",
+				"%s", strs[CAPTURE_STR_MESSAGE] ? strs[CAPTURE_STR_MESSAGE] : "");
+
+		for (i = 0; i < CAPTURE_STRS; i++)
+			free(strs[i]);
+	}
+
+	return ptr == end ? FWTS_OK : FWTS_ERROR;
+}
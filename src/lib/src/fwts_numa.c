@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "fwts.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+
+/*
+ *  The SLIT and HMAT matrix checks work on 64 bit words of packed
+ *  entries (8 x uint8_t or 4 x uint16_t) rather than on each entry
+ *  so that large matrices can be scanned quickly on any architecture.
+ *  Words are loaded little endian so that byte lane k is always
+ *  entry k of the word.
+ */
+#define LANES8_LO	(0x0101010101010101ULL)
+#define LANES8_HI	(0x8080808080808080ULL)
+#define LANES8_LOW7	(0x7f7f7f7f7f7f7f7fULL)
+#define LANES16_HI	(0x8000800080008000ULL)
+#define LANES16_LOW15	(0x7fff7fff7fff7fffULL)
+
+#define SLIT_LOCAL	(10)
+#define SLIT_UNREACHABLE (0xff)
+#define HMAT_UNREACHABLE (0xffff)
+
+static inline uint64_t load64(const void *ptr)
+{
+	uint64_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+	return le64toh(val);
+}
+
+/*
+ *  lanes8_nonzero()
+ *	top bit of each byte lane set if the byte is non-zero
+ */
+static inline uint64_t lanes8_nonzero(const uint64_t x)
+{
+	return (((x & LANES8_LOW7) + LANES8_LOW7) | x) & LANES8_HI;
+}
+
+/*
+ *  lanes8_less()
+ *	top bit of each byte lane set if the byte is less than val (val <= 128)
+ */
+static inline uint64_t lanes8_less(const uint64_t x, const uint8_t val)
+{
+	return ~((x | LANES8_HI) - (LANES8_LO * val)) & ~x & LANES8_HI;
+}
+
+/*
+ *  lanes8_mask()
+ *	compress the top bit of each byte lane into an 8 bit mask,
+ *	bit k being byte lane k
+ */
+static inline uint8_t lanes8_mask(const uint64_t hi)
+{
+	return (uint8_t)(((hi >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+/*
+ *  lanes16_mask()
+ *	compress the top bit of each 16 bit lane into a 4 bit mask
+ */
+static inline uint8_t lanes16_mask(const uint64_t hi)
+{
+	return (uint8_t)(((hi >> 15) * 0x0001000200040008ULL) >> 48) & 0xf;
+}
+
+/*
+ *  transpose8x8()
+ *	transpose an 8 x 8 matrix of bytes, one row per word
+ */
+static void transpose8x8(uint64_t r[8])
+{
+	static const uint64_t masks[3] = {
+		0x00ff00ff00ff00ffULL,
+		0x0000ffff0000ffffULL,
+		0x00000000ffffffffULL,
+	};
+	int s, i;
+
+	for (s = 0; s < 3; s++) {
+		const int stride = 1 << s;
+		const int shift = 8 << s;
+
+		for (i = 0; i < 8; i++) {
+			uint64_t t;
+
+			if (i & stride)
+				continue;
+			t = ((r[i] >> shift) ^ r[i + stride]) & masks[s];
+			r[i + stride] ^= t;
+			r[i] ^= t << shift;
+		}
+	}
+}
+
+/*
+ *  slit_set_mask()
+ *	set bits in a bitmap for 8 entries starting at [row][col]
+ */
+static void slit_set_mask(fwts_numa_bitmap *bitmap, const uint32_t row,
+	const uint32_t col, uint8_t mask)
+{
+	while (mask) {
+		const int bit = __builtin_ctz(mask);
+
+		fwts_numa_bitmap_set(bitmap, row, col + bit);
+		mask &= mask - 1;
+	}
+}
+
+/*
+ *  slit_check_row_word()
+ *	check 8 off diagonal (unless masked) entries of a row for
+ *	reserved and local distances
+ */
+static void slit_check_row_word(fwts_numa_bitmap bitmaps[FWTS_NUMA_SLIT_MAX],
+	const uint32_t row, const uint32_t col, const uint64_t x, const uint8_t diagonal)
+{
+	const uint8_t reserved = lanes8_mask(lanes8_less(x, SLIT_LOCAL)) & ~diagonal;
+	const uint8_t local = lanes8_mask(~lanes8_nonzero(x ^ (LANES8_LO * SLIT_LOCAL)) & LANES8_HI) & ~diagonal;
+
+	if (reserved)
+		slit_set_mask(&bitmaps[FWTS_NUMA_SLIT_RESERVED], row, col, reserved);
+	if (local)
+		slit_set_mask(&bitmaps[FWTS_NUMA_SLIT_LOCAL], row, col, local);
+}
+
+/*
+ *  slit_check_entry()
+ *	scalar check of [i][j] and, if i < j, the pair [i][j], [j][i]
+ */
+static void slit_check_entry(const uint8_t *matrix, const uint32_t n,
+	fwts_numa_bitmap bitmaps[FWTS_NUMA_SLIT_MAX], const uint32_t i, const uint32_t j)
+{
+	const uint8_t val1 = matrix[((uint64_t)i * n) + j];
+	const uint8_t val2 = matrix[((uint64_t)j * n) + i];
+
+	if (i == j)
+		return;
+	if (val1 < SLIT_LOCAL)
+		fwts_numa_bitmap_set(&bitmaps[FWTS_NUMA_SLIT_RESERVED], i, j);
+	else if (val1 == SLIT_LOCAL)
+		fwts_numa_bitmap_set(&bitmaps[FWTS_NUMA_SLIT_LOCAL], i, j);
+	if (i < j && val1 != val2) {
+		if ((val1 == SLIT_UNREACHABLE) || (val2 == SLIT_UNREACHABLE))
+			fwts_numa_bitmap_set(&bitmaps[FWTS_NUMA_SLIT_UNREACHABLE], i, j);
+		else
+			fwts_numa_bitmap_set(&bitmaps[FWTS_NUMA_SLIT_ASYMMETRIC], i, j);
+	}
+}
+
+/*
+ *  fwts_numa_slit_check_matrix()
+ *	check a n x n SLIT distance matrix, setting a bit in the
+ *	bitmap of each violation class for each offending entry.
+ *	Full 8 x 8 tiles [I][J] and [J][I] (J >= I) are checked
+ *	together a row word at a time, the remaining edge entries
+ *	are checked one at a time.
+ */
+int fwts_numa_slit_check_matrix(
+	const uint8_t *matrix,
+	const uint32_t n,
+	fwts_numa_bitmap bitmaps[FWTS_NUMA_SLIT_MAX])
+{
+	const uint32_t tiles = n / 8;
+	const uint32_t edge = tiles * 8;
+	uint32_t ti, tj, i, j;
+
+	for (i = 0; i < FWTS_NUMA_SLIT_MAX; i++) {
+		if (fwts_numa_bitmap_init(&bitmaps[i], n, n) != FWTS_OK) {
+			while (i--)
+				fwts_numa_bitmap_free(&bitmaps[i]);
+			return FWTS_ERROR;
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		if (matrix[((uint64_t)i * n) + i] != SLIT_LOCAL)
+			fwts_numa_bitmap_set(&bitmaps[FWTS_NUMA_SLIT_DIAGONAL], i, i);
+
+	for (ti = 0; ti < tiles; ti++) {
+		for (tj = ti; tj < tiles; tj++) {
+			uint64_t a[8], b[8];
+			const uint32_t row = ti * 8, col = tj * 8;
+			int r;
+
+			for (r = 0; r < 8; r++) {
+				a[r] = load64(matrix + ((uint64_t)(row + r) * n) + col);
+				b[r] = load64(matrix + ((uint64_t)(col + r) * n) + row);
+			}
+
+			for (r = 0; r < 8; r++) {
+				const uint8_t diagonal = (ti == tj) ? (1 << r) : 0;
+
+				slit_check_row_word(bitmaps, row + r, col, a[r], diagonal);
+				if (ti != tj)
+					slit_check_row_word(bitmaps, col + r, row, b[r], 0);
+			}
+
+			transpose8x8(b);
+
+			for (r = 0; r < 8; r++) {
+				const uint64_t ff_a = ~lanes8_nonzero(~a[r]) & LANES8_HI;
+				const uint64_t ff_b = ~lanes8_nonzero(~b[r]) & LANES8_HI;
+				/* only the upper triangle of diagonal tiles */
+				const uint8_t upper = (ti == tj) ? (uint8_t)(0xff << (r + 1)) : 0xff;
+
+				uint8_t mask, unreachable;
+
+				mask = lanes8_mask(lanes8_nonzero(a[r] ^ b[r])) & upper;
+				if (!mask)
+					continue;
+				unreachable = mask & lanes8_mask(ff_a ^ ff_b);
+				mask &= ~unreachable;
+				if (mask)
+					slit_set_mask(&bitmaps[FWTS_NUMA_SLIT_ASYMMETRIC], row + r, col, mask);
+				if (unreachable)
+					slit_set_mask(&bitmaps[FWTS_NUMA_SLIT_UNREACHABLE], row + r, col, unreachable);
+			}
+		}
+	}
+
+	/* Entries not covered by a full tile */
+	for (i = 0; i < n; i++) {
+		for (j = (i < edge) ? edge : 0; j < n; j++)
+			slit_check_entry(matrix, n, bitmaps, i, j);
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_numa_hmat_unreachable()
+ *	set a bit in the bitmap for each 0xffff (unreachable) entry of
+ *	a rows x cols HMAT latency or bandwidth matrix
+ */
+int fwts_numa_hmat_unreachable(
+	const uint16_t *matrix,
+	const uint32_t rows,
+	const uint32_t cols,
+	fwts_numa_bitmap *bitmap)
+{
+	uint32_t i, j;
+
+	if (fwts_numa_bitmap_init(bitmap, rows, cols) != FWTS_OK)
+		return FWTS_ERROR;
+
+	for (i = 0; i < rows; i++) {
+		const uint16_t *row = matrix + ((uint64_t)i * cols);
+
+		for (j = 0; j + 4 <= cols; j += 4) {
+			const uint64_t x = ~load64(row + j);
+			uint8_t mask;
+
+			/* top bit of each 16 bit lane set if entry is 0xffff */
+			mask = lanes16_mask(~((((x & LANES16_LOW15) + LANES16_LOW15) | x)) & LANES16_HI);
+			while (mask) {
+				fwts_numa_bitmap_set(bitmap, i, j + __builtin_ctz(mask));
+				mask &= mask - 1;
+			}
+		}
+		for (; j < cols; j++) {
+			uint16_t val;
+
+			memcpy(&val, row + j, sizeof(val));
+			if (val == HMAT_UNREACHABLE)
+				fwts_numa_bitmap_set(bitmap, i, j);
+		}
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_numa_bitmap_init()
+ *	allocate a zeroed rows x cols bitmap
+ */
+int fwts_numa_bitmap_init(fwts_numa_bitmap *bitmap, const uint32_t rows, const uint32_t cols)
+{
+	bitmap->rows = rows;
+	bitmap->cols = cols;
+	bitmap->words_per_row = (cols + 63) / 64;
+	bitmap->count = 0;
+	bitmap->bits = calloc(((size_t)rows * bitmap->words_per_row) + 1, sizeof(uint64_t));
+
+	return bitmap->bits ? FWTS_OK : FWTS_ERROR;
+}
+
+/*
+ *  fwts_numa_bitmap_free()
+ *	free a bitmap
+ */
+void fwts_numa_bitmap_free(fwts_numa_bitmap *bitmap)
+{
+	free(bitmap->bits);
+	bitmap->bits = NULL;
+	bitmap->count = 0;
+}
+
+/*
+ *  fwts_numa_bitmap_runs()
+ *	call func for each run of adjacent set bits in each row of the
+ *	bitmap, up to max_runs runs, all zero words are skipped. Returns
+ *	the total number of runs, including those not reported.
+ */
+uint32_t fwts_numa_bitmap_runs(
+	fwts_framework *fw,
+	const fwts_numa_bitmap *bitmap,
+	const uint32_t max_runs,
+	fwts_numa_run_func func,
+	void *private)
+{
+	uint32_t row, runs = 0;
+
+	if (!bitmap->count)
+		return 0;
+
+	for (row = 0; row < bitmap->rows; row++) {
+		const uint64_t *words = bitmap->bits + ((uint64_t)row * bitmap->words_per_row);
+		uint32_t w;
+		bool in_run = false;
+		uint32_t first = 0;
+
+		for (w = 0; w < bitmap->words_per_row; w++) {
+			uint64_t word = words[w];
+			uint32_t bit = 0;
+
+			if (!in_run && !word)
+				continue;
+			if (in_run && word == ~0ULL)
+				continue;
+
+			while (bit < 64) {
+				if (!in_run) {
+					if (!(word >> bit))
+						break;
+					bit += __builtin_ctzll(word >> bit);
+					first = (w * 64) + bit;
+					in_run = true;
+				} else {
+					const uint64_t rest = ~word >> bit;
+
+					if (!rest)
+						break;
+					bit += __builtin_ctzll(rest);
+					if (runs++ < max_runs)
+						func(fw, row, first, (w * 64) + bit - 1, private);
+					in_run = false;
+				}
+			}
+		}
+		if (in_run) {
+			if (runs++ < max_runs)
+				func(fw, row, first, bitmap->cols - 1, private);
+		}
+	}
+
+	return runs;
+}
+
+static int fwts_numa_domain_cmp(const void *a, const void *b)
+{
+	const fwts_numa_domain *d1 = (const fwts_numa_domain *)a;
+	const fwts_numa_domain *d2 = (const fwts_numa_domain *)b;
+
+	if (d1->domain < d2->domain)
+		return -1;
+	return d1->domain > d2->domain;
+}
+
+/*
+ *  fwts_numa_domain_find()
+ *	find a proximity domain in a list returned by fwts_numa_srat_domains
+ */
+fwts_numa_domain *fwts_numa_domain_find(
+	fwts_numa_domain *domains,
+	const uint32_t count,
+	const uint32_t domain)
+{
+	fwts_numa_domain key = { .domain = domain };
+
+	return bsearch(&key, domains, count, sizeof(*domains), fwts_numa_domain_cmp);
+}
+
+/*
+ *  fwts_numa_srat_domains()
+ *	gather the proximity domains of the enabled SRAT entries into a
+ *	sorted list of unique domains. Returns FWTS_ERROR if there is no
+ *	SRAT or it cannot be parsed, the list must be freed by the caller.
+ */
+int fwts_numa_srat_domains(
+	fwts_framework *fw,
+	fwts_numa_domain **domains,
+	uint32_t *count)
+{
+	fwts_acpi_table_info *table;
+	fwts_numa_domain *list;
+	const uint8_t *data;
+	size_t offset, max;
+	uint32_t i, n = 0;
+	uint8_t revision;
+
+	*domains = NULL;
+	*count = 0;
+
+	if (fwts_acpi_find_table(fw, "SRAT", 0, &table) != FWTS_OK ||
+	    table == NULL ||
+	    table->length < sizeof(fwts_acpi_table_srat))
+		return FWTS_ERROR;
+
+	data = (const uint8_t *)table->data;
+	revision = ((const fwts_acpi_table_header *)data)->revision;
+
+	/* Each SRAT entry is at least 10 bytes long */
+	max = (table->length - sizeof(fwts_acpi_table_srat)) / 10;
+	if (!max)
+		return FWTS_OK;
+	list = calloc(max, sizeof(*list));
+	if (!list)
+		return FWTS_ERROR;
+
+	offset = sizeof(fwts_acpi_table_srat);
+	while (offset + 2 <= table->length) {
+		const uint8_t type = data[offset];
+		const uint8_t length = data[offset + 1];
+		const void *entry = data + offset;
+		uint32_t domain, flags;
+		bool memory = false, initiator = false;
+
+		if (length < 2 || offset + length > table->length)
+			break;
+
+		switch (type) {
+		case 0:
+			if (length < sizeof(fwts_acpi_table_local_apic_sapic_affinity))
+				goto next;
+			{
+				const fwts_acpi_table_local_apic_sapic_affinity *a = entry;
+
+				domain = a->proximity_domain_0;
+				/* Domain bits 8..31 are reserved in revision 1 */
+				if (revision >= 2)
+					domain |= (a->proximity_domain_1 << 8) |
+						  (a->proximity_domain_2 << 16) |
+						  ((uint32_t)a->proximity_domain_3 << 24);
+				flags = a->flags;
+				initiator = true;
+			}
+			break;
+		case 1:
+			if (length < sizeof(fwts_acpi_table_memory_affinity))
+				goto next;
+			{
+				const fwts_acpi_table_memory_affinity *a = entry;
+
+				domain = a->proximity_domain;
+				if (revision < 2)
+					domain &= 0xff;
+				flags = a->flags;
+				memory = true;
+			}
+			break;
+		case 2:
+			if (length < sizeof(fwts_acpi_table_local_x2apic_affinity))
+				goto next;
+			domain = ((const fwts_acpi_table_local_x2apic_affinity *)entry)->proximity_domain;
+			flags = ((const fwts_acpi_table_local_x2apic_affinity *)entry)->flags;
+			initiator = true;
+			break;
+		case 3:
+			if (length < sizeof(fwts_acpi_table_gicc_affinity))
+				goto next;
+			domain = ((const fwts_acpi_table_gicc_affinity *)entry)->proximity_domain;
+			flags = ((const fwts_acpi_table_gicc_affinity *)entry)->flags;
+			initiator = true;
+			break;
+		case 4:
+			/* ITS affinity has no flags, always enabled */
+			if (length < sizeof(fwts_acpi_table_its_affinity))
+				goto next;
+			domain = ((const fwts_acpi_table_its_affinity *)entry)->proximity_domain;
+			flags = 1;
+			break;
+		case 5:
+			if (length < sizeof(fwts_acpi_table_initiator_affinity))
+				goto next;
+			domain = ((const fwts_acpi_table_initiator_affinity *)entry)->proximity_domain;
+			flags = ((const fwts_acpi_table_initiator_affinity *)entry)->flags;
+			initiator = true;
+			break;
+		case 6:
+			if (length < sizeof(fwts_acpi_table_port_affinity))
+				goto next;
+			domain = ((const fwts_acpi_table_port_affinity *)entry)->proximity_domain;
+			flags = ((const fwts_acpi_table_port_affinity *)entry)->flags;
+			break;
+		default:
+			goto next;
+		}
+
+		/* Bit 0 is the enabled flag for all entry types */
+		if ((flags & 1) && n < max) {
+			list[n].domain = domain;
+			list[n].memory = memory;
+			list[n].initiator = initiator;
+			n++;
+		}
+next:
+		offset += length;
+	}
+
+	qsort(list, n, sizeof(*list), fwts_numa_domain_cmp);
+
+	/* Merge duplicate domains */
+	for (i = 0, *count = 0; i < n; i++) {
+		if (*count && list[*count - 1].domain == list[i].domain) {
+			list[*count - 1].memory |= list[i].memory;
+			list[*count - 1].initiator |= list[i].initiator;
+		} else {
+			list[(*count)++] = list[i];
+		}
+	}
+	*domains = list;
+
+	return FWTS_OK;
+}
@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "fwts.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FWTS_RANGE_INDEX_INITIAL_SIZE	(64)
+
+/*
+ *  fwts_range_index_new()
+ *	create an empty address range index
+ */
+fwts_range_index *fwts_range_index_new(void)
+{
+	return calloc(1, sizeof(fwts_range_index));
+}
+
+/*
+ *  fwts_range_index_free()
+ *	free an address range index
+ */
+void fwts_range_index_free(fwts_range_index *index)
+{
+	if (index) {
+		free(index->ranges);
+		free(index->max_last);
+		free(index);
+	}
+}
+
+/*
+ *  fwts_range_index_add_range()
+ *	add the range [start..last], the index needs rebuilding
+ *	before it can be queried again
+ */
+static int fwts_range_index_add_range(
+	fwts_range_index *index,
+	const uint64_t start,
+	const uint64_t last,
+	const fwts_range_source source,
+	const int type,
+	const uint32_t domain,
+	const uint32_t id)
+{
+	fwts_range *range;
+
+	if (index->count == index->size) {
+		const size_t size = index->size ? index->size * 2 : FWTS_RANGE_INDEX_INITIAL_SIZE;
+		fwts_range *ranges;
+
+		ranges = realloc(index->ranges, size * sizeof(*ranges));
+		if (!ranges)
+			return FWTS_ERROR;
+		index->ranges = ranges;
+		index->size = size;
+	}
+
+	range = &index->ranges[index->count++];
+	range->start = start;
+	range->last = last;
+	range->source = source;
+	range->type = type;
+	range->domain = domain;
+	range->id = id;
+	index->built = false;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_range_index_add()
+ *	add a range of length bytes at start, zero length ranges are
+ *	ignored and ranges wrapping past the top of the address space
+ *	are clipped
+ */
+int fwts_range_index_add(
+	fwts_range_index *index,
+	const uint64_t start,
+	const uint64_t length,
+	const fwts_range_source source,
+	const int type,
+	const uint32_t domain,
+	const uint32_t id)
+{
+	uint64_t last;
+
+	if (!length)
+		return FWTS_OK;
+
+	last = start + (length - 1);
+	if (last < start)
+		last = UINT64_MAX;
+
+	return fwts_range_index_add_range(index, start, last, source, type, domain, id);
+}
+
+/*
+ *  fwts_range_index_add_memory_map()
+ *	add the entries of a memory map list from fwts_memory_map_table_load()
+ */
+int fwts_range_index_add_memory_map(fwts_range_index *index, fwts_list *memory_map_list)
+{
+	fwts_list_link *item;
+	uint32_t id = 0;
+
+	if (!memory_map_list)
+		return FWTS_OK;
+
+	fwts_list_foreach(item, memory_map_list) {
+		fwts_memory_map_entry *entry = fwts_list_data(fwts_memory_map_entry *, item);
+
+		/* memmap and kernel log end addresses are inclusive */
+		if (entry->end_address >= entry->start_address &&
+		    fwts_range_index_add_range(index, entry->start_address,
+			entry->end_address, FWTS_RANGE_MEMORY_MAP,
+			entry->type, 0, id) != FWTS_OK)
+			return FWTS_ERROR;
+		id++;
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_range_index_add_srat()
+ *	add the enabled SRAT memory affinity ranges
+ */
+static int fwts_range_index_add_srat(fwts_framework *fw, fwts_range_index *index)
+{
+	fwts_acpi_table_info *table;
+	size_t offset;
+	uint32_t id = 0;
+
+	if (fwts_acpi_find_table(fw, "SRAT", 0, &table) != FWTS_OK || !table)
+		return FWTS_OK;
+
+	for (offset = sizeof(fwts_acpi_table_srat); offset + 2 <= table->length;) {
+		const uint8_t *data = (const uint8_t *)table->data + offset;
+		const fwts_acpi_table_memory_affinity *entry;
+
+		if (data[1] < 2 || offset + data[1] > table->length)
+			break;
+		offset += data[1];
+		if (data[0] != 1 || data[1] < sizeof(*entry))
+			continue;
+
+		entry = (const fwts_acpi_table_memory_affinity *)data;
+		/* Only enabled entries describe memory */
+		if (entry->flags & 1) {
+			const uint64_t base = ((uint64_t)entry->base_addr_hi << 32) | entry->base_addr_lo;
+			const uint64_t length = ((uint64_t)entry->length_hi << 32) | entry->length_lo;
+
+			if (fwts_range_index_add(index, base, length, FWTS_RANGE_SRAT,
+			    0, entry->proximity_domain, id) != FWTS_OK)
+				return FWTS_ERROR;
+		}
+		id++;
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_range_index_add_cedt()
+ *	add the CEDT CXL fixed memory windows
+ */
+static int fwts_range_index_add_cedt(fwts_framework *fw, fwts_range_index *index)
+{
+	fwts_acpi_table_info *table;
+	size_t offset;
+	uint32_t id = 0;
+
+	if (fwts_acpi_find_table(fw, "CEDT", 0, &table) != FWTS_OK || !table)
+		return FWTS_OK;
+
+	for (offset = sizeof(fwts_acpi_table_cedt);
+	     offset + sizeof(fwts_acpi_table_cedt_header) <= table->length;) {
+		const fwts_acpi_table_cedt_header *header =
+			(const fwts_acpi_table_cedt_header *)((const uint8_t *)table->data + offset);
+		const fwts_acpi_table_cedt_cfmws *entry;
+
+		if (header->record_length < sizeof(*header) ||
+		    offset + header->record_length > table->length)
+			break;
+		offset += header->record_length;
+		if (header->type != FWTS_CEDT_TYPE_CFMWS ||
+		    header->record_length < sizeof(*entry))
+			continue;
+
+		entry = (const fwts_acpi_table_cedt_cfmws *)header;
+		if (fwts_range_index_add(index, entry->base_hpa, entry->window_size,
+		    FWTS_RANGE_CEDT_CFMWS, 0, 0, id++) != FWTS_OK)
+			return FWTS_ERROR;
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_range_index_add_nfit()
+ *	add the NFIT system physical address ranges
+ */
+static int fwts_range_index_add_nfit(fwts_framework *fw, fwts_range_index *index)
+{
+	fwts_acpi_table_info *table;
+	size_t offset;
+
+	if (fwts_acpi_find_table(fw, "NFIT", 0, &table) != FWTS_OK || !table)
+		return FWTS_OK;
+
+	for (offset = sizeof(fwts_acpi_table_nfit);
+	     offset + sizeof(fwts_acpi_table_nfit_struct_header) <= table->length;) {
+		const fwts_acpi_table_nfit_struct_header *header =
+			(const fwts_acpi_table_nfit_struct_header *)((const uint8_t *)table->data + offset);
+		const fwts_acpi_table_nfit_system_memory *entry;
+
+		if (header->length < sizeof(*header) ||
+		    offset + header->length > table->length)
+			break;
+		offset += header->length;
+		if (header->type != FWTS_NFIT_TYPE_SYSTEM_ADDRESS ||
+		    header->length < FWTS_NFIT_MINLEN_SYSTEM_ADDRESS)
+			continue;
+
+		entry = (const fwts_acpi_table_nfit_system_memory *)header;
+		if (fwts_range_index_add(index, entry->address, entry->length,
+		    FWTS_RANGE_NFIT_SPA, 0, entry->proximity_domain,
+		    entry->range_index) != FWTS_OK)
+			return FWTS_ERROR;
+	}
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_range_index_add_acpi()
+ *	add the SRAT memory affinity, CEDT CFMWS and NFIT SPA ranges
+ */
+int fwts_range_index_add_acpi(fwts_framework *fw, fwts_range_index *index)
+{
+	if (fwts_range_index_add_srat(fw, index) != FWTS_OK ||
+	    fwts_range_index_add_cedt(fw, index) != FWTS_OK ||
+	    fwts_range_index_add_nfit(fw, index) != FWTS_OK)
+		return FWTS_ERROR;
+
+	return FWTS_OK;
+}
+
+static int fwts_range_compare(const void *a, const void *b)
+{
+	const fwts_range *r1 = (const fwts_range *)a;
+	const fwts_range *r2 = (const fwts_range *)b;
+
+	if (r1->start != r2->start)
+		return r1->start < r2->start ? -1 : 1;
+	if (r1->last != r2->last)
+		return r1->last < r2->last ? -1 : 1;
+	if (r1->source != r2->source)
+		return r1->source < r2->source ? -1 : 1;
+	return (r1->id > r2->id) - (r1->id < r2->id);
+}
+
+/*
+ *  fwts_range_index_max()
+ *	fill in the highest last address of each subtree [lo..hi)
+ */
+static uint64_t fwts_range_index_max(fwts_range_index *index, const size_t lo, const size_t hi)
+{
+	size_t mid;
+	uint64_t max, tmp;
+
+	if (lo >= hi)
+		return 0;
+
+	mid = lo + (hi - lo) / 2;
+	max = index->ranges[mid].last;
+	tmp = fwts_range_index_max(index, lo, mid);
+	if (tmp > max)
+		max = tmp;
+	tmp = fwts_range_index_max(index, mid + 1, hi);
+	if (tmp > max)
+		max = tmp;
+	index->max_last[mid] = max;
+
+	return max;
+}
+
+/*
+ *  fwts_range_index_build()
+ *	sort the ranges and build the index, O(n log n)
+ */
+int fwts_range_index_build(fwts_range_index *index)
+{
+	uint64_t *max_last;
+
+	if (index->built)
+		return FWTS_OK;
+
+	max_last = realloc(index->max_last, (index->count + 1) * sizeof(*max_last));
+	if (!max_last)
+		return FWTS_ERROR;
+	index->max_last = max_last;
+
+	if (index->count)
+		qsort(index->ranges, index->count, sizeof(*index->ranges), fwts_range_compare);
+	fwts_range_index_max(index, 0, index->count);
+	index->built = true;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_range_index_find()
+ *	find the lowest addressed range containing address, O(log n).
+ *	Returns NULL if no range contains the address.
+ */
+const fwts_range *fwts_range_index_find(const fwts_range_index *index, const uint64_t address)
+{
+	size_t lo = 0, hi = index->count;
+
+	if (!index->built)
+		return NULL;
+
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		const size_t left = lo + (mid - lo) / 2;
+
+		/*
+		 *  If any range on the left reaches the address, either
+		 *  one on the left contains it or, as all ranges on the
+		 *  right start even higher, none does.
+		 */
+		if (mid > lo && index->max_last[left] >= address) {
+			hi = mid;
+			continue;
+		}
+		if (index->ranges[mid].start > address)
+			return NULL;
+		if (index->ranges[mid].last >= address)
+			return &index->ranges[mid];
+		lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+static size_t fwts_range_index_visit(
+	const fwts_range_index *index,
+	const size_t lo,
+	const size_t hi,
+	const uint64_t start,
+	const uint64_t last,
+	fwts_range_func func,
+	void *private)
+{
+	size_t mid, count;
+
+	if (lo >= hi)
+		return 0;
+	mid = lo + (hi - lo) / 2;
+	if (index->max_last[mid] < start)
+		return 0;
+
+	count = fwts_range_index_visit(index, lo, mid, start, last, func, private);
+	if (index->ranges[mid].start > last)
+		return count;
+	if (index->ranges[mid].last >= start) {
+		if (func)
+			func(&index->ranges[mid], private);
+		count++;
+	}
+
+	return count + fwts_range_index_visit(index, mid + 1, hi, start, last, func, private);
+}
+
+/*
+ *  fwts_range_index_query()
+ *	call func (if not NULL) for each range overlapping [start..last]
+ *	in address order, O(log n + matches). Returns the number of
+ *	overlapping ranges.
+ */
+size_t fwts_range_index_query(
+	const fwts_range_index *index,
+	const uint64_t start,
+	const uint64_t last,
+	fwts_range_func func,
+	void *private)
+{
+	if (!index->built || start > last)
+		return 0;
+
+	return fwts_range_index_visit(index, 0, index->count, start, last, func, private);
+}
+
+/*
+ *  fwts_range_index_overlaps()
+ *	call func (if not NULL) for each pair of overlapping ranges,
+ *	O(n log n + pairs). Returns the number of overlapping pairs.
+ */
+size_t fwts_range_index_overlaps(
+	const fwts_range_index *index,
+	fwts_range_pair_func func,
+	void *private)
+{
+	size_t i, j, pairs = 0;
+
+	if (!index->built)
+		return 0;
+
+	/* Sorted on start, so only later ranges starting before the end can overlap */
+	for (i = 0; i < index->count; i++) {
+		for (j = i + 1; j < index->count &&
+		     index->ranges[j].start <= index->ranges[i].last; j++) {
+			if (func)
+				func(&index->ranges[i], &index->ranges[j], private);
+			pairs++;
+		}
+	}
+
+	return pairs;
+}
+
+/*
+ *  fwts_range_source_name()
+ *	name of the table or map a range came from
+ */
+const char *fwts_range_source_name(const fwts_range_source source)
+{
+	switch (source) {
+	case FWTS_RANGE_MEMORY_MAP:
+		return "memory map";
+	case FWTS_RANGE_SRAT:
+		return "SRAT memory affinity";
+	case FWTS_RANGE_CEDT_CFMWS:
+		return "CEDT CFMWS";
+	case FWTS_RANGE_NFIT_SPA:
+		return "NFIT SPA range";
+	default:
+		return "other";
+	}
+}
@@ -29,11 +29,14 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <string.h>
+#include <bsd/string.h>
 #include <sys/ioctl.h>
+#include <pthread.h>
 
 #include "fwts.h"
 #include "fwts_uefi.h"
 #include "fwts_efi_runtime.h"
+#include "fwts_efi_module.h"
 
 /* Old sysfs uefi packed binary blob variables */
 typedef struct {
@@ -63,11 +66,26 @@ typedef struct {
 #define UEFI_IFACE_SYSFS		(2)	/* sysfs */
 #define UEFI_IFACE_EFIVARS		(3)	/* efivar fs */
 
+/* Threads reading variables in fwts_uefi_get_variables() */
+#define UEFI_READ_THREADS	(8)
+#define UEFI_ARENA_ALIGN(n)	(((n) + 7) & ~(size_t)7)	/* Keep variable data aligned */
+
+typedef struct {
+	char		**names;		/* efivarfs or sysfs file names */
+	fwts_uefi_var	*vars;
+	bool		*ok;			/* Variable was read */
+	size_t		count;
+	size_t		next;			/* Next name to read, atomic */
+} fwts_uefi_read_pool;
+
 /* File system magic numbers */
 #define PSTOREFS_MAGIC          ((__SWORD_TYPE)0x6165676C)
 #define EFIVARFS_MAGIC          ((__SWORD_TYPE)0xde5e81e4)
 #define SYS_FS_MAGIC		((__SWORD_TYPE)0x62656572)
 
+static int  efivars_interface = UEFI_IFACE_UNKNOWN;	/* Discovered interface */
+static char efivar_path[4096];				/* and its mount point */
+
 /*
  *  fwts_uefi_get_interface()
  *	find which type of EFI variable file system we are using,
@@ -76,9 +94,6 @@ typedef struct {
  */
 static int fwts_uefi_get_interface(char **path)
 {
-	static int  efivars_interface = UEFI_IFACE_UNKNOWN;
-	static char efivar_path[4096];
-
 	FILE *fp;
 	struct statfs statbuf;
 
@@ -145,6 +160,22 @@ static int fwts_uefi_get_interface(char **path)
 	return UEFI_IFACE_UNKNOWN;
 }
 
+/*
+ *  fwts_uefi_set_efivars_path()
+ *	use the efivarfs formatted directory path instead of the
+ *	mounted file system, NULL goes back to looking for the mount
+ */
+void fwts_uefi_set_efivars_path(const char *path)
+{
+	if (path) {
+		(void)strlcpy(efivar_path, path, sizeof(efivar_path));
+		efivars_interface = UEFI_IFACE_EFIVARS;
+	} else {
+		*efivar_path = '\0';
+		efivars_interface = UEFI_IFACE_UNKNOWN;
+	}
+}
+
 /*
  *  fwts_uefi_str_to_str16()
  *	convert 8 bit C string to 16 bit string.
@@ -429,6 +460,144 @@ int fwts_uefi_get_variable_names(fwts_list *list)
         return ret;
 }
 
+/*
+ *  fwts_uefi_read_worker()
+ *	read variables until there are none left.  The kernel still
+ *	makes one firmware call at a time, but the open, stat, read
+ *	and copying of each variable overlap with the others
+ */
+static void *fwts_uefi_read_worker(void *arg)
+{
+	fwts_uefi_read_pool *pool = (fwts_uefi_read_pool *)arg;
+
+	for (;;) {
+		const size_t i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+
+		if (i >= pool->count)
+			break;
+		pool->ok[i] = (fwts_uefi_get_variable(pool->names[i], &pool->vars[i]) == FWTS_OK);
+	}
+	return NULL;
+}
+
+/*
+ *  fwts_uefi_free_variables()
+ *	free the variables fetched by fwts_uefi_get_variables
+ */
+void fwts_uefi_free_variables(fwts_uefi_var_set *set)
+{
+	free(set->vars);
+	free(set->arena);
+	set->vars = NULL;
+	set->arena = NULL;
+	set->count = 0;
+}
+
+/*
+ *  fwts_uefi_get_variables()
+ *	fetch all the UEFI variables, reading them with a small pool of
+ *	threads.  Variables that cannot be read are left out, the rest
+ *	are returned in the order fwts_uefi_get_variable_names() lists
+ *	them with their names and data in one arena, free with
+ *	fwts_uefi_free_variables.
+ */
+int fwts_uefi_get_variables(fwts_uefi_var_set *set)
+{
+	fwts_uefi_read_pool pool;
+	pthread_t tids[UEFI_READ_THREADS];
+	fwts_list name_list;
+	fwts_list_link *item;
+	size_t i, n, nthreads, arena_size = 0;
+	uint8_t *ptr;
+	int ret = FWTS_ERROR;
+
+	memset(set, 0, sizeof(*set));
+	memset(&pool, 0, sizeof(pool));
+
+	if (fwts_uefi_get_variable_names(&name_list) != FWTS_OK)
+		return FWTS_ERROR;
+
+	pool.count = fwts_list_len(&name_list);
+	if (pool.count == 0) {
+		fwts_uefi_free_variable_names(&name_list);
+		return FWTS_OK;
+	}
+
+	pool.names = calloc(pool.count, sizeof(*pool.names));
+	pool.vars = calloc(pool.count, sizeof(*pool.vars));
+	pool.ok = calloc(pool.count, sizeof(*pool.ok));
+	if (!pool.names || !pool.vars || !pool.ok)
+		goto free_pool;
+
+	i = 0;
+	fwts_list_foreach(item, &name_list)
+		pool.names[i++] = fwts_list_data(char *, item);
+
+	/* Fall back to reading in this thread if none can be started */
+	nthreads = pool.count < UEFI_READ_THREADS ? pool.count : UEFI_READ_THREADS;
+	for (n = 0; n < nthreads; n++)
+		if (pthread_create(&tids[n], NULL, fwts_uefi_read_worker, &pool) != 0)
+			break;
+	if (n == 0)
+		(void)fwts_uefi_read_worker(&pool);
+	for (i = 0; i < n; i++)
+		(void)pthread_join(tids[i], NULL);
+
+	/* Gather the names and data of the variables read into the arena,
+	   keeping the order of the names */
+	for (i = 0; i < pool.count; i++) {
+		if (!pool.ok[i])
+			continue;
+		arena_size += UEFI_ARENA_ALIGN(pool.vars[i].datalen);
+		arena_size += UEFI_ARENA_ALIGN((fwts_uefi_str16len(pool.vars[i].varname) + 1) * sizeof(uint16_t));
+		set->count++;
+	}
+	if (set->count == 0) {
+		ret = FWTS_OK;
+		goto free_pool;
+	}
+
+	set->vars = calloc(set->count, sizeof(*set->vars));
+	set->arena = malloc(arena_size ? arena_size : 1);
+	if (!set->vars || !set->arena) {
+		fwts_uefi_free_variables(set);
+		goto free_pool;
+	}
+
+	ptr = set->arena;
+	for (i = 0, n = 0; i < pool.count; i++) {
+		fwts_uefi_var *var = &set->vars[n];
+		size_t len;
+
+		if (!pool.ok[i])
+			continue;
+
+		*var = pool.vars[i];
+		if (var->datalen)
+			memcpy(ptr, pool.vars[i].data, var->datalen);
+		var->data = ptr;
+		ptr += UEFI_ARENA_ALIGN(var->datalen);
+		len = (fwts_uefi_str16len(pool.vars[i].varname) + 1) * sizeof(uint16_t);
+		memcpy(ptr, pool.vars[i].varname, len);
+		var->varname = (uint16_t *)ptr;
+		ptr += UEFI_ARENA_ALIGN(len);
+		n++;
+	}
+	ret = FWTS_OK;
+
+free_pool:
+	if (pool.vars && pool.ok)
+		for (i = 0; i < pool.count; i++)
+			if (pool.ok[i])
+				fwts_uefi_free_variable(&pool.vars[i]);
+	free(pool.ok);
+	free(pool.vars);
+	free(pool.names);
+	fwts_uefi_free_variable_names(&name_list);
+
+	return ret;
+}
+
 static const uefistatus_info uefistatus_info_table[] = {
 	{ EFI_SUCCESS,			"EFI_SUCCESS",			"The operation completed successfully." },
 	{ EFI_LOAD_ERROR,		"EFI_LOAD_ERROR",		"The image failed to load." },
@@ -554,7 +723,7 @@ void fwts_uefi_rt_support_status_get(int fd, uint32_t *rtservicessupported)
 {
 	long ioret;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_SUPPORTED_MASK, rtservicessupported);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_SUPPORTED_MASK, rtservicessupported);
 	if (ioret == -1)
 		*rtservicessupported = EFI_RT_SUPPORTED_ALL;
 
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/stat.h>
@@ -44,6 +45,7 @@
 #include "acdebug.h"
 #include "actables.h"
 #include "acinterp.h"
+#include "acdispat.h"
 #include "acapps.h"
 #include "amlresrc.h"
 #include "aecommon.h"
@@ -51,7 +53,8 @@
 #define ACPI_MAX_INIT_TABLES		(64)	/* Number of ACPI tables */
 
 #define MAX_SEMAPHORES			(2048)	/* For semaphore tracking */
-#define MAX_THREADS			(128)	/* For thread tracking */
+#define MAX_EXECUTE_WORKERS		(8)	/* AcpiOsExecute worker threads */
+#define MAX_EXECUTE_QUEUE		(1024)	/* AcpiOsExecute pending calls */
 
 #define MAX_WAIT_TIMEOUT		(20)	/* Seconds */
 
@@ -63,19 +66,18 @@
  */
 typedef struct {
 	sem_t		sem;	/* Semaphore handle */
-	int		count;	/* count > 0 if acquired */
+	int		count;	/* count > 0 if acquired, updated atomically */
 	bool		used;	/* Semaphore being used flag */
+	bool		dirty;	/* In sem_dirty, count may be non-zero */
 } sem_info;
 
 /*
- *  Used to account for threads used by AcpiOsExecute
+ *  Deferred call queued by AcpiOsExecute
  */
 typedef struct {
-	bool		used;	/* true if the thread accounting info in use by a thread */
-	pthread_t	thread;	/* thread info */
-} fwts_thread;
-
-typedef void * (*pthread_callback)(void *);
+	ACPI_OSD_EXEC_CALLBACK	function;	/* Function to call */
+	void			*context;	/* ..and its argument */
+} fwts_execute_work;
 
 BOOLEAN AcpiGbl_AbortLoopOnTimeout = FALSE;
 BOOLEAN AcpiGbl_IgnoreErrors = FALSE;
@@ -86,12 +88,27 @@ UINT32  AcpiGbl_InitFileLineCount = 0;
 
 static ACPI_TABLE_DESC		Tables[ACPI_MAX_INIT_TABLES];	/* ACPICA Table descriptors */
 static bool			region_handler_called;		/* Region handler tracking */
+static volatile uint32_t	namespace_generation;		/* Bumped on namespace or AML state changes */
+static volatile uint32_t	namespace_unloads;		/* Bumped when nodes may be deleted */
+static __thread bool		side_effects;			/* AML evaluation changed state */
 
 static sem_info			sem_table[MAX_SEMAPHORES];	/* Semaphore accounting for AcpiOs*Semaphore() */
-static pthread_mutex_t		mutex_lock_sem_table;		/* Semaphore accounting mutex */
-
-static fwts_thread		threads[MAX_THREADS];		/* Thread accounting for AcpiOsExecute */
-static pthread_mutex_t		mutex_thread_info;		/* Thread accounting mutex */
+static pthread_mutex_t		mutex_lock_sem_table;		/* Semaphore create/delete and dirty set mutex */
+static sem_info			*sem_dirty[MAX_SEMAPHORES];	/* Semaphores used since last clear */
+static uint32_t			sem_dirty_count;		/* Entries in sem_dirty */
+
+static pthread_t		execute_workers[MAX_EXECUTE_WORKERS];	/* AcpiOsExecute worker pool */
+static int			execute_workers_started;	/* Workers started on demand */
+static fwts_execute_work	execute_queue[MAX_EXECUTE_QUEUE];	/* Ring of pending calls */
+static int			execute_queue_head;		/* Next call to run */
+static int			execute_queue_count;		/* Number of pending calls */
+static int			execute_active;			/* Calls being run by workers */
+static bool			execute_shutdown;		/* Workers exit once queue is empty */
+static fwts_acpica_execute_stats execute_stats;			/* Queued/executed/dropped counts */
+static pthread_mutex_t		mutex_execute;			/* Worker pool mutex */
+static pthread_cond_t		cond_execute_work;		/* Signalled on new work or shutdown */
+static pthread_cond_t		cond_execute_idle;		/* Signalled when all work completed */
+static __thread bool		execute_worker;			/* True in a worker thread */
 
 /*
  *  Static copies of ACPI tables used by ACPICA execution engine
@@ -107,19 +124,53 @@ static bool			fwts_acpica_init_called;	/* > 0, ACPICA initialised */
 
 /* Semaphore Tracking */
 
+/*
+ *  sem_count_add()
+ *	account for a semaphore acquire or release, adding the semaphore
+ *	to the dirty set the first time it is used after a clear
+ */
+static inline void sem_count_add(sem_info *sem, const int n)
+{
+	__atomic_add_fetch(&sem->count, n, __ATOMIC_SEQ_CST);
+
+	/* Only the first use after a clear takes the mutex */
+	if (__atomic_load_n(&sem->dirty, __ATOMIC_SEQ_CST))
+		return;
+
+	pthread_mutex_lock(&mutex_lock_sem_table);
+	if (!sem->dirty) {
+		/*
+		 *  With the mutex held a semaphore is in sem_dirty only
+		 *  while its dirty flag is set, so each of the at most
+		 *  MAX_SEMAPHORES semaphores has at most one entry
+		 */
+		__atomic_store_n(&sem->dirty, true, __ATOMIC_SEQ_CST);
+		sem_dirty[sem_dirty_count++] = sem;
+	}
+	pthread_mutex_unlock(&mutex_lock_sem_table);
+}
+
 /*
  *  fwts_acpica_sem_count_clear()
- *	clear refs to semaphores and per semaphore count
+ *	clear refs to semaphores and per semaphore count, only the
+ *	semaphores used since the last clear can have a non-zero count
  */
 void fwts_acpica_sem_count_clear(void)
 {
-	int i;
+	uint32_t i;
 
 	pthread_mutex_lock(&mutex_lock_sem_table);
+	for (i = 0; i < sem_dirty_count; i++) {
+		sem_info *sem = sem_dirty[i];
 
-	for (i = 0; i < MAX_SEMAPHORES; i++)
-		sem_table[i].count = 0;
-
+		/*
+		 *  Clear dirty before the count: a use that then sees the
+		 *  flag clear adds the semaphore back once the mutex is free
+		 */
+		__atomic_store_n(&sem->dirty, false, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&sem->count, 0, __ATOMIC_SEQ_CST);
+	}
+	sem_dirty_count = 0;
 	pthread_mutex_unlock(&mutex_lock_sem_table);
 }
 
@@ -130,35 +181,24 @@ void fwts_acpica_sem_count_clear(void)
  */
 void fwts_acpica_sem_count_get(int *acquired, int *released)
 {
-	int i;
+	uint32_t i;
 	*acquired = 0;
 	*released = 0;
 
-	/* Wait for any pending threads to complete */
-
-	for (i = 0; i < MAX_THREADS; i++) {
-		pthread_mutex_lock(&mutex_thread_info);
-		if (threads[i].used) {
-			pthread_mutex_unlock(&mutex_thread_info);
-
-			/* Wait for thread to complete */
-			pthread_join(threads[i].thread, NULL);
-
-			pthread_mutex_lock(&mutex_thread_info);
-			threads[i].used = false;
-		}
-		pthread_mutex_unlock(&mutex_thread_info);
-	}
+	/* Wait for any pending deferred calls to complete */
+	AcpiOsWaitEventsComplete();
 
 	/*
 	 * All threads (such as Notify() calls now complete, so
 	 * we can now do the semaphore accounting calculations
 	 */
 	pthread_mutex_lock(&mutex_lock_sem_table);
-	for (i = 0; i < MAX_SEMAPHORES; i++) {
-		if (sem_table[i].used) {
+	for (i = 0; i < sem_dirty_count; i++) {
+		const sem_info *sem = sem_dirty[i];
+
+		if (sem->used) {
 			(*acquired)++;
-			if (sem_table[i].count == 0)
+			if (__atomic_load_n(&sem->count, __ATOMIC_SEQ_CST) == 0)
 				(*released)++;
 		}
 	}
@@ -181,6 +221,17 @@ static void fwts_device_notify_handler(ACPI_HANDLE Device, UINT32 Value, void *C
 	(void)AcpiEvaluateObject(Device, "_NOT", NULL, NULL);
 }
 
+/*
+ *  state_changed()
+ *	AML changed state that other evaluations may read back, so
+ *	results cached before now can no longer be trusted
+ */
+static inline void state_changed(void)
+{
+	side_effects = true;
+	__atomic_add_fetch(&namespace_generation, 1, __ATOMIC_RELAXED);
+}
+
 static UINT32 fwts_interface_handler(ACPI_STRING InterfaceName, UINT32 Supported)
 {
 	return Supported;
@@ -188,6 +239,10 @@ static UINT32 fwts_interface_handler(ACPI_STRING InterfaceName, UINT32 Supported
 
 static ACPI_STATUS fwts_table_handler(UINT32 Event, void *Table, void *Context)
 {
+	if ((Event == ACPI_TABLE_EVENT_LOAD) || (Event == ACPI_TABLE_EVENT_UNLOAD))
+		state_changed();
+	if (Event == ACPI_TABLE_EVENT_UNLOAD)
+		namespace_unloads++;
 	return AE_OK;
 }
 
@@ -250,6 +305,91 @@ bool fwts_acpi_region_handler_called_get(void)
 	return region_handler_called;
 }
 
+/*
+ *  fwts_acpica_side_effects_clear()
+ *	clear side effect tracking for evaluations on this thread
+ */
+void fwts_acpica_side_effects_clear(void)
+{
+	side_effects = false;
+}
+
+/*
+ *  fwts_acpica_side_effects_get()
+ *	true if AML run on this thread since the last clear accessed
+ *	an OpRegion, stored to a named object, queued a Notify or
+ *	loaded or unloaded a table
+ */
+bool fwts_acpica_side_effects_get(void)
+{
+	return side_effects;
+}
+
+/*
+ *  fwts_acpica_namespace_generation()
+ *	changes whenever the namespace is loaded, reloaded or has tables
+ *	loaded or unloaded, and whenever AML stores to a named object,
+ *	writes an OpRegion or queues a Notify, so cached evaluation
+ *	results can be dropped
+ */
+uint32_t fwts_acpica_namespace_generation(void)
+{
+	return __atomic_load_n(&namespace_generation, __ATOMIC_RELAXED);
+}
+
+ACPI_STATUS __AcpiExStore(ACPI_OPERAND_OBJECT *SourceDesc,
+	ACPI_OPERAND_OBJECT *DestDesc, ACPI_WALK_STATE *WalkState);
+
+/*
+ *  fwts_acpica_store_indirect()
+ *	true if a store to a method argument goes through to the object
+ *	the argument refers to, which ACPICA does when the caller passed
+ *	RefOf() of it
+ */
+static bool fwts_acpica_store_indirect(
+	ACPI_OPERAND_OBJECT	*DestDesc,
+	ACPI_WALK_STATE		*WalkState)
+{
+	ACPI_OPERAND_OBJECT *obj;
+
+	if (!WalkState || (DestDesc->Reference.Value >= ACPI_METHOD_NUM_ARGS))
+		return false;
+
+	obj = AcpiNsGetAttachedObject(&WalkState->Arguments[DestDesc->Reference.Value]);
+
+	return obj &&
+		(ACPI_GET_DESCRIPTOR_TYPE(obj) == ACPI_DESC_TYPE_OPERAND) &&
+		(obj->Common.Type == ACPI_TYPE_LOCAL_REFERENCE) &&
+		(obj->Reference.Class == ACPI_REFCLASS_REFOF);
+}
+
+/*
+ *  AcpiExStore()
+ *	Wrap ACPICA AcpiExStore to note stores to anything other than
+ *	method locals, arguments or the debug object, a store to an
+ *	argument passed as RefOf() stores to the object it refers to
+ */
+ACPI_STATUS AcpiExStore(
+	ACPI_OPERAND_OBJECT	*SourceDesc,
+	ACPI_OPERAND_OBJECT	*DestDesc,
+	ACPI_WALK_STATE		*WalkState)
+{
+	if (DestDesc) {
+		if (ACPI_GET_DESCRIPTOR_TYPE(DestDesc) == ACPI_DESC_TYPE_NAMED)
+			state_changed();
+		else if (DestDesc->Common.Type != ACPI_TYPE_LOCAL_REFERENCE)
+			state_changed();
+		else if (DestDesc->Reference.Class == ACPI_REFCLASS_ARG) {
+			if (fwts_acpica_store_indirect(DestDesc, WalkState))
+				state_changed();
+		} else if ((DestDesc->Reference.Class != ACPI_REFCLASS_LOCAL) &&
+			   (DestDesc->Reference.Class != ACPI_REFCLASS_DEBUG))
+			state_changed();
+	}
+
+	return __AcpiExStore(SourceDesc, DestDesc, WalkState);
+}
+
 static ACPI_STATUS fwts_region_handler(
 	UINT32                  function,
 	ACPI_PHYSICAL_ADDRESS   address,
@@ -272,12 +412,19 @@ static ACPI_STATUS fwts_region_handler(
 		return AE_OK;
 
 	fwts_acpi_region_handler_called_set(true);
+	fwts_acpica_profile_region(regionobject->Region.SpaceId);
+	if ((function & ACPI_IO_MASK) == ACPI_WRITE)
+		state_changed();
+	else
+		side_effects = true;
 
 	switch (regionobject->Region.SpaceId) {
 	case ACPI_ADR_SPACE_SYSTEM_IO:
 		switch (function & ACPI_IO_MASK) {
 		case ACPI_READ:
-			*value = 0;
+			if (!fwts_acpi_region_trace_read(regionobject->Region.SpaceId,
+			    address, bitwidth, value))
+				*value = 0;
 			break;
 		case ACPI_WRITE:
 			break;
@@ -372,6 +519,9 @@ static ACPI_STATUS fwts_region_handler(
 
 		switch (function) {
 		case ACPI_READ:
+			if (fwts_acpi_region_trace_read(regionobject->Region.SpaceId,
+			    address, bitwidth, value))
+				break;
 			/* Fake it, return all set */
 			memset(value, 0x00, bytewidth);
 		break;
@@ -535,7 +685,7 @@ ACPI_STATUS AcpiOsCreateSemaphore(UINT32 MaxUnits,
 	}
 
 	sem->used = true;
-	sem->count = 0;
+	__atomic_store_n(&sem->count, 0, __ATOMIC_RELAXED);
 
 	if (sem_init(&sem->sem, 0, InitialUnits) == -1) {
 		*OutHandle = NULL;
@@ -635,9 +785,7 @@ ACPI_STATUS AcpiOsWaitSemaphore(ACPI_HANDLE handle, UINT32 Units, UINT16 Timeout
 		break;
 	}
 
-	pthread_mutex_lock(&mutex_lock_sem_table);
-	sem->count++;
-	pthread_mutex_unlock(&mutex_lock_sem_table);
+	sem_count_add(sem, 1);
 
 	return AE_OK;
 }
@@ -657,19 +805,20 @@ ACPI_STATUS AcpiOsSignalSemaphore(ACPI_HANDLE handle, UINT32 Units)
 	if (sem_post(&sem->sem) < 0)
 		return AE_LIMIT;
 
-	pthread_mutex_lock(&mutex_lock_sem_table);
-	sem->count--;
-	pthread_mutex_unlock(&mutex_lock_sem_table);
+	sem_count_add(sem, -1);
 
 	return AE_OK;
 }
 
 /*
  *  AcpiOsReadPort()
- *	Override ACPICA AcpiOsReadPort to fake port reads
+ *	Override ACPICA AcpiOsReadPort to fake port reads, or
+ *	replay them from an OpRegion trace
  */
 ACPI_STATUS AcpiOsReadPort(ACPI_IO_ADDRESS addr, UINT32 *value, UINT32 width)
 {
+	UINT64 traced;
+
 	switch (width) {
 	case 8:
 		*value = 0xFF;
@@ -683,80 +832,191 @@ ACPI_STATUS AcpiOsReadPort(ACPI_IO_ADDRESS addr, UINT32 *value, UINT32 width)
 	default:
 		return AE_BAD_PARAMETER;
 	}
+	if (fwts_acpi_region_trace_read(ACPI_ADR_SPACE_SYSTEM_IO, addr, width, &traced))
+		*value = (UINT32)traced;
+
 	return AE_OK;
 }
 
-typedef struct {
-	pthread_callback	func;
-	void *			context;
-	int			thread_index;
-} fwts_func_wrapper_context;
+/*
+ *  fwts_acpica_execute_worker()
+ *	run calls deferred by AcpiOsExecute until told to shut down,
+ *	any calls still queued at shutdown are run before exiting
+ */
+static void *fwts_acpica_execute_worker(void *arg)
+{
+	FWTS_UNUSED(arg);
+
+	execute_worker = true;
+
+	pthread_mutex_lock(&mutex_execute);
+	for (;;) {
+		fwts_execute_work work;
+
+		while (!execute_queue_count && !execute_shutdown)
+			pthread_cond_wait(&cond_execute_work, &mutex_execute);
+		if (!execute_queue_count)
+			break;
+
+		work = execute_queue[execute_queue_head];
+		execute_queue_head = (execute_queue_head + 1) % MAX_EXECUTE_QUEUE;
+		execute_queue_count--;
+		execute_active++;
+		pthread_mutex_unlock(&mutex_execute);
+
+		work.function(work.context);
+
+		pthread_mutex_lock(&mutex_execute);
+		execute_active--;
+		execute_stats.executed++;
+		if (!execute_queue_count && !execute_active)
+			pthread_cond_broadcast(&cond_execute_idle);
+	}
+	pthread_mutex_unlock(&mutex_execute);
+
+	return NULL;
+}
 
 /*
- *  fwts_pthread_func_wrapper()
- *	wrap the AcpiOsExecute function so we can mark the thread
- *	accounting free once the function has completed.
+ *  fwts_acpica_execute_stop()
+ *	run any pending deferred calls and join the worker pool
  */
-void *fwts_pthread_func_wrapper(fwts_func_wrapper_context *ctx)
+static void fwts_acpica_execute_stop(void)
 {
-	void *ret;
+	int i;
 
-	ret = ctx->func(ctx->context);
+	pthread_mutex_lock(&mutex_execute);
+	execute_shutdown = true;
+	pthread_cond_broadcast(&cond_execute_work);
+	pthread_mutex_unlock(&mutex_execute);
 
-	pthread_mutex_lock(&mutex_thread_info);
-	threads[ctx->thread_index].used = false;
-	pthread_mutex_unlock(&mutex_thread_info);
+	for (i = 0; i < execute_workers_started; i++)
+		pthread_join(execute_workers[i], NULL);
 
-	free(ctx);
+	execute_workers_started = 0;
+	execute_shutdown = false;
+}
 
-	return ret;
+/*
+ *  fwts_acpica_fork_prepare()
+ *	call before forking a child that will evaluate AML, waits for
+ *	deferred calls to complete so no locks are held by the workers
+ */
+void fwts_acpica_fork_prepare(void)
+{
+	AcpiOsWaitEventsComplete();
+}
+
+/*
+ *  fwts_acpica_fork_child()
+ *	call in the child after a fork, the AcpiOsExecute workers are
+ *	not inherited so the child starts its own on demand
+ */
+void fwts_acpica_fork_child(void)
+{
+	pthread_mutex_init(&mutex_lock_sem_table, NULL);
+	pthread_mutex_init(&mutex_execute, NULL);
+	pthread_cond_init(&cond_execute_work, NULL);
+	pthread_cond_init(&cond_execute_idle, NULL);
+
+	execute_workers_started = 0;
+	execute_queue_head = 0;
+	execute_queue_count = 0;
+	execute_active = 0;
+	execute_shutdown = false;
+}
+
+/*
+ *  fwts_acpica_execute_stats_get()
+ *	get AcpiOsExecute deferred call counts since fwts_acpica_init(),
+ *	these remain valid after fwts_acpica_deinit()
+ */
+void fwts_acpica_execute_stats_get(fwts_acpica_execute_stats *stats)
+{
+	/* No workers are left running once deinit has joined them */
+	if (!fwts_acpica_init_called) {
+		*stats = execute_stats;
+		return;
+	}
+
+	pthread_mutex_lock(&mutex_execute);
+	*stats = execute_stats;
+	pthread_mutex_unlock(&mutex_execute);
 }
 
+/*
+ *  AcpiOsExecute()
+ *	Override ACPICA AcpiOsExecute to queue the call on a pool of
+ *	worker threads, workers are started as the number of
+ *	outstanding calls grows. Calls are dropped if the queue is full.
+ */
 ACPI_STATUS AcpiOsExecute(
 	ACPI_EXECUTE_TYPE       type,
 	ACPI_OSD_EXEC_CALLBACK  function,
 	void                    *func_context)
 {
-	int	ret;
-	int 	i;
-
-	pthread_mutex_lock(&mutex_thread_info);
-
-	/* Find a free slot to do per-thread join tracking */
-	for (i = 0; i < MAX_THREADS; i++) {
-		if (!threads[i].used) {
-			fwts_func_wrapper_context *ctx;
+	int tail;
 
-			/* We need some context to pass through to the thread wrapper */
-			if ((ctx = malloc(sizeof(fwts_func_wrapper_context))) == NULL) {
-				pthread_mutex_unlock(&mutex_thread_info);
-				return AE_NO_MEMORY;
-			}
+	FWTS_UNUSED(type);
 
-			ctx->func = (pthread_callback)function;
-			ctx->context = func_context;
-			ctx->thread_index = i;
-			threads[i].used = true;
+	if (!function)
+		return AE_BAD_PARAMETER;
 
-			ret = pthread_create(&threads[i].thread, NULL,
-				(pthread_callback)fwts_pthread_func_wrapper, ctx);
-			pthread_mutex_unlock(&mutex_thread_info);
+	state_changed();
+	pthread_mutex_lock(&mutex_execute);
 
-			if (ret)
-				return AE_ERROR;
+	if (execute_queue_count == MAX_EXECUTE_QUEUE) {
+		execute_stats.dropped++;
+		pthread_mutex_unlock(&mutex_execute);
+		return AE_NO_MEMORY;
+	}
 
-			return AE_OK;
+	/* Start another worker if all the running ones are busy */
+	if ((execute_workers_started < MAX_EXECUTE_WORKERS) &&
+	    (execute_queue_count + execute_active >= execute_workers_started)) {
+		if (pthread_create(&execute_workers[execute_workers_started], NULL,
+		    fwts_acpica_execute_worker, NULL) == 0)
+			execute_workers_started++;
+		else if (!execute_workers_started) {
+			execute_stats.dropped++;
+			pthread_mutex_unlock(&mutex_execute);
+			return AE_ERROR;
 		}
 	}
 
-	/* No free slots, failed! */
-	pthread_mutex_unlock(&mutex_thread_info);
-	return AE_NO_MEMORY;
+	tail = (execute_queue_head + execute_queue_count) % MAX_EXECUTE_QUEUE;
+	execute_queue[tail].function = function;
+	execute_queue[tail].context = func_context;
+	execute_queue_count++;
+	execute_stats.queued++;
+
+	pthread_cond_signal(&cond_execute_work);
+	pthread_mutex_unlock(&mutex_execute);
+
+	return AE_OK;
+}
+
+/*
+ *  AcpiOsWaitEventsComplete()
+ *	Override ACPICA AcpiOsWaitEventsComplete to wait for all
+ *	calls queued by AcpiOsExecute to complete. Deferred calls
+ *	cannot wait for themselves, so this is a no-op in a worker.
+ */
+void AcpiOsWaitEventsComplete(void)
+{
+	if (execute_worker)
+		return;
+
+	pthread_mutex_lock(&mutex_execute);
+	while (execute_queue_count || execute_active)
+		pthread_cond_wait(&cond_execute_idle, &mutex_execute);
+	pthread_mutex_unlock(&mutex_execute);
 }
 
 /*
  *  AcpiOsReadPciConfiguration()
- *	Override ACPICA AcpiOsReadPciConfiguration to fake PCI reads
+ *	Override ACPICA AcpiOsReadPciConfiguration to fake PCI reads, or
+ *	replay them from an OpRegion trace
  */
 ACPI_STATUS AcpiOsReadPciConfiguration(ACPI_PCI_ID *pciid, UINT32 reg, UINT64 *value, UINT32 width)
 {
@@ -773,6 +1033,10 @@ ACPI_STATUS AcpiOsReadPciConfiguration(ACPI_PCI_ID *pciid, UINT32 reg, UINT64 *v
 	default:
 		return AE_BAD_PARAMETER;
 	}
+	(void)fwts_acpi_region_trace_read(ACPI_ADR_SPACE_PCI_CONFIG,
+		FWTS_REGION_TRACE_PCI_ADDR(pciid->Segment, pciid->Bus,
+		pciid->Device, pciid->Function, reg), width, value);
+
 	return AE_OK;
 }
 
@@ -1053,7 +1317,11 @@ int fwts_acpica_init(fwts_framework *fw)
 	AcpiGbl_CstyleDisassembly = FALSE;
 
 	pthread_mutex_init(&mutex_lock_sem_table, NULL);
-	pthread_mutex_init(&mutex_thread_info, NULL);
+	pthread_mutex_init(&mutex_execute, NULL);
+	pthread_cond_init(&cond_execute_work, NULL);
+	pthread_cond_init(&cond_execute_idle, NULL);
+	memset(&execute_stats, 0, sizeof(execute_stats));
+	fwts_acpica_sem_count_clear();
 
 	fwts_acpica_set_fwts_framework(fw);
 
@@ -1246,14 +1514,37 @@ int fwts_acpica_init(fwts_framework *fw)
 		goto failed;
 	}
 
+	fwts_acpica_budget_set(fw->aml_budget_opcodes, fw->aml_budget_ms);
+	if (fw->flags & FWTS_FLAG_AML_PROFILE)
+		fwts_acpica_profile_start();
+	if (fw->flags & FWTS_FLAG_AML_COVERAGE)
+		fwts_acpica_coverage_start();
+	fwts_acpi_region_trace_rewind();
+
 	fwts_acpica_init_called = true;
 	return FWTS_OK;
 
 failed:
+	fwts_acpica_execute_stop();
 	AcpiTerminate();
 	return FWTS_ERROR;
 }
 
+/*
+ *  fwts_acpica_region_trace_report()
+ *	note any reads that an OpRegion trace being replayed did not cover
+ */
+static void fwts_acpica_region_trace_report(fwts_framework *fw)
+{
+	fwts_acpi_region_trace_stats stats;
+
+	fwts_acpi_region_trace_stats_get(&stats);
+	if (stats.misses)
+		fwts_log_info(fw, "%" PRIu64 " of %" PRIu64 " OpRegion reads were "
+			"not in the OpRegion trace and returned fake values.",
+			stats.misses, stats.hits + stats.misses);
+}
+
 #define FWTS_ACPICA_FREE(x)	\
 	{ fwts_low_free(x); x = NULL; }
 
@@ -1266,57 +1557,243 @@ int fwts_acpica_deinit(void)
 	if (!fwts_acpica_init_called)
 		return FWTS_ERROR;
 
+	fwts_acpica_execute_stop();
+	fwts_acpica_profile_stop();
+	fwts_acpica_coverage_stop();
 	AcpiTerminate();
+	namespace_generation++;
+	namespace_unloads++;
 	pthread_mutex_destroy(&mutex_lock_sem_table);
-	pthread_mutex_destroy(&mutex_thread_info);
+	pthread_mutex_destroy(&mutex_execute);
+	pthread_cond_destroy(&cond_execute_work);
+	pthread_cond_destroy(&cond_execute_idle);
 
 	FWTS_ACPICA_FREE(fwts_acpica_XSDT);
 	FWTS_ACPICA_FREE(fwts_acpica_RSDT);
 	FWTS_ACPICA_FREE(fwts_acpica_RSDP);
 	FWTS_ACPICA_FREE(fwts_acpica_FADT);
 
+	fwts_acpica_profile_report(fwts_acpica_fw);
+	fwts_acpica_region_trace_report(fwts_acpica_fw);
 	fwts_acpica_init_called = false;
 
 	return FWTS_OK;
 }
 
+#define NODES_MAX_DEPTH		(256)	/* Deepest namespace nesting walked */
+
+typedef struct {
+	fwts_acpica_nodes *nodes;
+	size_t nodes_size;			/* Nodes allocated */
+	size_t strings_size;			/* String pool allocated */
+	uint32_t index[NODES_MAX_DEPTH];	/* Node index at each level */
+	size_t path_len[NODES_MAX_DEPTH];	/* Path length at each level */
+} fwts_acpica_nodes_walk;
+
 /*
- *  fwts_acpi_walk_for_object_names()
- *  	append to list (passed in context) objects names that match a given
- * 	type, (callback from fwts_acpica_get_object_names())
- *
+ *  fwts_acpi_walk_for_nodes()
+ *	append a node record to the nodes (passed in context), the path
+ *	is built from the parent path rather than walking back up to the
+ *	root, (callback from fwts_acpica_get_nodes())
  */
-static ACPI_STATUS fwts_acpi_walk_for_object_names(
+static ACPI_STATUS fwts_acpi_walk_for_nodes(
 	ACPI_HANDLE	objHandle,
 	UINT32		nestingLevel,
 	void		*context,
 	void		**ret)
 {
-	fwts_list *list = (fwts_list*)context;
+	fwts_acpica_nodes_walk *walk = (fwts_acpica_nodes_walk *)context;
+	fwts_acpica_nodes *nodes = walk->nodes;
+	ACPI_NAMESPACE_NODE *node = (ACPI_NAMESPACE_NODE *)objHandle;
+	fwts_acpica_node *record;
+	size_t parent_len, len;
+	char *path;
+
+	if ((nestingLevel < 1) || (nestingLevel > NODES_MAX_DEPTH))
+		return AE_OK;
 
-	ACPI_BUFFER	buffer;
-	char tmpbuf[1024];
+	/* Parent path, or "\" for nodes in the root scope */
+	parent_len = (nestingLevel > 1) ? walk->path_len[nestingLevel - 2] : 0;
+	len = parent_len + 1 + ACPI_NAMESEG_SIZE;
 
-	buffer.Pointer = tmpbuf;
-	buffer.Length  = sizeof(tmpbuf);
+	if (nodes->count == walk->nodes_size) {
+		const size_t size = walk->nodes_size ? walk->nodes_size * 2 : 1024;
 
-	if (!ACPI_FAILURE(AcpiNsHandleToPathname(objHandle, &buffer, FALSE)))
-		fwts_list_append(list, strdup((char *)buffer.Pointer));
+		record = realloc(nodes->nodes, size * sizeof(*record));
+		if (!record)
+			return AE_NO_MEMORY;
+		nodes->nodes = record;
+		walk->nodes_size = size;
+	}
+	if (nodes->strings_size + len + 1 > walk->strings_size) {
+		size_t size = walk->strings_size ? walk->strings_size * 2 : 16384;
+
+		while (size < nodes->strings_size + len + 1)
+			size *= 2;
+		if ((path = realloc(nodes->strings, size)) == NULL)
+			return AE_NO_MEMORY;
+		nodes->strings = path;
+		walk->strings_size = size;
+	}
+
+	path = nodes->strings + nodes->strings_size;
+	if (nestingLevel > 1) {
+		memcpy(path, nodes->strings + nodes->nodes[walk->index[nestingLevel - 2]].path,
+			parent_len);
+		path[parent_len] = '.';
+	} else
+		*path = '\\';
+	memcpy(path + parent_len + 1, node->Name.Ascii, ACPI_NAMESEG_SIZE);
+	path[len] = '\0';
+
+	record = &nodes->nodes[nodes->count];
+	record->handle = objHandle;
+	record->parent = (nestingLevel > 1) ? walk->index[nestingLevel - 2] : FWTS_ACPICA_NODE_NONE;
+	record->path = (uint32_t)nodes->strings_size;
+	memcpy(record->name, node->Name.Ascii, sizeof(record->name));
+	record->type = node->Type;
+
+	walk->index[nestingLevel - 1] = (uint32_t)nodes->count++;
+	walk->path_len[nestingLevel - 1] = len;
+	nodes->strings_size += len + 1;
 
 	return AE_OK;
 }
 
+/*
+ *  fwts_acpica_get_nodes()
+ *	fetch a record of every node in the namespace, with its handle,
+ *	type, parent and path, in namespace walk order
+ */
+fwts_acpica_nodes *fwts_acpica_get_nodes(void)
+{
+	fwts_acpica_nodes_walk *walk;
+	fwts_acpica_nodes *nodes;
+
+	if ((nodes = calloc(1, sizeof(*nodes))) == NULL)
+		return NULL;
+	if ((walk = calloc(1, sizeof(*walk))) == NULL) {
+		free(nodes);
+		return NULL;
+	}
+	walk->nodes = nodes;
+	nodes->unloads = namespace_unloads;
+
+	if (ACPI_FAILURE(AcpiWalkNamespace(ACPI_TYPE_ANY, ACPI_ROOT_OBJECT, ACPI_UINT32_MAX,
+	    fwts_acpi_walk_for_nodes, NULL, walk, NULL))) {
+		fwts_acpica_nodes_free(nodes);
+		nodes = NULL;
+	}
+	free(walk);
+
+	return nodes;
+}
+
+/*
+ *  fwts_acpica_nodes_free()
+ *	free nodes fetched by fwts_acpica_get_nodes()
+ */
+void fwts_acpica_nodes_free(fwts_acpica_nodes *nodes)
+{
+	if (nodes) {
+		free(nodes->nodes);
+		free(nodes->strings);
+		free(nodes);
+	}
+}
+
+/*
+ *  fwts_acpica_nodes_valid()
+ *	true if the node handles are still valid, no table has been
+ *	unloaded and ACPICA has not been terminated since they were fetched
+ */
+bool fwts_acpica_nodes_valid(const fwts_acpica_nodes *nodes)
+{
+	return nodes && (nodes->unloads == namespace_unloads);
+}
+
 /*
  *  fwts_acpica_get_object_names()
  *	fetch a list of object names that match a specified type
  */
 fwts_list *fwts_acpica_get_object_names(const int type)
+{
+	fwts_acpica_nodes *nodes;
+	fwts_list *list;
+	size_t i;
+
+	if ((list = fwts_list_new()) == NULL)
+		return NULL;
+	if ((nodes = fwts_acpica_get_nodes()) == NULL)
+		return list;
+
+	for (i = 0; i < nodes->count; i++) {
+		const fwts_acpica_node *node = &nodes->nodes[i];
+
+		if ((type == ACPI_TYPE_ANY) || (node->type == type))
+			fwts_list_append(list, strdup(nodes->strings + node->path));
+	}
+	fwts_acpica_nodes_free(nodes);
+
+	return list;
+}
+
+/*
+ *  fwts_acpi_walk_for_regions()
+ *	append to list (passed in context) the OperationRegions found,
+ *	(callback from fwts_acpica_get_regions())
+ */
+static ACPI_STATUS fwts_acpi_walk_for_regions(
+	ACPI_HANDLE	objHandle,
+	UINT32		nestingLevel,
+	void		*context,
+	void		**ret)
+{
+	fwts_list *list = (fwts_list *)context;
+	ACPI_OPERAND_OBJECT *obj;
+	fwts_acpica_region *region;
+	ACPI_BUFFER buffer;
+	ACPI_STATUS status = AE_OK;
+
+	obj = AcpiNsGetAttachedObject((ACPI_NAMESPACE_NODE *)objHandle);
+	if (!obj || (obj->Common.Type != ACPI_TYPE_REGION))
+		return AE_OK;
+
+	/* Region address and length may not have been evaluated yet */
+	if (!(obj->Common.Flags & AOPOBJ_DATA_VALID)) {
+		AcpiExEnterInterpreter();
+		status = AcpiDsGetRegionArguments(obj);
+		AcpiExExitInterpreter();
+	}
+	if (ACPI_FAILURE(status))
+		return AE_OK;
+
+	if ((region = calloc(1, sizeof(*region))) == NULL)
+		return AE_NO_MEMORY;
+
+	buffer.Pointer = region->path;
+	buffer.Length  = sizeof(region->path);
+	(void)AcpiNsHandleToPathname(objHandle, &buffer, FALSE);
+	region->space_id = obj->Region.SpaceId;
+	region->space_name = AcpiUtGetRegionName(obj->Region.SpaceId);
+	region->address = obj->Region.Address;
+	region->length = obj->Region.Length;
+	fwts_list_append(list, region);
+
+	return AE_OK;
+}
+
+/*
+ *  fwts_acpica_get_regions()
+ *	fetch a list of the OperationRegions in the namespace
+ */
+fwts_list *fwts_acpica_get_regions(void)
 {
 	fwts_list *list;
 
 	if ((list = fwts_list_new()) != NULL)
-		AcpiWalkNamespace(type, ACPI_ROOT_OBJECT, ACPI_UINT32_MAX,
-			fwts_acpi_walk_for_object_names, NULL, list, NULL);
+		AcpiWalkNamespace(ACPI_TYPE_REGION, ACPI_ROOT_OBJECT, ACPI_UINT32_MAX,
+			fwts_acpi_walk_for_regions, NULL, list, NULL);
 
 	return list;
 }
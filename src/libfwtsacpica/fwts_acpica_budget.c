@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  Per evaluation AML execution budget.
+ *
+ *  AcpiDsExecBeginOp() is called by the interpreter before every opcode
+ *  it executes; the original is renamed to __AcpiDsExecBeginOp (see
+ *  dswexec_munged.c) and wrapped here.  Each top level evaluation gets a
+ *  budget of opcodes and wall time, shared by all the methods it calls.
+ *  Once it is used up the evaluation is aborted with AE_AML_LOOP_TIMEOUT
+ *  and fwts_acpica_budget_exceeded() tells the caller why.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fwts.h"
+
+#include "acpi.h"
+#include "accommon.h"
+#include "acdispat.h"
+
+#define BUDGET_CLOCK_INTERVAL		(64)	/* Opcodes between clock checks */
+
+ACPI_STATUS __AcpiDsExecBeginOp(ACPI_WALK_STATE *WalkState, ACPI_PARSE_OBJECT **OutOp);
+
+static uint64_t			budget_opcodes;		/* Opcode limit, 0 = unlimited */
+static uint64_t			budget_ns;		/* Wall time limit, 0 = unlimited */
+
+static __thread bool		budget_active;		/* Evaluation in progress on this thread */
+static __thread uint64_t	budget_opcodes_used;
+static __thread uint64_t	budget_deadline_ns;
+static __thread fwts_acpica_budget_reason budget_reason;
+
+/*
+ *  budget_now()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t budget_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  fwts_acpica_budget_set()
+ *	set the per evaluation budget, zero for no limit
+ */
+void fwts_acpica_budget_set(const uint64_t opcodes, const uint32_t ms)
+{
+	budget_opcodes = opcodes;
+	budget_ns = (uint64_t)ms * 1000000ULL;
+}
+
+/*
+ *  fwts_acpica_budget_begin()
+ *	start the budget for a new top level evaluation on this thread
+ */
+void fwts_acpica_budget_begin(void)
+{
+	budget_reason = FWTS_ACPICA_BUDGET_OK;
+	budget_active = budget_opcodes || budget_ns;
+	if (!budget_active)
+		return;
+
+	budget_opcodes_used = 0;
+	budget_deadline_ns = budget_ns ? budget_now() + budget_ns : 0;
+}
+
+/*
+ *  fwts_acpica_budget_exceeded()
+ *	why the last evaluation on this thread was aborted, if it was
+ */
+fwts_acpica_budget_reason fwts_acpica_budget_exceeded(void)
+{
+	return budget_reason;
+}
+
+/*
+ *  fwts_acpica_budget_get()
+ *	get the per evaluation budget
+ */
+void fwts_acpica_budget_get(uint64_t *opcodes, uint32_t *ms)
+{
+	*opcodes = budget_opcodes;
+	*ms = (uint32_t)(budget_ns / 1000000ULL);
+}
+
+ACPI_STATUS AcpiDsExecBeginOp(
+	ACPI_WALK_STATE		*WalkState,
+	ACPI_PARSE_OBJECT	**OutOp)
+{
+	if (budget_active) {
+		budget_opcodes_used++;
+
+		if (budget_opcodes && (budget_opcodes_used > budget_opcodes))
+			budget_reason = FWTS_ACPICA_BUDGET_OPCODES;
+		else if (budget_deadline_ns &&
+			 ((budget_opcodes_used % BUDGET_CLOCK_INTERVAL) == 0) &&
+			 (budget_now() > budget_deadline_ns))
+			budget_reason = FWTS_ACPICA_BUDGET_TIME;
+
+		if (budget_reason != FWTS_ACPICA_BUDGET_OK) {
+			/* Abort once, the unwind then runs to completion */
+			budget_active = false;
+			return AE_AML_LOOP_TIMEOUT;
+		}
+	}
+
+	return __AcpiDsExecBeginOp(WalkState, OutOp);
+}
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  AML coverage.
+ *
+ *  The AcpiExStartTraceOpcode() wrapper in fwts_acpica_profile.c passes
+ *  the AML address of every opcode executed to fwts_acpica_coverage_opcode()
+ *  which sets the bit for its offset in a bitmap kept for each AML table.
+ *  Tables are matched by their header so the bitmaps of the same table
+ *  are merged over every ACPICA session of the run.  The bitmaps are in
+ *  shared memory so opcodes executed by forked method test workers are
+ *  counted too.  The control methods of each table are recorded before
+ *  ACPICA is terminated, fwts_acpi_coverage_report() reports on it all.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "fwts.h"
+
+#include "acpi.h"
+#include "accommon.h"
+#include "acnamesp.h"
+#include "actables.h"
+
+#define COVERAGE_MAX_RANGES	(256)	/* AML tables tracked per ACPICA session */
+
+/*
+ *  An AML table loaded in this ACPICA session
+ */
+typedef struct {
+	const uint8_t	*base;			/* Table in ACPICA's table list */
+	uint32_t	length;			/* Table length */
+	fwts_acpica_coverage_table *table;	/* Coverage of the table */
+} fwts_acpica_coverage_range;
+
+static volatile bool		coverage_enabled;	/* Coverage hook active */
+static pthread_mutex_t		coverage_mutex = PTHREAD_MUTEX_INITIALIZER;
+static fwts_acpica_coverage_table **coverage_tables;	/* Coverage of all tables seen */
+static size_t			coverage_tables_count;
+static fwts_acpica_coverage_range coverage_ranges[COVERAGE_MAX_RANGES];
+static volatile size_t		coverage_ranges_count;
+static UINT32			coverage_tables_seen;	/* Root table list entries scanned */
+
+static __thread const fwts_acpica_coverage_range *coverage_last;
+
+/*
+ *  coverage_table_find()
+ *	find or add the coverage of a table, called with coverage_mutex held
+ */
+static fwts_acpica_coverage_table *coverage_table_find(const ACPI_TABLE_HEADER *header)
+{
+	fwts_acpica_coverage_table **tables, *table;
+	size_t i, size = (header->Length + 7) / 8;
+
+	for (i = 0; i < coverage_tables_count; i++)
+		if (!memcmp(&coverage_tables[i]->header, header, sizeof(coverage_tables[i]->header)))
+			return coverage_tables[i];
+
+	tables = realloc(coverage_tables, (coverage_tables_count + 1) * sizeof(*tables));
+	if (!tables)
+		return NULL;
+	coverage_tables = tables;
+
+	if ((table = calloc(1, sizeof(*table))) == NULL)
+		return NULL;
+	/* Shared, so forked children set bits in the parent's bitmap */
+	table->executed = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (table->executed == MAP_FAILED) {
+		free(table);
+		return NULL;
+	}
+	memcpy(&table->header, header, sizeof(table->header));
+	coverage_tables[coverage_tables_count++] = table;
+
+	return table;
+}
+
+/*
+ *  coverage_ranges_update()
+ *	add any AML tables loaded since the table list was last scanned,
+ *	called with coverage_mutex held
+ */
+static void coverage_ranges_update(void)
+{
+	UINT32 i;
+
+	for (i = coverage_tables_seen; i < AcpiGbl_RootTableList.CurrentTableCount; i++) {
+		ACPI_TABLE_DESC *desc = &AcpiGbl_RootTableList.Tables[i];
+		fwts_acpica_coverage_range *range;
+
+		if (!desc->Pointer || !AcpiUtIsAmlTable(desc->Pointer))
+			continue;
+		if (coverage_ranges_count >= COVERAGE_MAX_RANGES)
+			break;
+
+		range = &coverage_ranges[coverage_ranges_count];
+		range->base = (const uint8_t *)desc->Pointer;
+		range->length = desc->Pointer->Length;
+		if ((range->table = coverage_table_find(desc->Pointer)) == NULL)
+			continue;
+		/* Publish the range only once it is filled in */
+		__atomic_store_n(&coverage_ranges_count, coverage_ranges_count + 1, __ATOMIC_RELEASE);
+	}
+	coverage_tables_seen = i;
+}
+
+/*
+ *  coverage_range_find()
+ *	find the table holding some AML, newer tables are searched first
+ *	as they may reuse the memory of a table that has been unloaded
+ */
+static const fwts_acpica_coverage_range *coverage_range_find(const uint8_t *aml)
+{
+	size_t i;
+
+	if (coverage_last && (aml >= coverage_last->base) &&
+	    (aml < coverage_last->base + coverage_last->length))
+		return coverage_last;
+
+	for (i = __atomic_load_n(&coverage_ranges_count, __ATOMIC_ACQUIRE); i > 0; i--) {
+		const fwts_acpica_coverage_range *range = &coverage_ranges[i - 1];
+
+		if ((aml >= range->base) && (aml < range->base + range->length))
+			return coverage_last = range;
+	}
+
+	return NULL;
+}
+
+/*
+ *  fwts_acpica_coverage_opcode()
+ *	mark the opcode at aml as executed
+ */
+void fwts_acpica_coverage_opcode(const uint8_t *aml)
+{
+	const fwts_acpica_coverage_range *range;
+	uint8_t *byte, bit;
+	uint32_t offset;
+
+	if (!coverage_enabled || !aml)
+		return;
+
+	if ((range = coverage_range_find(aml)) == NULL) {
+		/* Maybe executing a table loaded since the last scan */
+		pthread_mutex_lock(&coverage_mutex);
+		if (coverage_tables_seen != AcpiGbl_RootTableList.CurrentTableCount)
+			coverage_ranges_update();
+		pthread_mutex_unlock(&coverage_mutex);
+		if ((range = coverage_range_find(aml)) == NULL)
+			return;
+	}
+
+	offset = (uint32_t)(aml - range->base);
+	byte = &range->table->executed[offset >> 3];
+	bit = 1 << (offset & 7);
+	if (!(*byte & bit))
+		__atomic_fetch_or(byte, bit, __ATOMIC_RELAXED);
+}
+
+/*
+ *  coverage_method_add()
+ *	record a control method in the coverage of its table
+ */
+static ACPI_STATUS coverage_method_add(
+	ACPI_HANDLE	handle,
+	UINT32		level,
+	void		*context,
+	void		**ret_val)
+{
+	ACPI_NAMESPACE_NODE *node = (ACPI_NAMESPACE_NODE *)handle;
+	ACPI_OPERAND_OBJECT *obj = AcpiNsGetAttachedObject(node);
+	const fwts_acpica_coverage_range *range;
+	fwts_acpica_coverage_table *table;
+	fwts_acpica_coverage_method *method;
+	UINT32 size;
+
+	FWTS_UNUSED(level);
+	FWTS_UNUSED(context);
+	FWTS_UNUSED(ret_val);
+
+	/* Skip methods implemented by ACPICA, such as _OSI */
+	if (!obj || (obj->Method.InfoFlags & ACPI_METHOD_INTERNAL_ONLY) ||
+	    !obj->Method.AmlStart)
+		return AE_OK;
+	if ((range = coverage_range_find(obj->Method.AmlStart)) == NULL)
+		return AE_OK;
+
+	/* The methods of a table are the same every time it is loaded */
+	table = range->table;
+	if (table->methods_done)
+		return AE_OK;
+
+	if (table->methods_count == table->methods_size) {
+		const size_t methods_size = table->methods_size ? table->methods_size * 2 : 64;
+		fwts_acpica_coverage_method *methods;
+
+		methods = realloc(table->methods, methods_size * sizeof(*methods));
+		if (!methods)
+			return AE_NO_MEMORY;
+		table->methods = methods;
+		table->methods_size = methods_size;
+	}
+
+	method = &table->methods[table->methods_count];
+	size = AcpiNsBuildNormalizedPath(node, NULL, 0, TRUE);
+	if ((method->path = malloc(size ? size : 1)) == NULL)
+		return AE_NO_MEMORY;
+	*method->path = '\0';
+	(void)AcpiNsBuildNormalizedPath(node, method->path, size, TRUE);
+	method->offset = (uint32_t)(obj->Method.AmlStart - range->base);
+	method->length = obj->Method.AmlLength;
+	table->methods_count++;
+
+	return AE_OK;
+}
+
+/*
+ *  fwts_acpica_coverage_start()
+ *	start collecting AML coverage, tables must be loaded
+ */
+void fwts_acpica_coverage_start(void)
+{
+	pthread_mutex_lock(&coverage_mutex);
+	coverage_ranges_count = 0;
+	coverage_tables_seen = 0;
+	coverage_ranges_update();
+	pthread_mutex_unlock(&coverage_mutex);
+
+	coverage_last = NULL;
+	coverage_enabled = true;
+}
+
+/*
+ *  fwts_acpica_coverage_enabled()
+ *	true if AML coverage is being collected
+ */
+bool fwts_acpica_coverage_enabled(void)
+{
+	return coverage_enabled;
+}
+
+/*
+ *  fwts_acpica_coverage_stop()
+ *	stop collecting AML coverage and record the control methods
+ *	of each table, must be called before ACPICA is terminated
+ */
+void fwts_acpica_coverage_stop(void)
+{
+	size_t i;
+
+	if (!coverage_enabled)
+		return;
+
+	pthread_mutex_lock(&coverage_mutex);
+	coverage_ranges_update();
+	(void)AcpiWalkNamespace(ACPI_TYPE_METHOD, ACPI_ROOT_OBJECT,
+		ACPI_UINT32_MAX, coverage_method_add, NULL, NULL, NULL);
+	for (i = 0; i < coverage_ranges_count; i++)
+		coverage_ranges[i].table->methods_done = true;
+
+	coverage_enabled = false;
+	coverage_ranges_count = 0;
+	coverage_tables_seen = 0;
+	coverage_last = NULL;
+	pthread_mutex_unlock(&coverage_mutex);
+}
+
+/*
+ *  fwts_acpica_coverage_get()
+ *	get the coverage of all the AML tables seen
+ */
+fwts_acpica_coverage_table * const *fwts_acpica_coverage_get(size_t *count)
+{
+	*count = coverage_tables_count;
+
+	return coverage_tables;
+}
+
+/*
+ *  fwts_acpica_coverage_free()
+ *	free the coverage collected
+ */
+void fwts_acpica_coverage_free(void)
+{
+	size_t i, j;
+
+	pthread_mutex_lock(&coverage_mutex);
+	for (i = 0; i < coverage_tables_count; i++) {
+		fwts_acpica_coverage_table *table = coverage_tables[i];
+
+		for (j = 0; j < table->methods_count; j++)
+			free(table->methods[j].path);
+		free(table->methods);
+		(void)munmap(table->executed, (table->header.length + 7) / 8);
+		free(table);
+	}
+	free(coverage_tables);
+	coverage_tables = NULL;
+	coverage_tables_count = 0;
+	pthread_mutex_unlock(&coverage_mutex);
+}
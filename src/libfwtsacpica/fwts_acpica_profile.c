@@ -0,0 +1,581 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  AML execution profiler.
+ *
+ *  ACPICA calls the AcpiEx*Trace* hooks on control method entry and exit
+ *  and on every opcode it executes.  The originals are renamed to
+ *  __AcpiEx*Trace* (see extrace_munged.c) and wrapped here; when profiling
+ *  is not enabled the wrappers only add a flag test.  When enabled, calls,
+ *  inclusive and exclusive wall time, opcodes executed, While loop
+ *  iterations and OpRegion accesses are accumulated per control method.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "fwts.h"
+
+#include "acpi.h"
+#include "accommon.h"
+#include "acinterp.h"
+#include "acparser.h"
+#include "acnamesp.h"
+#include "amlcode.h"
+
+#define PROFILE_MAX_DEPTH		(256)	/* Deepest method nesting tracked */
+#define PROFILE_TABLE_SIZE		(256)	/* Initial hash table size, power of 2 */
+#define PROFILE_SPACES			(ACPI_NUM_PREDEFINED_REGIONS + 1)
+#define PROFILE_LOG_METHODS		(50)	/* Methods listed in the results log */
+#define PROFILE_LOG_LOOPS		(10)	/* Hot loops listed in the results log */
+
+/*
+ *  Per control method statistics
+ */
+typedef struct {
+	ACPI_NAMESPACE_NODE *node;		/* Method node, valid until ACPICA terminates */
+	char		*path;			/* Fully qualified method name */
+	uint64_t	calls;			/* Times method was invoked */
+	uint64_t	inclusive_ns;		/* Wall time including callees */
+	uint64_t	exclusive_ns;		/* Wall time excluding callees */
+	uint64_t	opcodes;		/* AML opcodes executed */
+	uint64_t	loops;			/* While loop iterations */
+	uint64_t	regions[PROFILE_SPACES];/* OpRegion accesses by space id */
+	int		active;			/* Nested activations, for recursion */
+} fwts_aml_profile;
+
+/*
+ *  Per thread method call stack frame
+ */
+typedef struct {
+	fwts_aml_profile *profile;		/* Method being executed */
+	uint64_t	start_ns;		/* When it was entered */
+	uint64_t	child_ns;		/* Time spent in its callees */
+} fwts_aml_profile_frame;
+
+void __AcpiExStartTraceMethod(ACPI_NAMESPACE_NODE *MethodNode,
+	ACPI_OPERAND_OBJECT *ObjDesc, ACPI_WALK_STATE *WalkState);
+void __AcpiExStopTraceMethod(ACPI_NAMESPACE_NODE *MethodNode,
+	ACPI_OPERAND_OBJECT *ObjDesc, ACPI_WALK_STATE *WalkState);
+void __AcpiExStartTraceOpcode(ACPI_PARSE_OBJECT *Op, ACPI_WALK_STATE *WalkState);
+void __AcpiExStopTraceOpcode(ACPI_PARSE_OBJECT *Op, ACPI_WALK_STATE *WalkState);
+
+static volatile bool		profile_enabled;		/* Profiling hooks active */
+static pthread_mutex_t		profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static fwts_aml_profile		**profile_table;		/* Hash of profiles keyed by node */
+static size_t			profile_table_size;
+static size_t			profile_count;
+static bool			profile_json_started;		/* JSON file has been written to */
+
+static __thread fwts_aml_profile_frame	profile_frames[PROFILE_MAX_DEPTH];
+static __thread int			profile_depth;
+
+/*
+ *  profile_now()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t profile_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  profile_hash()
+ *	hash a namespace node pointer into the profile table
+ */
+static inline size_t profile_hash(const ACPI_NAMESPACE_NODE *node, const size_t size)
+{
+	uint64_t h = (uint64_t)(uintptr_t)node;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+
+	return (size_t)h & (size - 1);
+}
+
+/*
+ *  profile_table_grow()
+ *	double the size of the profile hash table
+ */
+static int profile_table_grow(void)
+{
+	fwts_aml_profile **table;
+	size_t i, size = profile_table_size ? profile_table_size * 2 : PROFILE_TABLE_SIZE;
+
+	if ((table = calloc(size, sizeof(*table))) == NULL)
+		return FWTS_OUT_OF_MEMORY;
+
+	for (i = 0; i < profile_table_size; i++) {
+		size_t h;
+
+		if (!profile_table[i])
+			continue;
+		h = profile_hash(profile_table[i]->node, size);
+		while (table[h])
+			h = (h + 1) & (size - 1);
+		table[h] = profile_table[i];
+	}
+	free(profile_table);
+	profile_table = table;
+	profile_table_size = size;
+
+	return FWTS_OK;
+}
+
+/*
+ *  profile_lookup()
+ *	find or add the profile for a method node, called with profile_mutex held
+ */
+static fwts_aml_profile *profile_lookup(ACPI_NAMESPACE_NODE *node)
+{
+	fwts_aml_profile *profile;
+	char *path;
+	size_t h;
+	UINT32 size;
+
+	if ((profile_count + 1) * 2 > profile_table_size)
+		if (profile_table_grow() != FWTS_OK)
+			return NULL;
+
+	h = profile_hash(node, profile_table_size);
+	while (profile_table[h]) {
+		if (profile_table[h]->node == node)
+			return profile_table[h];
+		h = (h + 1) & (profile_table_size - 1);
+	}
+
+	if ((profile = calloc(1, sizeof(*profile))) == NULL)
+		return NULL;
+	size = AcpiNsBuildNormalizedPath(node, NULL, 0, TRUE);
+	if ((path = malloc(size ? size : 1)) == NULL) {
+		free(profile);
+		return NULL;
+	}
+	*path = '\0';
+	(void)AcpiNsBuildNormalizedPath(node, path, size, TRUE);
+	profile->path = path;
+	profile->node = node;
+	profile_table[h] = profile;
+	profile_count++;
+
+	return profile;
+}
+
+/*
+ *  profile_method_begin()
+ *	push a frame for a method being entered
+ */
+static void profile_method_begin(ACPI_NAMESPACE_NODE *node)
+{
+	fwts_aml_profile *profile;
+	fwts_aml_profile_frame *frame;
+
+	if (!node || (profile_depth >= PROFILE_MAX_DEPTH))
+		return;
+
+	pthread_mutex_lock(&profile_mutex);
+	profile = profile_lookup(node);
+	if (profile) {
+		profile->calls++;
+		profile->active++;
+	}
+	pthread_mutex_unlock(&profile_mutex);
+	if (!profile)
+		return;
+
+	frame = &profile_frames[profile_depth++];
+	frame->profile = profile;
+	frame->child_ns = 0;
+	frame->start_ns = profile_now();
+}
+
+/*
+ *  profile_method_end()
+ *	pop the frame of a method being exited, frames above it belong to
+ *	methods that were aborted and are discarded
+ */
+static void profile_method_end(ACPI_NAMESPACE_NODE *node)
+{
+	const uint64_t now = profile_now();
+	int depth;
+
+	for (depth = profile_depth - 1; depth >= 0; depth--)
+		if (profile_frames[depth].profile->node == node)
+			break;
+	if (depth < 0)
+		return;
+
+	pthread_mutex_lock(&profile_mutex);
+	while (profile_depth > depth) {
+		fwts_aml_profile_frame *frame = &profile_frames[--profile_depth];
+		const uint64_t elapsed = now - frame->start_ns;
+
+		frame->profile->active--;
+		if (profile_depth != depth)
+			continue;
+
+		frame->profile->exclusive_ns += elapsed - frame->child_ns;
+		if (frame->profile->active == 0)
+			frame->profile->inclusive_ns += elapsed;
+		if (profile_depth > 0)
+			profile_frames[profile_depth - 1].child_ns += elapsed;
+	}
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+void AcpiExStartTraceMethod(
+	ACPI_NAMESPACE_NODE	*MethodNode,
+	ACPI_OPERAND_OBJECT	*ObjDesc,
+	ACPI_WALK_STATE		*WalkState)
+{
+	__AcpiExStartTraceMethod(MethodNode, ObjDesc, WalkState);
+
+	/* No walk state, this is a top level evaluation */
+	if (!WalkState)
+		fwts_acpica_budget_begin();
+
+	if (profile_enabled)
+		profile_method_begin(MethodNode);
+}
+
+void AcpiExStopTraceMethod(
+	ACPI_NAMESPACE_NODE	*MethodNode,
+	ACPI_OPERAND_OBJECT	*ObjDesc,
+	ACPI_WALK_STATE		*WalkState)
+{
+	__AcpiExStopTraceMethod(MethodNode, ObjDesc, WalkState);
+
+	/*
+	 *  The exception stack dump also calls this for every method
+	 *  on the walk list, only count the method actually exiting
+	 */
+	if (profile_enabled && (!WalkState || (WalkState->MethodDesc == ObjDesc)))
+		profile_method_end(MethodNode);
+}
+
+void AcpiExStartTraceOpcode(
+	ACPI_PARSE_OBJECT	*Op,
+	ACPI_WALK_STATE		*WalkState)
+{
+	__AcpiExStartTraceOpcode(Op, WalkState);
+
+	/* Table loads parse opcodes too, only count those executed */
+	if (WalkState && Op && ((WalkState->ParseFlags & ACPI_PARSE_MODE_MASK) == ACPI_PARSE_EXECUTE))
+		fwts_acpica_coverage_opcode(Op->Common.Aml);
+
+	if (profile_enabled && profile_depth) {
+		pthread_mutex_lock(&profile_mutex);
+		profile_frames[profile_depth - 1].profile->opcodes++;
+		pthread_mutex_unlock(&profile_mutex);
+	}
+}
+
+void AcpiExStopTraceOpcode(
+	ACPI_PARSE_OBJECT	*Op,
+	ACPI_WALK_STATE		*WalkState)
+{
+	__AcpiExStopTraceOpcode(Op, WalkState);
+
+	/*
+	 *  A While op that completes with its control state still on
+	 *  the stack and the predicate true is looping back for another
+	 *  iteration, a terminated loop has already popped its state
+	 */
+	if (profile_enabled && profile_depth && WalkState && Op &&
+	    (Op->Common.AmlOpcode == AML_WHILE_OP)) {
+		ACPI_GENERIC_STATE *state = WalkState->ControlState;
+
+		if (state && (state->Control.Opcode == AML_WHILE_OP) &&
+		    (state->Control.AmlPredicateStart == Op->Common.Aml) &&
+		    state->Common.Value) {
+			pthread_mutex_lock(&profile_mutex);
+			profile_frames[profile_depth - 1].profile->loops++;
+			pthread_mutex_unlock(&profile_mutex);
+		}
+	}
+}
+
+/*
+ *  fwts_acpica_profile_region()
+ *	account an OpRegion access to the method currently executing
+ */
+void fwts_acpica_profile_region(const uint8_t space_id)
+{
+	if (!profile_enabled || !profile_depth)
+		return;
+
+	pthread_mutex_lock(&profile_mutex);
+	profile_frames[profile_depth - 1].profile->regions[
+		space_id < ACPI_NUM_PREDEFINED_REGIONS ?
+		space_id : ACPI_NUM_PREDEFINED_REGIONS]++;
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+/*
+ *  fwts_acpica_profile_start()
+ *	start profiling AML execution
+ */
+void fwts_acpica_profile_start(void)
+{
+	profile_depth = 0;
+	profile_enabled = true;
+}
+
+/*
+ *  fwts_acpica_profile_enabled()
+ *	true if AML is being profiled
+ */
+bool fwts_acpica_profile_enabled(void)
+{
+	return profile_enabled;
+}
+
+/*
+ *  fwts_acpica_profile_stop()
+ *	stop profiling, must be called before ACPICA is terminated
+ */
+void fwts_acpica_profile_stop(void)
+{
+	profile_enabled = false;
+	profile_depth = 0;
+
+	/* Method nodes are about to be freed */
+	pthread_mutex_lock(&profile_mutex);
+	if (profile_table) {
+		size_t i;
+
+		for (i = 0; i < profile_table_size; i++)
+			if (profile_table[i])
+				profile_table[i]->node = NULL;
+	}
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+static int profile_cmp_inclusive(const void *a, const void *b)
+{
+	const fwts_aml_profile *pa = *(fwts_aml_profile * const *)a;
+	const fwts_aml_profile *pb = *(fwts_aml_profile * const *)b;
+
+	if (pa->inclusive_ns != pb->inclusive_ns)
+		return pa->inclusive_ns < pb->inclusive_ns ? 1 : -1;
+	return strcmp(pa->path, pb->path);
+}
+
+static int profile_cmp_loops(const void *a, const void *b)
+{
+	const fwts_aml_profile *pa = *(fwts_aml_profile * const *)a;
+	const fwts_aml_profile *pb = *(fwts_aml_profile * const *)b;
+
+	if (pa->loops != pb->loops)
+		return pa->loops < pb->loops ? 1 : -1;
+	return strcmp(pa->path, pb->path);
+}
+
+static uint64_t profile_regions(const fwts_aml_profile *profile)
+{
+	uint64_t total = 0;
+	int i;
+
+	for (i = 0; i < PROFILE_SPACES; i++)
+		total += profile->regions[i];
+
+	return total;
+}
+
+static const char *profile_space_name(const int space)
+{
+	return space < ACPI_NUM_PREDEFINED_REGIONS ?
+		AcpiUtGetRegionName(space) : "Other";
+}
+
+/*
+ *  profile_json_path()
+ *	write a method path as a JSON string
+ */
+static void profile_json_path(FILE *fp, const char *path)
+{
+	fputc('"', fp);
+	for (; *path; path++) {
+		if ((*path == '\\') || (*path == '"'))
+			fputc('\\', fp);
+		fputc(*path, fp);
+	}
+	fputc('"', fp);
+}
+
+/*
+ *  profile_json_write()
+ *	add the profiles of this ACPICA session to the JSON profile file,
+ *	the file holds an array with an object for each test and is kept
+ *	valid JSON after each session is appended
+ */
+static int profile_json_write(
+	fwts_framework *fw,
+	fwts_aml_profile **profiles,
+	const size_t count)
+{
+	FILE *fp;
+	size_t i;
+	int j;
+
+	if (profile_json_started) {
+		if ((fp = fopen(fw->aml_profile_file, "r+")) == NULL)
+			return FWTS_ERROR;
+		/* Overwrite the closing "\n]\n" */
+		if (fseek(fp, -3, SEEK_END) < 0) {
+			(void)fclose(fp);
+			return FWTS_ERROR;
+		}
+		fprintf(fp, ",\n");
+	} else {
+		if ((fp = fopen(fw->aml_profile_file, "w")) == NULL)
+			return FWTS_ERROR;
+		fprintf(fp, "[\n");
+	}
+
+	fprintf(fp, "  {\n    \"test\": \"%s\",\n    \"methods\": [",
+		fw->current_major_test ? fw->current_major_test->name : "");
+	for (i = 0; i < count; i++) {
+		const fwts_aml_profile *profile = profiles[i];
+		bool first = true;
+
+		fprintf(fp, "%s\n      {\n        \"method\": ", i ? "," : "");
+		profile_json_path(fp, profile->path);
+		fprintf(fp, ",\n"
+			"        \"calls\": %" PRIu64 ",\n"
+			"        \"inclusive_ns\": %" PRIu64 ",\n"
+			"        \"exclusive_ns\": %" PRIu64 ",\n"
+			"        \"opcodes\": %" PRIu64 ",\n"
+			"        \"loop_iterations\": %" PRIu64 ",\n"
+			"        \"region_accesses\": {",
+			profile->calls, profile->inclusive_ns,
+			profile->exclusive_ns, profile->opcodes, profile->loops);
+		for (j = 0; j < PROFILE_SPACES; j++) {
+			if (!profile->regions[j])
+				continue;
+			fprintf(fp, "%s \"%s\": %" PRIu64, first ? "" : ",",
+				profile_space_name(j), profile->regions[j]);
+			first = false;
+		}
+		fprintf(fp, " }\n      }");
+	}
+	fprintf(fp, "\n    ]\n  }\n]\n");
+	(void)fclose(fp);
+
+	profile_json_started = true;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_acpica_profile_report()
+ *	log the profile of the AML executed since profiling was started,
+ *	write it to the JSON profile file if one was given and free it
+ */
+void fwts_acpica_profile_report(fwts_framework *fw)
+{
+	fwts_aml_profile **profiles;
+	uint64_t regions[PROFILE_SPACES];
+	size_t i, n = 0, loops = 0;
+	int j;
+
+	if (!profile_table)
+		return;
+
+	if ((profiles = calloc(profile_count ? profile_count : 1, sizeof(*profiles))) == NULL) {
+		fwts_log_error(fw, "Cannot allocate AML profile report.");
+		goto free_profiles;
+	}
+
+	memset(regions, 0, sizeof(regions));
+	for (i = 0; i < profile_table_size; i++) {
+		if (!profile_table[i])
+			continue;
+		profiles[n++] = profile_table[i];
+		for (j = 0; j < PROFILE_SPACES; j++)
+			regions[j] += profile_table[i]->regions[j];
+		if (profile_table[i]->loops)
+			loops++;
+	}
+	qsort(profiles, n, sizeof(*profiles), profile_cmp_inclusive);
+
+	fwts_log_nl(fw);
+	fwts_log_info(fw, "AML profile of %zu control methods, sorted by inclusive time:", n);
+	fwts_log_info_verbatim(fw, "    Calls  Incl (ms)  Excl (ms)   Opcodes    Loops  Regions  Method");
+	for (i = 0; i < n && i < PROFILE_LOG_METHODS; i++)
+		fwts_log_info_verbatim(fw, "%9" PRIu64 " %10.3f %10.3f %9" PRIu64
+			" %8" PRIu64 " %8" PRIu64 "  %s",
+			profiles[i]->calls,
+			(double)profiles[i]->inclusive_ns / 1000000.0,
+			(double)profiles[i]->exclusive_ns / 1000000.0,
+			profiles[i]->opcodes, profiles[i]->loops,
+			profile_regions(profiles[i]), profiles[i]->path);
+	if (n > PROFILE_LOG_METHODS)
+		fwts_log_info_verbatim(fw, "  (%zu more control methods not shown)",
+			n - PROFILE_LOG_METHODS);
+
+	if (loops) {
+		qsort(profiles, n, sizeof(*profiles), profile_cmp_loops);
+		fwts_log_info(fw, "Hot loops, control methods with the most While loop iterations:");
+		for (i = 0; i < loops && i < PROFILE_LOG_LOOPS; i++)
+			fwts_log_info_verbatim(fw, "%9" PRIu64 " iterations, %" PRIu64
+				" opcodes in %" PRIu64 " calls  %s",
+				profiles[i]->loops, profiles[i]->opcodes,
+				profiles[i]->calls, profiles[i]->path);
+	}
+
+	for (j = 0; j < PROFILE_SPACES; j++) {
+		if (!regions[j])
+			continue;
+		fwts_log_info(fw, "%" PRIu64 " %s OpRegion accesses.",
+			regions[j], profile_space_name(j));
+	}
+	fwts_log_nl(fw);
+
+	if (fw->aml_profile_file) {
+		qsort(profiles, n, sizeof(*profiles), profile_cmp_inclusive);
+		if (profile_json_write(fw, profiles, n) != FWTS_OK)
+			fwts_log_error(fw, "Cannot write AML profile to %s.",
+				fw->aml_profile_file);
+	}
+	free(profiles);
+
+free_profiles:
+	pthread_mutex_lock(&profile_mutex);
+	for (i = 0; i < profile_table_size; i++) {
+		if (profile_table[i]) {
+			free(profile_table[i]->path);
+			free(profile_table[i]);
+		}
+	}
+	free(profile_table);
+	profile_table = NULL;
+	profile_table_size = 0;
+	profile_count = 0;
+	pthread_mutex_unlock(&profile_mutex);
+}
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  Serialise the initialised ACPICA namespace into a snapshot, see
+ *  fwts_acpi_namespace.h for the layout and fwts_acpi_namespace.c
+ *  for loading it again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fwts.h"
+
+#include "acpi.h"
+#include "accommon.h"
+#include "acnamesp.h"
+#include "acdispat.h"
+#include "acinterp.h"
+
+typedef struct {
+	uint8_t		*data;
+	size_t		len;
+	size_t		size;
+} snapshot_pool;
+
+typedef struct {
+	snapshot_pool	tables;
+	snapshot_pool	nodes;
+	snapshot_pool	data;
+	const ACPI_TABLE_HEADER *aml[ACPI_MAX_TABLES];	/* AML tables, by snapshot table index */
+	uint32_t	aml_count;
+} snapshot_state;
+
+/*
+ *  snapshot_append()
+ *	append data to a pool, returning its offset, or -1 if out of memory
+ */
+static int64_t snapshot_append(snapshot_pool *pool, const void *data, const size_t len)
+{
+	const size_t offset = pool->len;
+
+	if (pool->len + len > pool->size) {
+		size_t size = pool->size ? pool->size : 4096;
+		uint8_t *ptr;
+
+		while (size < pool->len + len)
+			size *= 2;
+		if ((ptr = realloc(pool->data, size)) == NULL)
+			return -1;
+		pool->data = ptr;
+		pool->size = size;
+	}
+	memcpy(pool->data + pool->len, data, len);
+	pool->len += len;
+
+	return (int64_t)offset;
+}
+
+/*
+ *  snapshot_table()
+ *	find the snapshot index of the AML table holding some AML
+ */
+static uint32_t snapshot_table(snapshot_state *state, const uint8_t *aml)
+{
+	fwts_acpi_namespace_file_table table;
+	UINT32 i;
+
+	for (i = 0; i < state->aml_count; i++) {
+		const uint8_t *base = (const uint8_t *)state->aml[i];
+
+		if ((aml >= base) && (aml < base + state->aml[i]->Length))
+			return i;
+	}
+
+	for (i = 0; i < AcpiGbl_RootTableList.CurrentTableCount; i++) {
+		const ACPI_TABLE_HEADER *header = AcpiGbl_RootTableList.Tables[i].Pointer;
+
+		if (!header || (aml < (const uint8_t *)header) ||
+		    (aml >= (const uint8_t *)header + header->Length))
+			continue;
+		if (state->aml_count >= ACPI_MAX_TABLES)
+			break;
+
+		memcpy(table.signature, header->Signature, sizeof(table.signature));
+		memcpy(table.oem_tbl_id, header->OemTableId, sizeof(table.oem_tbl_id));
+		table.length = header->Length;
+		if (snapshot_append(&state->tables, &table, sizeof(table)) < 0)
+			break;
+		state->aml[state->aml_count] = header;
+		return state->aml_count++;
+	}
+
+	return FWTS_ACPI_NAMESPACE_NONE;
+}
+
+/*
+ *  snapshot_value()
+ *	add the static value of a data object to the snapshot node
+ */
+static int snapshot_value(
+	snapshot_state *state,
+	ACPI_NAMESPACE_NODE *ns_node,
+	ACPI_OPERAND_OBJECT *obj,
+	fwts_acpi_namespace_file_node *node)
+{
+	const void *value = NULL;
+	int64_t offset;
+
+	switch (obj->Common.Type) {
+	case ACPI_TYPE_INTEGER:
+		node->value_type = FWTS_ACPI_NAMESPACE_VALUE_INTEGER;
+		node->integer = obj->Integer.Value;
+		return FWTS_OK;
+	case ACPI_TYPE_STRING:
+		value = obj->String.Pointer;
+		node->value_length = obj->String.Length;
+		node->value_type = FWTS_ACPI_NAMESPACE_VALUE_STRING;
+		break;
+	case ACPI_TYPE_BUFFER:
+		/*
+		 *  The arguments of a Name() buffer are not evaluated until it
+		 *  is first used, any other buffer not yet valid is skipped
+		 */
+		if (!(obj->Common.Flags & AOPOBJ_DATA_VALID)) {
+			ACPI_STATUS status;
+
+			if (obj->Buffer.Node != ns_node)
+				return FWTS_OK;
+			AcpiExEnterInterpreter();
+			status = AcpiDsGetBufferArguments(obj);
+			AcpiExExitInterpreter();
+			if (ACPI_FAILURE(status))
+				return FWTS_OK;
+		}
+		value = obj->Buffer.Pointer;
+		node->value_length = obj->Buffer.Length;
+		node->value_type = FWTS_ACPI_NAMESPACE_VALUE_BUFFER;
+		break;
+	default:
+		return FWTS_OK;
+	}
+
+	if (!value || !node->value_length) {
+		node->value_length = 0;
+		return FWTS_OK;
+	}
+	if ((offset = snapshot_append(&state->data, value, node->value_length)) < 0)
+		return FWTS_OUT_OF_MEMORY;
+	node->value_offset = (uint32_t)offset;
+
+	return FWTS_OK;
+}
+
+/*
+ *  snapshot_node_add()
+ *	add a namespace node to the snapshot
+ */
+static int snapshot_node_add(snapshot_state *state, const fwts_acpica_node *record)
+{
+	ACPI_NAMESPACE_NODE *ns_node = (ACPI_NAMESPACE_NODE *)record->handle;
+	ACPI_OPERAND_OBJECT *obj = AcpiNsGetAttachedObject(ns_node);
+	fwts_acpi_namespace_file_node node;
+
+	memset(&node, 0, sizeof(node));
+	node.parent = record->parent;
+	memcpy(node.name, record->name, sizeof(node.name));
+	node.path = record->path;
+	node.type = record->type;
+	node.table = FWTS_ACPI_NAMESPACE_NONE;
+
+	if (obj && (record->type == ACPI_TYPE_METHOD)) {
+		node.args = obj->Method.ParamCount;
+		if (!(obj->Method.InfoFlags & ACPI_METHOD_INTERNAL_ONLY) && obj->Method.AmlStart) {
+			node.table = snapshot_table(state, obj->Method.AmlStart);
+			if (node.table != FWTS_ACPI_NAMESPACE_NONE) {
+				node.aml_offset = (uint32_t)(obj->Method.AmlStart -
+					(const uint8_t *)state->aml[node.table]);
+				node.aml_length = obj->Method.AmlLength;
+			}
+		}
+	} else if (obj && (snapshot_value(state, ns_node, obj, &node) != FWTS_OK))
+		return FWTS_OUT_OF_MEMORY;
+
+	if (snapshot_append(&state->nodes, &node, sizeof(node)) < 0)
+		return FWTS_OUT_OF_MEMORY;
+
+	return FWTS_OK;
+}
+
+/*
+ *  fwts_acpica_namespace_snapshot()
+ *	serialise the namespace into a snapshot, the caller frees *data
+ */
+int fwts_acpica_namespace_snapshot(const uint64_t fingerprint, void **data, size_t *length)
+{
+	fwts_acpi_namespace_file_header header;
+	fwts_acpica_nodes *nodes;
+	snapshot_state *state;
+	uint8_t *ptr;
+	size_t i;
+	int ret = FWTS_OUT_OF_MEMORY;
+
+	*data = NULL;
+	*length = 0;
+
+	/* Node paths and parents are as the records, so is the string pool */
+	if ((nodes = fwts_acpica_get_nodes()) == NULL)
+		return FWTS_OUT_OF_MEMORY;
+	if ((state = calloc(1, sizeof(*state))) == NULL) {
+		fwts_acpica_nodes_free(nodes);
+		return FWTS_OUT_OF_MEMORY;
+	}
+
+	for (i = 0; i < nodes->count; i++)
+		if (snapshot_node_add(state, &nodes->nodes[i]) != FWTS_OK)
+			goto free_state;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FWTS_ACPI_NAMESPACE_MAGIC, sizeof(header.magic));
+	header.version = FWTS_ACPI_NAMESPACE_VERSION;
+	header.tables = state->aml_count;
+	header.nodes = nodes->count;
+	header.strings_size = nodes->strings_size;
+	header.data_size = state->data.len;
+	header.fingerprint = fingerprint;
+
+	*length = sizeof(header) + state->tables.len + state->nodes.len +
+		nodes->strings_size + state->data.len;
+	if ((ptr = malloc(*length)) == NULL) {
+		*length = 0;
+		goto free_state;
+	}
+	*data = ptr;
+
+	memcpy(ptr, &header, sizeof(header));
+	ptr += sizeof(header);
+	if (state->tables.len)
+		memcpy(ptr, state->tables.data, state->tables.len);
+	ptr += state->tables.len;
+	if (state->nodes.len)
+		memcpy(ptr, state->nodes.data, state->nodes.len);
+	ptr += state->nodes.len;
+	if (nodes->strings_size)
+		memcpy(ptr, nodes->strings, nodes->strings_size);
+	ptr += nodes->strings_size;
+	if (state->data.len)
+		memcpy(ptr, state->data.data, state->data.len);
+	ret = FWTS_OK;
+
+free_state:
+	free(state->tables.data);
+	free(state->nodes.data);
+	free(state->data.data);
+	free(state);
+	fwts_acpica_nodes_free(nodes);
+
+	return ret;
+}
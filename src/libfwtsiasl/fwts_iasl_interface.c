@@ -28,6 +28,8 @@
 #include "aslcompiler.h"
 #include "acdisasm.h"
 #include "acapps.h"
+#include "acparser.h"
+#include "actables.h"
 
 static void AslInitialize(void)
 {
@@ -63,7 +65,8 @@ static void init_asl_core(void)
 
 /*
  *  fwts_iasl_disassemble_aml()
- *	invoke iasl to disassemble AML
+ *	invoke iasl to disassemble AML, for a listing the AML
+ *	byte code of each statement is dumped after it
  */
 int fwts_iasl_disassemble_aml(
 	char *tables[],
@@ -71,6 +74,7 @@ int fwts_iasl_disassemble_aml(
 	const int table_entries,
 	const int which,
 	const bool use_externals,
+	const bool listing,
 	const char *outputfile)
 {
 	pid_t	pid;
@@ -97,6 +101,7 @@ int fwts_iasl_disassemble_aml(
 		AslGbl_UseDefaultAmlFilename = FALSE;
 		AcpiGbl_CstyleDisassembly = FALSE;
 		AcpiGbl_DmOpt_Verbose = FALSE;
+		AcpiGbl_DmOpt_Listing = listing;
 		AslGbl_ParserErrorDetected = FALSE;
 		UtConvertBackslashes (AslGbl_OutputFilenamePrefix);
 
@@ -155,6 +160,256 @@ int fwts_iasl_disassemble_aml(
 	return 0;
 }
 
+/*
+ *  A disassembly session, each target table is disassembled
+ *  with all the external tables loaded except for itself
+ */
+typedef struct {
+	char	**tables;		/* Table file names */
+	char	**names;		/* Table names */
+	const int *which;		/* Indexes of tables to disassemble */
+	char	**outputfiles;		/* Disassembly output file of each */
+	bool	use_externals;
+} fwts_iasl_session;
+
+extern ACPI_PARSE_OBJECT *AcpiGbl_ParseOpRoot;
+
+/*
+ *  fwts_iasl_session_external()
+ *	is a table an external table for the disassembly of others
+ */
+static bool fwts_iasl_session_external(const fwts_iasl_session *session, const int i)
+{
+	return session->use_externals &&
+	       (session->names[i] != NULL) &&
+	       (session->tables[i] != NULL) &&
+	       (!strcmp(session->names[i], "SSDT") ||
+		!strcmp(session->names[i], "DSDT"));
+}
+
+/*
+ *  fwts_iasl_session_load()
+ *	parse an external table into the namespace for
+ *	symbol resolution, as AdDoExternalFileList() does
+ */
+static ACPI_STATUS fwts_iasl_session_load(const fwts_iasl_session *session, const int i)
+{
+	ACPI_NEW_TABLE_DESC *list = NULL;
+	ACPI_STATUS status;
+
+	if (!fwts_iasl_session_external(session, i))
+		return AE_OK;
+
+	/* The table manager has to grow as tables are loaded */
+	if (!(AcpiGbl_RootTableList.Flags & ACPI_ROOT_ALLOW_RESIZE)) {
+		status = AcpiAllocateRootTable(4);
+		if (ACPI_FAILURE(status))
+			return status;
+	}
+
+	status = AcGetAllTablesFromFile(session->tables[i], ACPI_GET_ONLY_AML_TABLES, &list);
+	if (ACPI_FAILURE(status))
+		return status;
+
+	/* The tables stay in use by the table manager */
+	for (; list; list = list->Next) {
+		ACPI_OWNER_ID owner_id;
+
+		status = AdParseTable(list->Table, &owner_id, TRUE, TRUE);
+		if (ACPI_FAILURE(status))
+			return status;
+		AcpiDmFinishNamespaceLoad(AcpiGbl_ParseOpRoot, AcpiGbl_RootNode, owner_id);
+		AcpiPsDeleteParseTree(AcpiGbl_ParseOpRoot);
+		AcpiGbl_ParseOpRoot = NULL;
+	}
+
+	return AE_OK;
+}
+
+/*
+ *  fwts_iasl_session_load_range()
+ *	load the external tables of targets lo..hi-1, last first
+ *	as iasl -e orders them, and exit if any fail to load
+ */
+static void fwts_iasl_session_load_range(const fwts_iasl_session *session, const int lo, const int hi)
+{
+	int i;
+
+	for (i = hi - 1; i >= lo; i--)
+		if (ACPI_FAILURE(fwts_iasl_session_load(session, session->which[i])))
+			_exit(1);
+
+	/* Clear external list generated by Scope in external tables */
+	if (AcpiGbl_ExternalList)
+		AcpiDmClearExternalList();
+}
+
+/*
+ *  fwts_iasl_session_disassemble()
+ *	disassemble target k against the namespace loaded so far
+ */
+static void fwts_iasl_session_disassemble(const fwts_iasl_session *session, const int k)
+{
+	/*
+	 *  AslDoDisassembly() resizes the table manager assuming it
+	 *  holds no more than 4 tables, so make it copy all the
+	 *  loaded tables into a new array rather than just the first 4
+	 */
+	AcpiGbl_RootTableList.Flags &= ~ACPI_ROOT_ORIGIN_ALLOCATED;
+
+	AslGbl_OutputFilenamePrefix = session->outputfiles[k];
+	UtConvertBackslashes(AslGbl_OutputFilenamePrefix);
+
+	AslDoOneFile(session->tables[session->which[k]]);
+	UtFreeLineBuffers();
+	AslParserCleanup();
+}
+
+/*
+ *  fwts_iasl_session_run()
+ *	disassemble targets lo..hi-1, the namespace holds all the
+ *	external tables other than those of these targets.  Each
+ *	half of the targets is handed to a child that loads the
+ *	external tables of the other half, so every table is
+ *	parsed O(log N) times rather than O(N) times.  Up to jobs
+ *	children run at the same time.
+ */
+static void fwts_iasl_session_run(
+	const fwts_iasl_session *session,
+	const int lo,
+	const int hi,
+	const int jobs)
+{
+	pid_t pids[2];
+	int status, mid, i;
+
+	if (hi - lo < 1)
+		return;
+
+	if (hi - lo == 1) {
+		if ((pids[0] = fork()) == 0) {
+			fwts_iasl_session_disassemble(session, lo);
+			_exit(0);
+		}
+		if (pids[0] > 0)
+			(void)waitpid(pids[0], &status, 0);
+		return;
+	}
+
+	mid = lo + (hi - lo) / 2;
+	for (i = 0; i < 2; i++) {
+		const int child_jobs = (jobs > 1) ? (i ? jobs - jobs / 2 : jobs / 2) : 1;
+
+		if ((pids[i] = fork()) == 0) {
+			if (i == 0) {
+				fwts_iasl_session_load_range(session, mid, hi);
+				fwts_iasl_session_run(session, lo, mid, child_jobs);
+			} else {
+				fwts_iasl_session_load_range(session, lo, mid);
+				fwts_iasl_session_run(session, mid, hi, child_jobs);
+			}
+			_exit(0);
+		}
+		/* Run the halves one after the other if there are no jobs to spare */
+		if ((pids[i] > 0) && (jobs < 2))
+			(void)waitpid(pids[i], &status, 0);
+	}
+	if (jobs >= 2) {
+		for (i = 0; i < 2; i++)
+			if (pids[i] > 0)
+				(void)waitpid(pids[i], &status, 0);
+	}
+}
+
+/*
+ *  fwts_iasl_disassemble_session_aml()
+ *	invoke iasl to disassemble a set of tables, loading the
+ *	external tables for all of them in one session rather
+ *	than once per table, with up to jobs disassemblies
+ *	running at the same time
+ */
+int fwts_iasl_disassemble_session_aml(
+	char *tables[],
+	char *names[],
+	const int table_entries,
+	const int which[],
+	char *outputfiles[],
+	const int count,
+	const bool use_externals,
+	const bool listing,
+	const int jobs)
+{
+	fwts_iasl_session session = {
+		.tables = tables,
+		.names = names,
+		.which = which,
+		.outputfiles = outputfiles,
+		.use_externals = use_externals,
+	};
+	pid_t	pid;
+	int	status;
+	FILE	*fpout, *fperr;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	pid = fork();
+	switch (pid) {
+	case -1:
+		return -1;
+	case 0:
+		/* Child */
+		init_asl_core();
+
+		/* Setup ACPICA disassembler globals */
+		AslGbl_WarningLevel = ASL_WARNING3;
+		AslGbl_IgnoreErrors = TRUE;
+		AcpiGbl_DisasmFlag = TRUE;
+		AslGbl_DoCompile = FALSE;
+		AslGbl_UseDefaultAmlFilename = FALSE;
+		AcpiGbl_CstyleDisassembly = FALSE;
+		AcpiGbl_DmOpt_Verbose = FALSE;
+		AcpiGbl_DmOpt_Listing = listing;
+		AslGbl_ParserErrorDetected = FALSE;
+
+		/* Throw away noisy errors */
+		if ((fpout = freopen("/dev/null", "w", stdout)) == NULL) {
+			_exit(1);
+		}
+		if ((fperr = freopen("/dev/null", "w", stderr)) == NULL) {
+			(void)fclose(fpout);
+			_exit(1);
+		}
+		AdInitialize();
+
+		/* External tables that are not disassembled are needed by all */
+		if (use_externals) {
+			int i, j;
+
+			for (i = table_entries - 1; i >= 0; i--) {
+				for (j = 0; (j < count) && (which[j] != i); j++)
+					;
+				if ((j == count) &&
+				    ACPI_FAILURE(fwts_iasl_session_load(&session, i)))
+					_exit(1);
+			}
+			if (AcpiGbl_ExternalList)
+				AcpiDmClearExternalList();
+		}
+		fwts_iasl_session_run(&session, 0, count, jobs);
+
+		(void)fclose(fperr);
+		(void)fclose(fpout);
+		_exit(0);
+		break;
+	default:
+		/* Parent */
+		(void)waitpid(pid, &status, WUNTRACED | WCONTINUED);
+	}
+
+	return 0;
+}
+
 /*
  *  fwts_iasl_read_output()
  *	consume output from iasl.
@@ -304,3 +559,12 @@ const char *fwts_iasl_exception_level__(uint8_t level)
 
 	return str;
 }
+
+/*
+ *  fwts_iasl_version__()
+ *	version of the ACPICA compiler and disassembler
+ */
+uint32_t fwts_iasl_version__(void)
+{
+	return ACPI_CA_VERSION;
+}
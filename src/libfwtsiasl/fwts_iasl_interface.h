@@ -25,10 +25,15 @@
 int fwts_iasl_disassemble_aml(
 	char *tables[], char *names[], const int table_entries,
 	const int which, const bool use_externals,
-	const char *outputfile);
+	const bool listing, const char *outputfile);
+int fwts_iasl_disassemble_session_aml(
+	char *tables[], char *names[], const int table_entries,
+	const int which[], char *outputfiles[], const int count,
+	const bool use_externals, const bool listing, const int jobs);
 int fwts_iasl_assemble_aml(
 	const char *source, char **stdout_output,
 	char **stderr_output);
 const char *fwts_iasl_exception_level__(uint8_t level);
+uint32_t fwts_iasl_version__(void);
 
 #endif
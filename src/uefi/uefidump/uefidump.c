@@ -25,6 +25,7 @@
 #include <ctype.h>
 
 #include "fwts_uefi.h"
+#include "fwts_efi_module.h"
 
 
 typedef void (*uefidump_func)(fwts_framework *fw, fwts_uefi_var *var);
@@ -1523,6 +1524,14 @@ static void uefidump_var(fwts_framework *fw, fwts_uefi_var *var)
 
 static int uefidump_init(fwts_framework *fw)
 {
+	/* Dump the emulated variables through an efivarfs copy of them */
+	if (fw->flags & FWTS_FLAG_EFI_EMULATOR) {
+		if (fwts_efi_emulator_init(fw) != FWTS_OK ||
+		    fwts_efi_emulator_efivarfs(fw) != FWTS_OK)
+			return FWTS_ABORTED;
+		return FWTS_OK;
+	}
+
 	if (fw->firmware_type != FWTS_FIRMWARE_UEFI) {
 		fwts_log_info(fw, "Cannot detect any UEFI firmware. Aborted.");
 		return FWTS_ABORTED;
@@ -1531,28 +1540,29 @@ static int uefidump_init(fwts_framework *fw)
 	return FWTS_OK;
 }
 
+static int uefidump_deinit(fwts_framework *fw)
+{
+	if (fw->flags & FWTS_FLAG_EFI_EMULATOR)
+		fwts_efi_emulator_deinit();
+
+	return FWTS_OK;
+}
+
 static int uefidump_test1(fwts_framework *fw)
 {
-	fwts_list name_list;
+	fwts_uefi_var_set set;
+	size_t i;
 
-	if (fwts_uefi_get_variable_names(&name_list) == FWTS_ERROR) {
+	if (fwts_uefi_get_variables(&set) == FWTS_ERROR) {
 		fwts_log_info(fw, "Cannot find any UEFI variables.");
 	} else {
-		fwts_list_link *item;
-
-		fwts_list_foreach(item, &name_list) {
-			fwts_uefi_var var;
-			char *name = fwts_list_data(char *, item);
-
-			if (fwts_uefi_get_variable(name, &var) == FWTS_OK) {
-				uefidump_var(fw, &var);
-				fwts_uefi_free_variable(&var);
-				fwts_log_nl(fw);
-			}
+		for (i = 0; i < set.count; i++) {
+			uefidump_var(fw, &set.vars[i]);
+			fwts_log_nl(fw);
 		}
 	}
 
-	fwts_uefi_free_variable_names(&name_list);
+	fwts_uefi_free_variables(&set);
 
 	return FWTS_OK;
 }
@@ -1565,6 +1575,7 @@ static fwts_framework_minor_test uefidump_tests[] = {
 static fwts_framework_ops uefidump_ops = {
 	.description = "Dump UEFI variables.",
 	.init        = uefidump_init,
+	.deinit      = uefidump_deinit,
 	.minor_tests = uefidump_tests
 };
 
@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  *
  */
+#define _GNU_SOURCE	/* for pthread_attr_setaffinity_np */
+
 #include "fwts.h"
 
 #if defined(FWTS_HAS_UEFI)
@@ -23,6 +25,9 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
 
@@ -42,6 +47,18 @@
 						0xDD, 0xB7, 0x11, 0xD0, 0x6E} \
 }
 
+#define TEST_GUID_STRESS \
+{ \
+	0x5C3E8A71, 0x2B4D, 0x4F06, {0x9A, 0x8E, 0x61, \
+						0x0D, 0xC2, 0x47, 0x00, 0x00} \
+}
+
+#define TEST_GUID_CAPACITY \
+{ \
+	0x0E7B4D92, 0x6A1C, 0x4B3F, {0x8D, 0x25, 0xF4, \
+						0x93, 0x1A, 0x6C, 0x58, 0xB0} \
+}
+
 #define MAX_DATA_LENGTH		1024
 
 static int fd;
@@ -55,6 +72,89 @@ static uint32_t uefi_query_variable_multiple = 1024;
 #define UEFI_GET_VARIABLE_MULTIPLE_MAX		(100000)
 #define UEFI_SET_VARIABLE_MULTIPLE_MAX		 (10000)
 #define UEFI_QUERY_VARIABLE_MULTIPLE_MAX	(100000)
+#define UEFI_STRESS_CALLS_MAX			(1000000)
+#define UEFI_STRESS_WEIGHT_MAX			   (1000)
+#define UEFI_CAPACITY_WRITES_MAX		(10000000)
+
+#define UEFI_STRESS_DATA_SIZE		(32)
+#define UEFI_STRESS_NAME_LENGTH		(512)	/* GetNextVariableName buffer, in UCS-2 chars */
+#define UEFI_STRESS_STORE_MAX		(65536)	/* Names walked before assuming a loop */
+
+/* Services issued by the concurrent stress test, in --uefi-stress-mix order */
+enum {
+	UEFI_STRESS_GET,
+	UEFI_STRESS_NEXT,
+	UEFI_STRESS_QUERY,
+	UEFI_STRESS_SET,
+	UEFI_STRESS_OPS
+};
+
+static const char *uefi_stress_op_names[UEFI_STRESS_OPS] = {
+	"GetVariable",
+	"GetNextVariableName",
+	"QueryVariableInfo",
+	"SetVariable",
+};
+
+typedef struct {
+	pthread_t	tid;
+	int		cpu;			/* CPU the thread is pinned to */
+	EFI_GUID	guid;			/* Of the private test variable */
+	uint32_t	random;
+	uint64_t	sequence;		/* Of the last data written */
+	bool		written;		/* Private variable has been written */
+	bool		uncertain;		/* Last SetVariable failed, data unknown */
+	uint16_t	name[UEFI_STRESS_NAME_LENGTH];	/* GetNextVariableName position */
+	EFI_GUID	name_guid;
+	uint64_t	last_status;
+	uint64_t	calls[UEFI_STRESS_OPS];
+	uint64_t	errors[UEFI_STRESS_OPS];
+	uint64_t	mismatches;		/* Calls returning inconsistent data */
+	uint64_t	out_of_resources;
+	uint64_t	device_errors;
+	fwts_efi_histogram latency;
+} uefi_stress_thread;
+
+typedef struct {
+	uint16_t	*name;
+	size_t		length;
+	EFI_GUID	guid;
+} uefi_stress_name;
+
+#define UEFI_CAPACITY_VARS		(16)	/* Variables inserted, updated and deleted */
+#define UEFI_CAPACITY_BATCH		(64)	/* Writes between QueryVariableInfo samples */
+#define UEFI_CAPACITY_CYCLE		(8)	/* Batches before deleting all the variables */
+#define UEFI_CAPACITY_LOG_SAMPLES	(32)	/* Samples logged */
+
+typedef struct {
+	uint16_t	name[16];
+	uint64_t	size;			/* Data size, 0 if not present */
+	bool		present;
+} uefi_capacity_var;
+
+typedef struct {
+	uint64_t	writes;			/* SetVariable calls so far */
+	uint64_t	remaining;		/* Storage with no test variables */
+	double		throughput;		/* Writes per second in the cycle */
+} uefi_capacity_sample;
+
+static EFI_GUID gtestguidstress = TEST_GUID_STRESS;
+static char *uefi_stress_cpus;			/* NULL, stress test not run */
+static char *uefi_stress_mix;
+static cpu_set_t uefi_stress_cpuset;
+static uint32_t uefi_stress_calls = 10000;
+static uint32_t uefi_stress_weights[UEFI_STRESS_OPS] = { 60, 30, 10, 0 };
+static uint32_t uefi_stress_weight_total;
+
+static pthread_mutex_t stress_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stress_cond = PTHREAD_COND_INITIALIZER;
+static bool stress_started;
+static bool stress_abort;
+
+static EFI_GUID gtestguidcapacity = TEST_GUID_CAPACITY;
+static uint32_t uefi_capacity_writes;		/* 0, capacity test not run */
+static uint32_t uefi_capacity_leak = 16;	/* Bytes lost per write */
+static uint32_t uefi_capacity_reclaim = 50;	/* Percent of storage in use */
 
 static uint32_t attributes =
 	FWTS_UEFI_VAR_NON_VOLATILE |
@@ -63,6 +163,7 @@ static uint32_t attributes =
 static uint16_t variablenametest[] = {'T', 'e', 's', 't', 'v', 'a', 'r', '\0'};
 static uint16_t variablenametest2[] = {'T', 'e', 's', 't', 'v', 'a', 'r', ' ', '\0'};
 static uint16_t variablenametest3[] = {'T', 'e', 's', 't', 'v', 'a', '\0'};
+static uint16_t variablenamestress[] = {'F', 'w', 't', 's', 'S', 't', 'r', 'e', 's', 's', '\0'};
 
 static uint32_t runtimeservicessupported;
 
@@ -79,20 +180,20 @@ static void uefirtvariable_env_cleanup(void)
 	setvariable.Data = &data;
 	status = ~0ULL;
 	setvariable.status = &status;
-	(void)ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	(void)fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	status = ~0ULL;
 	setvariable.VariableName = variablenametest2;
-	(void)ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	(void)fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	status = ~0ULL;
 	setvariable.VariableName = variablenametest3;
-	(void)ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	(void)fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	status = ~0ULL;
 	setvariable.VariableName = variablenametest;
 	setvariable.VendorGuid = &gtestguid2;
-	(void)ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	(void)fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 }
 
 static int uefirtvariable_init(fwts_framework *fw)
@@ -150,7 +251,7 @@ static int getvariable_test(
 	setvariable.Data = data;
 	setvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -190,7 +291,7 @@ static int getvariable_test(
 
 	for (i = 0; i < multitesttime; i++) {
 		status = ~0ULL;
-		ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED) {
 				fwts_skipped(fw, "Skipping test, GetVariable runtime "
@@ -241,7 +342,7 @@ static int getvariable_test(
 	setvariable.DataSize = 0;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
@@ -257,7 +358,7 @@ err_restore_env:
 	setvariable.DataSize = 0;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
@@ -339,7 +440,7 @@ static int getnextvariable_test1(fwts_framework *fw)
 	setvariable.Data = data;
 	setvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -389,7 +490,7 @@ static int getnextvariable_test1(fwts_framework *fw)
 	while (true) {
 		variablenamesize = maxvariablenamesize;
 		status = ~0ULL;
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED) {
@@ -460,7 +561,7 @@ static int getnextvariable_test1(fwts_framework *fw)
 	setvariable.DataSize = 0;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
@@ -476,7 +577,7 @@ err_restore_env:
 	setvariable.DataSize = 0;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
 			"Failed to delete variable with UEFI runtime service.");
@@ -548,7 +649,7 @@ static int getnextvariable_test2(fwts_framework *fw)
 
 		status = ~0ULL;
 		variablenamesize = maxvariablenamesize;
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED) {
@@ -719,7 +820,7 @@ static int getnextvariable_test3(fwts_framework *fw)
 
 		status = ~0ULL;
 		variablenamesize = maxvariablenamesize;
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED) {
@@ -846,7 +947,7 @@ static int getnextvariable_test4(fwts_framework *fw)
 	 */
 	getnextvariablename.VariableName = NULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -868,7 +969,7 @@ static int getnextvariable_test4(fwts_framework *fw)
 	getnextvariablename.VendorGuid = NULL;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 	if (ioret != -1 || status != EFI_INVALID_PARAMETER) {
 		fwts_failed(fw, LOG_LEVEL_HIGH,
@@ -882,7 +983,7 @@ static int getnextvariable_test4(fwts_framework *fw)
 	getnextvariablename.VariableNameSize = NULL;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 	if (ioret != -1 || status != EFI_INVALID_PARAMETER) {
 		fwts_failed(fw, LOG_LEVEL_HIGH,
@@ -904,7 +1005,7 @@ static int getnextvariable_test4(fwts_framework *fw)
 		variablename[0] = '\0';
 		status = ~0ULL;
 
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 		/*
 		 * We expect this machine to have at least some UEFI
@@ -969,7 +1070,7 @@ static int setvariable_insertvariable(
 	setvariable.DataSize = datasize;
 	setvariable.Data = data;
 	setvariable.status = &status;
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -1048,7 +1149,7 @@ static int setvariable_checkvariable(
 	getvariable.Data = testdata;
 	getvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
 			fwts_skipped(fw, "Skipping test, GetVariable runtime "
@@ -1114,7 +1215,7 @@ static int setvariable_checkvariable_notfound(
 	getvariable.Data = testdata;
 	getvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
 	/* expect the uefi runtime interface return EFI_NOT_FOUND */
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -1163,7 +1264,7 @@ static int setvariable_invalidattr(
 	setvariable.Data = data;
 	setvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -1517,7 +1618,7 @@ static int setvariable_test8(fwts_framework *fw)
 	setvariable.Data = &data;
 	setvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (status == EFI_UNSUPPORTED && ioret == -1)
 		return FWTS_OK;
@@ -1547,7 +1648,7 @@ static int do_queryvariableinfo(
 	queryvariableinfo.status = status;
 	*status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo);
 
 	if (ioret == -1)
 		return FWTS_ERROR;
@@ -1589,7 +1690,7 @@ static int getnextvariable_multitest(
 	setvariable.Data = data;
 	setvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -1628,7 +1729,7 @@ static int getnextvariable_multitest(
 		variablename[0] = '\0';
 		variablenamesize = MAX_DATA_LENGTH;
 		status = ~0ULL;
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED) {
@@ -1647,7 +1748,7 @@ static int getnextvariable_multitest(
 	setvariable.DataSize = 0;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
@@ -1662,7 +1763,7 @@ err_restore_env:
 	setvariable.DataSize = 0;
 	status = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
@@ -1996,7 +2097,7 @@ static void getvariable_test_invalid(
 	fwts_log_info(fw, "Testing GetVariable with %s.", test);
 	*(getvariable->status) = ~0ULL;
 
-	ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, getvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, getvariable);
 
 	if (ioret == -1) {
 		if (*(getvariable->status) == EFI_UNSUPPORTED) {
@@ -2052,7 +2153,7 @@ static int uefirtvariable_test8(fwts_framework *fw)
 	setvariable.Data = data;
 	setvariable.status = &status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 
 	if (ioret == -1) {
 		if (status == EFI_UNSUPPORTED) {
@@ -2119,7 +2220,7 @@ static int uefirtvariable_test8(fwts_framework *fw)
 	/* delete the variable */
 	setvariable.DataSize = 0;
 	status = ~0ULL;
-	ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 	if (ioret == -1) {
 		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
 			"Failed to delete variable with UEFI runtime service.");
@@ -2159,7 +2260,7 @@ static int uefirtvariable_test9(fwts_framework *fw)
 		setvariable.Data = &data;
 		setvariable.status = &status;
 
-		ioret = ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED)
 				fwts_passed(fw, "UEFI SetVariable runtime service "
@@ -2194,7 +2295,7 @@ static int uefirtvariable_test9(fwts_framework *fw)
 		getvariable.Data = testdata;
 		getvariable.status = &status;
 
-		ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED)
 				fwts_passed(fw, "UEFI GetVariable runtime service "
@@ -2220,10 +2321,12 @@ static int uefirtvariable_test9(fwts_framework *fw)
 	} else
 		fwts_skipped(fw, "GetVariable runtime service supported, skip test.");
 
-	/* delete the variable which was set */
-	setvariable.DataSize = 0;
-	status = ~0ULL;
-	(void)ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	/* delete the variable which was set, if SetVariable was tried */
+	if (!(runtimeservicessupported & EFI_RT_SUPPORTED_SET_VARIABLE)) {
+		setvariable.DataSize = 0;
+		status = ~0ULL;
+		(void)fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable);
+	}
 
 	variablename = malloc(sizeof(uint16_t) * variablenamesize);
 	if (!variablename) {
@@ -2239,7 +2342,7 @@ static int uefirtvariable_test9(fwts_framework *fw)
 		variablename[0] = '\0';
 		status = ~0ULL;
 
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED)
 				fwts_passed(fw, "UEFI GetNextVarName runtime service "
@@ -2273,7 +2376,7 @@ static int uefirtvariable_test9(fwts_framework *fw)
 		queryvariableinfo.status = &status;
 		status = ~0ULL;
 
-		ioret = ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo);
 		if (ioret == -1) {
 			if (status == EFI_UNSUPPORTED)
 				fwts_passed(fw, "UEFI QueryVarInfo runtime service "
@@ -2306,8 +2409,1045 @@ static int uefirtvariable_test9(fwts_framework *fw)
 	return FWTS_OK;
 }
 
+/*
+ *  stress_random()
+ *	xorshift32, each stress thread has its own state
+ */
+static uint32_t stress_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/*
+ *  stress_pattern()
+ *	data written by a stress thread, unique to the CPU and sequence
+ */
+static void stress_pattern(uint8_t *data, const int cpu, const uint64_t sequence)
+{
+	size_t i;
+
+	for (i = 0; i < UEFI_STRESS_DATA_SIZE; i++)
+		data[i] = (uint8_t)((sequence >> ((i & 7) * 8)) ^ (uint64_t)cpu ^ i);
+}
+
+/*
+ *  stress_getvariable()
+ *	read the shared test variable and check its data
+ */
+static void stress_getvariable(uefi_stress_thread *thread)
+{
+	struct efi_getvariable getvariable;
+	uint8_t data[MAX_DATA_LENGTH];
+	uint64_t datasize = sizeof(data);
+	uint64_t status = ~0ULL;
+	uint32_t attributestest = 0;
+	uint8_t expected[UEFI_STRESS_DATA_SIZE];
+
+	getvariable.VariableName = variablenametest;
+	getvariable.VendorGuid = &gtestguid1;
+	getvariable.Attributes = &attributestest;
+	getvariable.DataSize = &datasize;
+	getvariable.Data = data;
+	getvariable.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable) == -1) {
+		thread->errors[UEFI_STRESS_GET]++;
+		thread->last_status = status;
+		return;
+	}
+
+	stress_pattern(expected, -1, 0);
+	if ((datasize != sizeof(expected)) || memcmp(data, expected, sizeof(expected)))
+		thread->mismatches++;
+}
+
+/*
+ *  stress_getnextvariablename()
+ *	step to the next variable name, starting over at the end of the store
+ */
+static void stress_getnextvariablename(uefi_stress_thread *thread)
+{
+	struct efi_getnextvariablename getnextvariablename;
+	uint64_t namesize = sizeof(thread->name);
+	uint64_t status = ~0ULL;
+
+	getnextvariablename.VariableNameSize = &namesize;
+	getnextvariablename.VariableName = thread->name;
+	getnextvariablename.VendorGuid = &thread->name_guid;
+	getnextvariablename.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename) == -1) {
+		/* End of the store, start again from the first name */
+		if (status != EFI_NOT_FOUND) {
+			thread->errors[UEFI_STRESS_NEXT]++;
+			thread->last_status = status;
+		}
+		memset(thread->name, 0, sizeof(thread->name));
+		memset(&thread->name_guid, 0, sizeof(thread->name_guid));
+	}
+}
+
+/*
+ *  stress_queryvariableinfo()
+ *	query the variable store, the remaining space may change under us
+ */
+static void stress_queryvariableinfo(uefi_stress_thread *thread)
+{
+	struct efi_queryvariableinfo queryvariableinfo;
+	uint64_t status = ~0ULL;
+	uint64_t maxvariablestoragesize, remvariablestoragesize, maxvariablesize;
+
+	queryvariableinfo.Attributes = attributes;
+	queryvariableinfo.MaximumVariableStorageSize = &maxvariablestoragesize;
+	queryvariableinfo.RemainingVariableStorageSize = &remvariablestoragesize;
+	queryvariableinfo.MaximumVariableSize = &maxvariablesize;
+	queryvariableinfo.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo) == -1) {
+		thread->errors[UEFI_STRESS_QUERY]++;
+		thread->last_status = status;
+		return;
+	}
+	if (remvariablestoragesize > maxvariablestoragesize)
+		thread->mismatches++;
+}
+
+/*
+ *  stress_setvariable()
+ *	rewrite the private variable of the thread
+ */
+static void stress_setvariable(uefi_stress_thread *thread)
+{
+	struct efi_setvariable setvariable;
+	uint8_t data[UEFI_STRESS_DATA_SIZE];
+	uint64_t status = ~0ULL;
+
+	stress_pattern(data, thread->cpu, thread->sequence + 1);
+
+	setvariable.VariableName = variablenamestress;
+	setvariable.VendorGuid = &thread->guid;
+	setvariable.Attributes = attributes;
+	setvariable.DataSize = sizeof(data);
+	setvariable.Data = data;
+	setvariable.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable) == -1) {
+		thread->errors[UEFI_STRESS_SET]++;
+		thread->last_status = status;
+		/* The firmware may or may not have written it */
+		if (status != EFI_OUT_OF_RESOURCES)
+			thread->uncertain = true;
+		return;
+	}
+	thread->sequence++;
+	thread->written = true;
+	thread->uncertain = false;
+}
+
+/*
+ *  stress_thread()
+ *	issue the mix of variable services on the pinned CPU
+ */
+static void *stress_thread(void *arg)
+{
+	uefi_stress_thread *thread = (uefi_stress_thread *)arg;
+	uint32_t i;
+
+	pthread_mutex_lock(&stress_mutex);
+	while (!stress_started)
+		pthread_cond_wait(&stress_cond, &stress_mutex);
+	pthread_mutex_unlock(&stress_mutex);
+	if (stress_abort)
+		return NULL;
+
+	for (i = 0; i < uefi_stress_calls; i++) {
+		uint32_t pick = stress_random(&thread->random) % uefi_stress_weight_total;
+		uint64_t start;
+		int op;
+
+		for (op = 0; pick >= uefi_stress_weights[op]; op++)
+			pick -= uefi_stress_weights[op];
+
+		thread->last_status = EFI_SUCCESS;
+		start = fwts_efi_profile_time();
+		switch (op) {
+		case UEFI_STRESS_GET:
+			stress_getvariable(thread);
+			break;
+		case UEFI_STRESS_NEXT:
+			stress_getnextvariablename(thread);
+			break;
+		case UEFI_STRESS_QUERY:
+			stress_queryvariableinfo(thread);
+			break;
+		default:
+			stress_setvariable(thread);
+			break;
+		}
+		fwts_efi_histogram_add(&thread->latency, fwts_efi_profile_time() - start);
+		thread->calls[op]++;
+
+		if (thread->last_status == EFI_OUT_OF_RESOURCES)
+			thread->out_of_resources++;
+		else if (thread->last_status == EFI_DEVICE_ERROR)
+			thread->device_errors++;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_variable_read()
+ *	read a variable after the stress run, returns the EFI status
+ */
+static uint64_t stress_variable_read(
+	uint16_t *varname,
+	EFI_GUID *guid,
+	uint8_t *data,
+	uint64_t *datasize)
+{
+	struct efi_getvariable getvariable;
+	uint64_t status = ~0ULL;
+	uint32_t attributestest = 0;
+
+	getvariable.VariableName = varname;
+	getvariable.VendorGuid = guid;
+	getvariable.Attributes = &attributestest;
+	getvariable.DataSize = datasize;
+	getvariable.Data = data;
+	getvariable.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable) == -1)
+		return status;
+	return EFI_SUCCESS;
+}
+
+/*
+ *  stress_variable_write()
+ *	write or, with no data, delete a variable, returns the EFI status
+ */
+static uint64_t stress_variable_write(
+	uint16_t *varname,
+	EFI_GUID *guid,
+	uint8_t *data,
+	const uint64_t datasize)
+{
+	struct efi_setvariable setvariable;
+	uint64_t status = ~0ULL;
+	uint8_t dummy = 0;
+
+	setvariable.VariableName = varname;
+	setvariable.VendorGuid = guid;
+	setvariable.Attributes = datasize ? attributes : 0;
+	setvariable.DataSize = datasize;
+	setvariable.Data = data ? data : &dummy;
+	setvariable.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_SET_VARIABLE, &setvariable) == -1)
+		return status;
+	return EFI_SUCCESS;
+}
+
+/*
+ *  stress_name_match()
+ *	check if a variable name returned by the store is name and guid
+ */
+static bool stress_name_match(
+	const uefi_stress_name *entry,
+	const uint16_t *name,
+	const EFI_GUID *guid)
+{
+	return (entry->length == fwts_uefi_str16len(name)) &&
+		!memcmp(&entry->guid, guid, sizeof(EFI_GUID)) &&
+		!memcmp(entry->name, name, entry->length * sizeof(uint16_t));
+}
+
+/*
+ *  stress_verify_names()
+ *	walk the variable names, each must be returned once and each
+ *	private variable written by the stress threads must be found
+ */
+static bool stress_verify_names(
+	fwts_framework *fw,
+	uefi_stress_thread *threads,
+	const int nthreads)
+{
+	struct efi_getnextvariablename getnextvariablename;
+	uefi_stress_name *names = NULL;
+	uint16_t name[UEFI_STRESS_NAME_LENGTH];
+	EFI_GUID guid;
+	uint64_t namesize, status;
+	size_t count = 0, size = 0, i, j;
+	bool ok = true;
+	int n;
+
+	memset(name, 0, sizeof(name));
+	memset(&guid, 0, sizeof(guid));
+	getnextvariablename.VariableNameSize = &namesize;
+	getnextvariablename.VariableName = name;
+	getnextvariablename.VendorGuid = &guid;
+	getnextvariablename.status = &status;
+
+	for (;;) {
+		namesize = sizeof(name);
+		status = ~0ULL;
+		if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename) == -1) {
+			if (status != EFI_NOT_FOUND) {
+				fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressGetNextVariableName",
+					"GetNextVariableName failed walking the variable "
+					"store after the stress test.");
+				fwts_uefi_print_status_info(fw, status);
+				ok = false;
+			}
+			break;
+		}
+		if (count >= UEFI_STRESS_STORE_MAX) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressGetNextVariableNameLoop",
+				"GetNextVariableName returned more than %d names "
+				"after the stress test, it may be looping.",
+				UEFI_STRESS_STORE_MAX);
+			ok = false;
+			break;
+		}
+		if (count >= size) {
+			uefi_stress_name *tmp;
+
+			size = size ? size * 2 : 64;
+			if ((tmp = realloc(names, size * sizeof(*names))) == NULL) {
+				fwts_log_error(fw, "Cannot allocate variable name list.");
+				ok = false;
+				break;
+			}
+			names = tmp;
+		}
+		names[count].guid = guid;
+		names[count].length = fwts_uefi_str16len(name);
+		names[count].name = malloc((names[count].length + 1) * sizeof(uint16_t));
+		if (!names[count].name) {
+			fwts_log_error(fw, "Cannot allocate variable name.");
+			ok = false;
+			break;
+		}
+		memcpy(names[count].name, name, (names[count].length + 1) * sizeof(uint16_t));
+		count++;
+	}
+
+	for (i = 0; i < count; i++) {
+		for (j = i + 1; j < count; j++) {
+			if (stress_name_match(&names[j], names[i].name, &names[i].guid)) {
+				char varname[UEFI_STRESS_NAME_LENGTH];
+
+				fwts_uefi_str16_to_str(varname, sizeof(varname), names[i].name);
+				fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressDuplicateName",
+					"GetNextVariableName returned variable %s more "
+					"than once after the stress test.", varname);
+				ok = false;
+				break;
+			}
+		}
+	}
+
+	for (n = 0; n < nthreads; n++) {
+		if (!threads[n].written)
+			continue;
+		for (i = 0; i < count; i++)
+			if (stress_name_match(&names[i], variablenamestress, &threads[n].guid))
+				break;
+		if (i == count) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressMissingName",
+				"GetNextVariableName did not return the variable "
+				"written by CPU %d after the stress test.", threads[n].cpu);
+			ok = false;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		free(names[i].name);
+	free(names);
+
+	return ok;
+}
+
+/*
+ *  stress_verify()
+ *	check the variable store is consistent after the stress run
+ *	and remove the variables it used
+ */
+static bool stress_verify(
+	fwts_framework *fw,
+	uefi_stress_thread *threads,
+	const int nthreads)
+{
+	uint8_t data[MAX_DATA_LENGTH];
+	uint8_t expected[UEFI_STRESS_DATA_SIZE];
+	uint64_t datasize, status;
+	bool ok = true;
+	int n;
+
+	datasize = sizeof(data);
+	stress_pattern(expected, -1, 0);
+	status = stress_variable_read(variablenametest, &gtestguid1, data, &datasize);
+	if (status != EFI_SUCCESS) {
+		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressSharedVariable",
+			"Failed to read the shared test variable after the stress test.");
+		fwts_uefi_print_status_info(fw, status);
+		ok = false;
+	} else if ((datasize != sizeof(expected)) || memcmp(data, expected, sizeof(expected))) {
+		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressSharedVariableData",
+			"The shared test variable changed during the stress test.");
+		ok = false;
+	}
+
+	for (n = 0; n < nthreads; n++) {
+		uefi_stress_thread *thread = &threads[n];
+
+		if (!thread->written || thread->uncertain)
+			continue;
+
+		datasize = sizeof(data);
+		stress_pattern(expected, thread->cpu, thread->sequence);
+		status = stress_variable_read(variablenamestress, &thread->guid, data, &datasize);
+		if (status != EFI_SUCCESS) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressPrivateVariable",
+				"Failed to read the variable written by CPU %d "
+				"after the stress test.", thread->cpu);
+			fwts_uefi_print_status_info(fw, status);
+			ok = false;
+		} else if ((datasize != sizeof(expected)) || memcmp(data, expected, sizeof(expected))) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressPrivateVariableData",
+				"The variable written by CPU %d does not hold the "
+				"data of its last successful SetVariable.", thread->cpu);
+			ok = false;
+		}
+	}
+
+	if (!stress_verify_names(fw, threads, nthreads))
+		ok = false;
+
+	/* Clean up, the private variables must then be gone */
+	for (n = 0; n < nthreads; n++) {
+		uefi_stress_thread *thread = &threads[n];
+
+		if (!thread->written && !thread->uncertain)
+			continue;
+
+		(void)stress_variable_write(variablenamestress, &thread->guid, NULL, 0);
+		datasize = sizeof(data);
+		status = stress_variable_read(variablenamestress, &thread->guid, data, &datasize);
+		if (status != EFI_NOT_FOUND) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressDeleteVariable",
+				"The variable written by CPU %d was not deleted "
+				"after the stress test.", thread->cpu);
+			ok = false;
+		}
+	}
+	(void)stress_variable_write(variablenametest, &gtestguid1, NULL, 0);
+
+	return ok;
+}
+
+/*
+ *  stress_report()
+ *	log the per-CPU latencies, throughput and error rates
+ */
+static bool stress_report(
+	fwts_framework *fw,
+	uefi_stress_thread *threads,
+	const int nthreads,
+	const uint64_t duration_ns)
+{
+	fwts_efi_histogram total;
+	uint64_t calls[UEFI_STRESS_OPS], errors = 0;
+	uint64_t out_of_resources = 0, device_errors = 0, mismatches = 0;
+	bool ok = true;
+	int n, op, i;
+
+	memset(&total, 0, sizeof(total));
+	memset(calls, 0, sizeof(calls));
+
+	fwts_log_info_verbatim(fw, "  CPU      Calls    p50 (us)    p99 (us)  p99.9 (us)    max (us)  OutOfRes  DevErr");
+	for (n = 0; n < nthreads; n++) {
+		const uefi_stress_thread *thread = &threads[n];
+
+		fwts_log_info_verbatim(fw, "%5d %10" PRIu64 " %11.3f %11.3f %11.3f %11.3f %9" PRIu64 " %7" PRIu64,
+			thread->cpu, thread->latency.calls,
+			(double)fwts_efi_histogram_percentile(&thread->latency, 0.50) / 1000.0,
+			(double)fwts_efi_histogram_percentile(&thread->latency, 0.99) / 1000.0,
+			(double)fwts_efi_histogram_percentile(&thread->latency, 0.999) / 1000.0,
+			(double)thread->latency.max_ns / 1000.0,
+			thread->out_of_resources, thread->device_errors);
+
+		for (i = 0; i < FWTS_EFI_HISTOGRAM_BUCKETS; i++)
+			total.buckets[i] += thread->latency.buckets[i];
+		total.calls += thread->latency.calls;
+		if (thread->latency.max_ns > total.max_ns)
+			total.max_ns = thread->latency.max_ns;
+		for (op = 0; op < UEFI_STRESS_OPS; op++) {
+			calls[op] += thread->calls[op];
+			errors += thread->errors[op];
+		}
+		out_of_resources += thread->out_of_resources;
+		device_errors += thread->device_errors;
+		mismatches += thread->mismatches;
+	}
+	fwts_log_info_verbatim(fw, "  All %10" PRIu64 " %11.3f %11.3f %11.3f %11.3f %9" PRIu64 " %7" PRIu64,
+		total.calls,
+		(double)fwts_efi_histogram_percentile(&total, 0.50) / 1000.0,
+		(double)fwts_efi_histogram_percentile(&total, 0.99) / 1000.0,
+		(double)fwts_efi_histogram_percentile(&total, 0.999) / 1000.0,
+		(double)total.max_ns / 1000.0,
+		out_of_resources, device_errors);
+
+	for (op = 0; op < UEFI_STRESS_OPS; op++)
+		if (calls[op])
+			fwts_log_info(fw, "%" PRIu64 " %s calls.", calls[op], uefi_stress_op_names[op]);
+	fwts_log_info(fw, "%" PRIu64 " calls on %d CPUs in %.3f s, %.0f calls per second.",
+		total.calls, nthreads, (double)duration_ns / 1000000000.0,
+		duration_ns ? (double)total.calls * 1000000000.0 / (double)duration_ns : 0.0);
+
+	if (device_errors) {
+		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressDeviceError",
+			"%" PRIu64 " of %" PRIu64 " calls (%.3f%%) returned EFI_DEVICE_ERROR "
+			"under concurrent load.", device_errors, total.calls,
+			100.0 * (double)device_errors / (double)total.calls);
+		ok = false;
+	}
+	if (out_of_resources)
+		fwts_warning(fw, "%" PRIu64 " of %" PRIu64 " calls (%.3f%%) returned "
+			"EFI_OUT_OF_RESOURCES under concurrent load.", out_of_resources,
+			total.calls, 100.0 * (double)out_of_resources / (double)total.calls);
+	if (errors > out_of_resources + device_errors) {
+		fwts_failed(fw, LOG_LEVEL_MEDIUM, "UEFIRuntimeStressUnexpectedStatus",
+			"%" PRIu64 " calls returned an unexpected status under "
+			"concurrent load.", errors - out_of_resources - device_errors);
+		ok = false;
+	}
+	if (mismatches) {
+		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeStressInconsistentData",
+			"%" PRIu64 " GetVariable or QueryVariableInfo calls returned "
+			"inconsistent data under concurrent load.", mismatches);
+		ok = false;
+	}
+
+	return ok;
+}
+
+static int uefirtvariable_test10(fwts_framework *fw)
+{
+	static const uint32_t supported[UEFI_STRESS_OPS] = {
+		EFI_RT_SUPPORTED_GET_VARIABLE,
+		EFI_RT_SUPPORTED_GET_NEXT_VARIABLE_NAME,
+		EFI_RT_SUPPORTED_QUERY_VARIABLE_INFO,
+		EFI_RT_SUPPORTED_SET_VARIABLE
+	};
+	uefi_stress_thread *threads;
+	uint8_t data[UEFI_STRESS_DATA_SIZE];
+	uint64_t status, start, end;
+	pthread_attr_t attr;
+	int cpu, op, n, nthreads = 0;
+	bool ok;
+
+	if (!uefi_stress_cpus) {
+		fwts_skipped(fw, "Skipping test, use --uefi-stress-cpus to "
+			"select the CPUs to run the concurrent stress test on.");
+		return FWTS_SKIP;
+	}
+	if (!(runtimeservicessupported & EFI_RT_SUPPORTED_SET_VARIABLE)) {
+		fwts_skipped(fw, "Skipping test, SetVariable runtime service "
+			"is not supported on this platform.");
+		return FWTS_SKIP;
+	}
+	for (op = 0; op < UEFI_STRESS_OPS; op++) {
+		if (uefi_stress_weights[op] && !(runtimeservicessupported & supported[op])) {
+			fwts_skipped(fw, "Skipping test, %s runtime service "
+				"is not supported on this platform.", uefi_stress_op_names[op]);
+			return FWTS_SKIP;
+		}
+	}
+
+	/* The variable all the threads read */
+	stress_pattern(data, -1, 0);
+	status = stress_variable_write(variablenametest, &gtestguid1, data, sizeof(data));
+	if (status == EFI_OUT_OF_RESOURCES) {
+		fwts_uefi_print_status_info(fw, status);
+		fwts_skipped(fw, "Run out of resources for SetVariable UEFI "
+			"runtime interface: cannot test.");
+		return FWTS_SKIP;
+	}
+	if (status != EFI_SUCCESS) {
+		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeSetVariable",
+			"Failed to set variable with UEFI runtime service.");
+		fwts_uefi_print_status_info(fw, status);
+		return FWTS_ERROR;
+	}
+
+	threads = calloc(CPU_COUNT(&uefi_stress_cpuset), sizeof(*threads));
+	if (!threads) {
+		fwts_log_error(fw, "Cannot allocate stress test threads.");
+		(void)stress_variable_write(variablenametest, &gtestguid1, NULL, 0);
+		return FWTS_ERROR;
+	}
+
+	fwts_log_info(fw, "Running %" PRIu32 " calls on each of %d CPUs, "
+		"weighted %" PRIu32 " GetVariable, %" PRIu32 " GetNextVariableName, "
+		"%" PRIu32 " QueryVariableInfo, %" PRIu32 " SetVariable.",
+		uefi_stress_calls, CPU_COUNT(&uefi_stress_cpuset),
+		uefi_stress_weights[UEFI_STRESS_GET], uefi_stress_weights[UEFI_STRESS_NEXT],
+		uefi_stress_weights[UEFI_STRESS_QUERY], uefi_stress_weights[UEFI_STRESS_SET]);
+
+	stress_started = false;
+	stress_abort = false;
+	ok = true;
+	(void)pthread_attr_init(&attr);
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		uefi_stress_thread *thread = &threads[nthreads];
+		cpu_set_t mask;
+
+		if (!CPU_ISSET(cpu, &uefi_stress_cpuset))
+			continue;
+
+		thread->cpu = cpu;
+		thread->guid = gtestguidstress;
+		thread->guid.Data4[6] = (uint8_t)(cpu >> 8);
+		thread->guid.Data4[7] = (uint8_t)cpu;
+		thread->random = 0x9e3779b9U ^ (uint32_t)(cpu + 1) * 2654435761U;
+
+		CPU_ZERO(&mask);
+		CPU_SET(cpu, &mask);
+		if ((pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask) != 0) ||
+		    (pthread_create(&thread->tid, &attr, stress_thread, thread) != 0)) {
+			fwts_log_error(fw, "Cannot start a stress thread on CPU %d.", cpu);
+			ok = false;
+			break;
+		}
+		nthreads++;
+	}
+	(void)pthread_attr_destroy(&attr);
+
+	/* Release the threads together */
+	pthread_mutex_lock(&stress_mutex);
+	stress_abort = !ok;
+	stress_started = true;
+	start = fwts_efi_profile_time();
+	pthread_cond_broadcast(&stress_cond);
+	pthread_mutex_unlock(&stress_mutex);
+
+	for (n = 0; n < nthreads; n++)
+		(void)pthread_join(threads[n].tid, NULL);
+	end = fwts_efi_profile_time();
+
+	if (!ok) {
+		(void)stress_verify(fw, threads, nthreads);
+		free(threads);
+		return FWTS_ERROR;
+	}
+
+	if (!stress_report(fw, threads, nthreads, end - start))
+		ok = false;
+	if (!stress_verify(fw, threads, nthreads))
+		ok = false;
+	free(threads);
+
+	if (ok)
+		fwts_passed(fw, "UEFI runtime variable services on %d CPUs "
+			"concurrently passed the stress test.", nthreads);
+
+	return FWTS_OK;
+}
+
+/*
+ *  capacity_query()
+ *	QueryVariableInfo for the non-volatile store, returns the EFI status
+ */
+static uint64_t capacity_query(
+	uint64_t *maxvarstoragesize,
+	uint64_t *remvarstoragesize,
+	uint64_t *maxvariablesize)
+{
+	struct efi_queryvariableinfo queryvariableinfo;
+	uint64_t status = ~0ULL;
+
+	queryvariableinfo.Attributes = attributes;
+	queryvariableinfo.MaximumVariableStorageSize = maxvarstoragesize;
+	queryvariableinfo.RemainingVariableStorageSize = remvarstoragesize;
+	queryvariableinfo.MaximumVariableSize = maxvariablesize;
+	queryvariableinfo.status = &status;
+
+	if (fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo) == -1)
+		return status;
+	return EFI_SUCCESS;
+}
+
+/*
+ *  capacity_fit()
+ *	least squares straight line fit, y = slope * x + intercept
+ */
+static void capacity_fit(
+	const double *x,
+	const double *y,
+	const size_t n,
+	double *slope,
+	double *intercept)
+{
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, d;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		sx += x[i];
+		sy += y[i];
+		sxx += x[i] * x[i];
+		sxy += x[i] * y[i];
+	}
+	d = (double)n * sxx - sx * sx;
+	if ((n < 2) || (d <= 0.0)) {
+		*slope = 0.0;
+		*intercept = n ? sy / (double)n : 0.0;
+		return;
+	}
+	*slope = ((double)n * sxy - sx * sy) / d;
+	*intercept = (sy - *slope * sx) / (double)n;
+}
+
+/*
+ *  capacity_delete_all()
+ *	delete the capacity test variables that are in the store
+ */
+static int capacity_delete_all(
+	fwts_framework *fw,
+	uefi_capacity_var *vars,
+	uint64_t *writes)
+{
+	int i, ret = FWTS_OK;
+
+	for (i = 0; i < UEFI_CAPACITY_VARS; i++) {
+		uint64_t status;
+
+		if (!vars[i].present)
+			continue;
+		status = stress_variable_write(vars[i].name, &gtestguidcapacity, NULL, 0);
+		(*writes)++;
+		if (status != EFI_SUCCESS) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeCapacityDelete",
+				"Failed to delete a capacity test variable.");
+			fwts_uefi_print_status_info(fw, status);
+			ret = FWTS_ERROR;
+		}
+		vars[i].present = false;
+		vars[i].size = 0;
+	}
+	return ret;
+}
+
+static int uefirtvariable_test11(fwts_framework *fw)
+{
+	static const uint64_t sizes[] = { 8, 64, 256, 1024, 2048, 4096 };
+	uefi_capacity_var vars[UEFI_CAPACITY_VARS];
+	uefi_capacity_sample *samples;
+	uint8_t data[4096];
+	uint64_t maxvarstoragesize, remvarstoragesize, maxvariablesize;
+	uint64_t baseline, other_used, maxsize, live = 0, writes = 0;
+	uint64_t out_of_resources = 0, status;
+	uint32_t random = 0x2545f491;
+	size_t nsamples = 0, maxsamples, nsizes, i, step;
+	double *x, *y, leak, intercept, slope_tp, intercept_tp;
+	int reclaims = 0;
+	bool full = false, ok = true;
+
+	if (!uefi_capacity_writes) {
+		fwts_skipped(fw, "Skipping test, use --uefi-capacity-writes to "
+			"run the variable store capacity test.");
+		return FWTS_SKIP;
+	}
+	if (!(runtimeservicessupported & EFI_RT_SUPPORTED_SET_VARIABLE) ||
+	    !(runtimeservicessupported & EFI_RT_SUPPORTED_QUERY_VARIABLE_INFO)) {
+		fwts_skipped(fw, "Skipping test, SetVariable or QueryVariableInfo "
+			"runtime service is not supported on this platform.");
+		return FWTS_SKIP;
+	}
+
+	status = capacity_query(&maxvarstoragesize, &remvarstoragesize, &maxvariablesize);
+	if (status != EFI_SUCCESS) {
+		fwts_skipped(fw, "Skipping test, QueryVariableInfo failed.");
+		fwts_uefi_print_status_info(fw, status);
+		return FWTS_SKIP;
+	}
+	if (!maxvarstoragesize || (remvarstoragesize > maxvarstoragesize)) {
+		fwts_failed(fw, LOG_LEVEL_MEDIUM, "UEFIRuntimeCapacityQuery",
+			"QueryVariableInfo returned a remaining storage of %" PRIu64
+			" bytes larger than the maximum of %" PRIu64 " bytes.",
+			remvarstoragesize, maxvarstoragesize);
+		return FWTS_ERROR;
+	}
+	baseline = remvarstoragesize;
+	/*
+	 *  Storage used by everything but the test variables, including
+	 *  deleted space not yet reclaimed, lowered as reclaims are seen
+	 */
+	other_used = maxvarstoragesize - remvarstoragesize;
+
+	/* Keep the live test data to at most half of the free space */
+	maxsize = baseline / (2 * UEFI_CAPACITY_VARS);
+	if (maxsize > maxvariablesize / 2)
+		maxsize = maxvariablesize / 2;
+	for (nsizes = 0; (nsizes < FWTS_ARRAY_SIZE(sizes)) && (sizes[nsizes] <= maxsize); nsizes++)
+		;
+	if (!nsizes) {
+		fwts_skipped(fw, "Skipping test, only %" PRIu64 " bytes of "
+			"variable storage remaining.", baseline);
+		return FWTS_SKIP;
+	}
+
+	memset(vars, 0, sizeof(vars));
+	for (i = 0; i < UEFI_CAPACITY_VARS; i++) {
+		char name[16];
+		size_t j;
+
+		snprintf(name, sizeof(name), "FwtsCapacity%02zu", i);
+		for (j = 0; name[j]; j++)
+			vars[i].name[j] = (uint16_t)name[j];
+	}
+
+	maxsamples = uefi_capacity_writes / (UEFI_CAPACITY_BATCH * UEFI_CAPACITY_CYCLE) + 2;
+	samples = calloc(maxsamples, sizeof(*samples));
+	x = calloc(maxsamples, sizeof(*x));
+	y = calloc(maxsamples, sizeof(*y));
+	if (!samples || !x || !y) {
+		fwts_log_error(fw, "Cannot allocate capacity test samples.");
+		free(samples);
+		free(x);
+		free(y);
+		return FWTS_ERROR;
+	}
+
+	fwts_log_info(fw, "Running %" PRIu32 " SetVariable writes of up to %" PRIu64
+		" bytes on %d variables, %" PRIu64 " of %" PRIu64 " bytes of "
+		"storage remaining.", uefi_capacity_writes, sizes[nsizes - 1],
+		UEFI_CAPACITY_VARS, baseline, maxvarstoragesize);
+
+	samples[nsamples++].remaining = baseline;
+
+	while ((writes < uefi_capacity_writes) && !full && ok) {
+		uefi_capacity_sample *sample;
+		uint64_t cycle_writes = writes, cycle_ns = 0;
+		int batch, op;
+
+		/* A cycle of insert/update/delete batches, sampled after each */
+		for (batch = 0; (batch < UEFI_CAPACITY_CYCLE) && !full &&
+		     (writes < uefi_capacity_writes); batch++) {
+			for (op = 0; op < UEFI_CAPACITY_BATCH; op++) {
+				uefi_capacity_var *var = &vars[stress_random(&random) % UEFI_CAPACITY_VARS];
+				uint64_t size = 0, start, end;
+
+				/* Insert if absent, else mostly update with a new size */
+				if (!var->present || (stress_random(&random) % 4))
+					size = sizes[stress_random(&random) % nsizes];
+				memset(data, (int)(writes & 0xff), size);
+
+				start = fwts_efi_profile_time();
+				status = stress_variable_write(var->name, &gtestguidcapacity, data, size);
+				end = fwts_efi_profile_time();
+				cycle_ns += end - start;
+				writes++;
+
+				if (status == EFI_SUCCESS) {
+					live = live - var->size + size;
+					var->size = size;
+					var->present = (size != 0);
+					continue;
+				}
+				if (status != EFI_OUT_OF_RESOURCES) {
+					fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeCapacitySetVariable",
+						"SetVariable failed after %" PRIu64 " writes.", writes);
+					fwts_uefi_print_status_info(fw, status);
+					ok = false;
+					break;
+				}
+
+				/*
+				 *  Out of space, with how much of the store really in use?
+				 *  Either way stop, writes that cannot go in say nothing
+				 *  more about the space lost per write.
+				 */
+				out_of_resources++;
+				full = true;
+				if ((other_used + live) * 100 < (uint64_t)uefi_capacity_reclaim * maxvarstoragesize) {
+					fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeCapacityReclaim",
+						"SetVariable returned EFI_OUT_OF_RESOURCES after %" PRIu64
+						" writes with only %" PRIu64 " of %" PRIu64 " bytes "
+						"(%.1f%%) of variable storage in use, under the "
+						"%" PRIu32 "%% threshold.", writes, other_used + live,
+						maxvarstoragesize,
+						100.0 * (double)(other_used + live) / (double)maxvarstoragesize,
+						uefi_capacity_reclaim);
+					fwts_advice(fw, "The firmware does not reclaim the space "
+						"of deleted or updated variables at runtime, a "
+						"reboot is needed before the space can be used "
+						"again.");
+					ok = false;
+				} else
+					fwts_log_info(fw, "SetVariable returned EFI_OUT_OF_RESOURCES "
+						"after %" PRIu64 " writes with %" PRIu64 " of %" PRIu64
+						" bytes (%.1f%%) of variable storage in use, stopping.",
+						writes, other_used + live, maxvarstoragesize,
+						100.0 * (double)(other_used + live) / (double)maxvarstoragesize);
+				break;
+			}
+			if (!ok || full)
+				break;
+			status = capacity_query(&maxvarstoragesize, &remvarstoragesize, &maxvariablesize);
+			if (status != EFI_SUCCESS) {
+				fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeCapacityQuery",
+					"QueryVariableInfo failed after %" PRIu64 " writes.", writes);
+				fwts_uefi_print_status_info(fw, status);
+				ok = false;
+				break;
+			}
+			/* Using less than before is a reclaim, less than live is wrong */
+			if ((remvarstoragesize > maxvarstoragesize) ||
+			    (maxvarstoragesize - remvarstoragesize < live)) {
+				fwts_failed(fw, LOG_LEVEL_MEDIUM, "UEFIRuntimeCapacityQuery",
+					"QueryVariableInfo reported %" PRIu64 " bytes of storage "
+					"remaining with %" PRIu64 " bytes of test variables in a "
+					"%" PRIu64 " byte store.", remvarstoragesize,
+					live, maxvarstoragesize);
+				ok = false;
+				break;
+			}
+			if (maxvarstoragesize - remvarstoragesize - live < other_used)
+				other_used = maxvarstoragesize - remvarstoragesize - live;
+		}
+
+		/* Delete them all, the space not given back is lost */
+		if (capacity_delete_all(fw, vars, &writes) != FWTS_OK)
+			ok = false;
+		live = 0;
+		status = capacity_query(&maxvarstoragesize, &remvarstoragesize, &maxvariablesize);
+		if (status != EFI_SUCCESS) {
+			fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeCapacityQuery",
+				"QueryVariableInfo failed after %" PRIu64 " writes.", writes);
+			fwts_uefi_print_status_info(fw, status);
+			ok = false;
+			break;
+		}
+		if ((remvarstoragesize <= maxvarstoragesize) &&
+		    (maxvarstoragesize - remvarstoragesize < other_used))
+			other_used = maxvarstoragesize - remvarstoragesize;
+		if (nsamples >= maxsamples)
+			break;
+		sample = &samples[nsamples++];
+		sample->writes = writes;
+		sample->remaining = remvarstoragesize;
+		sample->throughput = cycle_ns ?
+			(double)(writes - cycle_writes) * 1000000000.0 / (double)cycle_ns : 0.0;
+		if (remvarstoragesize > samples[nsamples - 2].remaining)
+			reclaims++;
+	}
+
+	fwts_log_info_verbatim(fw, "    Writes   Remaining (bytes)   Lost (bytes)   Writes/s");
+	step = (nsamples + UEFI_CAPACITY_LOG_SAMPLES - 1) / UEFI_CAPACITY_LOG_SAMPLES;
+	for (i = 0; i < nsamples; i++) {
+		const int64_t lost = (int64_t)baseline - (int64_t)samples[i].remaining;
+
+		x[i] = (double)samples[i].writes;
+		y[i] = (double)lost;
+		if ((i % step) && (i != nsamples - 1))
+			continue;
+		fwts_log_info_verbatim(fw, "%10" PRIu64 " %19" PRIu64 " %14" PRId64 " %10.0f",
+			samples[i].writes, samples[i].remaining, lost, samples[i].throughput);
+	}
+
+	capacity_fit(x, y, nsamples, &leak, &intercept);
+	fwts_log_info(fw, "Variable storage lost per write: %.3f bytes, "
+		"%d runtime reclaims seen in %" PRIu64 " writes.", leak, reclaims, writes);
+	if (leak > 0.0)
+		fwts_log_info(fw, "At this rate the %" PRIu64 " bytes of remaining storage "
+			"are lost after about %.0f writes.", baseline, (double)baseline / leak);
+
+	/* Throughput over time, skipping the first sample with no writes */
+	if (nsamples > 2) {
+		for (i = 1; i < nsamples; i++)
+			y[i - 1] = samples[i].throughput;
+		capacity_fit(x + 1, y, nsamples - 1, &slope_tp, &intercept_tp);
+		fwts_log_info(fw, "SetVariable throughput %.0f writes/s at the start, "
+			"changing by %.1f writes/s per 1000 writes.",
+			intercept_tp + slope_tp * x[1], slope_tp * 1000.0);
+	}
+	if (out_of_resources)
+		fwts_log_info(fw, "%" PRIu64 " SetVariable writes returned "
+			"EFI_OUT_OF_RESOURCES.", out_of_resources);
+
+	if (leak > (double)uefi_capacity_leak) {
+		fwts_failed(fw, LOG_LEVEL_HIGH, "UEFIRuntimeCapacityLeak",
+			"The variable store lost %.3f bytes of storage per write, "
+			"more than the %" PRIu32 " bytes threshold.", leak, uefi_capacity_leak);
+		fwts_advice(fw, "Deleted and updated variables are not being "
+			"reclaimed, the store will run out of space after enough "
+			"writes and may need a reboot to recover it. Use "
+			"--uefi-capacity-leak to change the threshold.");
+		ok = false;
+	}
+
+	(void)capacity_delete_all(fw, vars, &writes);
+	free(samples);
+	free(x);
+	free(y);
+
+	if (ok)
+		fwts_passed(fw, "Variable store capacity test of %" PRIu64
+			" writes passed.", writes);
+
+	return FWTS_OK;
+}
+
+/*
+ *  stress_cpus_parse()
+ *	parse a CPU list such as 0-3,6 or all into a CPU set
+ */
+static int stress_cpus_parse(const char *str, cpu_set_t *set)
+{
+	CPU_ZERO(set);
+
+	if (!strcmp(str, "all"))
+		return sched_getaffinity(0, sizeof(*set), set) < 0 ? FWTS_ERROR : FWTS_OK;
+
+	while (*str) {
+		unsigned long first, last;
+		char *end;
+
+		first = strtoul(str, &end, 10);
+		if (end == str)
+			return FWTS_ERROR;
+		last = first;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtoul(str, &end, 10);
+			if ((end == str) || (last < first))
+				return FWTS_ERROR;
+		}
+		if (last >= CPU_SETSIZE)
+			return FWTS_ERROR;
+		for (; first <= last; first++)
+			CPU_SET(first, set);
+
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return FWTS_ERROR;
+		str = end;
+	}
+	return CPU_COUNT(set) ? FWTS_OK : FWTS_ERROR;
+}
+
 static int options_check(fwts_framework *fw)
 {
+	int op;
+
 	FWTS_UNUSED(fw);
 
 	if ((uefi_get_variable_multiple < 1) ||
@@ -2331,6 +3471,56 @@ static int options_check(fwts_framework *fw)
 			uefi_query_variable_multiple, UEFI_QUERY_VARIABLE_MULTIPLE_MAX);
 		return FWTS_ERROR;
 	}
+	if ((uefi_stress_calls < 1) ||
+	    (uefi_stress_calls > UEFI_STRESS_CALLS_MAX)) {
+		fprintf(stderr, "--uefi-stress-calls is %" PRIu32", it "
+			"should be 1..%" PRIu32 "\n",
+			uefi_stress_calls, UEFI_STRESS_CALLS_MAX);
+		return FWTS_ERROR;
+	}
+	if (uefi_stress_cpus &&
+	    (stress_cpus_parse(uefi_stress_cpus, &uefi_stress_cpuset) != FWTS_OK)) {
+		fprintf(stderr, "--uefi-stress-cpus '%s' is not a list of "
+			"CPUs such as 0-3,6 or all\n", uefi_stress_cpus);
+		return FWTS_ERROR;
+	}
+	if (uefi_stress_mix) {
+		int len = 0;
+
+		if ((sscanf(uefi_stress_mix, "%" SCNu32 ",%" SCNu32 ",%" SCNu32 ",%" SCNu32 "%n",
+			&uefi_stress_weights[UEFI_STRESS_GET], &uefi_stress_weights[UEFI_STRESS_NEXT],
+			&uefi_stress_weights[UEFI_STRESS_QUERY], &uefi_stress_weights[UEFI_STRESS_SET],
+			&len) != 4) || uefi_stress_mix[len]) {
+			fprintf(stderr, "--uefi-stress-mix '%s' should be the get,next,"
+				"query,set weights, such as 60,30,10,0\n", uefi_stress_mix);
+			return FWTS_ERROR;
+		}
+	}
+	if (uefi_capacity_writes > UEFI_CAPACITY_WRITES_MAX) {
+		fprintf(stderr, "--uefi-capacity-writes is %" PRIu32", it "
+			"should be 0..%" PRIu32 "\n",
+			uefi_capacity_writes, UEFI_CAPACITY_WRITES_MAX);
+		return FWTS_ERROR;
+	}
+	if ((uefi_capacity_reclaim < 1) || (uefi_capacity_reclaim > 100)) {
+		fprintf(stderr, "--uefi-capacity-reclaim is %" PRIu32", it "
+			"should be 1..100\n", uefi_capacity_reclaim);
+		return FWTS_ERROR;
+	}
+	uefi_stress_weight_total = 0;
+	for (op = 0; op < UEFI_STRESS_OPS; op++) {
+		if (uefi_stress_weights[op] > UEFI_STRESS_WEIGHT_MAX) {
+			fprintf(stderr, "--uefi-stress-mix weights should be "
+				"0..%d\n", UEFI_STRESS_WEIGHT_MAX);
+			return FWTS_ERROR;
+		}
+		uefi_stress_weight_total += uefi_stress_weights[op];
+	}
+	if (!uefi_stress_weight_total) {
+		fprintf(stderr, "--uefi-stress-mix should have at least one "
+			"non-zero weight\n");
+		return FWTS_ERROR;
+	}
 	return FWTS_OK;
 }
 
@@ -2356,6 +3546,24 @@ static int options_handler(
 		case 2: /* --uefi-query-var-multiple */
 			uefi_query_variable_multiple = strtoul(optarg, NULL, 10);
 			break;
+		case 3: /* --uefi-stress-cpus */
+			uefi_stress_cpus = optarg;
+			break;
+		case 4: /* --uefi-stress-calls */
+			uefi_stress_calls = strtoul(optarg, NULL, 10);
+			break;
+		case 5: /* --uefi-stress-mix */
+			uefi_stress_mix = optarg;
+			break;
+		case 6: /* --uefi-capacity-writes */
+			uefi_capacity_writes = strtoul(optarg, NULL, 10);
+			break;
+		case 7: /* --uefi-capacity-leak */
+			uefi_capacity_leak = strtoul(optarg, NULL, 10);
+			break;
+		case 8: /* --uefi-capacity-reclaim */
+			uefi_capacity_reclaim = strtoul(optarg, NULL, 10);
+			break;
 		}
 	}
 	return FWTS_OK;
@@ -2365,6 +3573,12 @@ static fwts_option options[] = {
 	{ "uefi-get-var-multiple",	"", 1, "Run uefirtvariable get variable test multiple times." },
 	{ "uefi-set-var-multiple",	"", 1, "Run uefirtvariable set variable test multiple times." },
 	{ "uefi-query-var-multiple", 	"", 1, "Run uefirtvariable query variable test multiple times." },
+	{ "uefi-stress-cpus",		"", 1, "Run uefirtvariable concurrent stress test on a CPU list, e.g. 0-3,6 or all." },
+	{ "uefi-stress-calls",		"", 1, "Specify the number of uefirtvariable concurrent stress test calls per CPU." },
+	{ "uefi-stress-mix",		"", 1, "Specify the get,next,query,set weights of the concurrent stress test calls." },
+	{ "uefi-capacity-writes",	"", 1, "Run uefirtvariable variable store capacity test for this many SetVariable writes." },
+	{ "uefi-capacity-leak",		"", 1, "Specify the capacity test maximum storage bytes lost per write, default 16." },
+	{ "uefi-capacity-reclaim",	"", 1, "Fail the capacity test if the store is full with less than this percent in use, default 50." },
 	{ NULL, NULL, 0, NULL }
 };
 
@@ -2378,6 +3592,8 @@ static fwts_framework_minor_test uefirtvariable_tests[] = {
 	{ uefirtvariable_test7, "Test UEFI RT service query variable info interface stress test." },
 	{ uefirtvariable_test8, "Test UEFI RT service get variable interface, invalid parameters." },
 	{ uefirtvariable_test9, "Test UEFI RT variable services unsupported status." },
+	{ uefirtvariable_test10, "Test UEFI RT service variable interface concurrent stress test." },
+	{ uefirtvariable_test11, "Test UEFI RT service variable store capacity over long SetVariable runs." },
 	{ NULL, NULL }
 };
 
@@ -38,6 +38,14 @@ static int uefivarinfo_init(fwts_framework *fw)
 {
 	if (fwts_lib_efi_runtime_module_init(fw, &fd) == FWTS_ABORTED)
 		return FWTS_ABORTED;
+
+	/* Count the emulated variables through an efivarfs copy of them */
+	if ((fw->flags & FWTS_FLAG_EFI_EMULATOR) &&
+	    fwts_efi_emulator_efivarfs(fw) != FWTS_OK) {
+		fwts_lib_efi_runtime_close(fd);
+		fwts_lib_efi_runtime_unload_module(fw);
+		return FWTS_ABORTED;
+	}
 	return FWTS_OK;
 }
 
@@ -88,7 +96,7 @@ static int do_checkvariables(
 		status = ~0ULL;
 
 		variablenamesize = MAX_VARNAME_LENGTH;
-		ioret = ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_NEXTVARIABLENAME, &getnextvariablename);
 
 		if (ioret == -1) {
 
@@ -116,7 +124,7 @@ static int do_checkvariables(
 		getvariable.Data = data;
 		status = ~0ULL;
 
-		ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
+		ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
 		if (ioret == -1) {
 			if (status != EFI_BUFFER_TOO_SMALL) {
 				free(data);
@@ -141,7 +149,7 @@ static int do_checkvariables(
 				getvariable.Data = data;
 				status = ~0ULL;
 
-				ioret = ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
+				ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_GET_VARIABLE, &getvariable);
 				if (ioret == -1) {
 					fwts_log_info(fw, "Failed to get variable with variable larger than maximum variable length.");
 					fwts_uefi_print_status_info(fw, status);
@@ -160,6 +168,44 @@ static int do_checkvariables(
 
 }
 
+/*
+ *  do_checkvariables_efivars()
+ *	count the variables and their sizes from efivarfs, the variables
+ *	are read in parallel, much faster than one GetVariable at a time
+ */
+static int do_checkvariables_efivars(
+	fwts_framework *fw,
+	uint64_t *usedvars,
+	uint64_t *usedvarssize,
+	const uint64_t maxvarsize)
+{
+	fwts_uefi_var_set set;
+	size_t i;
+
+	*usedvars = 0;
+	*usedvarssize = 0;
+
+	if (fwts_uefi_get_variables(&set) != FWTS_OK) {
+		fwts_log_info(fw, "Failed to read the UEFI variables from efivarfs.");
+		return FWTS_ERROR;
+	}
+
+	for (i = 0; i < set.count; i++) {
+		if (set.vars[i].datalen > maxvarsize) {
+			char varname[MAX_VARNAME_LENGTH];
+
+			fwts_uefi_get_varname(varname, sizeof(varname), &set.vars[i]);
+			fwts_log_info(fw, "Variable %s is larger than maximum variable length.", varname);
+		}
+		(*usedvarssize) += set.vars[i].datalen;
+	}
+	*usedvars = set.count;
+
+	fwts_uefi_free_variables(&set);
+
+	return FWTS_OK;
+}
+
 static int do_queryvariableinfo(
 	uint64_t *status,
 	uint64_t *maxvarstoragesize,
@@ -178,7 +224,7 @@ static int do_queryvariableinfo(
 	*status = ~0ULL;
 	queryvariableinfo.status = status;
 
-	ioret = ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo);
+	ioret = fwts_lib_efi_runtime_ioctl(fd, EFI_RUNTIME_QUERY_VARIABLEINFO, &queryvariableinfo);
 
 	if (ioret == -1)
 		return FWTS_ERROR;
@@ -195,6 +241,7 @@ static int uefivarinfo_test1(fwts_framework *fw)
 
 	uint64_t usedvars;
 	uint64_t usedvarssize;
+	int ret;
 
 	if (do_queryvariableinfo(&status, &maxvarstoragesize, &remvarstoragesize, &maxvariablesize) == FWTS_ERROR) {
 		if (status == EFI_UNSUPPORTED) {
@@ -219,7 +266,13 @@ static int uefivarinfo_test1(fwts_framework *fw)
 	fwts_log_info_verbatim(fw, "  Remaining storage:     %8" PRIu64 " bytes", remvarstoragesize);
 	fwts_log_info_verbatim(fw, "  Maximum variable size: %8" PRIu64 " bytes", maxvariablesize);
 
-	if (do_checkvariables(fw, &usedvars, &usedvarssize, maxvariablesize) == FWTS_OK) {
+	/* efivarfs holds the same runtime variables */
+	if (fwts_uefi_efivars_iface_exist())
+		ret = do_checkvariables_efivars(fw, &usedvars, &usedvarssize, maxvariablesize);
+	else
+		ret = do_checkvariables(fw, &usedvars, &usedvarssize, maxvariablesize);
+
+	if (ret == FWTS_OK) {
 		fwts_log_info_verbatim(fw, "Currently used:");
 		fwts_log_info_verbatim(fw, "  %" PRIu64 " variables, storage used: %" PRIu64 " bytes", usedvars, usedvarssize);
 	}
@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2024 Canonical
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ *  acpigen: generate synthetic ACPI tables in acpidump format so that
+ *  fwts can be run with --dumpfile against machines far larger than
+ *  those in the fwts-test corpus.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+
+#define ACPI_HDR_SIZE		(36)
+#define TABLE_BASE_ADDR		(0x7a000000ULL)
+#define BASE36_3		(36 * 36 * 36)
+#define MAX_CPUS		(BASE36_3)
+#define MAX_DEVICES		(23 * BASE36_3)
+
+typedef struct {
+	uint8_t *data;
+	size_t len;
+	size_t size;
+} buffer;
+
+typedef struct {
+	bool arm64;		/* GICC instead of x2APIC entries */
+	uint32_t cpus;		/* MADT and PPTT processors */
+	uint32_t packages;	/* PPTT physical packages */
+	uint32_t domains;	/* SRAT and SLIT proximity domains */
+	uint32_t devices;	/* DSDT and SSDT devices */
+	uint32_t ssdts;		/* SSDTs to spread the devices over */
+} config;
+
+static uint64_t next_addr = TABLE_BASE_ADDR;
+
+/*
+ *  buf_reserve()
+ *	make room for len more bytes, exits on failure
+ */
+static uint8_t *buf_reserve(buffer *buf, const size_t len)
+{
+	uint8_t *ptr;
+
+	if (buf->len + len > buf->size) {
+		size_t size = buf->size ? buf->size : 4096;
+
+		while (size < buf->len + len)
+			size *= 2;
+		ptr = realloc(buf->data, size);
+		if (!ptr) {
+			fprintf(stderr, "acpigen: out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		buf->data = ptr;
+		buf->size = size;
+	}
+	ptr = buf->data + buf->len;
+	memset(ptr, 0, len);
+	buf->len += len;
+
+	return ptr;
+}
+
+static void buf_bytes(buffer *buf, const void *data, const size_t len)
+{
+	memcpy(buf_reserve(buf, len), data, len);
+}
+
+static void buf_u8(buffer *buf, const uint8_t val)
+{
+	*buf_reserve(buf, 1) = val;
+}
+
+static void put_le(uint8_t *ptr, uint64_t val, const int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++, val >>= 8)
+		ptr[i] = val & 0xff;
+}
+
+static void buf_u32(buffer *buf, const uint32_t val)
+{
+	put_le(buf_reserve(buf, 4), val, 4);
+}
+
+static void buf_u64(buffer *buf, const uint64_t val)
+{
+	put_le(buf_reserve(buf, 8), val, 8);
+}
+
+/*
+ *  table_begin()
+ *	start an ACPI table, the length and checksum are filled in
+ *	by table_end()
+ */
+static void table_begin(buffer *buf, const char *sig, const uint8_t revision)
+{
+	uint8_t *hdr = buf_reserve(buf, ACPI_HDR_SIZE);
+
+	memcpy(hdr, sig, 4);
+	hdr[8] = revision;
+	memcpy(hdr + 10, "FWTSID", 6);
+	memcpy(hdr + 16, "ACPIGEN ", 8);
+	put_le(hdr + 24, 1, 4);
+	memcpy(hdr + 28, "FWTS", 4);
+	put_le(hdr + 32, 1, 4);
+}
+
+static void table_end(buffer *buf)
+{
+	uint8_t sum = 0;
+	size_t i;
+
+	put_le(buf->data + 4, buf->len, 4);
+	buf->data[9] = 0;
+	for (i = 0; i < buf->len; i++)
+		sum += buf->data[i];
+	buf->data[9] = -sum;
+}
+
+/*
+ *  table_dump()
+ *	write a table in acpidump format and free it
+ */
+static uint64_t table_dump(FILE *fp, const char *name, buffer *buf)
+{
+	const uint64_t addr = next_addr;
+	size_t i, j;
+
+	fprintf(fp, "%4.4s @ 0x%016" PRIx64 "\n", name, addr);
+	for (i = 0; i < buf->len; i += 16) {
+		char ascii[17];
+
+		fprintf(fp, "  %4.4zx:", i);
+		for (j = 0; j < 16; j++) {
+			if (i + j < buf->len) {
+				const uint8_t c = buf->data[i + j];
+
+				fprintf(fp, " %2.2x", c);
+				ascii[j] = (c >= 32 && c < 127) ? c : '.';
+			} else {
+				fprintf(fp, "   ");
+				ascii[j] = '\0';
+			}
+		}
+		ascii[16] = '\0';
+		fprintf(fp, "  %s\n", ascii);
+	}
+	fprintf(fp, "\n");
+
+	next_addr += (buf->len + 0xfff) & ~0xfffULL;
+	free(buf->data);
+	memset(buf, 0, sizeof(*buf));
+
+	return addr;
+}
+
+/*
+ *  gen_madt()
+ *	one x2APIC or GICC entry per processor
+ */
+static void gen_madt(FILE *fp, const config *cfg)
+{
+	buffer buf = { NULL, 0, 0 };
+	uint32_t i;
+
+	table_begin(&buf, "APIC", cfg->arm64 ? 5 : 4);
+	buf_u32(&buf, cfg->arm64 ? 0 : 0xfee00000);	/* Local APIC address */
+	buf_u32(&buf, 0);				/* Flags */
+
+	for (i = 0; i < cfg->cpus; i++) {
+		uint8_t *entry;
+
+		if (cfg->arm64) {
+			entry = buf_reserve(&buf, 80);
+			entry[0] = 11;			/* GICC */
+			entry[1] = 80;
+			put_le(entry + 4, i, 4);	/* CPU interface number */
+			put_le(entry + 8, i, 4);	/* ACPI processor UID */
+			put_le(entry + 12, 1, 4);	/* Enabled */
+			put_le(entry + 68, ((uint64_t)(i / 8) << 8) | (i % 8), 8);	/* MPIDR */
+		} else {
+			entry = buf_reserve(&buf, 16);
+			entry[0] = 9;			/* x2APIC */
+			entry[1] = 16;
+			put_le(entry + 4, i, 4);	/* x2APIC ID */
+			put_le(entry + 8, 1, 4);	/* Enabled */
+			put_le(entry + 12, i, 4);	/* ACPI processor UID */
+		}
+	}
+	table_end(&buf);
+	table_dump(fp, "APIC", &buf);
+}
+
+/*
+ *  gen_pptt()
+ *	packages of cores, each core with a private L1 and each
+ *	package with a shared L2 cache
+ */
+static void gen_pptt(FILE *fp, const config *cfg)
+{
+	buffer buf = { NULL, 0, 0 };
+	const uint32_t per_package = (cfg->cpus + cfg->packages - 1) / cfg->packages;
+	uint32_t p, i, cpu = 0;
+
+	table_begin(&buf, "PPTT", 3);
+
+	for (p = 0; p < cfg->packages && cpu < cfg->cpus; p++) {
+		const uint32_t l2 = buf.len;
+		uint32_t package;
+		uint8_t *node;
+
+		/* Shared L2 cache */
+		node = buf_reserve(&buf, 28);
+		node[0] = 1;
+		node[1] = 28;
+		put_le(node + 4, 0xff, 4);		/* all fields valid */
+		put_le(node + 12, 1 << 20, 4);		/* size */
+		put_le(node + 16, 1024, 4);		/* sets */
+		node[20] = 16;				/* associativity */
+		node[21] = 0x0a;			/* unified, write back */
+		put_le(node + 22, 64, 2);		/* line size */
+		put_le(node + 24, p + 1, 4);		/* cache id */
+
+		/* Physical package */
+		package = buf.len;
+		node = buf_reserve(&buf, 24);
+		node[0] = 0;
+		node[1] = 24;
+		put_le(node + 4, 0x1, 4);		/* physical package */
+		put_le(node + 12, p, 4);		/* ACPI processor id */
+		put_le(node + 16, 1, 4);		/* private resources */
+		put_le(node + 20, l2, 4);
+
+		for (i = 0; i < per_package && cpu < cfg->cpus; i++, cpu++) {
+			const uint32_t l1 = buf.len;
+
+			/* Private L1 cache, next level is the package L2 */
+			node = buf_reserve(&buf, 28);
+			node[0] = 1;
+			node[1] = 28;
+			put_le(node + 4, 0xff, 4);
+			put_le(node + 8, l2, 4);
+			put_le(node + 12, 32 << 10, 4);
+			put_le(node + 16, 64, 4);
+			node[20] = 8;
+			node[21] = 0x0a;
+			put_le(node + 22, 64, 2);
+			put_le(node + 24, cfg->packages + cpu + 1, 4);
+
+			/* Leaf processor, id matches the MADT UID */
+			node = buf_reserve(&buf, 24);
+			node[0] = 0;
+			node[1] = 24;
+			put_le(node + 4, 0x2 | 0x8, 4);	/* id valid, leaf */
+			put_le(node + 8, package, 4);
+			put_le(node + 12, cpu, 4);
+			put_le(node + 16, 1, 4);
+			put_le(node + 20, l1, 4);
+		}
+	}
+	table_end(&buf);
+	table_dump(fp, "PPTT", &buf);
+}
+
+/*
+ *  gen_srat_slit()
+ *	processors spread round robin over the domains, 1GB of
+ *	memory per domain and a SLIT of distance 20 + |i - j|
+ */
+static void gen_srat_slit(FILE *fp, const config *cfg)
+{
+	buffer buf = { NULL, 0, 0 };
+	uint32_t i, j;
+
+	table_begin(&buf, "SRAT", 3);
+	buf_u32(&buf, 1);
+	buf_u64(&buf, 0);
+
+	for (i = 0; i < cfg->cpus; i++) {
+		uint8_t *entry;
+
+		if (cfg->arm64) {
+			entry = buf_reserve(&buf, 18);
+			entry[0] = 3;			/* GICC affinity */
+			entry[1] = 18;
+			put_le(entry + 2, i % cfg->domains, 4);
+			put_le(entry + 6, i, 4);
+			put_le(entry + 10, 1, 4);
+		} else {
+			entry = buf_reserve(&buf, 24);
+			entry[0] = 2;			/* x2APIC affinity */
+			entry[1] = 24;
+			put_le(entry + 4, i % cfg->domains, 4);
+			put_le(entry + 8, i, 4);
+			put_le(entry + 12, 1, 4);
+		}
+	}
+	for (i = 0; i < cfg->domains; i++) {
+		uint8_t *entry = buf_reserve(&buf, 40);
+		const uint64_t base = 0x100000000ULL + ((uint64_t)i << 30);
+
+		entry[0] = 1;				/* Memory affinity */
+		entry[1] = 40;
+		put_le(entry + 2, i, 4);
+		put_le(entry + 8, base, 8);
+		put_le(entry + 16, 1ULL << 30, 8);
+		put_le(entry + 28, 1, 4);		/* Enabled */
+	}
+	table_end(&buf);
+	table_dump(fp, "SRAT", &buf);
+
+	table_begin(&buf, "SLIT", 1);
+	buf_u64(&buf, cfg->domains);
+	for (i = 0; i < cfg->domains; i++) {
+		uint8_t *row = buf_reserve(&buf, cfg->domains);
+
+		for (j = 0; j < cfg->domains; j++) {
+			const uint32_t d = 20 + (i > j ? i - j : j - i);
+
+			row[j] = (i == j) ? 10 : (d > 254 ? 254 : d);
+		}
+	}
+	table_end(&buf);
+	table_dump(fp, "SLIT", &buf);
+}
+
+/*
+ *  aml_pkg_length()
+ *	encode an AML PkgLength for a payload of len bytes
+ */
+static void aml_pkg_length(buffer *buf, const size_t len)
+{
+	size_t total;
+	int n;
+
+	if (len + 1 < 64) {
+		buf_u8(buf, len + 1);
+		return;
+	}
+	for (n = 2; n <= 4; n++) {
+		total = len + n;
+		if (total < (1UL << (4 + 8 * (n - 1))))
+			break;
+	}
+	buf_u8(buf, ((n - 1) << 6) | (total & 0xf));
+	total >>= 4;
+	while (--n) {
+		buf_u8(buf, total & 0xff);
+		total >>= 8;
+	}
+}
+
+/*
+ *  aml_wrap()
+ *	emit op, PkgLength and the contents of body
+ */
+static void aml_wrap(buffer *buf, const uint8_t *op, const size_t op_len, buffer *body)
+{
+	buf_bytes(buf, op, op_len);
+	aml_pkg_length(buf, body->len);
+	buf_bytes(buf, body->data, body->len);
+	free(body->data);
+	memset(body, 0, sizeof(*body));
+}
+
+/*
+ *  aml_name()
+ *	4 character name, prefix followed by index in base 36
+ */
+static void aml_name(buffer *buf, const char prefix, const uint32_t index)
+{
+	static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	char name[4];
+
+	name[0] = prefix;
+	name[1] = digits[(index / (36 * 36)) % 36];
+	name[2] = digits[(index / 36) % 36];
+	name[3] = digits[index % 36];
+	buf_bytes(buf, name, 4);
+}
+
+/*
+ *  aml_name_integer()
+ *	Name (name, DWordConst)
+ */
+static void aml_name_integer(buffer *buf, const char *name, const uint32_t val)
+{
+	buf_u8(buf, 0x08);
+	buf_bytes(buf, name, 4);
+	buf_u8(buf, 0x0c);
+	buf_u32(buf, val);
+}
+
+/*
+ *  aml_processor()
+ *	Device (Cnnn) { Name (_HID, "ACPI0007") Name (_UID, index) }
+ */
+static void aml_processor(buffer *buf, const uint32_t index)
+{
+	static const uint8_t device_op[] = { 0x5b, 0x82 };
+	buffer body = { NULL, 0, 0 };
+
+	aml_name(&body, 'C', index);
+	buf_u8(&body, 0x08);
+	buf_bytes(&body, "_HID", 4);
+	buf_u8(&body, 0x0d);
+	buf_bytes(&body, "ACPI0007", 9);
+	aml_name_integer(&body, "_UID", index);
+	aml_wrap(buf, device_op, sizeof(device_op), &body);
+}
+
+/*
+ *  aml_device()
+ *	Device (Xnnn) with _HID, _UID, _STA and a Memory32Fixed _CRS,
+ *	X being D..Z
+ */
+static void aml_device(buffer *buf, const uint32_t index)
+{
+	static const uint8_t device_op[] = { 0x5b, 0x82 };
+	static const uint8_t method_op[] = { 0x14 };
+	static const uint8_t buffer_op[] = { 0x11 };
+	buffer body = { NULL, 0, 0 };
+	buffer sub = { NULL, 0, 0 };
+	uint8_t *res;
+
+	aml_name(&body, 'D' + (index / BASE36_3), index);
+
+	/* Name (_HID, EisaId ("PNP0C02")) */
+	aml_name_integer(&body, "_HID", 0x020cd041);
+	aml_name_integer(&body, "_UID", index);
+
+	/* Method (_STA, 0, NotSerialized) { Return (0x0F) } */
+	buf_bytes(&sub, "_STA", 4);
+	buf_u8(&sub, 0x00);
+	buf_u8(&sub, 0xa4);
+	buf_u8(&sub, 0x0a);
+	buf_u8(&sub, 0x0f);
+	aml_wrap(&body, method_op, sizeof(method_op), &sub);
+
+	/* Name (_CRS, ResourceTemplate () { Memory32Fixed (ReadWrite, base, 0x1000) }) */
+	buf_u8(&body, 0x08);
+	buf_bytes(&body, "_CRS", 4);
+	buf_u8(&sub, 0x0a);
+	buf_u8(&sub, 14);
+	res = buf_reserve(&sub, 14);
+	res[0] = 0x86;
+	res[1] = 9;
+	res[3] = 1;
+	put_le(res + 4, 0xd0000000ULL + ((uint64_t)index << 12), 4);
+	put_le(res + 8, 0x1000, 4);
+	res[12] = 0x79;
+	aml_wrap(&body, buffer_op, sizeof(buffer_op), &sub);
+
+	aml_wrap(buf, device_op, sizeof(device_op), &body);
+}
+
+/*
+ *  gen_definition_block()
+ *	DSDT or SSDT of Scope (\_SB) { processors, devices first..last-1 }
+ */
+static uint64_t gen_definition_block(
+	FILE *fp,
+	const char *sig,
+	const uint32_t cpus,
+	const uint32_t first,
+	const uint32_t last)
+{
+	static const uint8_t scope_op[] = { 0x10 };
+	buffer buf = { NULL, 0, 0 };
+	buffer scope = { NULL, 0, 0 };
+	uint32_t i;
+
+	table_begin(&buf, sig, 2);
+	buf_bytes(&scope, "\\_SB_", 5);
+	for (i = 0; i < cpus; i++)
+		aml_processor(&scope, i);
+	for (i = first; i < last; i++)
+		aml_device(&scope, i);
+	aml_wrap(&buf, scope_op, sizeof(scope_op), &scope);
+	table_end(&buf);
+
+	return table_dump(fp, sig, &buf);
+}
+
+/*
+ *  gen_fadt_facs()
+ *	minimal revision 6 FADT pointing to the DSDT and FACS
+ */
+static void gen_fadt_facs(FILE *fp, const config *cfg, const uint64_t dsdt)
+{
+	buffer buf = { NULL, 0, 0 };
+	uint8_t *facs, *fadt;
+	uint64_t facs_addr;
+
+	facs = buf_reserve(&buf, 64);
+	memcpy(facs, "FACS", 4);
+	put_le(facs + 4, 64, 4);
+	facs[32] = 2;				/* version */
+	facs_addr = table_dump(fp, "FACS", &buf);
+
+	table_begin(&buf, "FACP", 6);
+	fadt = buf_reserve(&buf, 276 - ACPI_HDR_SIZE) - ACPI_HDR_SIZE;
+	if (cfg->arm64) {
+		put_le(fadt + 112, 1 << 20, 4);	/* HW_REDUCED_ACPI */
+		put_le(fadt + 129, 0x1, 2);	/* PSCI compliant */
+	} else {
+		fadt[45] = 4;			/* Enterprise server */
+	}
+	fadt[131] = 3;				/* FADT minor version */
+	put_le(fadt + 132, facs_addr, 8);	/* X_FIRMWARE_CTRL */
+	put_le(fadt + 140, dsdt, 8);		/* X_DSDT */
+	table_end(&buf);
+	table_dump(fp, "FACP", &buf);
+}
+
+static void usage(void)
+{
+	printf("Usage: acpigen [options]\n"
+		"Generate synthetic ACPI tables in acpidump format.\n\n"
+		"  -a, --arm64           use GICC rather than x2APIC entries\n"
+		"  -c, --cpus=N          MADT and PPTT processors (default 64)\n"
+		"  -p, --packages=N      PPTT physical packages (default 2)\n"
+		"  -d, --domains=N       SRAT and SLIT proximity domains (default 2)\n"
+		"  -m, --devices=N       DSDT and SSDT devices (default 64)\n"
+		"  -s, --ssdts=N         SSDTs to spread the devices over (default 0)\n"
+		"  -o, --output=FILE     write to FILE rather than stdout\n"
+		"  -h, --help            this help\n");
+}
+
+static int parse_u32(const char *str, uint32_t *val, const uint32_t min, const uint32_t max)
+{
+	char *end;
+	unsigned long tmp;
+
+	errno = 0;
+	tmp = strtoul(str, &end, 0);
+	if (errno || *end || end == str || tmp < min || tmp > max) {
+		fprintf(stderr, "acpigen: invalid value '%s', must be %" PRIu32
+			"..%" PRIu32 "\n", str, min, max);
+		return -1;
+	}
+	*val = (uint32_t)tmp;
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[] = {
+		{ "arm64",	no_argument,		NULL, 'a' },
+		{ "cpus",	required_argument,	NULL, 'c' },
+		{ "packages",	required_argument,	NULL, 'p' },
+		{ "domains",	required_argument,	NULL, 'd' },
+		{ "devices",	required_argument,	NULL, 'm' },
+		{ "ssdts",	required_argument,	NULL, 's' },
+		{ "output",	required_argument,	NULL, 'o' },
+		{ "help",	no_argument,		NULL, 'h' },
+		{ NULL,		0,			NULL, 0 }
+	};
+	config cfg = {
+		.arm64 = false,
+		.cpus = 64,
+		.packages = 2,
+		.domains = 2,
+		.devices = 64,
+		.ssdts = 0,
+	};
+	const char *output = NULL;
+	FILE *fp = stdout;
+	uint64_t dsdt;
+	uint32_t i, per_table;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "ac:p:d:m:s:o:h", long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'a':
+			cfg.arm64 = true;
+			break;
+		case 'c':
+			if (parse_u32(optarg, &cfg.cpus, 1, MAX_CPUS) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'p':
+			if (parse_u32(optarg, &cfg.packages, 1, 1 << 16) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'd':
+			if (parse_u32(optarg, &cfg.domains, 1, 4096) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'm':
+			if (parse_u32(optarg, &cfg.devices, 0, MAX_DEVICES) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 's':
+			if (parse_u32(optarg, &cfg.ssdts, 0, 4096) < 0)
+				return EXIT_FAILURE;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+	if (cfg.packages > cfg.cpus)
+		cfg.packages = cfg.cpus;
+
+	if (output && (fp = fopen(output, "w")) == NULL) {
+		fprintf(stderr, "acpigen: cannot open %s: %s\n", output, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/* Devices are spread evenly over the DSDT and SSDTs */
+	per_table = (cfg.devices + cfg.ssdts) / (cfg.ssdts + 1);
+	dsdt = gen_definition_block(fp, "DSDT", cfg.cpus, 0, per_table < cfg.devices ? per_table : cfg.devices);
+	for (i = 1; i <= cfg.ssdts; i++) {
+		const uint32_t first = i * per_table;
+		const uint32_t last = first + per_table;
+
+		gen_definition_block(fp, "SSDT", 0,
+			first < cfg.devices ? first : cfg.devices,
+			last < cfg.devices ? last : cfg.devices);
+	}
+	gen_fadt_facs(fp, &cfg, dsdt);
+	gen_madt(fp, &cfg);
+	gen_pptt(fp, &cfg);
+	gen_srat_slit(fp, &cfg);
+
+	if (fp != stdout && fclose(fp) != 0) {
+		fprintf(stderr, "acpigen: cannot write %s: %s\n", output, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}